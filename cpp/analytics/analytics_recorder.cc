@@ -32,6 +32,10 @@ namespace {
 const char kVersion[] = "v1.0.0";
 }  // namespace
 
+// C++14 requires to declare this.
+// TODO(apolyudov): remove when migration to c++17 is possible.
+constexpr int AnalyticsRecorder::kMaxPendingEvents;
+
 using ::location::nearby::analytics::proto::ConnectionsLog;
 using ::location::nearby::proto::connections::ACCEPTED;
 using ::location::nearby::proto::connections::ADVERTISER;
@@ -93,12 +97,16 @@ AnalyticsRecorder::AnalyticsRecorder(EventLogger *event_logger)
 }
 
 AnalyticsRecorder::~AnalyticsRecorder() {
+  // Shut down first: chunk drains on serial_executor_ take mutex_.
+  serial_executor_.Shutdown();
+  // Flush whatever serial_executor_ didn't get to, such as the session logged
+  // right before shutting down.
+  DeliverEvents();
   MutexLock lock(&mutex_);
   incoming_connection_requests_.clear();
   outgoing_connection_requests_.clear();
   active_connections_.clear();
   bandwidth_upgrade_attempts_.clear();
-  serial_executor_.Shutdown();
 }
 
 void AnalyticsRecorder::OnStartAdvertising(
@@ -414,6 +422,7 @@ void AnalyticsRecorder::OnConnectionClosed(const std::string &endpoint_id,
   if (!CanRecordAnalyticsLocked("OnConnectionClosed")) {
     return;
   }
+  DrainChunkEventsLocked();
   auto it = active_connections_.find(endpoint_id);
   if (it == active_connections_.end()) {
     return;
@@ -451,16 +460,7 @@ void AnalyticsRecorder::OnIncomingPayloadStarted(
 void AnalyticsRecorder::OnPayloadChunkReceived(const std::string &endpoint_id,
                                                std::int64_t payload_id,
                                                std::int64_t chunk_size_bytes) {
-  MutexLock lock(&mutex_);
-  if (!CanRecordAnalyticsLocked("OnPayloadChunkReceived")) {
-    return;
-  }
-  auto it = active_connections_.find(endpoint_id);
-  if (it == active_connections_.end()) {
-    return;
-  }
-  const std::unique_ptr<LogicalConnection> &logical_connection = it->second;
-  logical_connection->ChunkReceived(payload_id, chunk_size_bytes);
+  OnPayloadChunk(endpoint_id, payload_id, chunk_size_bytes, /*incoming=*/true);
 }
 
 void AnalyticsRecorder::OnIncomingPayloadDone(const std::string &endpoint_id,
@@ -470,6 +470,7 @@ void AnalyticsRecorder::OnIncomingPayloadDone(const std::string &endpoint_id,
   if (!CanRecordAnalyticsLocked("OnIncomingPayloadDone")) {
     return;
   }
+  DrainChunkEventsLocked();
   auto it = active_connections_.find(endpoint_id);
   if (it == active_connections_.end()) {
     return;
@@ -499,16 +500,8 @@ void AnalyticsRecorder::OnOutgoingPayloadStarted(
 void AnalyticsRecorder::OnPayloadChunkSent(const std::string &endpoint_id,
                                            std::int64_t payload_id,
                                            std::int64_t chunk_size_bytes) {
-  MutexLock lock(&mutex_);
-  if (!CanRecordAnalyticsLocked("OnPayloadChunkSent")) {
-    return;
-  }
-  auto it = active_connections_.find(endpoint_id);
-  if (it == active_connections_.end()) {
-    return;
-  }
-  const std::unique_ptr<LogicalConnection> &logical_connection = it->second;
-  logical_connection->ChunkSent(payload_id, chunk_size_bytes);
+  OnPayloadChunk(endpoint_id, payload_id, chunk_size_bytes,
+                 /*incoming=*/false);
 }
 
 void AnalyticsRecorder::OnOutgoingPayloadDone(const std::string &endpoint_id,
@@ -518,6 +511,7 @@ void AnalyticsRecorder::OnOutgoingPayloadDone(const std::string &endpoint_id,
   if (!CanRecordAnalyticsLocked("OnOutgoingPayloadDone")) {
     return;
   }
+  DrainChunkEventsLocked();
   auto it = active_connections_.find(endpoint_id);
   if (it == active_connections_.end()) {
     return;
@@ -613,19 +607,11 @@ void AnalyticsRecorder::OnErrorCode(const ErrorCodeParams &params) {
     }
   }
 
-  serial_executor_.Execute(
-      "analytics-recorder", [this, error_code = error_code.release()]() {
-        ConnectionsLog connections_log;
-        connections_log.set_event_type(ERROR_CODE);
-        connections_log.set_version(kVersion);
-        connections_log.set_allocated_error_code(error_code);
-
-        NEARBY_LOGS(VERBOSE)
-            << "AnalyticsRecorder LogErrorCode connections_log="
-            << connections_log.DebugString();
-
-        event_logger_->Log(connections_log);
-      });
+  ConnectionsLog connections_log;
+  connections_log.set_event_type(ERROR_CODE);
+  connections_log.set_version(kVersion);
+  connections_log.set_allocated_error_code(error_code.release());
+  EnqueueEvent(std::move(connections_log));
 }
 
 void AnalyticsRecorder::LogSession() {
@@ -633,6 +619,7 @@ void AnalyticsRecorder::LogSession() {
   if (!CanRecordAnalyticsLocked("LogSession")) {
     return;
   }
+  DrainChunkEventsLocked();
   FinishStrategySessionLocked();
   client_session_->set_duration_millis(absl::ToInt64Milliseconds(
       SystemClock::ElapsedRealtime() - started_client_session_time_));
@@ -683,33 +670,110 @@ bool AnalyticsRecorder::CanRecordAnalyticsLocked(
   return true;
 }
 
-void AnalyticsRecorder::LogClientSession() {
-  serial_executor_.Execute(
-      "analytics-recorder", [this]() {
-        ConnectionsLog connections_log;
-        connections_log.set_event_type(CLIENT_SESSION);
-        connections_log.set_allocated_client_session(client_session_.release());
-        connections_log.set_version(kVersion);
+void AnalyticsRecorder::OnPayloadChunk(const std::string &endpoint_id,
+                                       std::int64_t payload_id,
+                                       std::int64_t chunk_size_bytes,
+                                       bool incoming) {
+  // The checks of CanRecordAnalyticsLocked(), without the lock or logging.
+  if (event_logger_ == nullptr || session_was_logged_) {
+    return;
+  }
+  if (!chunk_events_.Push(endpoint_id, payload_id, chunk_size_bytes,
+                          incoming)) {
+    MutexLock lock(&mutex_);
+    DrainChunkEventsLocked();
+    RecordChunkLocked(endpoint_id, payload_id, chunk_size_bytes, incoming);
+    return;
+  }
+  // Fold chunks in the background well before the ring fills up.
+  if (chunk_events_.GetSize() >= ChunkEventRing::kCapacity / 2 &&
+      !chunk_drain_scheduled_.exchange(true)) {
+    serial_executor_.Execute("analytics-recorder-chunks", [this]() {
+      MutexLock lock(&mutex_);
+      chunk_drain_scheduled_ = false;
+      DrainChunkEventsLocked();
+    });
+  }
+}
 
-        NEARBY_LOGS(VERBOSE)
-            << "AnalyticsRecorder LogClientSession connections_log="
-            << connections_log.DebugString();
+void AnalyticsRecorder::RecordChunkLocked(const std::string &endpoint_id,
+                                          std::int64_t payload_id,
+                                          std::int64_t chunk_size_bytes,
+                                          bool incoming) {
+  auto it = active_connections_.find(endpoint_id);
+  if (it == active_connections_.end()) {
+    return;
+  }
+  const std::unique_ptr<LogicalConnection> &logical_connection = it->second;
+  if (incoming) {
+    logical_connection->ChunkReceived(payload_id, chunk_size_bytes);
+  } else {
+    logical_connection->ChunkSent(payload_id, chunk_size_bytes);
+  }
+}
+
+void AnalyticsRecorder::DrainChunkEventsLocked() {
+  ChunkEventRing::Event event;
+  while (chunk_events_.Pop(&event)) {
+    RecordChunkLocked(event.GetEndpointId(), event.payload_id,
+                      event.size_bytes, event.incoming);
+  }
+}
 
-        event_logger_->Log(connections_log);
-      });
+void AnalyticsRecorder::LogClientSession() {
+  ConnectionsLog connections_log;
+  connections_log.set_event_type(CLIENT_SESSION);
+  connections_log.set_allocated_client_session(client_session_.release());
+  connections_log.set_version(kVersion);
+  EnqueueEvent(std::move(connections_log));
 }
 
 void AnalyticsRecorder::LogEvent(EventType event_type) {
-  serial_executor_.Execute("analytics-recorder", [this, event_type]() {
-    ConnectionsLog connections_log;
-    connections_log.set_event_type(event_type);
-    connections_log.set_version(kVersion);
+  ConnectionsLog connections_log;
+  connections_log.set_event_type(event_type);
+  connections_log.set_version(kVersion);
+  EnqueueEvent(std::move(connections_log));
+}
+
+void AnalyticsRecorder::EnqueueEvent(ConnectionsLog connections_log) {
+  MutexLock lock(&event_mutex_);
+  EventType event_type = connections_log.event_type();
+  if (pending_events_.size() >= static_cast<std::size_t>(kMaxPendingEvents) &&
+      event_type != CLIENT_SESSION && event_type != STOP_CLIENT_SESSION) {
+    dropped_events_++;
+    return;
+  }
+  pending_events_.push_back(std::move(connections_log));
+  if (!delivery_scheduled_) {
+    delivery_scheduled_ = true;
+    serial_executor_.Execute("analytics-recorder",
+                             [this]() { DeliverEvents(); });
+  }
+}
 
+void AnalyticsRecorder::DeliverEvents() {
+  std::vector<ConnectionsLog> events;
+  {
+    MutexLock lock(&event_mutex_);
+    events.swap(pending_events_);
+    delivery_scheduled_ = false;
+    if (dropped_events_ > reported_dropped_events_) {
+      NEARBY_LOGS(WARNING) << "AnalyticsRecorder dropped "
+                           << dropped_events_ - reported_dropped_events_
+                           << " events waiting for a slow EventLogger.";
+      reported_dropped_events_ = dropped_events_;
+    }
+  }
+  for (const ConnectionsLog &connections_log : events) {
     NEARBY_LOGS(VERBOSE) << "AnalyticsRecorder LogEvent connections_log="
                          << connections_log.DebugString();
-
     event_logger_->Log(connections_log);
-  });
+  }
+}
+
+std::int64_t AnalyticsRecorder::GetDroppedEventCount() const {
+  MutexLock lock(&event_mutex_);
+  return dropped_events_;
 }
 
 void AnalyticsRecorder::UpdateStrategySessionLocked(
@@ -15,10 +15,14 @@
 #ifndef ANALYTICS_ANALYTICS_RECORDER_H_
 #define ANALYTICS_ANALYTICS_RECORDER_H_
 
+#include <atomic>
+#include <cstdint>
 #include <string>
+#include <vector>
 
 #include "absl/container/btree_map.h"
 #include "absl/time/time.h"
+#include "analytics/chunk_event_ring.h"
 #include "analytics/connection_attempt_metadata_params.h"
 #include "core/event_logger.h"
 #include "core/payload.h"
@@ -35,6 +39,9 @@ namespace analytics {
 
 class AnalyticsRecorder {
  public:
+  // Maximum number of events waiting to be delivered to the EventLogger.
+  static constexpr int kMaxPendingEvents = 256;
+
   explicit AnalyticsRecorder(EventLogger *event_logger);
   virtual ~AnalyticsRecorder();
 
@@ -121,6 +128,9 @@ class AnalyticsRecorder {
                                 connections::Payload::Type type,
                                 std::int64_t total_size_bytes)
       ABSL_LOCKS_EXCLUDED(mutex_);
+  // Chunks are only queued here, without taking mutex_ unless the queue is
+  // full; they're folded into the session in the background, and before any
+  // call that reads them.
   void OnPayloadChunkReceived(const std::string &endpoint_id,
                               std::int64_t payload_id,
                               std::int64_t chunk_size_bytes)
@@ -134,6 +144,7 @@ class AnalyticsRecorder {
                                 connections::Payload::Type type,
                                 std::int64_t total_size_bytes)
       ABSL_LOCKS_EXCLUDED(mutex_);
+  // Same as OnPayloadChunkReceived().
   void OnPayloadChunkSent(const std::string &endpoint_id,
                           std::int64_t payload_id,
                           std::int64_t chunk_size_bytes)
@@ -167,6 +178,11 @@ class AnalyticsRecorder {
   // execution.
   void LogSession() ABSL_LOCKS_EXCLUDED(mutex_);
 
+  // Number of events dropped because kMaxPendingEvents were already waiting
+  // for a slow EventLogger.
+  std::int64_t GetDroppedEventCount() const
+      ABSL_LOCKS_EXCLUDED(event_mutex_);
+
  private:
   // Tracks the chunks and duration of a Payload on a particular medium.
   class PendingPayload {
@@ -268,12 +284,33 @@ class AnalyticsRecorder {
   bool CanRecordAnalyticsLocked(const std::string &method_name)
       ABSL_SHARED_LOCKS_REQUIRED(mutex_);
 
+  // Queues a chunk on chunk_events_, or records it right away if it can't be
+  // queued.
+  void OnPayloadChunk(const std::string &endpoint_id, std::int64_t payload_id,
+                      std::int64_t chunk_size_bytes, bool incoming)
+      ABSL_LOCKS_EXCLUDED(mutex_);
+  void RecordChunkLocked(const std::string &endpoint_id,
+                         std::int64_t payload_id,
+                         std::int64_t chunk_size_bytes, bool incoming)
+      ABSL_EXCLUSIVE_LOCKS_REQUIRED(mutex_);
+  // Folds all queued chunks into their payloads.
+  void DrainChunkEventsLocked() ABSL_EXCLUSIVE_LOCKS_REQUIRED(mutex_);
+
   // Callbacks the ConnectionsLog proto byte array data to the EventLogger with
   // ClientSession sub-proto.
-  void LogClientSession();
+  void LogClientSession() ABSL_EXCLUSIVE_LOCKS_REQUIRED(mutex_);
   // Callbacks the ConnectionsLog proto byte array data to the EventLogger.
   void LogEvent(location::nearby::proto::connections::EventType event_type);
 
+  // Queues |connections_log| for delivery to event_logger_ on
+  // serial_executor_, where queued events are delivered in batches. Once
+  // kMaxPendingEvents are queued, further events are dropped, except for the
+  // client session itself and STOP_CLIENT_SESSION.
+  void EnqueueEvent(proto::ConnectionsLog connections_log)
+      ABSL_LOCKS_EXCLUDED(event_mutex_);
+  // Delivers all queued events to event_logger_.
+  void DeliverEvents() ABSL_LOCKS_EXCLUDED(event_mutex_);
+
   void UpdateStrategySessionLocked(
       connections::Strategy strategy,
       location::nearby::proto::connections::SessionRole role)
@@ -325,11 +362,27 @@ class AnalyticsRecorder {
   // Protects all sub-protos reading and writing in ConnectionLog.
   Mutex mutex_;
 
+  // Events waiting for serial_executor_ to deliver them. Never held while
+  // calling event_logger_.
+  mutable Mutex event_mutex_;
+  std::vector<proto::ConnectionsLog> pending_events_
+      ABSL_GUARDED_BY(event_mutex_);
+  bool delivery_scheduled_ ABSL_GUARDED_BY(event_mutex_) = false;
+  std::int64_t dropped_events_ ABSL_GUARDED_BY(event_mutex_) = 0;
+  // Value of dropped_events_ when drops were last reported in the log.
+  std::int64_t reported_dropped_events_ ABSL_GUARDED_BY(event_mutex_) = 0;
+
   // ClientSession
   std::unique_ptr<proto::ConnectionsLog::ClientSession> client_session_ =
       absl::make_unique<proto::ConnectionsLog::ClientSession>();
   absl::Time started_client_session_time_;
-  bool session_was_logged_ ABSL_GUARDED_BY(mutex_) = false;
+  // Written under mutex_, but also read by OnPayloadChunk() without it.
+  std::atomic_bool session_was_logged_{false};
+
+  // Chunks reported without taking mutex_. Only popped under mutex_.
+  ChunkEventRing chunk_events_;
+  // Whether a background drain of chunk_events_ is already scheduled.
+  std::atomic_bool chunk_drain_scheduled_{false};
 
   // Current StrategySession
   connections::Strategy current_strategy_ ABSL_GUARDED_BY(mutex_) =
@@ -110,6 +110,31 @@ class FakeEventLogger : public EventLogger {
   std::vector<EventType> logged_event_types_;
 };
 
+// Blocks in its first Log() call until released.
+class BlockingEventLogger : public EventLogger {
+ public:
+  void Log(const ConnectionsLog& connections_log) override {
+    if (!blocked_once_) {
+      blocked_once_ = true;
+      blocked_latch_.CountDown();
+      release_latch_.Await();
+    }
+    EventType event_type = connections_log.event_type();
+    if (event_type == ERROR_CODE) error_code_count_++;
+    if (event_type == CLIENT_SESSION) client_session_count_++;
+    if (event_type == STOP_CLIENT_SESSION) {
+      client_session_done_latch_.CountDown();
+    }
+  }
+
+  CountDownLatch blocked_latch_{1};
+  CountDownLatch release_latch_{1};
+  CountDownLatch client_session_done_latch_{1};
+  bool blocked_once_ = false;
+  int error_code_count_ = 0;
+  int client_session_count_ = 0;
+};
+
 TEST(AnalyticsRecorderTest, SessionOnlyLoggedOnceWorks) {
   CountDownLatch client_session_done_latch(1);
   FakeEventLogger event_logger(client_session_done_latch);
@@ -780,6 +805,42 @@ TEST(AnalyticsRecorderTest, OutgoingPayloadUpgraded) {
                 >)pb")));
 }
 
+TEST(AnalyticsRecorderTest, CountsChunksBeyondChunkEventRingCapacity) {
+  std::string endpoint_id = "endpoint_id";
+  std::int64_t payload_id = 123456789;
+  int num_chunks = 3 * ChunkEventRing::kCapacity;
+
+  CountDownLatch client_session_done_latch(1);
+  FakeEventLogger event_logger(client_session_done_latch);
+  AnalyticsRecorder analytics_recorder(&event_logger);
+
+  analytics_recorder.OnStartAdvertising(connections::Strategy::kP2pStar,
+                                        {BLUETOOTH});
+  analytics_recorder.OnConnectionEstablished(endpoint_id, BLUETOOTH,
+                                             "connection_token");
+  analytics_recorder.OnIncomingPayloadStarted(
+      endpoint_id, payload_id, connections::Payload::Type::kBytes,
+      num_chunks);
+  for (int i = 0; i < num_chunks; i++) {
+    analytics_recorder.OnPayloadChunkReceived(endpoint_id, payload_id, 1);
+  }
+  analytics_recorder.OnIncomingPayloadDone(endpoint_id, payload_id, SUCCESS);
+  analytics_recorder.OnConnectionClosed(endpoint_id, BLUETOOTH,
+                                        LOCAL_DISCONNECTION);
+
+  analytics_recorder.LogSession();
+  ASSERT_TRUE(client_session_done_latch.Await(kDefaultTimeout).result());
+
+  const ConnectionsLog::Payload& payload =
+      event_logger.GetLoggedClientSession()
+          .strategy_session(0)
+          .established_connection(0)
+          .received_payload(0);
+  EXPECT_EQ(payload.num_chunks(), num_chunks);
+  EXPECT_EQ(payload.num_bytes_transferred(), num_chunks);
+  EXPECT_EQ(payload.status(), SUCCESS);
+}
+
 TEST(AnalyticsRecorderTest, UpgradeAttemptWorks) {
   connections::Strategy strategy = connections::Strategy::kP2pStar;
   std::vector<Medium> mediums = {BLE, BLUETOOTH};
@@ -878,6 +939,42 @@ TEST(AnalyticsRecorderTest, SetErrorCodeFieldsCorrectly) {
               )pb")));
 }
 
+TEST(AnalyticsRecorderTest, DropsEventsForSlowEventLoggerButKeepsSession) {
+  BlockingEventLogger event_logger;
+  AnalyticsRecorder analytics_recorder(&event_logger);
+  // START_CLIENT_SESSION is being delivered, and blocks delivery.
+  ASSERT_TRUE(event_logger.blocked_latch_.Await(kDefaultTimeout).result());
+
+  ErrorCodeParams error_code_params = ErrorCodeRecorder::BuildErrorCodeParams(
+      WEB_RTC, DISCONNECT, DISCONNECT_NETWORK_FAILED,
+      TACHYON_SEND_MESSAGE_STATUS_EXCEPTION, "", "connection_token");
+  for (int i = 0; i < AnalyticsRecorder::kMaxPendingEvents + 5; i++) {
+    analytics_recorder.OnErrorCode(error_code_params);
+  }
+  EXPECT_EQ(analytics_recorder.GetDroppedEventCount(), 5);
+
+  analytics_recorder.LogSession();
+  event_logger.release_latch_.CountDown();
+  ASSERT_TRUE(
+      event_logger.client_session_done_latch_.Await(kDefaultTimeout).result());
+
+  EXPECT_EQ(event_logger.error_code_count_,
+            AnalyticsRecorder::kMaxPendingEvents);
+  EXPECT_EQ(event_logger.client_session_count_, 1);
+}
+
+TEST(AnalyticsRecorderTest, FlushesSessionOnDestruction) {
+  CountDownLatch client_session_done_latch(1);
+  FakeEventLogger event_logger(client_session_done_latch);
+  {
+    AnalyticsRecorder analytics_recorder(&event_logger);
+    analytics_recorder.LogSession();
+  }
+
+  EXPECT_TRUE(client_session_done_latch.Await(absl::ZeroDuration()).result());
+  EXPECT_EQ(event_logger.GetLoggedClientSessionCount(), 1);
+}
+
 TEST(AnalyticsRecorderTest, SetErrorCodeFieldsCorrectlyForUnknownDescription) {
   connections::Strategy strategy = connections::Strategy::kP2pStar;
   std::vector<Medium> mediums = {BLUETOOTH};
@@ -0,0 +1,98 @@
+// Copyright 2021 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "analytics/chunk_event_ring.h"
+
+#include <cstdint>
+#include <cstring>
+
+namespace location {
+namespace nearby {
+namespace analytics {
+
+// C++14 requires to declare this.
+// TODO(apolyudov): remove when migration to c++17 is possible.
+constexpr std::size_t ChunkEventRing::kCapacity;
+constexpr std::size_t ChunkEventRing::kMaxEndpointIdSize;
+
+static_assert((ChunkEventRing::kCapacity & (ChunkEventRing::kCapacity - 1)) ==
+                  0,
+              "kCapacity must be a power of 2");
+
+ChunkEventRing::ChunkEventRing() {
+  for (std::size_t i = 0; i < kCapacity; i++) {
+    slots_[i].sequence.store(i, std::memory_order_relaxed);
+  }
+}
+
+bool ChunkEventRing::Push(const std::string& endpoint_id,
+                          std::int64_t payload_id, std::int64_t size_bytes,
+                          bool incoming) {
+  if (endpoint_id.size() > kMaxEndpointIdSize) return false;
+
+  std::size_t position = push_position_.load(std::memory_order_relaxed);
+  Slot* slot;
+  while (true) {
+    slot = &slots_[position & (kCapacity - 1)];
+    std::size_t sequence = slot->sequence.load(std::memory_order_acquire);
+    auto difference = static_cast<std::intptr_t>(sequence - position);
+    if (difference == 0) {
+      // The slot is free; claim it.
+      if (push_position_.compare_exchange_weak(position, position + 1,
+                                               std::memory_order_relaxed)) {
+        break;
+      }
+    } else if (difference < 0) {
+      // The consumer hasn't freed this slot yet: the ring is full.
+      return false;
+    } else {
+      // Another producer claimed the slot first.
+      position = push_position_.load(std::memory_order_relaxed);
+    }
+  }
+
+  Event& event = slot->event;
+  event.payload_id = payload_id;
+  event.size_bytes = size_bytes;
+  event.incoming = incoming;
+  event.endpoint_id_size = static_cast<std::uint8_t>(endpoint_id.size());
+  std::memcpy(event.endpoint_id, endpoint_id.data(), endpoint_id.size());
+  // Publish the event to the consumer.
+  slot->sequence.store(position + 1, std::memory_order_release);
+  return true;
+}
+
+bool ChunkEventRing::Pop(Event* event) {
+  std::size_t position = pop_position_.load(std::memory_order_relaxed);
+  Slot* slot = &slots_[position & (kCapacity - 1)];
+  if (slot->sequence.load(std::memory_order_acquire) != position + 1) {
+    // Empty, or the producer of the next event hasn't published it yet.
+    return false;
+  }
+  *event = slot->event;
+  pop_position_.store(position + 1, std::memory_order_relaxed);
+  // Hand the slot back to producers, one lap later.
+  slot->sequence.store(position + kCapacity, std::memory_order_release);
+  return true;
+}
+
+std::size_t ChunkEventRing::GetSize() const {
+  std::size_t push_position = push_position_.load(std::memory_order_relaxed);
+  std::size_t pop_position = pop_position_.load(std::memory_order_relaxed);
+  return push_position > pop_position ? push_position - pop_position : 0;
+}
+
+}  // namespace analytics
+}  // namespace nearby
+}  // namespace location
@@ -0,0 +1,85 @@
+// Copyright 2021 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef ANALYTICS_CHUNK_EVENT_RING_H_
+#define ANALYTICS_CHUNK_EVENT_RING_H_
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+namespace location {
+namespace nearby {
+namespace analytics {
+
+// A fixed-size, lock-free queue of payload chunk events, so that threads
+// sending and receiving payloads can report chunks to AnalyticsRecorder
+// without taking its mutex or allocating.
+//
+// Any number of threads may Push(); only one thread at a time may Pop().
+// Based on Dmitry Vyukov's bounded MPMC queue: each slot carries a sequence
+// number that tells producers and the consumer whose turn it is.
+class ChunkEventRing {
+ public:
+  // Must be a power of 2.
+  static constexpr std::size_t kCapacity = 512;
+  // Longer endpoint IDs can't be queued; see Push().
+  static constexpr std::size_t kMaxEndpointIdSize = 16;
+
+  struct Event {
+    std::string GetEndpointId() const {
+      return std::string(endpoint_id, endpoint_id_size);
+    }
+
+    std::int64_t payload_id = 0;
+    std::int64_t size_bytes = 0;
+    bool incoming = false;
+    std::uint8_t endpoint_id_size = 0;
+    char endpoint_id[kMaxEndpointIdSize] = {};
+  };
+
+  ChunkEventRing();
+  ChunkEventRing(const ChunkEventRing&) = delete;
+  ChunkEventRing& operator=(const ChunkEventRing&) = delete;
+
+  // Queues a chunk event. Returns false, without queueing it, if the ring is
+  // full or |endpoint_id| is longer than kMaxEndpointIdSize.
+  bool Push(const std::string& endpoint_id, std::int64_t payload_id,
+            std::int64_t size_bytes, bool incoming);
+
+  // Takes the oldest event off the ring. Returns false if there is none.
+  bool Pop(Event* event);
+
+  // Number of queued events; only exact when no other thread is using the
+  // ring.
+  std::size_t GetSize() const;
+
+ private:
+  struct Slot {
+    std::atomic<std::size_t> sequence{0};
+    Event event;
+  };
+
+  Slot slots_[kCapacity];
+  // Kept apart so producers and the consumer don't share a cache line.
+  alignas(64) std::atomic<std::size_t> push_position_{0};
+  alignas(64) std::atomic<std::size_t> pop_position_{0};
+};
+
+}  // namespace analytics
+}  // namespace nearby
+}  // namespace location
+
+#endif  // ANALYTICS_CHUNK_EVENT_RING_H_
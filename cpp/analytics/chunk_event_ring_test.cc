@@ -0,0 +1,108 @@
+// Copyright 2021 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "analytics/chunk_event_ring.h"
+
+#include <memory>
+#include <string>
+#include <thread>  // NOLINT
+#include <vector>
+
+#include "gtest/gtest.h"
+
+namespace location {
+namespace nearby {
+namespace analytics {
+namespace {
+
+TEST(ChunkEventRingTest, PopsEventsInOrder) {
+  ChunkEventRing ring;
+  ChunkEventRing::Event event;
+
+  EXPECT_FALSE(ring.Pop(&event));
+  ASSERT_TRUE(ring.Push("ABCD", /*payload_id=*/1, /*size_bytes=*/10,
+                        /*incoming=*/true));
+  ASSERT_TRUE(ring.Push("EFGH", /*payload_id=*/2, /*size_bytes=*/20,
+                        /*incoming=*/false));
+  EXPECT_EQ(ring.GetSize(), 2);
+
+  ASSERT_TRUE(ring.Pop(&event));
+  EXPECT_EQ(event.GetEndpointId(), "ABCD");
+  EXPECT_EQ(event.payload_id, 1);
+  EXPECT_EQ(event.size_bytes, 10);
+  EXPECT_TRUE(event.incoming);
+  ASSERT_TRUE(ring.Pop(&event));
+  EXPECT_EQ(event.GetEndpointId(), "EFGH");
+  EXPECT_EQ(event.payload_id, 2);
+  EXPECT_FALSE(event.incoming);
+  EXPECT_FALSE(ring.Pop(&event));
+}
+
+TEST(ChunkEventRingTest, RejectsEventsWhenFull) {
+  ChunkEventRing ring;
+  for (std::size_t i = 0; i < ChunkEventRing::kCapacity; i++) {
+    ASSERT_TRUE(ring.Push("ABCD", i, 1, true));
+  }
+
+  EXPECT_FALSE(ring.Push("ABCD", 0, 1, true));
+
+  ChunkEventRing::Event event;
+  ASSERT_TRUE(ring.Pop(&event));
+  EXPECT_EQ(event.payload_id, 0);
+  EXPECT_TRUE(ring.Push("ABCD", 0, 1, true));
+}
+
+TEST(ChunkEventRingTest, RejectsLongEndpointIds) {
+  ChunkEventRing ring;
+
+  EXPECT_FALSE(ring.Push(
+      std::string(ChunkEventRing::kMaxEndpointIdSize + 1, 'A'), 1, 1, true));
+  EXPECT_TRUE(ring.Push(std::string(ChunkEventRing::kMaxEndpointIdSize, 'A'),
+                        1, 1, true));
+}
+
+TEST(ChunkEventRingTest, ConcurrentProducersLoseNothing) {
+  constexpr int kProducers = 4;
+  constexpr int kEventsPerProducer = 10000;
+  auto ring = std::make_unique<ChunkEventRing>();
+  std::vector<std::thread> producers;
+  for (int i = 0; i < kProducers; i++) {
+    producers.emplace_back([&ring, i]() {
+      for (int j = 0; j < kEventsPerProducer; j++) {
+        while (!ring->Push("ABCD", i, 1, true)) {
+          std::this_thread::yield();
+        }
+      }
+    });
+  }
+
+  std::vector<int> counts(kProducers);
+  int popped = 0;
+  ChunkEventRing::Event event;
+  while (popped < kProducers * kEventsPerProducer) {
+    if (ring->Pop(&event)) {
+      counts[event.payload_id] += event.size_bytes;
+      popped++;
+    }
+  }
+  for (auto& producer : producers) producer.join();
+
+  for (int count : counts) EXPECT_EQ(count, kEventsPerProducer);
+  EXPECT_FALSE(ring->Pop(&event));
+}
+
+}  // namespace
+}  // namespace analytics
+}  // namespace nearby
+}  // namespace location
@@ -0,0 +1,58 @@
+// Copyright 2021 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "benchmarks/allocation_counter.h"
+
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+namespace {
+
+std::atomic<std::int64_t> allocation_count{0};
+
+}  // namespace
+
+void* operator new(std::size_t size) {
+  allocation_count.fetch_add(1, std::memory_order_relaxed);
+  void* pointer = std::malloc(size == 0 ? 1 : size);
+  if (pointer == nullptr) std::abort();
+  return pointer;
+}
+
+void operator delete(void* pointer) noexcept { std::free(pointer); }
+
+void operator delete(void* pointer, std::size_t) noexcept {
+  std::free(pointer);
+}
+
+namespace location {
+namespace nearby {
+namespace benchmarks {
+
+AllocationCounter::AllocationCounter()
+    : start_(allocation_count.load(std::memory_order_relaxed)) {}
+
+std::int64_t AllocationCounter::GetCount() const {
+  return allocation_count.load(std::memory_order_relaxed) - start_;
+}
+
+void AllocationCounter::Report(benchmark::State& state) const {
+  state.counters["allocs/op"] = benchmark::Counter(
+      static_cast<double>(GetCount()), benchmark::Counter::kAvgIterations);
+}
+
+}  // namespace benchmarks
+}  // namespace nearby
+}  // namespace location
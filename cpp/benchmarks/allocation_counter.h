@@ -0,0 +1,48 @@
+// Copyright 2021 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef BENCHMARKS_ALLOCATION_COUNTER_H_
+#define BENCHMARKS_ALLOCATION_COUNTER_H_
+
+#include <cstdint>
+
+#include "benchmark/benchmark.h"
+
+namespace location {
+namespace nearby {
+namespace benchmarks {
+
+// Counts calls to the global operator new, which this library replaces.
+// The count covers all threads, so allocations made by executor and pipe
+// threads on behalf of the benchmarked operation are included.
+class AllocationCounter {
+ public:
+  // Starts counting from now.
+  AllocationCounter();
+
+  std::int64_t GetCount() const;
+
+  // Reports the allocations counted so far as "allocs/op", averaged over the
+  // iterations of |state|.
+  void Report(benchmark::State& state) const;
+
+ private:
+  std::int64_t start_;
+};
+
+}  // namespace benchmarks
+}  // namespace nearby
+}  // namespace location
+
+#endif  // BENCHMARKS_ALLOCATION_COUNTER_H_
@@ -0,0 +1,75 @@
+// Copyright 2021 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <string>
+
+#include "benchmark/benchmark.h"
+#include "benchmarks/allocation_counter.h"
+#include "core/internal/ble_advertisement.h"
+#include "platform/base/byte_array.h"
+
+namespace location {
+namespace nearby {
+namespace connections {
+namespace {
+
+using ::location::nearby::benchmarks::AllocationCounter;
+
+constexpr BleAdvertisement::Version kVersion = BleAdvertisement::Version::kV1;
+constexpr Pcp kPcp = Pcp::kP2pCluster;
+constexpr char kServiceIdHash[] = "\x0a\x0b\x0c";
+constexpr char kEndpointId[] = "AB12";
+constexpr char kBluetoothMacAddress[] = "00:00:E6:88:64:13";
+
+BleAdvertisement MakeAdvertisement(bool fast) {
+  if (fast) {
+    return BleAdvertisement(kVersion, kPcp, kEndpointId,
+                            ByteArray(std::string(
+                                BleAdvertisement::kMaxFastEndpointInfoLength,
+                                'x')),
+                            ByteArray{});
+  }
+  return BleAdvertisement(
+      kVersion, kPcp, ByteArray(std::string(kServiceIdHash)), kEndpointId,
+      ByteArray(std::string(BleAdvertisement::kMaxEndpointInfoLength, 'x')),
+      kBluetoothMacAddress, ByteArray{}, WebRtcState::kConnectable);
+}
+
+void BM_BleAdvertisementSerialize(benchmark::State& state) {
+  BleAdvertisement advertisement = MakeAdvertisement(state.range(0));
+  AllocationCounter allocations;
+  for (auto _ : state) {
+    ByteArray bytes(advertisement);
+    benchmark::DoNotOptimize(bytes);
+  }
+  allocations.Report(state);
+}
+BENCHMARK(BM_BleAdvertisementSerialize)->ArgName("fast")->Arg(0)->Arg(1);
+
+void BM_BleAdvertisementParse(benchmark::State& state) {
+  bool fast = state.range(0);
+  ByteArray bytes(MakeAdvertisement(fast));
+  AllocationCounter allocations;
+  for (auto _ : state) {
+    BleAdvertisement advertisement(fast, bytes);
+    benchmark::DoNotOptimize(advertisement);
+  }
+  allocations.Report(state);
+}
+BENCHMARK(BM_BleAdvertisementParse)->ArgName("fast")->Arg(0)->Arg(1);
+
+}  // namespace
+}  // namespace connections
+}  // namespace nearby
+}  // namespace location
@@ -0,0 +1,91 @@
+// Copyright 2021 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <string>
+#include <vector>
+
+#include "benchmark/benchmark.h"
+#include "absl/strings/str_cat.h"
+#include "absl/strings/string_view.h"
+#include "benchmarks/allocation_counter.h"
+#include "core/internal/mediums/bloom_filter.h"
+
+namespace location {
+namespace nearby {
+namespace connections {
+namespace {
+
+using ::location::nearby::benchmarks::AllocationCounter;
+using ::location::nearby::connections::mediums::BloomFilter;
+
+// BleAdvertisementHeader::kServiceIdBloomFilterLength.
+constexpr size_t kBloomFilterLength = 10;
+
+std::vector<std::string> MakeServiceIds(const std::string& prefix) {
+  std::vector<std::string> service_ids;
+  for (int i = 0; i < 64; i++) {
+    service_ids.push_back(absl::StrCat(prefix, ".service_id.", i));
+  }
+  return service_ids;
+}
+
+void BM_BloomFilterAdd(benchmark::State& state) {
+  std::vector<std::string> service_ids = MakeServiceIds("com.google.added");
+  BloomFilter<kBloomFilterLength> bloom_filter;
+  AllocationCounter allocations;
+  size_t i = 0;
+  for (auto _ : state) {
+    bloom_filter.Add(service_ids[i++ % service_ids.size()]);
+  }
+  allocations.Report(state);
+}
+BENCHMARK(BM_BloomFilterAdd);
+
+void BM_BloomFilterPossiblyContains(benchmark::State& state) {
+  std::vector<std::string> added = MakeServiceIds("com.google.added");
+  std::vector<std::string> missing = MakeServiceIds("com.google.missing");
+  BloomFilter<kBloomFilterLength> bloom_filter;
+  for (int i = 0; i < 4; i++) bloom_filter.Add(added[i]);
+  // Discovery mostly checks service IDs that aren't being advertised.
+  const std::vector<std::string>& queries = state.range(0) ? added : missing;
+  AllocationCounter allocations;
+  size_t i = 0;
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(
+        bloom_filter.PossiblyContains(queries[i++ % 4]));
+  }
+  allocations.Report(state);
+}
+BENCHMARK(BM_BloomFilterPossiblyContains)->ArgName("hit")->Arg(0)->Arg(1);
+
+void BM_BloomFilterPossiblyContainsAny(benchmark::State& state) {
+  std::vector<std::string> added = MakeServiceIds("com.google.added");
+  std::vector<std::string> missing = MakeServiceIds("com.google.missing");
+  BloomFilter<kBloomFilterLength> bloom_filter;
+  for (int i = 0; i < 4; i++) bloom_filter.Add(added[i]);
+  // The service IDs a client is discovering, none of them advertised.
+  std::vector<absl::string_view> queries(missing.begin(),
+                                         missing.begin() + state.range(0));
+  AllocationCounter allocations;
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(bloom_filter.PossiblyContainsAny(queries));
+  }
+  allocations.Report(state);
+}
+BENCHMARK(BM_BloomFilterPossiblyContainsAny)->Range(1, 64);
+
+}  // namespace
+}  // namespace connections
+}  // namespace nearby
+}  // namespace location
@@ -0,0 +1,106 @@
+// Copyright 2021 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// Perf regression gate: runs each topology with a handful of simulated users
+// and fails if the run goes over its thresholds. The thresholds are loose
+// enough for sanitizer builds on shared CI machines; they are meant to catch
+// regressions by a factor, not by a few percent.
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+#include "absl/time/time.h"
+#include "benchmarks/load_test.h"
+#include "platform/public/logging.h"
+
+namespace location {
+namespace nearby {
+namespace benchmarks {
+namespace {
+
+using ::testing::IsEmpty;
+
+constexpr LoadTestThresholds kThresholds{
+    .min_throughput_bytes_per_second = 64 * 1024,
+    .max_connection_latency_p99 = absl::Seconds(5),
+    .max_threads = 1000,
+    .max_peak_rss_bytes = std::int64_t{2} * 1024 * 1024 * 1024,
+    .max_allocations_per_connection = 200000,
+};
+
+LoadTestReport RunAndLog(const LoadTestOptions& options) {
+  LoadTestReport report = RunLoadTest(options);
+  NEARBY_LOGS(INFO) << "Load test report:\n" << report.ToString();
+  return report;
+}
+
+TEST(ConnectionsLoadTest, PointToPoint) {
+  LoadTestReport report = RunAndLog({
+      .users = 8,
+      .topology = LoadTestTopology::kPointToPoint,
+      .payloads_per_connection = 4,
+      .payload_size = 64 * 1024,
+  });
+
+  EXPECT_EQ(report.connections_requested, 4);
+  EXPECT_THAT(CheckThresholds(report, kThresholds), IsEmpty());
+}
+
+TEST(ConnectionsLoadTest, Star) {
+  LoadTestReport report = RunAndLog({
+      .users = 8,
+      .topology = LoadTestTopology::kStar,
+      .payloads_per_connection = 4,
+      .payload_size = 64 * 1024,
+  });
+
+  EXPECT_EQ(report.connections_requested, 7);
+  EXPECT_THAT(CheckThresholds(report, kThresholds), IsEmpty());
+}
+
+TEST(ConnectionsLoadTest, Cluster) {
+  LoadTestReport report = RunAndLog({
+      .users = 8,
+      .topology = LoadTestTopology::kCluster,
+      .cluster_size = 4,
+      .payloads_per_connection = 4,
+      .payload_size = 64 * 1024,
+  });
+
+  // Two clusters of four, with six connections each.
+  EXPECT_EQ(report.connections_requested, 12);
+  EXPECT_THAT(CheckThresholds(report, kThresholds), IsEmpty());
+}
+
+TEST(ConnectionsLoadTest, ReportsRunsOverThresholds) {
+  LoadTestReport report{
+      .connections_requested = 2,
+      .connections_established = 1,
+      .payloads_sent = 2,
+      .payloads_received = 2,
+      .throughput_bytes_per_second = 1,
+      .connection_latency_p99 = absl::Seconds(10),
+  };
+
+  EXPECT_EQ(CheckThresholds(report, LoadTestThresholds()).size(), 1);
+  EXPECT_EQ(CheckThresholds(report, kThresholds).size(), 3);
+}
+
+}  // namespace
+}  // namespace benchmarks
+}  // namespace nearby
+}  // namespace location
@@ -0,0 +1,137 @@
+// Copyright 2021 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <memory>
+#include <string>
+#include <utility>
+
+#include "securegcm/ukey2_handshake.h"
+#include "benchmark/benchmark.h"
+#include "absl/time/time.h"
+#include "benchmarks/allocation_counter.h"
+#include "core/internal/base_endpoint_channel.h"
+#include "core/internal/client_proxy.h"
+#include "core/internal/encryption_runner.h"
+#include "platform/base/byte_array.h"
+#include "platform/public/count_down_latch.h"
+#include "platform/public/pipe.h"
+#include "proto/connections_enums.pb.h"
+
+namespace location {
+namespace nearby {
+namespace connections {
+namespace {
+
+using ::location::nearby::benchmarks::AllocationCounter;
+using ::location::nearby::proto::connections::Medium;
+using EncryptionContext = BaseEndpointChannel::EncryptionContext;
+
+class BenchmarkEndpointChannel : public BaseEndpointChannel {
+ public:
+  BenchmarkEndpointChannel(InputStream* input, OutputStream* output)
+      : BaseEndpointChannel("benchmark", input, output) {}
+
+  Medium GetMedium() const override { return Medium::BLUETOOTH; }
+
+ private:
+  void CloseImpl() override {}
+};
+
+// A pair of channels connected through Pipes; |a| writes what |b| reads, and
+// the other way around.
+struct ChannelPair {
+  ChannelPair()
+      : a(&b_to_a.GetInputStream(), &a_to_b.GetOutputStream()),
+        b(&a_to_b.GetInputStream(), &b_to_a.GetOutputStream()) {}
+
+  // Runs a UKEY2 handshake between the channels and enables encryption on
+  // both. Returns false if the handshake fails.
+  bool Encrypt() {
+    std::shared_ptr<EncryptionContext> context_a;
+    std::shared_ptr<EncryptionContext> context_b;
+    EncryptionRunner runner_a;
+    EncryptionRunner runner_b;
+    ClientProxy proxy_a;
+    ClientProxy proxy_b;
+    CountDownLatch latch(2);
+    auto listener = [&latch](std::shared_ptr<EncryptionContext>* context) {
+      return EncryptionRunner::ResultListener{
+          .on_success_cb =
+              [&latch, context](
+                  const std::string& endpoint_id,
+                  std::unique_ptr<securegcm::UKey2Handshake> ukey2,
+                  const std::string& auth_token,
+                  const ByteArray& raw_auth_token) {
+                if (ukey2->VerifyHandshake()) {
+                  *context = ukey2->ToConnectionContext();
+                }
+                latch.CountDown();
+              },
+          .on_failure_cb =
+              [&latch](const std::string& endpoint_id,
+                       EndpointChannel* channel) { latch.CountDown(); },
+      };
+    };
+    runner_a.StartClient(&proxy_a, "endpoint_b", &a, listener(&context_a));
+    runner_b.StartServer(&proxy_b, "endpoint_a", &b, listener(&context_b));
+    if (!latch.Await(absl::Seconds(5)).result() || !context_a || !context_b) {
+      return false;
+    }
+    a.EnableEncryption(std::move(context_a));
+    b.EnableEncryption(std::move(context_b));
+    return true;
+  }
+
+  Pipe a_to_b;
+  Pipe b_to_a;
+  BenchmarkEndpointChannel a;
+  BenchmarkEndpointChannel b;
+};
+
+void RunWriteRead(benchmark::State& state, ChannelPair& channels) {
+  ByteArray message(std::string(state.range(0), 'x'));
+  AllocationCounter allocations;
+  for (auto _ : state) {
+    channels.a.Write(message);
+    ExceptionOr<ByteArray> result = channels.b.Read();
+    if (!result.ok()) {
+      state.SkipWithError("Read failed");
+      break;
+    }
+    benchmark::DoNotOptimize(result.result());
+  }
+  allocations.Report(state);
+  state.SetBytesProcessed(state.iterations() * state.range(0));
+}
+
+void BM_EndpointChannelWriteRead(benchmark::State& state) {
+  ChannelPair channels;
+  RunWriteRead(state, channels);
+}
+BENCHMARK(BM_EndpointChannelWriteRead)->Range(64, 64 * 1024);
+
+void BM_EncryptedEndpointChannelWriteRead(benchmark::State& state) {
+  ChannelPair channels;
+  if (!channels.Encrypt()) {
+    state.SkipWithError("UKEY2 handshake failed");
+    return;
+  }
+  RunWriteRead(state, channels);
+}
+BENCHMARK(BM_EncryptedEndpointChannelWriteRead)->Range(64, 64 * 1024);
+
+}  // namespace
+}  // namespace connections
+}  // namespace nearby
+}  // namespace location
@@ -0,0 +1,73 @@
+// Copyright 2021 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <cstdint>
+
+#include "benchmark/benchmark.h"
+#include "benchmarks/allocation_counter.h"
+#include "platform/base/exception.h"
+#include "platform/public/count_down_latch.h"
+#include "platform/public/future.h"
+#include "platform/public/multi_thread_executor.h"
+#include "platform/public/single_thread_executor.h"
+
+namespace location {
+namespace nearby {
+namespace {
+
+using ::location::nearby::benchmarks::AllocationCounter;
+
+// Runs state.max_iterations tasks on |executor| and waits for all of them,
+// so the time per operation covers both submission and execution.
+template <typename Executor>
+void RunExecute(benchmark::State& state, Executor& executor) {
+  CountDownLatch done(state.max_iterations);
+  AllocationCounter allocations;
+  for (auto _ : state) {
+    executor.Execute([&done]() { done.CountDown(); });
+  }
+  done.Await();
+  allocations.Report(state);
+}
+
+void BM_SingleThreadExecutorExecute(benchmark::State& state) {
+  SingleThreadExecutor executor;
+  RunExecute(state, executor);
+}
+BENCHMARK(BM_SingleThreadExecutorExecute)->UseRealTime();
+
+void BM_MultiThreadExecutorExecute(benchmark::State& state) {
+  MultiThreadExecutor executor(state.range(0));
+  RunExecute(state, executor);
+}
+BENCHMARK(BM_MultiThreadExecutorExecute)->Arg(2)->Arg(4)->UseRealTime();
+
+// One Submit() and Future::Get() per operation; the round trip an executor
+// adds to a blocking call.
+void BM_SingleThreadExecutorSubmitAndGet(benchmark::State& state) {
+  SingleThreadExecutor executor;
+  AllocationCounter allocations;
+  for (auto _ : state) {
+    Future<std::int64_t> future;
+    executor.Submit<std::int64_t>(
+        []() { return ExceptionOr<std::int64_t>(1); }, &future);
+    benchmark::DoNotOptimize(future.Get());
+  }
+  allocations.Report(state);
+}
+BENCHMARK(BM_SingleThreadExecutorSubmitAndGet)->UseRealTime();
+
+}  // namespace
+}  // namespace nearby
+}  // namespace location
@@ -0,0 +1,109 @@
+// Copyright 2021 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <cstdint>
+#include <cstdio>
+#include <memory>
+#include <string>
+
+#include "benchmark/benchmark.h"
+#include "benchmarks/allocation_counter.h"
+#include "core/internal/internal_payload.h"
+#include "core/internal/internal_payload_factory.h"
+#include "core/payload.h"
+#include "platform/base/byte_array.h"
+#include "platform/public/file.h"
+#include "platform/public/pipe.h"
+
+namespace location {
+namespace nearby {
+namespace connections {
+namespace {
+
+using ::location::nearby::benchmarks::AllocationCounter;
+
+// Size of stream and file payloads; their argument is the chunk size.
+constexpr std::int64_t kPayloadSize = 1024 * 1024;
+
+// Detaches chunks until the payload is exhausted; returns the bytes read.
+std::int64_t DetachAllChunks(InternalPayload& payload, int chunk_size) {
+  std::int64_t size = 0;
+  while (true) {
+    ByteArray chunk = payload.DetachNextChunk(chunk_size);
+    if (chunk.Empty()) break;
+    size += chunk.size();
+  }
+  return size;
+}
+
+// Bytes payloads are sent as a single chunk, so the argument is the payload
+// size.
+void BM_ChunkBytesPayload(benchmark::State& state) {
+  ByteArray data(std::string(state.range(0), 'x'));
+  AllocationCounter allocations;
+  for (auto _ : state) {
+    std::unique_ptr<InternalPayload> payload =
+        CreateOutgoingInternalPayload(Payload(data));
+    benchmark::DoNotOptimize(DetachAllChunks(*payload, state.range(0)));
+  }
+  allocations.Report(state);
+  state.SetBytesProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_ChunkBytesPayload)->Range(64, kPayloadSize);
+
+void BM_ChunkStreamPayload(benchmark::State& state) {
+  ByteArray data(std::string(state.range(0), 'x'));
+  AllocationCounter allocations;
+  for (auto _ : state) {
+    auto pipe = std::make_shared<Pipe>();
+    for (std::int64_t size = 0; size < kPayloadSize; size += data.size()) {
+      pipe->GetOutputStream().Write(data);
+    }
+    pipe->GetOutputStream().Close();
+    std::unique_ptr<InternalPayload> payload = CreateOutgoingInternalPayload(
+        Payload([pipe]() -> InputStream& { return pipe->GetInputStream(); }));
+    benchmark::DoNotOptimize(DetachAllChunks(*payload, state.range(0)));
+  }
+  allocations.Report(state);
+  state.SetBytesProcessed(state.iterations() * kPayloadSize);
+}
+BENCHMARK(BM_ChunkStreamPayload)->Range(4 * 1024, 64 * 1024);
+
+void BM_ChunkFilePayload(benchmark::State& state) {
+  Payload::Id payload_id = Payload::GenerateId();
+  {
+    OutputFile file(payload_id);
+    if (!file.Write(ByteArray(std::string(kPayloadSize, 'x'))).Ok() ||
+        !file.Close().Ok()) {
+      state.SkipWithError("Failed to create the payload file");
+      return;
+    }
+  }
+  AllocationCounter allocations;
+  for (auto _ : state) {
+    std::unique_ptr<InternalPayload> payload = CreateOutgoingInternalPayload(
+        Payload(payload_id, InputFile(payload_id, kPayloadSize)));
+    benchmark::DoNotOptimize(DetachAllChunks(*payload, state.range(0)));
+    payload->Close();
+  }
+  allocations.Report(state);
+  state.SetBytesProcessed(state.iterations() * kPayloadSize);
+  std::remove(InputFile(payload_id, kPayloadSize).GetFilePath().c_str());
+}
+BENCHMARK(BM_ChunkFilePayload)->Range(4 * 1024, 64 * 1024);
+
+}  // namespace
+}  // namespace connections
+}  // namespace nearby
+}  // namespace location
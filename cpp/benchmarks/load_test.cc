@@ -0,0 +1,499 @@
+// Copyright 2021 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "benchmarks/load_test.h"
+
+#include <dirent.h>
+
+#include <algorithm>
+#include <fstream>
+#include <functional>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "absl/base/thread_annotations.h"
+#include "absl/container/flat_hash_map.h"
+#include "absl/container/flat_hash_set.h"
+#include "absl/functional/bind_front.h"
+#include "absl/strings/match.h"
+#include "absl/strings/numbers.h"
+#include "absl/strings/str_cat.h"
+#include "absl/strings/str_format.h"
+#include "absl/strings/string_view.h"
+#include "absl/strings/strip.h"
+#include "absl/time/clock.h"
+#include "benchmarks/allocation_counter.h"
+#include "core/internal/offline_simulation_user.h"
+#include "core/listeners.h"
+#include "core/payload.h"
+#include "core/strategy.h"
+#include "platform/base/byte_array.h"
+#include "platform/public/count_down_latch.h"
+#include "platform/public/logging.h"
+#include "platform/public/multi_thread_executor.h"
+#include "platform/public/mutex.h"
+#include "platform/public/mutex_lock.h"
+#include "platform/public/single_thread_executor.h"
+
+namespace location {
+namespace nearby {
+namespace benchmarks {
+namespace {
+
+using ::location::nearby::connections::BooleanMediumSelector;
+using ::location::nearby::connections::ConnectionListener;
+using ::location::nearby::connections::ConnectionResponseInfo;
+using ::location::nearby::connections::DiscoveryListener;
+using ::location::nearby::connections::OfflineSimulationUser;
+using ::location::nearby::connections::Payload;
+using ::location::nearby::connections::PayloadListener;
+using ::location::nearby::connections::Status;
+using ::location::nearby::connections::Strategy;
+
+// Threads that request connections, so that users connect in parallel.
+constexpr int kConnectingThreads = 8;
+
+// Latches counted down by every user, one per phase of the run.
+struct PhaseLatches {
+  CountDownLatch* found;
+  CountDownLatch* connected;
+  CountDownLatch* received;
+};
+
+// OfflineSimulationUser that can be connected to several endpoints. It
+// accepts every connection, and records connection latency and the payloads
+// it receives.
+class LoadTestUser : public OfflineSimulationUser {
+ public:
+  LoadTestUser(absl::string_view name, const Strategy& strategy,
+               const BooleanMediumSelector& mediums, PhaseLatches latches)
+      : OfflineSimulationUser(name, mediums), latches_(latches) {
+    options_.strategy = strategy;
+  }
+
+  Status Advertise(const std::string& service_id) {
+    service_id_ = service_id;
+    return ctrl_.StartAdvertising(&client_, service_id, options_,
+                                  {
+                                      .endpoint_info = info_,
+                                      .listener = CreateListener(false),
+                                  });
+  }
+
+  // Discovers users named in |targets|, to connect to them later.
+  Status Discover(const std::string& service_id,
+                  absl::flat_hash_set<std::string> targets) {
+    {
+      MutexLock lock(&mutex_);
+      targets_ = std::move(targets);
+    }
+    DiscoveryListener listener = {
+        .endpoint_found_cb =
+            [this](const std::string& endpoint_id,
+                   const ByteArray& endpoint_info,
+                   const std::string& service_id) {
+              MutexLock lock(&mutex_);
+              std::string name(endpoint_info);
+              if (!targets_.contains(name)) return;
+              if (!found_.emplace(name, endpoint_id).second) return;
+              latches_.found->CountDown();
+            },
+    };
+    return ctrl_.StartDiscovery(&client_, service_id, options_,
+                                std::move(listener));
+  }
+
+  // Requests a connection to the discovered user named |target|.
+  void Connect(const std::string& target) {
+    std::string endpoint_id;
+    {
+      MutexLock lock(&mutex_);
+      auto item = found_.find(target);
+      if (item == found_.end()) return;
+      endpoint_id = item->second;
+      request_times_[endpoint_id] = absl::Now();
+    }
+    client_.AddCancellationFlag(endpoint_id);
+    Status status =
+        ctrl_.RequestConnection(&client_, endpoint_id,
+                                {
+                                    .endpoint_info = info_,
+                                    .listener = CreateListener(true),
+                                },
+                                connection_options_);
+    if (!status.Ok()) {
+      NEARBY_LOGS(INFO) << "Load test: connection request failed; endpoint_id="
+                        << endpoint_id << "; status=" << status.value;
+    }
+  }
+
+  // Sends |count| payloads of |size| bytes over each connection this user
+  // requested. Returns the number of payloads sent.
+  int SendPayloads(int count, int size) {
+    std::vector<std::string> endpoint_ids;
+    {
+      MutexLock lock(&mutex_);
+      endpoint_ids = outgoing_connections_;
+    }
+    for (const auto& endpoint_id : endpoint_ids) {
+      for (int i = 0; i < count; i++) {
+        ctrl_.SendPayload(&client_, {endpoint_id},
+                          Payload(ByteArray(static_cast<size_t>(size))));
+      }
+    }
+    return endpoint_ids.size() * count;
+  }
+
+  std::vector<absl::Duration> GetConnectionLatencies() {
+    MutexLock lock(&mutex_);
+    return connection_latencies_;
+  }
+
+  int GetPayloadsReceived() {
+    MutexLock lock(&mutex_);
+    return payloads_received_;
+  }
+
+  std::int64_t GetBytesReceived() {
+    MutexLock lock(&mutex_);
+    return bytes_received_;
+  }
+
+  // Stops the user; callbacks are not called after this returns.
+  void Shutdown() {
+    Stop();
+    executor_.Shutdown();
+  }
+
+ private:
+  ConnectionListener CreateListener(bool is_outgoing) {
+    return {
+        .initiated_cb =
+            [this](const std::string& endpoint_id,
+                   const ConnectionResponseInfo& info) {
+              // Callbacks are called with the client locked, so accept
+              // the connection from another thread.
+              executor_.Execute([this, endpoint_id]() {
+                ctrl_.AcceptConnection(
+                    &client_, endpoint_id,
+                    PayloadListener{
+                        .payload_cb = absl::bind_front(
+                            &LoadTestUser::OnPayloadReceived, this),
+                    });
+              });
+            },
+        .accepted_cb =
+            [this, is_outgoing](const std::string& endpoint_id) {
+              OnAccepted(endpoint_id, is_outgoing);
+            },
+    };
+  }
+
+  void OnAccepted(const std::string& endpoint_id, bool is_outgoing) {
+    MutexLock lock(&mutex_);
+    if (is_outgoing) {
+      auto item = request_times_.find(endpoint_id);
+      if (item != request_times_.end()) {
+        connection_latencies_.push_back(absl::Now() - item->second);
+      }
+      outgoing_connections_.push_back(endpoint_id);
+    }
+    latches_.connected->CountDown();
+  }
+
+  void OnPayloadReceived(const std::string& endpoint_id, Payload payload) {
+    MutexLock lock(&mutex_);
+    payloads_received_++;
+    bytes_received_ += payload.AsBytes().size();
+    latches_.received->CountDown();
+  }
+
+  PhaseLatches latches_;
+  SingleThreadExecutor executor_;
+  Mutex mutex_;
+  absl::flat_hash_set<std::string> targets_ ABSL_GUARDED_BY(mutex_);
+  // Discovered user name vs endpoint id.
+  absl::flat_hash_map<std::string, std::string> found_ ABSL_GUARDED_BY(mutex_);
+  absl::flat_hash_map<std::string, absl::Time> request_times_
+      ABSL_GUARDED_BY(mutex_);
+  std::vector<std::string> outgoing_connections_ ABSL_GUARDED_BY(mutex_);
+  std::vector<absl::Duration> connection_latencies_ ABSL_GUARDED_BY(mutex_);
+  int payloads_received_ ABSL_GUARDED_BY(mutex_) = 0;
+  std::int64_t bytes_received_ ABSL_GUARDED_BY(mutex_) = 0;
+};
+
+// What a user does in a run.
+struct UserPlan {
+  std::string service_id;
+  bool advertises = false;
+  // Users this one connects to.
+  std::vector<int> targets;
+};
+
+std::vector<UserPlan> PlanUsers(const LoadTestOptions& options) {
+  std::vector<UserPlan> plans(options.users);
+  for (int i = 0; i < options.users; i++) {
+    auto& plan = plans[i];
+    switch (options.topology) {
+      case LoadTestTopology::kPointToPoint:
+        plan.service_id = absl::StrCat("load_test_", i / 2);
+        if (i % 2 == 0) {
+          plan.advertises = true;
+        } else {
+          plan.targets.push_back(i - 1);
+        }
+        break;
+      case LoadTestTopology::kStar:
+        plan.service_id = "load_test";
+        if (i == 0) {
+          plan.advertises = true;
+        } else {
+          plan.targets.push_back(0);
+        }
+        break;
+      case LoadTestTopology::kCluster: {
+        int cluster_size = std::max(options.cluster_size, 1);
+        int cluster = i / cluster_size;
+        plan.service_id = absl::StrCat("load_test_", cluster);
+        plan.advertises = true;
+        int cluster_end = std::min((cluster + 1) * cluster_size, options.users);
+        for (int j = i + 1; j < cluster_end; j++) plan.targets.push_back(j);
+        break;
+      }
+    }
+  }
+  return plans;
+}
+
+const Strategy& GetStrategy(LoadTestTopology topology) {
+  switch (topology) {
+    case LoadTestTopology::kPointToPoint:
+      return Strategy::kP2pPointToPoint;
+    case LoadTestTopology::kStar:
+      return Strategy::kP2pStar;
+    case LoadTestTopology::kCluster:
+      return Strategy::kP2pCluster;
+  }
+  return Strategy::kP2pCluster;
+}
+
+std::string GetUserName(int user) { return absl::StrCat("user-", user); }
+
+// Returns the nearest-rank |percentile| of sorted |values|.
+absl::Duration GetPercentile(const std::vector<absl::Duration>& values,
+                             int percentile) {
+  if (values.empty()) return absl::ZeroDuration();
+  std::size_t rank = (values.size() * percentile + 99) / 100;
+  return values[std::max<std::size_t>(rank, 1) - 1];
+}
+
+int CountThreads() {
+  DIR* dir = opendir("/proc/self/task");
+  if (dir == nullptr) return 0;
+  int count = 0;
+  while (dirent* entry = readdir(dir)) {
+    if (entry->d_name[0] != '.') count++;
+  }
+  closedir(dir);
+  return count;
+}
+
+std::int64_t GetPeakRssBytes() {
+  std::ifstream status("/proc/self/status");
+  std::string line;
+  while (std::getline(status, line)) {
+    absl::string_view value = line;
+    if (!absl::ConsumePrefix(&value, "VmHWM:")) continue;
+    absl::ConsumeSuffix(&value, "kB");
+    std::int64_t kilobytes = 0;
+    if (absl::SimpleAtoi(value, &kilobytes)) return kilobytes * 1024;
+  }
+  return 0;
+}
+
+// Waits for |latch|, and returns how long it took.
+absl::Duration AwaitPhase(CountDownLatch& latch, absl::Duration timeout,
+                          absl::string_view phase) {
+  absl::Time start_time = absl::Now();
+  auto result = latch.Await(timeout);
+  if (!result.ok() || !result.result()) {
+    NEARBY_LOGS(ERROR) << "Load test: " << phase << " timed out";
+  }
+  return absl::Now() - start_time;
+}
+
+}  // namespace
+
+std::string LoadTestReport::ToString() const {
+  return absl::StrFormat(
+      "connections: %d/%d established\n"
+      "payloads: %d/%d received, %d bytes\n"
+      "discovery: %s, connection: %s, payloads: %s\n"
+      "throughput: %.0f bytes/s\n"
+      "connection latency: p50=%s p90=%s p99=%s max=%s\n"
+      "threads: %d, peak rss: %d bytes, allocations: %d",
+      connections_established, connections_requested, payloads_received,
+      payloads_sent, bytes_received, absl::FormatDuration(discovery_duration),
+      absl::FormatDuration(connection_duration),
+      absl::FormatDuration(payload_duration), throughput_bytes_per_second,
+      absl::FormatDuration(connection_latency_p50),
+      absl::FormatDuration(connection_latency_p90),
+      absl::FormatDuration(connection_latency_p99),
+      absl::FormatDuration(connection_latency_max), threads, peak_rss_bytes,
+      allocations);
+}
+
+LoadTestReport RunLoadTest(const LoadTestOptions& options) {
+  LoadTestReport report;
+  std::vector<UserPlan> plans = PlanUsers(options);
+  for (const auto& plan : plans) {
+    report.connections_requested += plan.targets.size();
+  }
+  CountDownLatch found_latch(report.connections_requested);
+  // Both sides of a connection count it down once accepted.
+  CountDownLatch connected_latch(2 * report.connections_requested);
+  CountDownLatch received_latch(report.connections_requested *
+                                options.payloads_per_connection);
+
+  auto& env = MediumEnvironment::Instance();
+  env.Stop();
+  env.Start(options.environment);
+  AllocationCounter allocations;
+  {
+    std::vector<std::unique_ptr<LoadTestUser>> users;
+    for (int i = 0; i < options.users; i++) {
+      users.push_back(std::make_unique<LoadTestUser>(
+          GetUserName(i), GetStrategy(options.topology), options.mediums,
+          PhaseLatches{
+              .found = &found_latch,
+              .connected = &connected_latch,
+              .received = &received_latch,
+          }));
+    }
+
+    for (int i = 0; i < options.users; i++) {
+      if (plans[i].advertises) users[i]->Advertise(plans[i].service_id);
+    }
+    for (int i = 0; i < options.users; i++) {
+      if (plans[i].targets.empty()) continue;
+      absl::flat_hash_set<std::string> targets;
+      for (int target : plans[i].targets) targets.insert(GetUserName(target));
+      users[i]->Discover(plans[i].service_id, std::move(targets));
+    }
+    report.discovery_duration =
+        AwaitPhase(found_latch, options.phase_timeout, "discovery");
+
+    {
+      MultiThreadExecutor executor(kConnectingThreads);
+      for (int i = 0; i < options.users; i++) {
+        for (int target : plans[i].targets) {
+          executor.Execute([user = users[i].get(), target]() {
+            user->Connect(GetUserName(target));
+          });
+        }
+      }
+      report.connection_duration =
+          AwaitPhase(connected_latch, options.phase_timeout, "connection");
+    }
+    report.threads = CountThreads();
+
+    absl::Time payload_start_time = absl::Now();
+    for (auto& user : users) {
+      report.payloads_sent += user->SendPayloads(
+          options.payloads_per_connection, options.payload_size);
+    }
+    AwaitPhase(received_latch, options.phase_timeout, "payload exchange");
+    report.payload_duration = absl::Now() - payload_start_time;
+
+    std::vector<absl::Duration> latencies;
+    for (auto& user : users) {
+      auto user_latencies = user->GetConnectionLatencies();
+      latencies.insert(latencies.end(), user_latencies.begin(),
+                       user_latencies.end());
+      report.payloads_received += user->GetPayloadsReceived();
+      report.bytes_received += user->GetBytesReceived();
+    }
+    for (auto& user : users) user->Shutdown();
+
+    std::sort(latencies.begin(), latencies.end());
+    report.connections_established = latencies.size();
+    report.connection_latency_p50 = GetPercentile(latencies, 50);
+    report.connection_latency_p90 = GetPercentile(latencies, 90);
+    report.connection_latency_p99 = GetPercentile(latencies, 99);
+    report.connection_latency_max = GetPercentile(latencies, 100);
+    if (report.payload_duration > absl::ZeroDuration()) {
+      report.throughput_bytes_per_second =
+          report.bytes_received /
+          absl::ToDoubleSeconds(report.payload_duration);
+    }
+  }
+  env.Stop();
+  report.allocations = allocations.GetCount();
+  report.peak_rss_bytes = GetPeakRssBytes();
+  return report;
+}
+
+std::vector<std::string> CheckThresholds(const LoadTestReport& report,
+                                         const LoadTestThresholds& thresholds) {
+  std::vector<std::string> failures;
+  if (report.connections_established < report.connections_requested) {
+    failures.push_back(absl::StrCat("only ", report.connections_established,
+                                    " of ", report.connections_requested,
+                                    " connections were established"));
+  }
+  if (report.payloads_received < report.payloads_sent) {
+    failures.push_back(absl::StrCat("only ", report.payloads_received, " of ",
+                                    report.payloads_sent,
+                                    " payloads were received"));
+  }
+  if (report.throughput_bytes_per_second <
+      thresholds.min_throughput_bytes_per_second) {
+    failures.push_back(absl::StrCat(
+        "throughput ", report.throughput_bytes_per_second,
+        " bytes/s is under ", thresholds.min_throughput_bytes_per_second));
+  }
+  if (report.connection_latency_p99 > thresholds.max_connection_latency_p99) {
+    failures.push_back(absl::StrCat(
+        "connection latency p99 ",
+        absl::FormatDuration(report.connection_latency_p99), " is over ",
+        absl::FormatDuration(thresholds.max_connection_latency_p99)));
+  }
+  if (thresholds.max_threads > 0 && report.threads > thresholds.max_threads) {
+    failures.push_back(absl::StrCat(report.threads, " threads is over ",
+                                    thresholds.max_threads));
+  }
+  if (thresholds.max_peak_rss_bytes > 0 &&
+      report.peak_rss_bytes > thresholds.max_peak_rss_bytes) {
+    failures.push_back(absl::StrCat("peak rss ", report.peak_rss_bytes,
+                                    " bytes is over ",
+                                    thresholds.max_peak_rss_bytes));
+  }
+  if (thresholds.max_allocations_per_connection > 0) {
+    std::int64_t allocations_per_connection =
+        report.allocations / std::max(report.connections_requested, 1);
+    if (allocations_per_connection >
+        thresholds.max_allocations_per_connection) {
+      failures.push_back(absl::StrCat(
+          allocations_per_connection, " allocations per connection is over ",
+          thresholds.max_allocations_per_connection));
+    }
+  }
+  return failures;
+}
+
+}  // namespace benchmarks
+}  // namespace nearby
+}  // namespace location
@@ -0,0 +1,109 @@
+// Copyright 2021 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef BENCHMARKS_LOAD_TEST_H_
+#define BENCHMARKS_LOAD_TEST_H_
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "absl/time/time.h"
+#include "core/options.h"
+#include "platform/base/medium_environment.h"
+
+namespace location {
+namespace nearby {
+namespace benchmarks {
+
+// How simulated users connect to each other.
+enum class LoadTestTopology {
+  // Users are paired up; one of each pair connects to the other.
+  kPointToPoint,
+  // Every user connects to the first one.
+  kStar,
+  // Users are split into clusters of LoadTestOptions::cluster_size, and
+  // every user connects to every other user of its cluster.
+  kCluster,
+};
+
+struct LoadTestOptions {
+  int users = 2;
+  LoadTestTopology topology = LoadTestTopology::kPointToPoint;
+  int cluster_size = 4;
+  // Mediums users discover and connect over.
+  connections::BooleanMediumSelector mediums{.bluetooth = true};
+  // Bytes payloads each connecting user sends over each of its connections.
+  int payloads_per_connection = 1;
+  int payload_size = 1024;
+  // MediumEnvironment is restarted with this config for the run.
+  EnvironmentConfig environment;
+  // Time each phase (discovery, connection, payload exchange) may take.
+  absl::Duration phase_timeout = absl::Seconds(30);
+};
+
+struct LoadTestReport {
+  int connections_requested = 0;
+  int connections_established = 0;
+  int payloads_sent = 0;
+  int payloads_received = 0;
+  std::int64_t bytes_received = 0;
+
+  absl::Duration discovery_duration;
+  absl::Duration connection_duration;
+  absl::Duration payload_duration;
+  // Payload bytes received per second during payload exchange.
+  double throughput_bytes_per_second = 0;
+  // From RequestConnection() until both sides accepted the connection,
+  // including the UKEY2 handshake.
+  absl::Duration connection_latency_p50;
+  absl::Duration connection_latency_p90;
+  absl::Duration connection_latency_p99;
+  absl::Duration connection_latency_max;
+
+  // Threads of the process once all users are connected.
+  int threads = 0;
+  // Peak resident set size of the process.
+  std::int64_t peak_rss_bytes = 0;
+  // Allocations made during the run, by all threads.
+  std::int64_t allocations = 0;
+
+  std::string ToString() const;
+};
+
+// Limits a LoadTestReport has to stay within; the defaults check nothing but
+// that every connection and payload went through.
+struct LoadTestThresholds {
+  double min_throughput_bytes_per_second = 0;
+  absl::Duration max_connection_latency_p99 = absl::InfiniteDuration();
+  // 0 means no limit.
+  int max_threads = 0;
+  std::int64_t max_peak_rss_bytes = 0;
+  std::int64_t max_allocations_per_connection = 0;
+};
+
+// Runs the scenario described by |options| to completion, or until a phase
+// times out, and reports how it went.
+LoadTestReport RunLoadTest(const LoadTestOptions& options);
+
+// Returns a description of every threshold |report| is over; empty if the
+// run passes.
+std::vector<std::string> CheckThresholds(const LoadTestReport& report,
+                                         const LoadTestThresholds& thresholds);
+
+}  // namespace benchmarks
+}  // namespace nearby
+}  // namespace location
+
+#endif  // BENCHMARKS_LOAD_TEST_H_
@@ -0,0 +1,86 @@
+// Copyright 2021 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <string>
+
+#include "benchmark/benchmark.h"
+#include "benchmarks/allocation_counter.h"
+#include "core/internal/offline_frames.h"
+#include "platform/base/byte_array.h"
+#include "proto/connections/offline_wire_formats.pb.h"
+
+namespace location {
+namespace nearby {
+namespace connections {
+namespace {
+
+using ::location::nearby::benchmarks::AllocationCounter;
+
+PayloadTransferFrame::PayloadHeader MakeHeader(int chunk_size) {
+  PayloadTransferFrame::PayloadHeader header;
+  header.set_id(12345);
+  header.set_type(PayloadTransferFrame::PayloadHeader::BYTES);
+  header.set_total_size(chunk_size * 16);
+  return header;
+}
+
+PayloadTransferFrame::PayloadChunk MakeChunk(int chunk_size) {
+  PayloadTransferFrame::PayloadChunk chunk;
+  chunk.set_body(std::string(chunk_size, 'x'));
+  chunk.set_offset(chunk_size * 8);
+  chunk.set_flags(0);
+  return chunk;
+}
+
+void BM_ForDataPayloadTransfer(benchmark::State& state) {
+  PayloadTransferFrame::PayloadHeader header = MakeHeader(state.range(0));
+  PayloadTransferFrame::PayloadChunk chunk = MakeChunk(state.range(0));
+  AllocationCounter allocations;
+  for (auto _ : state) {
+    ByteArray bytes = parser::ForDataPayloadTransfer(header, chunk);
+    benchmark::DoNotOptimize(bytes);
+  }
+  allocations.Report(state);
+  state.SetBytesProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_ForDataPayloadTransfer)->Range(64, 64 * 1024);
+
+void BM_FromBytesDataPayloadTransfer(benchmark::State& state) {
+  ByteArray bytes = parser::ForDataPayloadTransfer(MakeHeader(state.range(0)),
+                                                   MakeChunk(state.range(0)));
+  AllocationCounter allocations;
+  for (auto _ : state) {
+    ExceptionOr<OfflineFrame> frame = parser::FromBytes(bytes);
+    benchmark::DoNotOptimize(frame);
+  }
+  allocations.Report(state);
+  state.SetBytesProcessed(state.iterations() * bytes.size());
+}
+BENCHMARK(BM_FromBytesDataPayloadTransfer)->Range(64, 64 * 1024);
+
+void BM_FromBytesKeepAlive(benchmark::State& state) {
+  ByteArray bytes = parser::ForKeepAlive();
+  AllocationCounter allocations;
+  for (auto _ : state) {
+    ExceptionOr<OfflineFrame> frame = parser::FromBytes(bytes);
+    benchmark::DoNotOptimize(frame);
+  }
+  allocations.Report(state);
+}
+BENCHMARK(BM_FromBytesKeepAlive);
+
+}  // namespace
+}  // namespace connections
+}  // namespace nearby
+}  // namespace location
@@ -0,0 +1,80 @@
+// Copyright 2021 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <cstdint>
+#include <string>
+
+#include "benchmark/benchmark.h"
+#include "benchmarks/allocation_counter.h"
+#include "platform/base/byte_array.h"
+#include "platform/public/count_down_latch.h"
+#include "platform/public/pipe.h"
+#include "platform/public/single_thread_executor.h"
+
+namespace location {
+namespace nearby {
+namespace {
+
+using ::location::nearby::benchmarks::AllocationCounter;
+
+void BM_PipeWriteRead(benchmark::State& state) {
+  Pipe pipe;
+  ByteArray data(std::string(state.range(0), 'x'));
+  AllocationCounter allocations;
+  for (auto _ : state) {
+    pipe.GetOutputStream().Write(data);
+    ExceptionOr<ByteArray> result =
+        pipe.GetInputStream().Read(Pipe::kChunkSize);
+    benchmark::DoNotOptimize(result);
+  }
+  allocations.Report(state);
+  state.SetBytesProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_PipeWriteRead)->Range(64, Pipe::kChunkSize);
+
+// Moves kTransferSize bytes per iteration, written in chunks of the given size
+// on the benchmark thread and drained by another thread, as an endpoint
+// channel and its reader do.
+void BM_PipeThroughput(benchmark::State& state) {
+  constexpr std::int64_t kTransferSize = 1024 * 1024;
+  Pipe pipe;
+  ByteArray data(std::string(state.range(0), 'x'));
+  SingleThreadExecutor reader;
+  AllocationCounter allocations;
+  for (auto _ : state) {
+    CountDownLatch done(1);
+    reader.Execute([&pipe, &done]() {
+      std::int64_t read_size = 0;
+      while (read_size < kTransferSize) {
+        ExceptionOr<ByteArray> result =
+            pipe.GetInputStream().Read(Pipe::kChunkSize);
+        if (!result.ok()) break;
+        read_size += result.result().size();
+      }
+      done.CountDown();
+    });
+    for (std::int64_t written = 0; written < kTransferSize;
+         written += data.size()) {
+      pipe.GetOutputStream().Write(data);
+    }
+    done.Await();
+  }
+  allocations.Report(state);
+  state.SetBytesProcessed(state.iterations() * kTransferSize);
+}
+BENCHMARK(BM_PipeThroughput)->Range(64, Pipe::kChunkSize)->UseRealTime();
+
+}  // namespace
+}  // namespace nearby
+}  // namespace location
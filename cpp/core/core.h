@@ -27,6 +27,7 @@
 #include "core/listeners.h"
 #include "core/options.h"
 #include "core/params.h"
+#include "platform/public/metrics_registry.h"
 
 namespace location {
 namespace nearby {
@@ -235,6 +236,13 @@ class Core {
   // Gets the local endpoint generated by Nearby Connections.
   std::string GetLocalEndpointId() { return client_.GetLocalEndpointId(); }
 
+  // Gets the current transfer and executor metrics, eg. per-endpoint bytes
+  // ("endpoint/<endpoint_id>/bytes_written") and latency histograms. Metrics
+  // are process wide; they include the activity of every Core instance.
+  MetricsSnapshot GetMetricsSnapshot() const {
+    return MetricsRegistry::GetInstance().GetSnapshot();
+  }
+
  private:
   ClientProxy client_;
   ServiceControllerRouter* router_ = nullptr;
@@ -121,6 +121,7 @@ BaseEndpointChannel::BaseEndpointChannel(
 
 ExceptionOr<ByteArray> BaseEndpointChannel::Read() {
   ByteArray result;
+  absl::Time read_start_time;
   {
     MutexLock lock(&reader_mutex_);
 
@@ -135,6 +136,7 @@ ExceptionOr<ByteArray> BaseEndpointChannel::Read() {
       return ExceptionOr<ByteArray>(Exception::kIo);
     }
 
+    read_start_time = SystemClock::ElapsedRealtime();
     ExceptionOr<ByteArray> read_bytes = ReadExactly(reader_, read_int.result());
     if (!read_bytes.ok()) {
       return read_bytes;
@@ -142,13 +144,30 @@ ExceptionOr<ByteArray> BaseEndpointChannel::Read() {
     result = std::move(read_bytes.result());
   }
 
+  std::shared_ptr<const Metrics> metrics = std::atomic_load(&metrics_);
+  absl::Time decrypt_start_time = SystemClock::ElapsedRealtime();
+  if (metrics) {
+    metrics->bytes_read->Increment(sizeof(std::int32_t) + result.size());
+    metrics->frames_read->Increment();
+    metrics->read_latency->Record(decrypt_start_time - read_start_time);
+  }
+
   {
-    MutexLock crypto_lock(&crypto_mutex_);
-    if (IsEncryptionEnabledLocked()) {
+    MutexLock crypto_lock(&decrypt_mutex_);
+    bool decrypting = decrypt_context_ != nullptr;
+    if (decrypt_context_ && decrypt_cipher_ &&
+        DataFrameCipher::IsSealed(result)) {
+      ExceptionOr<ByteArray> opened = decrypt_cipher_->Open(result);
+      if (!opened.ok()) {
+        NEARBY_LOGS(WARNING) << __func__ << ": Unable to open data frame.";
+        return opened;
+      }
+      result = std::move(opened.result());
+    } else if (decrypt_context_) {
       // If encryption is enabled, decode the message.
       std::string input(std::move(result));
       std::unique_ptr<std::string> decrypted_data =
-          crypto_context_->DecodeMessageFromPeer(input);
+          decrypt_context_->DecodeMessageFromPeer(input);
       if (decrypted_data) {
         result = ByteArray(std::move(*decrypted_data));
       } else {
@@ -181,6 +200,10 @@ ExceptionOr<ByteArray> BaseEndpointChannel::Read() {
         return ExceptionOr<ByteArray>(Exception::kInvalidProtocolBuffer);
       }
     }
+    if (metrics && decrypting) {
+      metrics->decrypt_latency->Record(SystemClock::ElapsedRealtime() -
+                                       decrypt_start_time);
+    }
   }
 
   {
@@ -198,20 +221,31 @@ Exception BaseEndpointChannel::Write(const ByteArray& data) {
     }
   }
 
+  std::shared_ptr<const Metrics> metrics = std::atomic_load(&metrics_);
+  absl::Time write_start_time = SystemClock::ElapsedRealtime();
   ByteArray encrypted_data;
   const ByteArray* data_to_write = &data;
   {
     // Holding both mutexes is necessary to prevent the keep alive and payload
     // threads from writing encrypted messages out of order which causes a
-    // failure to decrypt on the reader side. However we need to release the
-    // crypto lock after encrypting to ensure read decryption is not blocked.
+    // failure to decrypt on the reader side. Reads only take the decrypt
+    // lock, so they are never blocked by a write.
     MutexLock lock(&writer_mutex_);
     {
-      MutexLock crypto_lock(&crypto_mutex_);
-      if (IsEncryptionEnabledLocked()) {
+      MutexLock crypto_lock(&encrypt_mutex_);
+      absl::Time encrypt_start_time = SystemClock::ElapsedRealtime();
+      if (encrypt_context_ && encrypt_cipher_) {
+        // Sealing writes the ciphertext straight into the outgoing frame.
+        encrypted_data = encrypt_cipher_->Seal(data);
+        if (encrypted_data.Empty()) {
+          NEARBY_LOGS(WARNING) << __func__ << ": Failed to seal data.";
+          return {Exception::kIo};
+        }
+        data_to_write = &encrypted_data;
+      } else if (encrypt_context_) {
         // If encryption is enabled, encode the message.
         std::unique_ptr<std::string> encrypted =
-            crypto_context_->EncodeMessageToPeer(std::string(data));
+            encrypt_context_->EncodeMessageToPeer(std::string(data));
         if (!encrypted) {
           NEARBY_LOGS(WARNING) << __func__ << ": Failed to encrypt data.";
           return {Exception::kIo};
@@ -219,6 +253,10 @@ Exception BaseEndpointChannel::Write(const ByteArray& data) {
         encrypted_data = ByteArray(std::move(*encrypted));
         data_to_write = &encrypted_data;
       }
+      if (metrics && encrypt_context_) {
+        metrics->encrypt_latency->Record(SystemClock::ElapsedRealtime() -
+                                         encrypt_start_time);
+      }
     }
 
     Exception write_exception =
@@ -242,9 +280,16 @@ Exception BaseEndpointChannel::Write(const ByteArray& data) {
     }
   }
 
+  absl::Time write_end_time = SystemClock::ElapsedRealtime();
+  if (metrics) {
+    metrics->bytes_written->Increment(sizeof(std::int32_t) +
+                                      data_to_write->size());
+    metrics->frames_written->Increment();
+    metrics->write_latency->Record(write_end_time - write_start_time);
+  }
   {
     MutexLock lock(&last_write_mutex_);
-    last_write_timestamp_ = SystemClock::ElapsedRealtime();
+    last_write_timestamp_ = write_end_time;
   }
   return {Exception::kSuccess};
 }
@@ -288,6 +333,26 @@ void BaseEndpointChannel::SetAnalyticsRecorder(
     const std::string& endpoint_id) {
   analytics_recorder_ = analytics_recorder;
   endpoint_id_ = endpoint_id;
+
+  MetricsRegistry& registry = MetricsRegistry::GetInstance();
+  auto metrics = std::make_shared<Metrics>();
+  std::string prefix = absl::StrCat("endpoint/", endpoint_id, "/");
+  metrics->bytes_read = registry.GetCounter(absl::StrCat(prefix, "bytes_read"));
+  metrics->bytes_written =
+      registry.GetCounter(absl::StrCat(prefix, "bytes_written"));
+  metrics->frames_read =
+      registry.GetCounter(absl::StrCat(prefix, "frames_read"));
+  metrics->frames_written =
+      registry.GetCounter(absl::StrCat(prefix, "frames_written"));
+  metrics->read_latency =
+      registry.GetHistogram(absl::StrCat(prefix, "read_latency_us"));
+  metrics->write_latency =
+      registry.GetHistogram(absl::StrCat(prefix, "write_latency_us"));
+  metrics->encrypt_latency =
+      registry.GetHistogram(absl::StrCat(prefix, "encrypt_latency_us"));
+  metrics->decrypt_latency =
+      registry.GetHistogram(absl::StrCat(prefix, "decrypt_latency_us"));
+  std::atomic_store(&metrics_, std::shared_ptr<const Metrics>(metrics));
 }
 
 void BaseEndpointChannel::Close(
@@ -302,8 +367,11 @@ void BaseEndpointChannel::Close(
 }
 
 std::string BaseEndpointChannel::GetType() const {
-  MutexLock crypto_lock(&crypto_mutex_);
-  std::string subtype = IsEncryptionEnabledLocked() ? "ENCRYPTED_" : "";
+  std::string subtype;
+  {
+    MutexLock crypto_lock(&encrypt_mutex_);
+    if (encrypt_context_) subtype = "ENCRYPTED_";
+  }
   std::string medium = proto::connections::Medium_Name(
       proto::connections::Medium::UNKNOWN_MEDIUM);
 
@@ -323,13 +391,27 @@ int BaseEndpointChannel::GetMaxTransmitPacketSize() const {
 
 void BaseEndpointChannel::EnableEncryption(
     std::shared_ptr<EncryptionContext> context) {
-  MutexLock crypto_lock(&crypto_mutex_);
-  crypto_context_ = context;
+  MutexLock encrypt_lock(&encrypt_mutex_);
+  MutexLock decrypt_lock(&decrypt_mutex_);
+  encrypt_context_ = context;
+  decrypt_context_ = std::move(context);
+}
+
+void BaseEndpointChannel::EnableDataFrameCipher(
+    std::shared_ptr<DataFrameCipher> cipher) {
+  MutexLock encrypt_lock(&encrypt_mutex_);
+  MutexLock decrypt_lock(&decrypt_mutex_);
+  encrypt_cipher_ = cipher;
+  decrypt_cipher_ = std::move(cipher);
 }
 
 void BaseEndpointChannel::DisableEncryption() {
-  MutexLock crypto_lock(&crypto_mutex_);
-  crypto_context_.reset();
+  MutexLock encrypt_lock(&encrypt_mutex_);
+  MutexLock decrypt_lock(&decrypt_mutex_);
+  encrypt_context_.reset();
+  decrypt_context_.reset();
+  encrypt_cipher_.reset();
+  decrypt_cipher_.reset();
 }
 
 bool BaseEndpointChannel::IsPaused() const {
@@ -374,10 +456,6 @@ int BaseEndpointChannel::GetFrequency() const { return frequency_; }
 // Returns the try count of this EndpointChannel.
 int BaseEndpointChannel::GetTryCount() const { return try_count_; }
 
-bool BaseEndpointChannel::IsEncryptionEnabledLocked() const {
-  return crypto_context_ != nullptr;
-}
-
 void BaseEndpointChannel::BlockUntilUnpaused() {
   // For more on how this works, see
   // https://docs.oracle.com/javase/tutorial/essential/concurrency/guardmeth.html
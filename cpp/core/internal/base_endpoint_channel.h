@@ -22,12 +22,14 @@
 #include "securegcm/d2d_connection_context_v1.h"
 #include "absl/base/thread_annotations.h"
 #include "analytics/analytics_recorder.h"
+#include "core/internal/data_frame_cipher.h"
 #include "core/internal/endpoint_channel.h"
 #include "platform/base/byte_array.h"
 #include "platform/base/input_stream.h"
 #include "platform/base/output_stream.h"
 #include "platform/public/atomic_reference.h"
 #include "platform/public/condition_variable.h"
+#include "platform/public/metrics_registry.h"
 #include "platform/public/mutex.h"
 #include "platform/public/system_clock.h"
 #include "proto/connections_enums.proto.h"
@@ -48,11 +50,11 @@ class BaseEndpointChannel : public EndpointChannel {
   ~BaseEndpointChannel() override = default;
 
   ExceptionOr<ByteArray> Read()
-      ABSL_LOCKS_EXCLUDED(reader_mutex_, crypto_mutex_,
+      ABSL_LOCKS_EXCLUDED(reader_mutex_, decrypt_mutex_,
                           last_read_mutex_) override;
 
   Exception Write(const ByteArray& data)
-      ABSL_LOCKS_EXCLUDED(writer_mutex_, crypto_mutex_) override;
+      ABSL_LOCKS_EXCLUDED(writer_mutex_, encrypt_mutex_) override;
 
   // Closes this EndpointChannel, without tracking the closure in analytics.
   void Close() ABSL_LOCKS_EXCLUDED(is_paused_mutex_) override;
@@ -77,6 +79,10 @@ class BaseEndpointChannel : public EndpointChannel {
   // before entering data phase, where Payloads may be exchanged.
   void EnableEncryption(std::shared_ptr<EncryptionContext> context) override;
 
+  // Seals data frames with |cipher| from here on. Frames the peer sends as D2D
+  // messages are still accepted.
+  void EnableDataFrameCipher(std::shared_ptr<DataFrameCipher> cipher) override;
+
   // Disables encryption on the EndpointChannel.
   void DisableEncryption() override;
 
@@ -112,6 +118,8 @@ class BaseEndpointChannel : public EndpointChannel {
   // Returns the try count of this EndpointChannel.
   int GetTryCount() const override;
 
+  // Also starts reporting this channel's traffic to MetricsRegistry, under
+  // "endpoint/<endpoint_id>/".
   void SetAnalyticsRecorder(analytics::AnalyticsRecorder* analytics_recorder,
                             const std::string& endpoint_id) override;
 
@@ -125,8 +133,19 @@ class BaseEndpointChannel : public EndpointChannel {
   // The default maximum transmit unit/packet size.
   static constexpr int kDefaultMaxTransmitPacketSize = 65536;  // 64 KB
 
-  bool IsEncryptionEnabledLocked() const
-      ABSL_EXCLUSIVE_LOCKS_REQUIRED(crypto_mutex_);
+  struct Metrics {
+    std::shared_ptr<Counter> bytes_read;
+    std::shared_ptr<Counter> bytes_written;
+    std::shared_ptr<Counter> frames_read;
+    std::shared_ptr<Counter> frames_written;
+    // Time to read a frame once its header has arrived.
+    std::shared_ptr<Histogram> read_latency;
+    // Time for Write() to return, including waiting for other writers.
+    std::shared_ptr<Histogram> write_latency;
+    std::shared_ptr<Histogram> encrypt_latency;
+    std::shared_ptr<Histogram> decrypt_latency;
+  };
+
   void UnblockPausedWriter() ABSL_EXCLUSIVE_LOCKS_REQUIRED(is_paused_mutex_);
   void BlockUntilUnpaused() ABSL_EXCLUSIVE_LOCKS_REQUIRED(is_paused_mutex_);
   void CloseIo() ABSL_NO_THREAD_SAFETY_ANALYSIS;
@@ -153,10 +172,21 @@ class BaseEndpointChannel : public EndpointChannel {
   Mutex writer_mutex_;
   OutputStream* writer_ ABSL_PT_GUARDED_BY(writer_mutex_);
 
-  // An encryptor/decryptor. May be null.
-  mutable Mutex crypto_mutex_;
-  std::shared_ptr<EncryptionContext> crypto_context_
-      ABSL_GUARDED_BY(crypto_mutex_) ABSL_PT_GUARDED_BY(crypto_mutex_);
+  // The encryptor and decryptor; both null, or both the same context. The
+  // context keeps separate keys and sequence numbers for each direction, so
+  // a write may encrypt while a read decrypts, and each side only needs to
+  // be serialized with itself.
+  // The optional data frame ciphers follow the same pattern.
+  mutable Mutex encrypt_mutex_;
+  std::shared_ptr<EncryptionContext> encrypt_context_
+      ABSL_GUARDED_BY(encrypt_mutex_) ABSL_PT_GUARDED_BY(encrypt_mutex_);
+  std::shared_ptr<DataFrameCipher> encrypt_cipher_
+      ABSL_GUARDED_BY(encrypt_mutex_) ABSL_PT_GUARDED_BY(encrypt_mutex_);
+  mutable Mutex decrypt_mutex_;
+  std::shared_ptr<EncryptionContext> decrypt_context_
+      ABSL_GUARDED_BY(decrypt_mutex_) ABSL_PT_GUARDED_BY(decrypt_mutex_);
+  std::shared_ptr<DataFrameCipher> decrypt_cipher_
+      ABSL_GUARDED_BY(decrypt_mutex_) ABSL_PT_GUARDED_BY(decrypt_mutex_);
 
   mutable Mutex is_paused_mutex_;
   ConditionVariable is_paused_cond_{&is_paused_mutex_};
@@ -171,6 +201,10 @@ class BaseEndpointChannel : public EndpointChannel {
 
   analytics::AnalyticsRecorder* analytics_recorder_ = nullptr;
   std::string endpoint_id_ = "";
+
+  // Null until the endpoint is known. Accessed with std::atomic_load() and
+  // std::atomic_store(), since reads and writes may already be going on.
+  std::shared_ptr<const Metrics> metrics_;
 };
 
 }  // namespace connections
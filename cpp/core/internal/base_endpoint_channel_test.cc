@@ -22,6 +22,7 @@
 #include "securegcm/ukey2_handshake.h"
 #include "gmock/gmock.h"
 #include "gtest/gtest.h"
+#include "absl/strings/str_cat.h"
 #include "absl/synchronization/mutex.h"
 #include "absl/time/time.h"
 #include "core/internal/encryption_runner.h"
@@ -287,6 +288,103 @@ TEST(BaseEndpointChannelTest, EncryptedReadWriteCanNotBeIntercepted) {
   channel_b.Close(DisconnectionReason::REMOTE_DISCONNECTION);
 }
 
+TEST(BaseEndpointChannelTest, EncryptedReadsAndWritesRunConcurrently) {
+  constexpr int kMessageCount = 100;
+  Pipe pipe_a;  // channel_a writes to pipe_a, reads from pipe_b.
+  Pipe pipe_b;  // channel_b writes to pipe_b, reads from pipe_a.
+  TestEndpointChannel channel_a(&pipe_b.GetInputStream(),
+                                &pipe_a.GetOutputStream());
+  TestEndpointChannel channel_b(&pipe_a.GetInputStream(),
+                                &pipe_b.GetOutputStream());
+  auto [context_a, context_b] = DoDhKeyExchange(&channel_a, &channel_b);
+  ASSERT_NE(context_a, nullptr);
+  ASSERT_NE(context_b, nullptr);
+  channel_a.EnableEncryption(context_a);
+  channel_b.EnableEncryption(context_b);
+
+  // Both channels read and write at the same time, so each one decrypts while
+  // it also encrypts.
+  MultiThreadExecutor executor(4);
+  CountDownLatch latch(4);
+  for (TestEndpointChannel* channel : {&channel_a, &channel_b}) {
+    executor.Execute([channel, &latch]() {
+      for (int i = 0; i < kMessageCount; i++) {
+        ByteArray message(absl::StrCat("message ", i));
+        EXPECT_TRUE(channel->Write(message).Ok());
+      }
+      latch.CountDown();
+    });
+    executor.Execute([channel, &latch]() {
+      for (int i = 0; i < kMessageCount; i++) {
+        ExceptionOr<ByteArray> message = channel->Read();
+        ASSERT_TRUE(message.ok());
+        EXPECT_EQ(message.result(), ByteArray(absl::StrCat("message ", i)));
+      }
+      latch.CountDown();
+    });
+  }
+  EXPECT_TRUE(latch.Await(absl::Milliseconds(5000)).result());
+
+  channel_a.Close(DisconnectionReason::LOCAL_DISCONNECTION);
+  channel_b.Close(DisconnectionReason::REMOTE_DISCONNECTION);
+}
+
+TEST(BaseEndpointChannelTest, DataFrameCipherSealsFrames) {
+  Pipe pipe_a;  // channel_a writes to pipe_a, reads from pipe_b.
+  Pipe pipe_b;  // channel_b writes to pipe_b, reads from pipe_a.
+  TestEndpointChannel channel_a(&pipe_b.GetInputStream(),
+                                &pipe_a.GetOutputStream());
+  TestEndpointChannel channel_b(&pipe_a.GetInputStream(),
+                                &pipe_b.GetOutputStream());
+  auto [context_a, context_b] = DoDhKeyExchange(&channel_a, &channel_b);
+  ASSERT_NE(context_a, nullptr);
+  ASSERT_NE(context_b, nullptr);
+  std::shared_ptr<DataFrameCipher> cipher_a =
+      DataFrameCipher::Create(*context_a);
+  std::shared_ptr<DataFrameCipher> cipher_b =
+      DataFrameCipher::Create(*context_b);
+  ASSERT_NE(cipher_a, nullptr);
+  ASSERT_NE(cipher_b, nullptr);
+  channel_a.EnableEncryption(context_a);
+  channel_a.EnableDataFrameCipher(cipher_a);
+  channel_b.EnableEncryption(context_b);
+  channel_b.EnableDataFrameCipher(cipher_b);
+
+  for (int i = 0; i < 3; i++) {
+    ByteArray tx_message(absl::StrCat("data message ", i));
+    EXPECT_TRUE(channel_a.Write(tx_message).Ok());
+    EXPECT_TRUE(channel_b.Write(tx_message).Ok());
+    EXPECT_EQ(channel_b.Read().result(), tx_message);
+    EXPECT_EQ(channel_a.Read().result(), tx_message);
+  }
+
+  channel_a.Close(DisconnectionReason::LOCAL_DISCONNECTION);
+  channel_b.Close(DisconnectionReason::REMOTE_DISCONNECTION);
+}
+
+TEST(BaseEndpointChannelTest, DataFrameCipherStillReadsD2dMessages) {
+  Pipe pipe_a;  // channel_a writes to pipe_a, reads from pipe_b.
+  Pipe pipe_b;  // channel_b writes to pipe_b, reads from pipe_a.
+  TestEndpointChannel channel_a(&pipe_b.GetInputStream(),
+                                &pipe_a.GetOutputStream());
+  TestEndpointChannel channel_b(&pipe_a.GetInputStream(),
+                                &pipe_b.GetOutputStream());
+  auto [context_a, context_b] = DoDhKeyExchange(&channel_a, &channel_b);
+  ASSERT_NE(context_a, nullptr);
+  ASSERT_NE(context_b, nullptr);
+  channel_a.EnableEncryption(context_a);
+  channel_b.EnableEncryption(context_b);
+  channel_b.EnableDataFrameCipher(DataFrameCipher::Create(*context_b));
+
+  // channel_a has not switched to sealed data frames yet.
+  ByteArray tx_message{"data message"};
+  EXPECT_TRUE(channel_a.Write(tx_message).Ok());
+  EXPECT_EQ(channel_b.Read().result(), tx_message);
+
+  channel_a.Close(DisconnectionReason::LOCAL_DISCONNECTION);
+  channel_b.Close(DisconnectionReason::REMOTE_DISCONNECTION);
+}
+
 TEST(BaseEndpointChannelTest, CanBesuspendedAndResumed) {
   // Setup test communication environment.
   Pipe pipe_a;  // channel_a writes to pipe_a, reads from pipe_b.
@@ -14,6 +14,7 @@
 
 #include "core/internal/base_pcp_handler.h"
 
+#include <algorithm>
 #include <cassert>
 #include <cinttypes>
 #include <cstdlib>
@@ -25,6 +26,7 @@
 #include "absl/container/flat_hash_set.h"
 #include "absl/strings/escaping.h"
 #include "absl/types/span.h"
+#include "core/internal/data_frame_cipher.h"
 #include "core/internal/mediums/utils.h"
 #include "core/internal/offline_frames.h"
 #include "core/internal/pcp_handler.h"
@@ -39,11 +41,23 @@ namespace nearby {
 namespace connections {
 
 using ::location::nearby::proto::connections::Medium;
+using ::securegcm::D2DConnectionContextV1;
 using ::securegcm::UKey2Handshake;
 
 constexpr absl::Duration BasePcpHandler::kConnectionRequestReadTimeout;
 constexpr absl::Duration BasePcpHandler::kRejectedConnectionCloseDelay;
 
+namespace {
+
+// Returns the highest AEAD data frame version we announce; 0 if disabled.
+std::int32_t GetLocalAeadDataFrameVersion() {
+  return FeatureFlags::GetInstance().GetFlags().enable_aead_data_frames
+             ? DataFrameCipher::kVersion
+             : 0;
+}
+
+}  // namespace
+
 BasePcpHandler::BasePcpHandler(Mediums* mediums,
                                EndpointManager* endpoint_manager,
                                EndpointChannelManager* channel_manager,
@@ -219,7 +233,7 @@ Status BasePcpHandler::StartDiscovery(ClientProxy* client,
 
         // Now that we've succeeded, mark the client as discovering and clear
         // out any old endpoints we had discovered.
-        discovered_endpoints_.clear();
+        discovered_endpoints_.Clear();
         client->StartedDiscovery(service_id, GetStrategy(), listener,
                                  absl::MakeSpan(result.mediums),
                                  discovery_options);
@@ -302,7 +316,8 @@ EncryptionRunner::ResultListener BasePcpHandler::GetResultListener() {
                  raw_auth_token]() RUN_ON_PCP_HANDLER_THREAD() mutable {
                   OnEncryptionSuccessRunnable(
                       endpoint_id, std::unique_ptr<UKey2Handshake>(raw_ukey2),
-                      auth_token, raw_auth_token);
+                      /*resumed_context=*/nullptr, auth_token,
+                      raw_auth_token);
                 });
           },
       .on_failure_cb =
@@ -317,11 +332,28 @@ EncryptionRunner::ResultListener BasePcpHandler::GetResultListener() {
                   OnEncryptionFailureRunnable(endpoint_id, channel);
                 });
           },
+      .on_resumed_cb =
+          [this](const std::string& endpoint_id,
+                 std::unique_ptr<D2DConnectionContextV1> context,
+                 const std::string& auth_token,
+                 const ByteArray& raw_auth_token) {
+            RunOnPcpHandlerThread(
+                "encryption-resumed",
+                [this, endpoint_id, raw_context = context.release(),
+                 auth_token,
+                 raw_auth_token]() RUN_ON_PCP_HANDLER_THREAD() mutable {
+                  OnEncryptionSuccessRunnable(
+                      endpoint_id, /*ukey2=*/nullptr,
+                      std::unique_ptr<D2DConnectionContextV1>(raw_context),
+                      auth_token, raw_auth_token);
+                });
+          },
   };
 }
 
 void BasePcpHandler::OnEncryptionSuccessRunnable(
     const std::string& endpoint_id, std::unique_ptr<UKey2Handshake> ukey2,
+    std::unique_ptr<D2DConnectionContextV1> resumed_context,
     const std::string& auth_token, const ByteArray& raw_auth_token) {
   // Quick fail if we've been removed from pending connections while we were
   // busy running UKEY2.
@@ -336,7 +368,7 @@ void BasePcpHandler::OnEncryptionSuccessRunnable(
   BasePcpHandler::PendingConnectionInfo& connection_info = it->second;
   Medium medium = connection_info.channel->GetMedium();
 
-  if (!ukey2) {
+  if (!ukey2 && !resumed_context) {
     // Fail early, if there is no crypto context.
     ProcessPreConnectionInitiationFailure(
         connection_info.client, medium, endpoint_id,
@@ -346,7 +378,11 @@ void BasePcpHandler::OnEncryptionSuccessRunnable(
     return;
   }
 
-  connection_info.SetCryptoContext(std::move(ukey2));
+  if (resumed_context) {
+    connection_info.SetCryptoContext(std::move(resumed_context));
+  } else {
+    connection_info.SetCryptoContext(std::move(ukey2));
+  }
   connection_info.connection_token = GetHashedConnectionToken(raw_auth_token);
   NEARBY_LOGS(INFO)
       << "Register encrypted connection; wait for response; endpoint_id="
@@ -357,6 +393,7 @@ void BasePcpHandler::OnEncryptionSuccessRunnable(
 
   // Now we register our endpoint so that we can listen for both sides to
   // accept.
+  TraceSpan register_span("pcp", "register_endpoint", endpoint_id);
   endpoint_manager_->RegisterEndpoint(
       connection_info.client, endpoint_id,
       {
@@ -387,9 +424,18 @@ void BasePcpHandler::OnEncryptionSuccessRunnable(
               connection_info.options.keep_alive_interval_millis,
           .keep_alive_timeout_millis =
               connection_info.options.keep_alive_timeout_millis,
+          .max_send_bytes_per_second =
+              connection_info.options.max_send_bytes_per_second,
+          .max_send_bytes_per_second_per_medium =
+              connection_info.options.max_send_bytes_per_second_per_medium,
       },
       std::move(connection_info.channel), connection_info.listener,
       connection_info.connection_token);
+  register_span.End();
+  if (connection_info.is_incoming) {
+    connection_info.client->SetRemotePayloadCompressionSupported(
+        endpoint_id, connection_info.supports_payload_compression);
+  }
 
   LogConnectionAttemptSuccess(endpoint_id, connection_info);
 
@@ -439,6 +485,7 @@ Status BasePcpHandler::RequestConnection(ClientProxy* client,
   RunOnPcpHandlerThread(
       "request-connection", [this, client, &info, options, endpoint_id,
                              result]() RUN_ON_PCP_HANDLER_THREAD() {
+        NEARBY_TRACE_SPAN("pcp", "request_connection", endpoint_id);
         absl::Time start_time = SystemClock::ElapsedRealtime();
 
         // If we already have a pending connection, then we shouldn't allow any
@@ -495,7 +542,9 @@ Status BasePcpHandler::RequestConnection(ClientProxy* client,
           if (!MediumSupportedByClientOptions(connect_endpoint->medium,
                                               options))
             continue;
+          TraceSpan connect_span("pcp", "connect_impl", endpoint_id);
           connect_impl_result = ConnectImpl(client, connect_endpoint);
+          connect_span.End();
           if (connect_impl_result.status.Ok()) {
             channel = std::move(connect_impl_result.endpoint_channel);
             break;
@@ -523,11 +572,13 @@ Status BasePcpHandler::RequestConnection(ClientProxy* client,
 
         // The first message we have to send, after connecting, is to tell the
         // endpoint about ourselves.
+        TraceSpan write_span("pcp", "write_connection_request", endpoint_id);
         Exception write_exception = WriteConnectionRequestFrame(
             channel.get(), client->GetLocalEndpointId(), info.endpoint_info,
             nonce, GetSupportedConnectionMediumsByPriority(options),
             options.keep_alive_interval_millis,
             options.keep_alive_timeout_millis);
+        write_span.End();
         if (!write_exception.Ok()) {
           NEARBY_LOGS(INFO) << "Failed to send connection request: endpoint_id="
                             << endpoint_id;
@@ -554,6 +605,8 @@ Status BasePcpHandler::RequestConnection(ClientProxy* client,
         pendingConnectionInfo.nonce = nonce;
         pendingConnectionInfo.is_incoming = false;
         pendingConnectionInfo.start_time = start_time;
+        pendingConnectionInfo.trace_span =
+            TraceSpan::Async("pcp", "pending_connection", endpoint_id);
         pendingConnectionInfo.listener = info.listener;
         pendingConnectionInfo.options = options;
         pendingConnectionInfo.result = result;
@@ -609,24 +662,21 @@ BasePcpHandler::GetSupportedConnectionMediumsByPriority(
 // Get any single discovered endpoint for a given endpoint_id.
 BasePcpHandler::DiscoveredEndpoint* BasePcpHandler::GetDiscoveredEndpoint(
     const std::string& endpoint_id) {
-  auto it = discovered_endpoints_.find(endpoint_id);
-  if (it == discovered_endpoints_.end()) {
-    return nullptr;
-  }
-  return it->second.get();
+  return discovered_endpoints_.FindFirst(endpoint_id);
 }
 
 std::vector<BasePcpHandler::DiscoveredEndpoint*>
 BasePcpHandler::GetDiscoveredEndpoints(const std::string& endpoint_id) {
-  std::vector<BasePcpHandler::DiscoveredEndpoint*> result;
-  auto it = discovered_endpoints_.equal_range(endpoint_id);
-  for (auto item = it.first; item != it.second; item++) {
-    result.push_back(item->second.get());
-  }
-  std::sort(result.begin(), result.end(),
-            [this](DiscoveredEndpoint* a, DiscoveredEndpoint* b) -> bool {
-              return IsPreferred(*a, *b);
-            });
+  std::vector<BasePcpHandler::DiscoveredEndpoint*> result =
+      discovered_endpoints_.FindAll(endpoint_id);
+  if (result.size() < 2) return result;
+  std::vector<proto::connections::Medium> mediums =
+      GetConnectionMediumsByPriority();
+  std::stable_sort(
+      result.begin(), result.end(),
+      [this, &mediums](DiscoveredEndpoint* a, DiscoveredEndpoint* b) -> bool {
+        return IsPreferred(*a, *b, mediums);
+      });
 
   return result;
 }
@@ -634,13 +684,7 @@ BasePcpHandler::GetDiscoveredEndpoints(const std::string& endpoint_id) {
 std::vector<BasePcpHandler::DiscoveredEndpoint*>
 BasePcpHandler::GetDiscoveredEndpoints(
     const proto::connections::Medium medium) {
-  std::vector<BasePcpHandler::DiscoveredEndpoint*> result;
-  for (const auto& item : discovered_endpoints_) {
-    if (item.second->medium == medium) {
-      result.push_back(item.second.get());
-    }
-  }
-  return result;
+  return discovered_endpoints_.FindAll(medium);
 }
 
 mediums::WebrtcPeerId BasePcpHandler::CreatePeerIdFromAdvertisement(
@@ -688,7 +732,10 @@ Exception BasePcpHandler::WriteConnectionRequestFrame(
   return endpoint_channel->Write(parser::ForConnectionRequest(
       local_endpoint_id, local_endpoint_info, nonce, /*supports_5_ghz =*/false,
       /*bssid=*/std::string{}, supported_mediums, keep_alive_interval_millis,
-      keep_alive_timeout_millis));
+      keep_alive_timeout_millis,
+      FeatureFlags::GetInstance().GetFlags().enable_payload_compression,
+      GetLocalAeadDataFrameVersion(),
+      FeatureFlags::GetInstance().GetFlags().enable_session_resumption));
 }
 
 void BasePcpHandler::ProcessPreConnectionInitiationFailure(
@@ -774,7 +821,15 @@ Status BasePcpHandler::AcceptConnection(
         }
 
         Exception write_exception =
-            channel->Write(parser::ForConnectionResponse(Status::kSuccess));
+            channel->Write(parser::ForConnectionResponse(
+                Status::kSuccess,
+                FeatureFlags::GetInstance()
+                    .GetFlags()
+                    .enable_payload_compression,
+                GetLocalAeadDataFrameVersion(),
+                FeatureFlags::GetInstance()
+                    .GetFlags()
+                    .enable_session_resumption));
         if (!write_exception.Ok()) {
           NEARBY_LOGS(INFO)
               << "AcceptConnection: failed to send response: endpoint_id="
@@ -831,7 +886,10 @@ Status BasePcpHandler::RejectConnection(ClientProxy* client,
         }
 
         Exception write_exception = channel->Write(
-            parser::ForConnectionResponse(Status::kConnectionRejected));
+            parser::ForConnectionResponse(Status::kConnectionRejected,
+                                          FeatureFlags::GetInstance()
+                                              .GetFlags()
+                                              .enable_payload_compression));
         if (!write_exception.Ok()) {
           NEARBY_LOGS(INFO)
               << "RejectConnection: failed to send response: endpoint_id="
@@ -888,6 +946,15 @@ void BasePcpHandler::OnIncomingFrame(OfflineFrame& frame,
           NEARBY_LOGS(INFO)
               << "OnConnectionResponse: remote accepted; endpoint_id="
               << endpoint_id;
+          client->SetRemotePayloadCompressionSupported(
+              endpoint_id, connection_response.supports_payload_compression());
+          auto pending = pending_connections_.find(endpoint_id);
+          if (pending != pending_connections_.end()) {
+            pending->second.aead_data_frame_version =
+                connection_response.aead_data_frame_version();
+            pending->second.supports_session_resumption =
+                connection_response.supports_session_resumption();
+          }
           client->RemoteEndpointAcceptedConnection(endpoint_id);
         } else {
           NEARBY_LOGS(INFO)
@@ -938,39 +1005,31 @@ void BasePcpHandler::OnEndpointFound(
   std::string& endpoint_id = endpoint->endpoint_id;
   NEARBY_LOGS(INFO) << "OnEndpointFound: id=" << endpoint_id << " [enter]";
 
-  auto range = discovered_endpoints_.equal_range(endpoint->endpoint_id);
-
-  DiscoveredEndpoint* owned_endpoint = nullptr;
-  for (auto& item = range.first; item != range.second; ++item) {
-    auto& discovered_endpoint = item->second;
-    if (discovered_endpoint->medium != endpoint->medium) continue;
+  DiscoveredEndpoint* discovered_endpoint =
+      discovered_endpoints_.Find(endpoint_id, endpoint->medium);
+  if (discovered_endpoint != nullptr) {
     // Check if there was a info change. If there was, report the previous
-    // endpoint as lost.
+    // endpoint as lost, and this one as found.
     if (discovered_endpoint->endpoint_info != endpoint->endpoint_info) {
       OnEndpointLost(client, *discovered_endpoint);
-      discovered_endpoint = endpoint;  // Replace endpoint.
       OnEndpointFound(client, std::move(endpoint));
-      return;
-    } else {
-      owned_endpoint = endpoint.get();
-      break;
     }
+    return;
   }
 
-  if (!owned_endpoint) {
-    owned_endpoint =
-        discovered_endpoints_.emplace(endpoint_id, std::move(endpoint))
-            ->second.get();
-  }
+  bool is_first_medium = !discovered_endpoints_.Contains(endpoint_id);
+  DiscoveredEndpoint* owned_endpoint =
+      discovered_endpoints_.Add(std::move(endpoint));
 
-  // Range is empty: this is the first endpoint we discovered so far.
+  // This is the first endpoint we discovered so far with this endpoint_id.
   // Report this endpoint_id to client.
-  if (range.first == range.second) {
+  if (is_first_medium) {
     NEARBY_LOGS(INFO) << "Adding new endpoint: endpoint_id=" << endpoint_id;
     // And, as it's the first time, report it to the client.
     client->OnEndpointFound(
         owned_endpoint->service_id, owned_endpoint->endpoint_id,
         owned_endpoint->endpoint_info, owned_endpoint->medium);
+    OnNewEndpointDiscovered(client);
   } else {
     NEARBY_LOGS(INFO) << "Adding new medium for endpoint: endpoint_id="
                       << endpoint_id << "; medium=" << owned_endpoint->medium;
@@ -980,7 +1039,8 @@ void BasePcpHandler::OnEndpointFound(
 void BasePcpHandler::OnEndpointLost(
     ClientProxy* client, const BasePcpHandler::DiscoveredEndpoint& endpoint) {
   // Look up the DiscoveredEndpoint we have in our cache.
-  const auto* discovered_endpoint = GetDiscoveredEndpoint(endpoint.endpoint_id);
+  const auto* discovered_endpoint =
+      discovered_endpoints_.Find(endpoint.endpoint_id, endpoint.medium);
   if (discovered_endpoint == nullptr) {
     NEARBY_LOGS(INFO) << "No previous endpoint (nothing to lose): endpoint_id="
                       << endpoint.endpoint_id;
@@ -1000,17 +1060,19 @@ void BasePcpHandler::OnEndpointLost(
     return;
   }
 
-  auto item = discovered_endpoints_.extract(endpoint.endpoint_id);
-  if (!discovered_endpoints_.count(endpoint.endpoint_id)) {
+  // |endpoint| may be the one we're removing, so keep it alive until we're
+  // done.
+  std::shared_ptr<DiscoveredEndpoint> removed_endpoint =
+      discovered_endpoints_.Remove(endpoint.endpoint_id, endpoint.medium);
+  if (!discovered_endpoints_.Contains(endpoint.endpoint_id)) {
     client->OnEndpointLost(endpoint.service_id, endpoint.endpoint_id);
   }
 }
 
 bool BasePcpHandler::IsPreferred(
     const BasePcpHandler::DiscoveredEndpoint& new_endpoint,
-    const BasePcpHandler::DiscoveredEndpoint& old_endpoint) {
-  std::vector<proto::connections::Medium> mediums =
-      GetConnectionMediumsByPriority();
+    const BasePcpHandler::DiscoveredEndpoint& old_endpoint,
+    const std::vector<proto::connections::Medium>& mediums) {
   // As we iterate through the list of mediums, we see if we run into the new
   // endpoint's medium or the old endpoint's medium first.
   for (const auto& medium : mediums) {
@@ -1040,6 +1102,7 @@ Exception BasePcpHandler::OnIncomingConnection(
     ClientProxy* client, const ByteArray& remote_endpoint_info,
     std::unique_ptr<EndpointChannel> channel,
     proto::connections::Medium medium) {
+  NEARBY_TRACE_SPAN("pcp", "incoming_connection");
   absl::Time start_time = SystemClock::ElapsedRealtime();
 
   //  Fixes an NPE in ClientProxy.OnConnectionAccepted. The crash happened when
@@ -1137,6 +1200,12 @@ Exception BasePcpHandler::OnIncomingConnection(
     options.keep_alive_timeout_millis =
         FeatureFlags::GetInstance().GetFlags().keep_alive_timeout_millis;
   }
+  // Send rate limits are local policy, so they come from our own options.
+  ConnectionOptions advertising_options = client->GetAdvertisingOptions();
+  options.max_send_bytes_per_second =
+      advertising_options.max_send_bytes_per_second;
+  options.max_send_bytes_per_second_per_medium =
+      advertising_options.max_send_bytes_per_second_per_medium;
 
   // We've successfully connected to the device, and are now about to jump on to
   // the EncryptionRunner thread to start running our encryption protocol. We'll
@@ -1150,10 +1219,18 @@ Exception BasePcpHandler::OnIncomingConnection(
   pendingConnectionInfo.nonce = connection_request.nonce();
   pendingConnectionInfo.is_incoming = true;
   pendingConnectionInfo.start_time = start_time;
+  pendingConnectionInfo.trace_span = TraceSpan::Async(
+      "pcp", "pending_connection", connection_request.endpoint_id());
   pendingConnectionInfo.listener = advertising_listener_;
   pendingConnectionInfo.options = options;
   pendingConnectionInfo.supported_mediums =
       parser::ConnectionRequestMediumsToMediums(connection_request);
+  pendingConnectionInfo.supports_payload_compression =
+      connection_request.supports_payload_compression();
+  pendingConnectionInfo.aead_data_frame_version =
+      connection_request.aead_data_frame_version();
+  pendingConnectionInfo.supports_session_resumption =
+      connection_request.supports_session_resumption();
   pendingConnectionInfo.channel = std::move(channel);
 
   auto* owned_channel = pending_connections_
@@ -1246,19 +1323,17 @@ bool BasePcpHandler::AppendRemoteBluetoothMacAddressEndpoint(
     return false;
   }
 
-  auto it = discovered_endpoints_.equal_range(endpoint_id);
-  if (it.first == it.second) {
+  auto endpoint = discovered_endpoints_.FindFirst(endpoint_id);
+  if (endpoint == nullptr) {
     return false;
   }
-  auto endpoint = it.first->second.get();
-  for (auto item = it.first; item != it.second; item++) {
-    if (item->second->medium == proto::connections::Medium::BLUETOOTH) {
-      NEARBY_LOGS(INFO)
-          << "Cannot append remote Bluetooth MAC Address endpoint, because "
-             "the endpoint has already been found over Bluetooth ["
-          << remote_bluetooth_mac_address << "]";
-      return false;
-    }
+  if (discovered_endpoints_.Find(endpoint_id,
+                                 proto::connections::Medium::BLUETOOTH)) {
+    NEARBY_LOGS(INFO)
+        << "Cannot append remote Bluetooth MAC Address endpoint, because "
+           "the endpoint has already been found over Bluetooth ["
+        << remote_bluetooth_mac_address << "]";
+    return false;
   }
 
   auto remote_bluetooth_device =
@@ -1278,7 +1353,7 @@ bool BasePcpHandler::AppendRemoteBluetoothMacAddressEndpoint(
           remote_bluetooth_device,
       });
 
-  discovered_endpoints_.emplace(endpoint_id, std::move(bluetooth_endpoint));
+  discovered_endpoints_.Add(std::move(bluetooth_endpoint));
   return true;
 }
 
@@ -1290,11 +1365,17 @@ bool BasePcpHandler::AppendWebRTCEndpoint(
   }
 
   bool should_connect_web_rtc = false;
-  auto it = discovered_endpoints_.equal_range(endpoint_id);
-  if (it.first == it.second) return false;
-  auto endpoint = it.first->second.get();
-  for (auto item = it.first; item != it.second; item++) {
-    if (item->second->web_rtc_state != WebRtcState::kUnconnectable) {
+  auto endpoints = discovered_endpoints_.FindAll(endpoint_id);
+  if (endpoints.empty()) return false;
+  if (discovered_endpoints_.Find(endpoint_id,
+                                 proto::connections::Medium::WEB_RTC)) {
+    NEARBY_LOGS(INFO) << "Cannot append Web RTC endpoint, because the endpoint "
+                         "has already been appended over Web RTC";
+    return false;
+  }
+  auto endpoint = endpoints.front();
+  for (auto item : endpoints) {
+    if (item->web_rtc_state != WebRtcState::kUnconnectable) {
       should_connect_web_rtc = true;
       break;
     }
@@ -1308,7 +1389,7 @@ bool BasePcpHandler::AppendWebRTCEndpoint(
                                     endpoint->endpoint_info),
   });
 
-  discovered_endpoints_.emplace(endpoint_id, std::move(webrtc_endpoint));
+  discovered_endpoints_.Add(std::move(webrtc_endpoint));
   return true;
 }
 
@@ -1331,6 +1412,8 @@ void BasePcpHandler::EvaluateConnectionResult(ClientProxy* client,
     return;
   }
 
+  NEARBY_TRACE_SPAN("pcp", "evaluate_connection_result", endpoint_id);
+
   // Clean up the endpoint channel from our list of 'pending' connections. It's
   // no longer pending.
   auto it = pending_connections_.find(endpoint_id);
@@ -1354,15 +1437,41 @@ void BasePcpHandler::EvaluateConnectionResult(ClientProxy* client,
     // channels
     // Now, after both parties accepted connection (presumably after verifying &
     // matching security tokens), we are allowed to extract the shared key.
-    auto ukey2 = std::move(connection_info.ukey2);
-    bool succeeded = ukey2->VerifyHandshake();
-    CHECK(succeeded);  // If this fails, it's a UKEY2 protocol bug.
-    auto context = ukey2->ToConnectionContext();
-    CHECK(context);  // there is no way how this can fail, if Verify succeeded.
-    // If it did, it's a UKEY2 protocol bug.
+    std::unique_ptr<D2DConnectionContextV1> context;
+    if (connection_info.resumed_context) {
+      context = std::move(connection_info.resumed_context);
+    } else {
+      auto ukey2 = std::move(connection_info.ukey2);
+      bool succeeded = ukey2->VerifyHandshake();
+      CHECK(succeeded);  // If this fails, it's a UKEY2 protocol bug.
+      context = ukey2->ToConnectionContext();
+      // There is no way how this can fail, if Verify succeeded.
+      // If it did, it's a UKEY2 protocol bug.
+      CHECK(context);
+    }
 
-    channel_manager_->EncryptChannelForEndpoint(endpoint_id,
-                                                std::move(context));
+    // Keep a secret for skipping UKEY2 the next time we connect to this
+    // endpoint.
+    if (FeatureFlags::GetInstance().GetFlags().enable_session_resumption &&
+        connection_info.supports_session_resumption) {
+      encryption_runner_.SaveResumptionSecret(endpoint_id, *context,
+                                              !connection_info.is_incoming);
+    }
+
+    // Data frames are sealed with AEAD only if both sides can read them;
+    // older peers keep getting D2D messages.
+    std::unique_ptr<DataFrameCipher> data_frame_cipher;
+    if (std::min(GetLocalAeadDataFrameVersion(),
+                 connection_info.aead_data_frame_version) >=
+        DataFrameCipher::kVersion) {
+      data_frame_cipher = DataFrameCipher::Create(*context);
+    }
+    NEARBY_LOGS(INFO) << "Encrypting channel with "
+                      << (data_frame_cipher ? "AEAD data frames" : "D2D")
+                      << "; endpoint_id=" << endpoint_id;
+
+    channel_manager_->EncryptChannelForEndpoint(
+        endpoint_id, std::move(context), std::move(data_frame_cipher));
 
     client->GetAnalyticsRecorder().OnConnectionEstablished(
         endpoint_id,
@@ -1526,6 +1635,11 @@ void BasePcpHandler::PendingConnectionInfo::SetCryptoContext(
   this->ukey2 = std::move(ukey2);
 }
 
+void BasePcpHandler::PendingConnectionInfo::SetCryptoContext(
+    std::unique_ptr<D2DConnectionContextV1> resumed_context) {
+  this->resumed_context = std::move(resumed_context);
+}
+
 BasePcpHandler::PendingConnectionInfo::~PendingConnectionInfo() {
   auto future_status = result.lock();
   if (future_status && !future_status->IsSet()) {
@@ -1540,6 +1654,7 @@ BasePcpHandler::PendingConnectionInfo::~PendingConnectionInfo() {
   // Destroy crypto context now; for some reason, crypto context destructor
   // segfaults if it is not destroyed here.
   this->ukey2.reset();
+  this->resumed_context.reset();
 }
 
 void BasePcpHandler::PendingConnectionInfo::LocalEndpointAcceptedConnection(
@@ -22,11 +22,11 @@
 
 #include "securegcm/d2d_connection_context_v1.h"
 #include "securegcm/ukey2_handshake.h"
-#include "absl/container/btree_map.h"
 #include "absl/container/flat_hash_map.h"
 #include "absl/time/time.h"
 #include "core/internal/bwu_manager.h"
 #include "core/internal/client_proxy.h"
+#include "core/internal/discovered_endpoint_index.h"
 #include "core/internal/encryption_runner.h"
 #include "core/internal/endpoint_channel_manager.h"
 #include "core/internal/endpoint_manager.h"
@@ -51,6 +51,7 @@
 #include "platform/public/scheduled_executor.h"
 #include "platform/public/single_thread_executor.h"
 #include "platform/public/system_clock.h"
+#include "platform/public/tracing.h"
 
 namespace location {
 namespace nearby {
@@ -276,6 +277,11 @@ class BasePcpHandler : public PcpHandler,
                                         DiscoveredEndpoint* endpoint)
       RUN_ON_PCP_HANDLER_THREAD() = 0;
 
+  // Called when discovery finds an endpoint_id it hadn't found yet, on any
+  // medium.
+  virtual void OnNewEndpointDiscovered(ClientProxy* client)
+      RUN_ON_PCP_HANDLER_THREAD() {}
+
   virtual std::vector<proto::connections::Medium>
   GetConnectionMediumsByPriority() = 0;
   virtual proto::connections::Medium GetDefaultUpgradeMedium() = 0;
@@ -316,6 +322,11 @@ class BasePcpHandler : public PcpHandler,
     // ownership here.
     void SetCryptoContext(std::unique_ptr<securegcm::UKey2Handshake> ukey2);
 
+    // Passes the context of a resumed session, which needs no handshake
+    // verification, for temporary ownership here.
+    void SetCryptoContext(
+        std::unique_ptr<securegcm::D2DConnectionContextV1> resumed_context);
+
     // Pass Accept notification to client.
     void LocalEndpointAcceptedConnection(
         const std::string& endpoint_id,
@@ -331,6 +342,8 @@ class BasePcpHandler : public PcpHandler,
     std::int32_t nonce = 0;
     bool is_incoming = false;
     absl::Time start_time{absl::InfinitePast()};
+    // Traces the connection attempt while it is pending.
+    TraceSpan trace_span;
     // Client callbacks. Always valid.
     ConnectionListener listener;
     ConnectionOptions options;
@@ -342,6 +355,18 @@ class BasePcpHandler : public PcpHandler,
     // Only (possibly) vector for incoming connections.
     std::vector<proto::connections::Medium> supported_mediums;
 
+    // Only set for incoming connections; whether the remote endpoint can read
+    // compressed payload chunks.
+    bool supports_payload_compression = false;
+
+    // Highest AEAD data frame version the remote endpoint can read, from its
+    // connection request or response; 0 if it only reads D2D messages.
+    std::int32_t aead_data_frame_version = 0;
+
+    // Whether the remote endpoint keeps session resumption secrets, from its
+    // connection request or response.
+    bool supports_session_resumption = false;
+
     // Keep track of a channel before we pass it to EndpointChannelManager.
     std::unique_ptr<EndpointChannel> channel;
 
@@ -352,6 +377,8 @@ class BasePcpHandler : public PcpHandler,
     // accepted. Crypto context is passed over to channel_manager_ before
     // switching to connected state, where Payload may be exchanged.
     std::unique_ptr<securegcm::UKey2Handshake> ukey2;
+    // Set instead of |ukey2| when an earlier session was resumed.
+    std::unique_ptr<securegcm::D2DConnectionContextV1> resumed_context;
 
     // Used in AnalyticsRecorder for devices connection tracking.
     std::string connection_token;
@@ -371,9 +398,11 @@ class BasePcpHandler : public PcpHandler,
 
   EncryptionRunner::ResultListener GetResultListener();
 
+  // Exactly one of |ukey2| and |resumed_context| is expected to be set.
   void OnEncryptionSuccessRunnable(
       const std::string& endpoint_id,
       std::unique_ptr<securegcm::UKey2Handshake> ukey2,
+      std::unique_ptr<securegcm::D2DConnectionContextV1> resumed_context,
       const std::string& auth_token, const ByteArray& raw_auth_token);
   void OnEncryptionFailureRunnable(const std::string& endpoint_id,
                                    EndpointChannel* endpoint_channel);
@@ -394,9 +423,12 @@ class BasePcpHandler : public PcpHandler,
   void OnConnectionResponse(ClientProxy* client, const std::string& endpoint_id,
                             const OfflineFrame& frame);
 
-  // Returns true if the new endpoint is preferred over the old endpoint.
-  bool IsPreferred(const BasePcpHandler::DiscoveredEndpoint& new_endpoint,
-                   const BasePcpHandler::DiscoveredEndpoint& old_endpoint);
+  // Returns true if the new endpoint is preferred over the old endpoint,
+  // given the result of GetConnectionMediumsByPriority().
+  bool IsPreferred(
+      const BasePcpHandler::DiscoveredEndpoint& new_endpoint,
+      const BasePcpHandler::DiscoveredEndpoint& old_endpoint,
+      const std::vector<proto::connections::Medium>& mediums_by_priority);
 
   // Returns true, if connection party should respect the specified topology.
   bool ShouldEnforceTopologyConstraints(
@@ -504,9 +536,9 @@ class BasePcpHandler : public PcpHandler,
   // the connection is decided (either accepted or rejected), it should be
   // removed from this map.
   absl::flat_hash_map<std::string, PendingConnectionInfo> pending_connections_;
-  // A map of endpoint id -> DiscoveredEndpoint.
-  absl::btree_multimap<std::string, std::shared_ptr<DiscoveredEndpoint>>
-      discovered_endpoints_;
+  // The endpoints found since discovery started, at most one per endpoint id
+  // and medium.
+  DiscoveredEndpointIndex<DiscoveredEndpoint> discovered_endpoints_;
   // A map of endpoint id -> alarm. These alarms delay closing the
   // EndpointChannel to give the other side enough time to read the rejection
   // message. It's expected that the other side will close the connection
@@ -16,15 +16,54 @@
 
 #include <inttypes.h>
 
+#include <cstring>
+
 #include "absl/strings/escaping.h"
+#include "absl/strings/string_view.h"
 #include "core/internal/base_pcp_handler.h"
-#include "platform/base/base_input_stream.h"
 #include "platform/public/logging.h"
 
 namespace location {
 namespace nearby {
 namespace connections {
 
+namespace {
+
+int HexDigitValue(char c) {
+  if (c >= '0' && c <= '9') return c - '0';
+  if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+  if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+  return -1;
+}
+
+// Like BluetoothUtils::FromString(), but writes the address into |output|
+// instead of allocating. Returns false if |bluetooth_mac_address| isn't a
+// valid, set address.
+bool ParseBluetoothMacAddress(absl::string_view bluetooth_mac_address,
+                              char* output) {
+  std::size_t digit_count = 0;
+  bool is_set = false;
+  for (char c : bluetooth_mac_address) {
+    if (c == ':') continue;
+    int value = HexDigitValue(c);
+    if (value < 0 ||
+        digit_count == BluetoothUtils::kBluetoothMacAddressLength * 2) {
+      return false;
+    }
+    if (digit_count % 2 == 0) {
+      output[digit_count / 2] = static_cast<char>(value << 4);
+    } else {
+      output[digit_count / 2] |= static_cast<char>(value);
+    }
+    is_set |= value != 0;
+    digit_count++;
+  }
+  return is_set &&
+         digit_count == BluetoothUtils::kBluetoothMacAddressLength * 2;
+}
+
+}  // namespace
+
 BleAdvertisement::BleAdvertisement(Version version, Pcp pcp,
                                    const ByteArray& service_id_hash,
                                    const std::string& endpoint_id,
@@ -45,6 +84,27 @@ BleAdvertisement::BleAdvertisement(Version version, Pcp pcp,
                endpoint_info, {}, uwb_address, WebRtcState::kUndefined);
 }
 
+bool BleAdvertisement::MayMatch(bool fast_advertisement,
+                                const ByteArray& ble_advertisement_bytes,
+                                Pcp pcp, const ByteArray& service_id_hash) {
+  int min_advertisement_length = fast_advertisement
+                                     ? kMinFastAdvertisementLength
+                                     : kMinAdvertisementLength;
+  if (ble_advertisement_bytes.size() < min_advertisement_length) return false;
+
+  const char* bytes = ble_advertisement_bytes.data();
+  char expected_version_and_pcp_byte =
+      ((static_cast<char>(Version::kV1) << 5) & kVersionBitmask) |
+      (static_cast<char>(pcp) & kPcpBitmask);
+  if (bytes[0] != expected_version_and_pcp_byte) return false;
+
+  // Fast advertisements don't carry a service_id_hash.
+  if (fast_advertisement) return true;
+  return service_id_hash.size() == kServiceIdHashLength &&
+         std::memcmp(bytes + kVersionAndPcpLength, service_id_hash.data(),
+                     kServiceIdHashLength) == 0;
+}
+
 void BleAdvertisement::DoInitialize(bool fast_advertisement, Version version,
                                     Pcp pcp, const ByteArray& service_id_hash,
                                     const std::string& endpoint_id,
@@ -89,10 +149,31 @@ void BleAdvertisement::DoInitialize(bool fast_advertisement, Version version,
 }
 
 BleAdvertisement::BleAdvertisement(bool fast_advertisement,
-                                   const ByteArray& ble_advertisement_bytes) {
-  fast_advertisement_ = fast_advertisement;
+                                   const ByteArray& ble_advertisement_bytes)
+    : BleAdvertisement(View(fast_advertisement,
+                            absl::string_view(ble_advertisement_bytes.data(),
+                                              ble_advertisement_bytes.size()))) {
+}
 
-  if (ble_advertisement_bytes.Empty()) {
+BleAdvertisement::BleAdvertisement(const View& view)
+    : fast_advertisement_(view.IsFastAdvertisement()),
+      version_(view.GetVersion()),
+      pcp_(view.GetPcp()),
+      service_id_hash_(view.GetServiceIdHash().data(),
+                       view.GetServiceIdHash().size()),
+      endpoint_id_(view.GetEndpointId()),
+      endpoint_info_(view.GetEndpointInfo().data(),
+                     view.GetEndpointInfo().size()),
+      bluetooth_mac_address_(BluetoothUtils::ToString(
+          ByteArray(view.GetBluetoothMacAddressBytes().data(),
+                    view.GetBluetoothMacAddressBytes().size()))),
+      uwb_address_(view.GetUwbAddress().data(), view.GetUwbAddress().size()),
+      web_rtc_state_(view.GetWebRtcState()) {}
+
+BleAdvertisement::View::View(bool fast_advertisement,
+                             absl::string_view ble_advertisement_bytes)
+    : fast_advertisement_(fast_advertisement) {
+  if (ble_advertisement_bytes.empty()) {
     NEARBY_LOG(ERROR,
                "Cannot deserialize BleAdvertisement: null bytes passed in.");
     return;
@@ -110,10 +191,17 @@ BleAdvertisement::BleAdvertisement(bool fast_advertisement,
     return;
   }
 
-  ByteArray advertisement_bytes{ble_advertisement_bytes};
-  BaseInputStream base_input_stream{advertisement_bytes};
+  // Returns the next |size| bytes, or nothing if there aren't that many left.
+  absl::string_view remaining = ble_advertisement_bytes;
+  auto read = [&remaining](std::size_t size) -> absl::string_view {
+    if (remaining.size() < size) return {};
+    absl::string_view bytes = remaining.substr(0, size);
+    remaining.remove_prefix(size);
+    return bytes;
+  };
+
   // The first 1 byte is supposed to be the version and pcp.
-  auto version_and_pcp_byte = static_cast<char>(base_input_stream.ReadUint8());
+  char version_and_pcp_byte = read(kVersionAndPcpLength)[0];
   // The upper 3 bits are supposed to be the version.
   version_ =
       static_cast<Version>((version_and_pcp_byte & kVersionBitmask) >> 5);
@@ -138,22 +226,21 @@ BleAdvertisement::BleAdvertisement(bool fast_advertisement,
 
   // The next 3 bytes are supposed to be the service_id_hash if not fast
   // advertisment.
-  if (!fast_advertisement_)
-    service_id_hash_ = base_input_stream.ReadBytes(kServiceIdHashLength);
+  if (!fast_advertisement_) service_id_hash_ = read(kServiceIdHashLength);
 
   // The next 4 bytes are supposed to be the endpoint_id.
-  endpoint_id_ = std::string{base_input_stream.ReadBytes(kEndpointIdLength)};
+  endpoint_id_ = read(kEndpointIdLength);
 
   // The next 1 byte is supposed to be the length of the endpoint_info.
-  std::uint32_t expected_endpoint_info_length = base_input_stream.ReadUint8();
+  std::uint32_t expected_endpoint_info_length =
+      static_cast<std::uint8_t>(read(kEndpointInfoSizeLength)[0]);
 
   // The next x bytes are the endpoint info. (Max length is 131 bytes or 17
   // bytes as fast_advertisement being true).
-  endpoint_info_ = base_input_stream.ReadBytes(expected_endpoint_info_length);
+  endpoint_info_ = read(expected_endpoint_info_length);
   const int max_endpoint_info_length =
       fast_advertisement_ ? kMaxFastEndpointInfoLength : kMaxEndpointInfoLength;
-  if (endpoint_info_.Empty() ||
-      endpoint_info_.size() != expected_endpoint_info_length ||
+  if (endpoint_info_.empty() ||
       endpoint_info_.size() > max_endpoint_info_length) {
     NEARBY_LOG(INFO,
                "Cannot deserialize BleAdvertisement(fast advertisement=%d): "
@@ -162,115 +249,117 @@ BleAdvertisement::BleAdvertisement(bool fast_advertisement,
                endpoint_info_.size());
 
     // Clear enpoint_id for validity.
-    endpoint_id_.clear();
+    endpoint_id_ = {};
     return;
   }
 
   // The next 6 bytes are the bluetooth mac address if not fast advertisment.
   if (!fast_advertisement_) {
-    auto bluetooth_mac_address_bytes =
-        base_input_stream.ReadBytes(BluetoothUtils::kBluetoothMacAddressLength);
-    bluetooth_mac_address_ =
-        BluetoothUtils::ToString(bluetooth_mac_address_bytes);
+    bluetooth_mac_address_bytes_ = read(kBluetoothMacAddressLength);
   }
 
   // The next 1 byte is supposed to be the length of the uwb_address. If the
   // next byte is not available then it should be a fast advertisement and skip
   // it for remaining bytes.
-  if (base_input_stream.IsAvailable(1)) {
-    std::uint32_t expected_uwb_address_length = base_input_stream.ReadUint8();
+  if (!remaining.empty()) {
+    std::uint32_t expected_uwb_address_length =
+        static_cast<std::uint8_t>(read(kUwbAddressSizeLength)[0]);
     // If the length of uwb_address is not zero, then retrieve it.
     if (expected_uwb_address_length != 0) {
-      uwb_address_ = base_input_stream.ReadBytes(expected_uwb_address_length);
-      if (uwb_address_.Empty() ||
-          uwb_address_.size() != expected_uwb_address_length) {
+      uwb_address_ = read(expected_uwb_address_length);
+      if (uwb_address_.empty()) {
         NEARBY_LOG(INFO,
                    "Cannot deserialize BleAdvertisement: "
                    "expected uwbAddress size to be %d bytes, got %" PRIu64,
-                   expected_uwb_address_length, uwb_address_.size());
+                   expected_uwb_address_length, remaining.size());
 
         // Clear enpoint_id for validity.
-        endpoint_id_.clear();
+        endpoint_id_ = {};
         return;
       }
     }
 
     // The next 1 byte is extra field.
-    if (!fast_advertisement_) {
-      if (base_input_stream.IsAvailable(kExtraFieldLength)) {
-        auto extra_field = static_cast<char>(base_input_stream.ReadUint8());
-        web_rtc_state_ = (extra_field & kWebRtcConnectableFlagBitmask) == 1
-                             ? WebRtcState::kConnectable
-                             : WebRtcState::kUnconnectable;
-      }
+    if (!fast_advertisement_ && remaining.size() >= kExtraFieldLength) {
+      char extra_field = read(kExtraFieldLength)[0];
+      web_rtc_state_ = (extra_field & kWebRtcConnectableFlagBitmask) == 1
+                           ? WebRtcState::kConnectable
+                           : WebRtcState::kUnconnectable;
     }
   }
-
-  base_input_stream.Close();
 }
 
 BleAdvertisement::operator ByteArray() const {
-  if (!IsValid()) {
-    return ByteArray();
+  char buffer[kMaxAdvertisementLength];
+  return ByteArray(buffer, SerializeTo(buffer, sizeof(buffer)));
+}
+
+std::size_t BleAdvertisement::SerializeTo(char* buffer,
+                                          std::size_t size) const {
+  if (!IsValid() || uwb_address_.size() > kMaxUwbAddressLength) {
+    return 0;
   }
 
+  std::size_t serialized_size = kVersionAndPcpLength + endpoint_id_.size() +
+                                kEndpointInfoSizeLength +
+                                endpoint_info_.size();
+  if (!fast_advertisement_) {
+    serialized_size += service_id_hash_.size() + kBluetoothMacAddressLength +
+                       kUwbAddressSizeLength + kExtraFieldLength;
+  } else if (!uwb_address_.Empty()) {
+    serialized_size += kUwbAddressSizeLength;
+  }
+  serialized_size += uwb_address_.size();
+  if (serialized_size > size) return 0;
+
+  char* out = buffer;
+  auto write = [&out](const char* data, std::size_t data_size) {
+    std::memcpy(out, data, data_size);
+    out += data_size;
+  };
+
   // The first 3 bits are the Version.
   char version_and_pcp_byte =
       (static_cast<char>(version_) << 5) & kVersionBitmask;
   // The next 5 bits are the Pcp.
   version_and_pcp_byte |= static_cast<char>(pcp_) & kPcpBitmask;
+  *out++ = version_and_pcp_byte;
 
-  std::string out;
-  if (fast_advertisement_) {
-    // clang-format off
-    out = absl::StrCat(std::string(1, version_and_pcp_byte),
-                       endpoint_id_,
-                       std::string(1, endpoint_info_.size()),
-                       std::string(endpoint_info_));
-    // clang-format on
-  } else {
-    // clang-format off
-    out = absl::StrCat(std::string(1, version_and_pcp_byte),
-                       std::string(service_id_hash_),
-                       endpoint_id_,
-                       std::string(1, endpoint_info_.size()),
-                       std::string(endpoint_info_));
-    // clang-format on
+  if (!fast_advertisement_) {
+    write(service_id_hash_.data(), service_id_hash_.size());
+  }
+  write(endpoint_id_.data(), endpoint_id_.size());
+  *out++ = static_cast<char>(endpoint_info_.size());
+  write(endpoint_info_.data(), endpoint_info_.size());
 
+  if (!fast_advertisement_) {
     // The next 6 bytes are the bluetooth mac address. If bluetooth_mac_address
-    // is invalid or empty, we get back an empty byte array.
-    auto bluetooth_mac_address_bytes{
-        BluetoothUtils::FromString(bluetooth_mac_address_)};
-    if (!bluetooth_mac_address_bytes.Empty()) {
-      absl::StrAppend(&out, std::string(bluetooth_mac_address_bytes));
-    } else {
-      // If bluetooth MAC address is invalid, then reserve the bytes.
-      auto fake_bt_mac_address_bytes =
-          ByteArray(BluetoothUtils::kBluetoothMacAddressLength);
-      absl::StrAppend(&out, std::string(fake_bt_mac_address_bytes));
+    // is invalid or empty, the bytes are reserved.
+    if (!ParseBluetoothMacAddress(bluetooth_mac_address_, out)) {
+      std::memset(out, 0, kBluetoothMacAddressLength);
     }
+    out += kBluetoothMacAddressLength;
   }
 
   // The next bytes are UWB address field.
   if (!uwb_address_.Empty()) {
-    absl::StrAppend(&out, std::string(1, uwb_address_.size()));
-    absl::StrAppend(&out, std::string(uwb_address_));
+    *out++ = static_cast<char>(uwb_address_.size());
+    write(uwb_address_.data(), uwb_address_.size());
   } else if (!fast_advertisement_) {
     // Write UWB address with length 0 to be able to read the next field when
     // decode.
-    absl::StrAppend(&out, std::string(1, uwb_address_.size()));
+    *out++ = 0;
   }
 
   // The next 1 byte is extra field.
   if (!fast_advertisement_) {
     int web_rtc_connectable_flag =
         (web_rtc_state_ == WebRtcState::kConnectable) ? 1 : 0;
-    char extra_field_byte = static_cast<char>(web_rtc_connectable_flag) &
-                            kWebRtcConnectableFlagBitmask;
-    absl::StrAppend(&out, std::string(1, extra_field_byte));
+    *out++ = static_cast<char>(web_rtc_connectable_flag) &
+             kWebRtcConnectableFlagBitmask;
   }
 
-  return ByteArray(std::move(out));
+  return out - buffer;
 }
 
 }  // namespace connections
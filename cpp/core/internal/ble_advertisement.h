@@ -15,6 +15,10 @@
 #ifndef CORE_INTERNAL_BLE_ADVERTISEMENT_H_
 #define CORE_INTERNAL_BLE_ADVERTISEMENT_H_
 
+#include <cstddef>
+#include <string>
+
+#include "absl/strings/string_view.h"
 #include "core/internal/base_pcp_handler.h"
 #include "core/internal/pcp.h"
 #include "platform/base/bluetooth_utils.h"
@@ -68,6 +72,44 @@ class BleAdvertisement {
                                                      kBluetoothMacAddressLength;
   static constexpr int kMaxEndpointInfoLength = 131;
   static constexpr int kMaxFastEndpointInfoLength = 17;
+  // The UWB address size is written in a single byte.
+  static constexpr int kMaxUwbAddressLength = 0x0FF;
+  static constexpr int kMaxAdvertisementLength =
+      kMinAdvertisementLength + kMaxEndpointInfoLength +
+      kUwbAddressSizeLength + kMaxUwbAddressLength + kExtraFieldLength;
+
+  // A parsed advertisement that points into the bytes it was parsed from,
+  // rather than copying them, so that advertisements can be inspected as
+  // they're discovered without allocating. The bytes must outlive the View.
+  class View {
+   public:
+    View(bool fast_advertisement, absl::string_view ble_advertisement_bytes);
+
+    bool IsValid() const { return !endpoint_id_.empty(); }
+    bool IsFastAdvertisement() const { return fast_advertisement_; }
+    Version GetVersion() const { return version_; }
+    Pcp GetPcp() const { return pcp_; }
+    absl::string_view GetServiceIdHash() const { return service_id_hash_; }
+    absl::string_view GetEndpointId() const { return endpoint_id_; }
+    absl::string_view GetEndpointInfo() const { return endpoint_info_; }
+    // The raw address bytes; all zeros if the advertiser didn't set one.
+    absl::string_view GetBluetoothMacAddressBytes() const {
+      return bluetooth_mac_address_bytes_;
+    }
+    absl::string_view GetUwbAddress() const { return uwb_address_; }
+    WebRtcState GetWebRtcState() const { return web_rtc_state_; }
+
+   private:
+    bool fast_advertisement_;
+    Version version_{Version::kUndefined};
+    Pcp pcp_{Pcp::kUnknown};
+    absl::string_view service_id_hash_;
+    absl::string_view endpoint_id_;
+    absl::string_view endpoint_info_;
+    absl::string_view bluetooth_mac_address_bytes_;
+    absl::string_view uwb_address_;
+    WebRtcState web_rtc_state_{WebRtcState::kUndefined};
+  };
 
   BleAdvertisement() = default;
   BleAdvertisement(Version version, Pcp pcp, const std::string& endpoint_id,
@@ -80,23 +122,39 @@ class BleAdvertisement {
                    const ByteArray& uwb_address, WebRtcState web_rtc_state);
   BleAdvertisement(bool fast_advertisement,
                    const ByteArray& ble_advertisement_bytes);
+  explicit BleAdvertisement(const View& view);
   BleAdvertisement(const BleAdvertisement&) = default;
   BleAdvertisement& operator=(const BleAdvertisement&) = default;
   BleAdvertisement(BleAdvertisement&&) = default;
   BleAdvertisement& operator=(BleAdvertisement&&) = default;
   ~BleAdvertisement() = default;
 
+  // Returns false if |ble_advertisement_bytes| can't be a valid advertisement
+  // for |pcp| and |service_id_hash|. Only the fixed-size header is compared,
+  // without parsing or allocating, so foreign advertisements can be dropped
+  // as soon as they're discovered.
+  static bool MayMatch(bool fast_advertisement,
+                       const ByteArray& ble_advertisement_bytes, Pcp pcp,
+                       const ByteArray& service_id_hash);
+
   explicit operator ByteArray() const;
 
+  // Writes the serialized advertisement into |buffer|, and returns its size;
+  // or 0 if the advertisement is invalid, or doesn't fit in |size| bytes.
+  // kMaxAdvertisementLength bytes are always enough.
+  std::size_t SerializeTo(char* buffer, std::size_t size) const;
+
   bool IsValid() const { return !endpoint_id_.empty(); }
   bool IsFastAdvertisement() const { return fast_advertisement_; }
   Version GetVersion() const { return version_; }
   Pcp GetPcp() const { return pcp_; }
-  ByteArray GetServiceIdHash() const { return service_id_hash_; }
-  std::string GetEndpointId() const { return endpoint_id_; }
-  ByteArray GetEndpointInfo() const { return endpoint_info_; }
-  std::string GetBluetoothMacAddress() const { return bluetooth_mac_address_; }
-  ByteArray GetUwbAddress() const { return uwb_address_; }
+  const ByteArray& GetServiceIdHash() const { return service_id_hash_; }
+  const std::string& GetEndpointId() const { return endpoint_id_; }
+  const ByteArray& GetEndpointInfo() const { return endpoint_info_; }
+  const std::string& GetBluetoothMacAddress() const {
+    return bluetooth_mac_address_;
+  }
+  const ByteArray& GetUwbAddress() const { return uwb_address_; }
   WebRtcState GetWebRtcState() const { return web_rtc_state_; }
 
  private:
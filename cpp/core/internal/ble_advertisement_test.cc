@@ -283,6 +283,58 @@ TEST(BleAdvertisementTest, ConstructionFromBytesWorks) {
   EXPECT_EQ(kWebRtcState, ble_advertisement.GetWebRtcState());
 }
 
+TEST(BleAdvertisementTest, ViewParsesBytesInPlace) {
+  ByteArray service_id_hash{std::string(kServiceIdHashBytes)};
+  ByteArray endpoint_info{std::string(kEndpointName)};
+  BleAdvertisement org_ble_advertisement{
+      kVersion,        kPcp,
+      service_id_hash, std::string(kEndpointId),
+      endpoint_info,   std::string(kBluetoothMacAddress),
+      ByteArray{},     kWebRtcState};
+  ByteArray ble_advertisement_bytes(org_ble_advertisement);
+  absl::string_view bytes(ble_advertisement_bytes.data(),
+                          ble_advertisement_bytes.size());
+
+  BleAdvertisement::View view{false, bytes};
+
+  EXPECT_TRUE(view.IsValid());
+  EXPECT_FALSE(view.IsFastAdvertisement());
+  EXPECT_EQ(kVersion, view.GetVersion());
+  EXPECT_EQ(kPcp, view.GetPcp());
+  EXPECT_EQ(kServiceIdHashBytes, view.GetServiceIdHash());
+  EXPECT_EQ(kEndpointId, view.GetEndpointId());
+  EXPECT_EQ(kEndpointName, view.GetEndpointInfo());
+  EXPECT_EQ(kWebRtcState, view.GetWebRtcState());
+  // The fields point into the parsed bytes.
+  EXPECT_GE(view.GetEndpointId().data(), bytes.data());
+  EXPECT_LT(view.GetEndpointId().data(), bytes.data() + bytes.size());
+
+  BleAdvertisement ble_advertisement{view};
+
+  EXPECT_TRUE(ble_advertisement.IsValid());
+  EXPECT_EQ(kEndpointId, ble_advertisement.GetEndpointId());
+  EXPECT_EQ(endpoint_info, ble_advertisement.GetEndpointInfo());
+  EXPECT_EQ(kBluetoothMacAddress, ble_advertisement.GetBluetoothMacAddress());
+}
+
+TEST(BleAdvertisementTest, SerializeToMatchesByteArray) {
+  ByteArray service_id_hash{std::string(kServiceIdHashBytes)};
+  ByteArray endpoint_info{std::string(kEndpointName)};
+  BleAdvertisement ble_advertisement{
+      kVersion,        kPcp,
+      service_id_hash, std::string(kEndpointId),
+      endpoint_info,   std::string(kBluetoothMacAddress),
+      ByteArray{},     kWebRtcState};
+  ByteArray ble_advertisement_bytes(ble_advertisement);
+  char buffer[BleAdvertisement::kMaxAdvertisementLength];
+
+  std::size_t size = ble_advertisement.SerializeTo(buffer, sizeof(buffer));
+
+  EXPECT_EQ(std::string(ble_advertisement_bytes), std::string(buffer, size));
+  // Nothing is written if the buffer is too small.
+  EXPECT_EQ(0, ble_advertisement.SerializeTo(buffer, size - 1));
+}
+
 TEST(BleAdvertisementTest, ConstructionFromBytesWorksForFastAdvertisement) {
   // Serialize good data into a good Ble Advertisement.
   ByteArray fast_endpoint_info{std::string(kFastAdvertisementEndpointName)};
@@ -430,6 +482,55 @@ TEST(BleAdvertisementTest,
   EXPECT_FALSE(corrupt_ble_advertisement.IsValid());
 }
 
+TEST(BleAdvertisementTest, MayMatchAcceptsMatchingBytes) {
+  ByteArray service_id_hash{std::string(kServiceIdHashBytes)};
+  ByteArray endpoint_info{std::string(kEndpointName)};
+  BleAdvertisement ble_advertisement{
+      kVersion,        kPcp,
+      service_id_hash, std::string(kEndpointId),
+      endpoint_info,   std::string(kBluetoothMacAddress),
+      ByteArray{},     kWebRtcState};
+  ByteArray ble_advertisement_bytes(ble_advertisement);
+
+  EXPECT_TRUE(BleAdvertisement::MayMatch(false, ble_advertisement_bytes, kPcp,
+                                         service_id_hash));
+}
+
+TEST(BleAdvertisementTest, MayMatchRejectsOtherPcpAndServiceIdHash) {
+  ByteArray service_id_hash{std::string(kServiceIdHashBytes)};
+  ByteArray endpoint_info{std::string(kEndpointName)};
+  BleAdvertisement ble_advertisement{
+      kVersion,        kPcp,
+      service_id_hash, std::string(kEndpointId),
+      endpoint_info,   std::string(kBluetoothMacAddress),
+      ByteArray{},     kWebRtcState};
+  ByteArray ble_advertisement_bytes(ble_advertisement);
+
+  ByteArray other_service_id_hash{std::string("\x0a\x0b\x0d")};
+  ByteArray short_bytes{std::string("\x21\x0a\x0b\x0c")};
+
+  EXPECT_FALSE(BleAdvertisement::MayMatch(false, ble_advertisement_bytes,
+                                          Pcp::kP2pStar, service_id_hash));
+  EXPECT_FALSE(BleAdvertisement::MayMatch(false, ble_advertisement_bytes, kPcp,
+                                          other_service_id_hash));
+  EXPECT_FALSE(
+      BleAdvertisement::MayMatch(false, short_bytes, kPcp, service_id_hash));
+}
+
+TEST(BleAdvertisementTest, MayMatchIgnoresServiceIdHashForFastAdvertisement) {
+  ByteArray fast_endpoint_info{std::string(kFastAdvertisementEndpointName)};
+  BleAdvertisement ble_advertisement{kVersion, kPcp, std::string(kEndpointId),
+                                     fast_endpoint_info, ByteArray{}};
+  ByteArray ble_advertisement_bytes(ble_advertisement);
+
+  ByteArray other_service_id_hash{std::string("\x01\x02\x03")};
+
+  EXPECT_TRUE(BleAdvertisement::MayMatch(true, ble_advertisement_bytes, kPcp,
+                                         other_service_id_hash));
+  EXPECT_FALSE(BleAdvertisement::MayMatch(true, ble_advertisement_bytes,
+                                          Pcp::kP2pStar, ByteArray{}));
+}
+
 }  // namespace
 }  // namespace connections
 }  // namespace nearby
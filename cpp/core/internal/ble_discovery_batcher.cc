@@ -0,0 +1,154 @@
+// Copyright 2021 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "core/internal/ble_discovery_batcher.h"
+
+#include <algorithm>
+#include <utility>
+
+#include "absl/hash/hash.h"
+#include "absl/strings/string_view.h"
+#include "platform/public/mutex_lock.h"
+#include "platform/public/system_clock.h"
+
+namespace location {
+namespace nearby {
+namespace connections {
+
+namespace {
+
+std::size_t HashAdvertisement(const ByteArray& advertisement_bytes,
+                              bool fast_advertisement) {
+  return absl::Hash<std::pair<absl::string_view, bool>>()(
+      {absl::string_view(advertisement_bytes.data(),
+                         advertisement_bytes.size()),
+       fast_advertisement});
+}
+
+}  // namespace
+
+BleDiscoveryBatcher::BleDiscoveryBatcher(absl::Duration flush_interval,
+                                         FlushCallback flush_callback)
+    : flush_interval_(flush_interval),
+      flush_callback_(std::move(flush_callback)) {}
+
+BleDiscoveryBatcher::~BleDiscoveryBatcher() {
+  {
+    MutexLock lock(&mutex_);
+    flush_alarm_.Cancel();
+  }
+  alarm_executor_.Shutdown();
+}
+
+void BleDiscoveryBatcher::OnPeripheralDiscovered(
+    ClientProxy* client, BlePeripheral& peripheral,
+    const std::string& service_id, const ByteArray& advertisement_bytes,
+    bool fast_advertisement) {
+  std::size_t advertisement_hash =
+      HashAdvertisement(advertisement_bytes, fast_advertisement);
+  absl::Time now = SystemClock::ElapsedRealtime();
+  MutexLock lock(&mutex_);
+  auto result = peripherals_.emplace(
+      std::make_pair(client, peripheral.GetName()), PeripheralState{});
+  PeripheralState& state = result.first->second;
+  bool is_new = result.second;
+  if (is_new) state.first_seen = now;
+  state.last_seen = now;
+  state.sighting_count++;
+  if (!is_new && state.advertisement_hash == advertisement_hash) return;
+
+  state.advertisement_hash = advertisement_hash;
+  pending_events_.push_back({
+      .type = Event::Type::kFound,
+      .client = client,
+      .peripheral = &peripheral,
+      .service_id = service_id,
+      .advertisement_bytes = advertisement_bytes,
+      .fast_advertisement = fast_advertisement,
+  });
+  ScheduleFlushLocked();
+}
+
+void BleDiscoveryBatcher::OnPeripheralLost(ClientProxy* client,
+                                           BlePeripheral& peripheral,
+                                           const std::string& service_id) {
+  MutexLock lock(&mutex_);
+  peripherals_.erase(std::make_pair(client, peripheral.GetName()));
+  pending_events_.push_back({
+      .type = Event::Type::kLost,
+      .client = client,
+      .peripheral = &peripheral,
+      .service_id = service_id,
+      .advertisement_bytes = {},
+      .fast_advertisement = false,
+  });
+  ScheduleFlushLocked();
+}
+
+void BleDiscoveryBatcher::Flush() {
+  MutexLock lock(&mutex_);
+  FlushLocked();
+}
+
+void BleDiscoveryBatcher::Reset(ClientProxy* client) {
+  MutexLock lock(&mutex_);
+  for (auto item = peripherals_.begin(); item != peripherals_.end();) {
+    if (item->first.first == client) {
+      peripherals_.erase(item++);
+    } else {
+      ++item;
+    }
+  }
+  pending_events_.erase(
+      std::remove_if(pending_events_.begin(), pending_events_.end(),
+                     [client](const Event& event) {
+                       return event.client == client;
+                     }),
+      pending_events_.end());
+  // A flush that's already scheduled finds nothing to deliver, if these were
+  // the only events.
+}
+
+absl::optional<BleDiscoveryBatcher::PeripheralState>
+BleDiscoveryBatcher::GetPeripheralState(
+    ClientProxy* client, const std::string& peripheral_name) const {
+  MutexLock lock(&mutex_);
+  auto item = peripherals_.find(std::make_pair(client, peripheral_name));
+  if (item == peripherals_.end()) return absl::nullopt;
+  return item->second;
+}
+
+void BleDiscoveryBatcher::ScheduleFlushLocked() {
+  if (flush_scheduled_) return;
+  flush_scheduled_ = true;
+  flush_alarm_ = CancelableAlarm(
+      "ble-discovery-flush",
+      [this]() {
+        MutexLock lock(&mutex_);
+        flush_scheduled_ = false;
+        FlushLocked();
+      },
+      flush_interval_, &alarm_executor_);
+}
+
+void BleDiscoveryBatcher::FlushLocked() {
+  if (pending_events_.empty()) return;
+  std::vector<Event> events;
+  events.swap(pending_events_);
+  flush_callback_(std::move(events));
+}
+
+}  // namespace connections
+}  // namespace nearby
+}  // namespace location
@@ -0,0 +1,130 @@
+// Copyright 2021 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef CORE_INTERNAL_BLE_DISCOVERY_BATCHER_H_
+#define CORE_INTERNAL_BLE_DISCOVERY_BATCHER_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "absl/container/flat_hash_map.h"
+#include "absl/time/time.h"
+#include "absl/types/optional.h"
+#include "core/internal/client_proxy.h"
+#include "platform/base/byte_array.h"
+#include "platform/public/bluetooth_adapter.h"
+#include "platform/public/cancelable_alarm.h"
+#include "platform/public/mutex.h"
+#include "platform/public/scheduled_executor.h"
+
+namespace location {
+namespace nearby {
+namespace connections {
+
+// Sits between the BLE scan callbacks and the PCP handler thread.
+//
+// Platforms report a peripheral every time they see its advertisement, often
+// several times a second. The batcher keeps one entry per peripheral and
+// client, and only passes on sightings of new peripherals, or of peripherals
+// whose advertisement changed. Those are delivered in batches, at most once per
+// flush interval, so a busy scan costs one PCP handler task per interval
+// instead of one per sighting.
+class BleDiscoveryBatcher {
+ public:
+  struct Event {
+    enum class Type {
+      kFound,
+      kLost,
+    };
+
+    Type type;
+    ClientProxy* client;
+    // Owned by the BLE medium, which keeps it alive while scanning.
+    BlePeripheral* peripheral;
+    std::string service_id;
+    // Only set for kFound.
+    ByteArray advertisement_bytes;
+    bool fast_advertisement;
+  };
+
+  // What's known about a peripheral that's currently in range.
+  struct PeripheralState {
+    std::size_t advertisement_hash;
+    absl::Time first_seen;
+    absl::Time last_seen;
+    std::int64_t sighting_count;
+  };
+
+  // Receives events in the order they were reported. Called with the
+  // batcher's lock held, so it must not call back into the batcher; it's
+  // expected to post the events to another thread.
+  using FlushCallback = std::function<void(std::vector<Event>)>;
+
+  BleDiscoveryBatcher(absl::Duration flush_interval,
+                      FlushCallback flush_callback);
+  ~BleDiscoveryBatcher();
+  BleDiscoveryBatcher(const BleDiscoveryBatcher&) = delete;
+  BleDiscoveryBatcher& operator=(const BleDiscoveryBatcher&) = delete;
+
+  // Queues a kFound event, unless |peripheral| was already seen with the same
+  // advertisement.
+  void OnPeripheralDiscovered(ClientProxy* client, BlePeripheral& peripheral,
+                              const std::string& service_id,
+                              const ByteArray& advertisement_bytes,
+                              bool fast_advertisement)
+      ABSL_LOCKS_EXCLUDED(mutex_);
+
+  // Forgets |peripheral| and queues a kLost event.
+  void OnPeripheralLost(ClientProxy* client, BlePeripheral& peripheral,
+                        const std::string& service_id)
+      ABSL_LOCKS_EXCLUDED(mutex_);
+
+  // Delivers the pending events right away.
+  void Flush() ABSL_LOCKS_EXCLUDED(mutex_);
+
+  // Forgets the peripherals seen for |client| and drops its pending events;
+  // eg. once it stops discovery, so that its next discovery reports every
+  // peripheral again. Other clients are left alone.
+  void Reset(ClientProxy* client) ABSL_LOCKS_EXCLUDED(mutex_);
+
+  absl::optional<PeripheralState> GetPeripheralState(
+      ClientProxy* client, const std::string& peripheral_name) const
+      ABSL_LOCKS_EXCLUDED(mutex_);
+
+ private:
+  void ScheduleFlushLocked() ABSL_EXCLUSIVE_LOCKS_REQUIRED(mutex_);
+  void FlushLocked() ABSL_EXCLUSIVE_LOCKS_REQUIRED(mutex_);
+
+  const absl::Duration flush_interval_;
+  const FlushCallback flush_callback_;
+
+  mutable Mutex mutex_;
+  // Keyed by client and peripheral name.
+  absl::flat_hash_map<std::pair<ClientProxy*, std::string>, PeripheralState>
+      peripherals_ ABSL_GUARDED_BY(mutex_);
+  std::vector<Event> pending_events_ ABSL_GUARDED_BY(mutex_);
+  bool flush_scheduled_ ABSL_GUARDED_BY(mutex_) = false;
+  CancelableAlarm flush_alarm_ ABSL_GUARDED_BY(mutex_);
+  ScheduledExecutor alarm_executor_;
+};
+
+}  // namespace connections
+}  // namespace nearby
+}  // namespace location
+
+#endif  // CORE_INTERNAL_BLE_DISCOVERY_BATCHER_H_
@@ -0,0 +1,187 @@
+// Copyright 2021 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "core/internal/ble_discovery_batcher.h"
+
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "absl/time/time.h"
+#include "platform/api/ble.h"
+#include "platform/public/count_down_latch.h"
+
+namespace location {
+namespace nearby {
+namespace connections {
+namespace {
+
+using Event = BleDiscoveryBatcher::Event;
+
+constexpr absl::string_view kServiceId{"service"};
+constexpr absl::Duration kLongInterval = absl::Hours(1);
+
+class FakeBlePeripheral : public api::BlePeripheral {
+ public:
+  explicit FakeBlePeripheral(std::string name) : name_(std::move(name)) {}
+
+  std::string GetName() const override { return name_; }
+  ByteArray GetAdvertisementBytes(
+      const std::string& service_id) const override {
+    return {};
+  }
+
+ private:
+  std::string name_;
+};
+
+class BleDiscoveryBatcherTest : public ::testing::Test {
+ protected:
+  BleDiscoveryBatcher::FlushCallback Collect() {
+    return [this](std::vector<Event> events) {
+      for (Event& event : events) events_.push_back(std::move(event));
+    };
+  }
+
+  void Discover(BleDiscoveryBatcher& batcher, BlePeripheral& peripheral,
+                const std::string& advertisement) {
+    Discover(batcher, &client_, peripheral, advertisement);
+  }
+
+  void Discover(BleDiscoveryBatcher& batcher, ClientProxy* client,
+                BlePeripheral& peripheral, const std::string& advertisement) {
+    batcher.OnPeripheralDiscovered(client, peripheral, std::string(kServiceId),
+                                   ByteArray(advertisement), false);
+  }
+
+  ClientProxy client_;
+  ClientProxy other_client_;
+  FakeBlePeripheral peripheral_impl_a_{"a"};
+  FakeBlePeripheral peripheral_impl_b_{"b"};
+  BlePeripheral peripheral_a_{&peripheral_impl_a_};
+  BlePeripheral peripheral_b_{&peripheral_impl_b_};
+  std::vector<Event> events_;
+};
+
+TEST_F(BleDiscoveryBatcherTest, DeliversNewPeripheralsOnFlush) {
+  BleDiscoveryBatcher batcher(kLongInterval, Collect());
+
+  Discover(batcher, peripheral_a_, "advertisement a");
+  Discover(batcher, peripheral_b_, "advertisement b");
+  EXPECT_TRUE(events_.empty());
+  batcher.Flush();
+
+  ASSERT_EQ(events_.size(), 2);
+  EXPECT_EQ(events_[0].type, Event::Type::kFound);
+  EXPECT_EQ(events_[0].client, &client_);
+  EXPECT_EQ(events_[0].peripheral, &peripheral_a_);
+  EXPECT_EQ(events_[0].service_id, kServiceId);
+  EXPECT_EQ(events_[0].advertisement_bytes, ByteArray("advertisement a"));
+  EXPECT_EQ(events_[1].peripheral, &peripheral_b_);
+}
+
+TEST_F(BleDiscoveryBatcherTest, DropsRepeatedAdvertisements) {
+  BleDiscoveryBatcher batcher(kLongInterval, Collect());
+
+  Discover(batcher, peripheral_a_, "advertisement");
+  batcher.Flush();
+  Discover(batcher, peripheral_a_, "advertisement");
+  Discover(batcher, peripheral_a_, "advertisement");
+  batcher.Flush();
+
+  EXPECT_EQ(events_.size(), 1);
+  absl::optional<BleDiscoveryBatcher::PeripheralState> state =
+      batcher.GetPeripheralState(&client_, "a");
+  ASSERT_TRUE(state.has_value());
+  EXPECT_EQ(state->sighting_count, 3);
+  EXPECT_LE(state->first_seen, state->last_seen);
+}
+
+TEST_F(BleDiscoveryBatcherTest, DeliversChangedAdvertisements) {
+  BleDiscoveryBatcher batcher(kLongInterval, Collect());
+
+  Discover(batcher, peripheral_a_, "advertisement");
+  Discover(batcher, peripheral_a_, "new advertisement");
+  batcher.OnPeripheralDiscovered(&client_, peripheral_a_,
+                                 std::string(kServiceId),
+                                 ByteArray("new advertisement"), true);
+  batcher.Flush();
+
+  ASSERT_EQ(events_.size(), 3);
+  EXPECT_EQ(events_[1].advertisement_bytes, ByteArray("new advertisement"));
+  EXPECT_TRUE(events_[2].fast_advertisement);
+}
+
+TEST_F(BleDiscoveryBatcherTest, LostPeripheralsAreReportedAgain) {
+  BleDiscoveryBatcher batcher(kLongInterval, Collect());
+
+  Discover(batcher, peripheral_a_, "advertisement");
+  batcher.OnPeripheralLost(&client_, peripheral_a_, std::string(kServiceId));
+  EXPECT_FALSE(batcher.GetPeripheralState(&client_, "a").has_value());
+  Discover(batcher, peripheral_a_, "advertisement");
+  batcher.Flush();
+
+  ASSERT_EQ(events_.size(), 3);
+  EXPECT_EQ(events_[0].type, Event::Type::kFound);
+  EXPECT_EQ(events_[1].type, Event::Type::kLost);
+  EXPECT_EQ(events_[2].type, Event::Type::kFound);
+}
+
+TEST_F(BleDiscoveryBatcherTest, ResetDropsPendingEventsAndPeripherals) {
+  BleDiscoveryBatcher batcher(kLongInterval, Collect());
+
+  Discover(batcher, peripheral_a_, "advertisement");
+  batcher.Reset(&client_);
+  batcher.Flush();
+  EXPECT_TRUE(events_.empty());
+
+  Discover(batcher, peripheral_a_, "advertisement");
+  batcher.Flush();
+  EXPECT_EQ(events_.size(), 1);
+}
+
+TEST_F(BleDiscoveryBatcherTest, ResetLeavesOtherClientsAlone) {
+  BleDiscoveryBatcher batcher(kLongInterval, Collect());
+
+  Discover(batcher, &client_, peripheral_a_, "advertisement");
+  Discover(batcher, &other_client_, peripheral_a_, "advertisement");
+  batcher.Reset(&client_);
+  EXPECT_FALSE(batcher.GetPeripheralState(&client_, "a").has_value());
+  EXPECT_TRUE(batcher.GetPeripheralState(&other_client_, "a").has_value());
+  batcher.Flush();
+
+  ASSERT_EQ(events_.size(), 1);
+  EXPECT_EQ(events_[0].client, &other_client_);
+  EXPECT_EQ(events_[0].peripheral, &peripheral_a_);
+}
+
+TEST_F(BleDiscoveryBatcherTest, FlushesAfterInterval) {
+  CountDownLatch latch(1);
+  BleDiscoveryBatcher batcher(absl::Milliseconds(10),
+                              [&latch](std::vector<Event> events) {
+                                EXPECT_EQ(events.size(), 2);
+                                latch.CountDown();
+                              });
+
+  Discover(batcher, peripheral_a_, "advertisement a");
+  Discover(batcher, peripheral_b_, "advertisement b");
+
+  EXPECT_TRUE(latch.Await(absl::Seconds(1)).result());
+}
+
+}  // namespace
+}  // namespace connections
+}  // namespace nearby
+}  // namespace location
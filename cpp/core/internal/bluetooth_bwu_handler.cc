@@ -18,6 +18,7 @@
 #include "core/internal/bluetooth_endpoint_channel.h"
 #include "core/internal/client_proxy.h"
 #include "core/internal/offline_frames.h"
+#include "platform/public/tracing.h"
 
 // Manages the Bluetooth-specific methods needed to upgrade an {@link
 // EndpointChannel}.
@@ -130,8 +131,10 @@ BluetoothBwuHandler::CreateUpgradedEndpointChannel(
     return nullptr;
   }
 
+  TraceSpan connect_span("medium", "bluetooth_connect", endpoint_id);
   BluetoothSocket socket = bluetooth_medium_.Connect(
       device, service_name, client->GetCancellationFlag(endpoint_id));
+  connect_span.End();
   if (!socket.IsValid()) {
     NEARBY_LOGS(ERROR)
         << "BluetoothBwuHandler failed to connect to the Bluetooth device ("
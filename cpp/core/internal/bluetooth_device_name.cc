@@ -16,13 +16,12 @@
 
 #include <inttypes.h>
 
+#include <algorithm>
 #include <cstring>
 #include <utility>
 
 #include "absl/strings/escaping.h"
-#include "absl/strings/str_cat.h"
 #include "platform/base/base64_utils.h"
-#include "platform/base/base_input_stream.h"
 #include "platform/public/logging.h"
 
 namespace location {
@@ -58,26 +57,69 @@ BluetoothDeviceName::BluetoothDeviceName(Version version, Pcp pcp,
   web_rtc_state_ = web_rtc_state;
 }
 
+bool BluetoothDeviceName::MayMatch(
+    absl::string_view bluetooth_device_name_string, Pcp pcp,
+    const ByteArray& service_id_hash) {
+  char header[kHeaderLength];
+  // Leave names that aren't plain base64 to the full parser.
+  if (!Base64Utils::DecodePrefix(bluetooth_device_name_string, header,
+                                 kHeaderLength)) {
+    return true;
+  }
+
+  char expected_version_and_pcp_byte = static_cast<char>(
+      ((static_cast<uint32_t>(Version::kV1) << 5) & kVersionBitmask) |
+      (static_cast<uint32_t>(pcp) & kPcpBitmask));
+  if (header[0] != expected_version_and_pcp_byte) return false;
+
+  return service_id_hash.size() == kServiceIdHashLength &&
+         std::memcmp(header + 1 + kEndpointIdLength, service_id_hash.data(),
+                     kServiceIdHashLength) == 0;
+}
+
 BluetoothDeviceName::BluetoothDeviceName(
+    absl::string_view bluetooth_device_name_string)
+    : BluetoothDeviceName(View(bluetooth_device_name_string)) {}
+
+BluetoothDeviceName::BluetoothDeviceName(const View& view)
+    : version_(view.GetVersion()),
+      pcp_(view.GetPcp()),
+      endpoint_id_(view.GetEndpointId()),
+      service_id_hash_(view.GetServiceIdHash().data(),
+                       view.GetServiceIdHash().size()),
+      endpoint_info_(view.GetEndpointInfo().data(),
+                     view.GetEndpointInfo().size()),
+      uwb_address_(view.GetUwbAddress().data(), view.GetUwbAddress().size()),
+      web_rtc_state_(view.GetWebRtcState()) {}
+
+BluetoothDeviceName::View::View(
     absl::string_view bluetooth_device_name_string) {
-  ByteArray bluetooth_device_name_bytes =
-      Base64Utils::Decode(bluetooth_device_name_string);
-  if (bluetooth_device_name_bytes.Empty()) {
+  int decoded_size = Base64Utils::DecodeTo(bluetooth_device_name_string,
+                                           bytes_, sizeof(bytes_));
+  if (decoded_size <= 0) {
     return;
   }
 
-  if (bluetooth_device_name_bytes.size() < kMinBluetoothDeviceNameLength) {
+  if (decoded_size < kMinBluetoothDeviceNameLength) {
     NEARBY_LOG(INFO,
                "Cannot deserialize BluetoothDeviceName: expecting min %d raw "
-               "bytes, got %" PRIu64,
-               kMinBluetoothDeviceNameLength,
-               bluetooth_device_name_bytes.size());
+               "bytes, got %d",
+               kMinBluetoothDeviceNameLength, decoded_size);
     return;
   }
 
-  BaseInputStream base_input_stream{bluetooth_device_name_bytes};
+  // Returns the next |size| bytes, or nothing if there aren't that many left.
+  absl::string_view remaining(
+      bytes_, std::min<std::size_t>(decoded_size, sizeof(bytes_)));
+  auto read = [&remaining](std::size_t size) -> absl::string_view {
+    if (remaining.size() < size) return {};
+    absl::string_view bytes = remaining.substr(0, size);
+    remaining.remove_prefix(size);
+    return bytes;
+  };
+
   // The first 1 byte is supposed to be the version and pcp.
-  auto version_and_pcp_byte = static_cast<char>(base_input_stream.ReadUint8());
+  char version_and_pcp_byte = read(1)[0];
   // The upper 3 bits are supposed to be the version.
   version_ =
       static_cast<Version>((version_and_pcp_byte & kVersionBitmask) >> 5);
@@ -102,56 +144,56 @@ BluetoothDeviceName::BluetoothDeviceName(
   }
 
   // The next 4 bytes are supposed to be the endpoint_id.
-  endpoint_id_ = std::string{base_input_stream.ReadBytes(kEndpointIdLength)};
+  endpoint_id_ = read(kEndpointIdLength);
 
   // The next 3 bytes are supposed to be the service_id_hash.
-  service_id_hash_ = base_input_stream.ReadBytes(kServiceIdHashLength);
+  service_id_hash_ = read(kServiceIdHashLength);
 
   // The next 1 byte is field containning WebRtc state.
-  auto field_byte = static_cast<char>(base_input_stream.ReadUint8());
+  char field_byte = read(1)[0];
   web_rtc_state_ = (field_byte & kWebRtcConnectableFlagBitmask) == 1
                        ? WebRtcState::kConnectable
                        : WebRtcState::kUnconnectable;
 
   // The next 6 bytes are supposed to be reserved, and can be left
   // untouched.
-  base_input_stream.ReadBytes(kReservedLength);
+  read(kReservedLength);
 
   // The next 1 byte is supposed to be the length of the endpoint_info.
-  std::uint32_t expected_endpoint_info_length = base_input_stream.ReadUint8();
+  std::uint32_t expected_endpoint_info_length =
+      static_cast<std::uint8_t>(read(1)[0]);
 
   // The rest bytes are supposed to be the endpoint_info
-  endpoint_info_ = base_input_stream.ReadBytes(expected_endpoint_info_length);
-  if (endpoint_info_.Empty() ||
-      endpoint_info_.size() != expected_endpoint_info_length) {
+  endpoint_info_ = read(expected_endpoint_info_length);
+  if (endpoint_info_.empty()) {
     NEARBY_LOG(INFO,
                "Cannot deserialize BluetoothDeviceName: expected "
                "endpoint info to be %d bytes, got %" PRIu64,
-               expected_endpoint_info_length, endpoint_info_.size());
+               expected_endpoint_info_length, remaining.size());
 
     // Clear enpoint_id for validadity.
-    endpoint_id_.clear();
+    endpoint_id_ = {};
     return;
   }
 
   // If the input stream has extra bytes, it's for UWB address. The first byte
   // is the address length. It can be 2-byte short address or 8-byte extended
   // address.
-  if (base_input_stream.IsAvailable(1)) {
+  if (!remaining.empty()) {
     // The next 1 byte is supposed to be the length of the uwb_address.
-    std::uint32_t expected_uwb_address_length = base_input_stream.ReadUint8();
+    std::uint32_t expected_uwb_address_length =
+        static_cast<std::uint8_t>(read(1)[0]);
     // If the length of usb_address is not zero, then retrieve it.
     if (expected_uwb_address_length != 0) {
-      uwb_address_ = base_input_stream.ReadBytes(expected_uwb_address_length);
-      if (uwb_address_.Empty() ||
-          uwb_address_.size() != expected_uwb_address_length) {
+      uwb_address_ = read(expected_uwb_address_length);
+      if (uwb_address_.empty()) {
         NEARBY_LOG(INFO,
                    "Cannot deserialize BluetoothDeviceName: "
                    "expected uwbAddress size to be %d bytes, got %" PRIu64,
-                   expected_uwb_address_length, uwb_address_.size());
+                   expected_uwb_address_length, remaining.size());
 
         // Clear enpoint_id for validadity.
-        endpoint_id_.clear();
+        endpoint_id_ = {};
         return;
       }
     }
@@ -159,52 +201,64 @@ BluetoothDeviceName::BluetoothDeviceName(
 }
 
 BluetoothDeviceName::operator std::string() const {
-  if (!IsValid()) {
-    return "";
+  char buffer[kMaxBluetoothDeviceNameLength];
+  return std::string(buffer, SerializeTo(buffer, sizeof(buffer)));
+}
+
+std::size_t BluetoothDeviceName::SerializeTo(char* buffer,
+                                             std::size_t size) const {
+  if (!IsValid() || uwb_address_.size() > kMaxFieldLength) {
+    return 0;
+  }
+
+  std::size_t endpoint_info_size = endpoint_info_.size();
+  if (endpoint_info_size > kMaxEndpointInfoLength) {
+    NEARBY_LOG(INFO,
+               "While serializing Advertisement, truncating Endpoint Name %s "
+               "(%lu bytes) down to %d bytes",
+               absl::BytesToHexString(endpoint_info_.data()).c_str(),
+               endpoint_info_.size(), kMaxEndpointInfoLength);
+    endpoint_info_size = kMaxEndpointInfoLength;
   }
 
+  char bytes[kMaxSerializedBytesLength];
+  char* out = bytes;
+  auto write = [&out](const char* data, std::size_t data_size) {
+    std::memcpy(out, data, data_size);
+    out += data_size;
+  };
+
   // The upper 3 bits are the Version.
   auto version_and_pcp_byte = static_cast<char>(
       (static_cast<uint32_t>(Version::kV1) << 5) & kVersionBitmask);
   // The lower 5 bits are the PCP.
   version_and_pcp_byte |=
       static_cast<char>(static_cast<uint32_t>(pcp_) & kPcpBitmask);
+  *out++ = version_and_pcp_byte;
+
+  write(endpoint_id_.data(), endpoint_id_.size());
+  write(service_id_hash_.data(), service_id_hash_.size());
 
   // A byte contains WebRtcState state.
   int web_rtc_connectable_flag =
       (web_rtc_state_ == WebRtcState::kConnectable) ? 1 : 0;
-  char field_byte = static_cast<char>(web_rtc_connectable_flag) &
-                    kWebRtcConnectableFlagBitmask;
-
-  ByteArray reserved_bytes{kReservedLength};
+  *out++ = static_cast<char>(web_rtc_connectable_flag) &
+           kWebRtcConnectableFlagBitmask;
 
-  ByteArray usable_endpoint_info(endpoint_info_);
-  if (endpoint_info_.size() > kMaxEndpointInfoLength) {
-    NEARBY_LOG(INFO,
-               "While serializing Advertisement, truncating Endpoint Name %s "
-               "(%lu bytes) down to %d bytes",
-               absl::BytesToHexString(endpoint_info_.data()).c_str(),
-               endpoint_info_.size(), kMaxEndpointInfoLength);
-    usable_endpoint_info.SetData(endpoint_info_.data(), kMaxEndpointInfoLength);
-  }
+  std::memset(out, 0, kReservedLength);
+  out += kReservedLength;
 
-  // clang-format off
-  std::string out = absl::StrCat(std::string(1, version_and_pcp_byte),
-                                 endpoint_id_,
-                                 std::string(service_id_hash_),
-                                 std::string(1, field_byte),
-                                 std::string(reserved_bytes),
-                                 std::string(1, usable_endpoint_info.size()),
-                                 std::string(usable_endpoint_info));
-  // clang-format on
+  *out++ = static_cast<char>(endpoint_info_size);
+  write(endpoint_info_.data(), endpoint_info_size);
 
   // If UWB address is available, attach it at the end.
   if (!uwb_address_.Empty()) {
-    absl::StrAppend(&out, std::string(1, uwb_address_.size()));
-    absl::StrAppend(&out, std::string(uwb_address_));
+    *out++ = static_cast<char>(uwb_address_.size());
+    write(uwb_address_.data(), uwb_address_.size());
   }
 
-  return Base64Utils::Encode(ByteArray{std::move(out)});
+  return Base64Utils::EncodeTo(absl::string_view(bytes, out - bytes), buffer,
+                               size);
 }
 
 }  // namespace connections
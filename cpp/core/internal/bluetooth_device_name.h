@@ -15,7 +15,9 @@
 #ifndef CORE_INTERNAL_BLUETOOTH_DEVICE_NAME_H_
 #define CORE_INTERNAL_BLUETOOTH_DEVICE_NAME_H_
 
+#include <cstddef>
 #include <cstdint>
+#include <string>
 
 #include "absl/strings/string_view.h"
 #include "core/internal/base_pcp_handler.h"
@@ -42,34 +44,97 @@ class BluetoothDeviceName {
 
   static constexpr int kServiceIdHashLength = 3;
 
+ private:
+  static constexpr int kEndpointIdLength = 4;
+  static constexpr int kReservedLength = 6;
+  static constexpr int kMaxEndpointInfoLength = 131;
+  static constexpr int kMinBluetoothDeviceNameLength = 16;
+  // Endpoint info and UWB address sizes are written in a single byte.
+  static constexpr int kMaxFieldLength = 0x0FF;
+  // The longest name that can be parsed, with both variable length fields as
+  // long as their size allows, and the longest name that's serialized.
+  static constexpr int kMaxBytesLength =
+      kMinBluetoothDeviceNameLength + kMaxFieldLength + 1 + kMaxFieldLength;
+  static constexpr int kMaxSerializedBytesLength =
+      kMinBluetoothDeviceNameLength + kMaxEndpointInfoLength + 1 +
+      kMaxFieldLength;
+
+ public:
+  // Base64 takes 4 characters for every 3 bytes, without padding.
+  static constexpr int kMaxBluetoothDeviceNameLength =
+      (kMaxSerializedBytesLength * 8 + 5) / 6;
+
+  // A parsed name that keeps its decoded bytes inline, and points into them
+  // rather than copying each field, so that discovered devices can be
+  // inspected without allocating. Not copyable, since the accessors point
+  // into the View itself.
+  class View {
+   public:
+    explicit View(absl::string_view bluetooth_device_name_string);
+    View(const View&) = delete;
+    View& operator=(const View&) = delete;
+
+    bool IsValid() const { return !endpoint_id_.empty(); }
+    Version GetVersion() const { return version_; }
+    Pcp GetPcp() const { return pcp_; }
+    absl::string_view GetEndpointId() const { return endpoint_id_; }
+    absl::string_view GetServiceIdHash() const { return service_id_hash_; }
+    absl::string_view GetEndpointInfo() const { return endpoint_info_; }
+    absl::string_view GetUwbAddress() const { return uwb_address_; }
+    WebRtcState GetWebRtcState() const { return web_rtc_state_; }
+
+   private:
+    Version version_{Version::kUndefined};
+    Pcp pcp_{Pcp::kUnknown};
+    absl::string_view endpoint_id_;
+    absl::string_view service_id_hash_;
+    absl::string_view endpoint_info_;
+    absl::string_view uwb_address_;
+    WebRtcState web_rtc_state_{WebRtcState::kUndefined};
+    // Bytes past the end of the longest possible name are ignored.
+    char bytes_[kMaxBytesLength];
+  };
+
   BluetoothDeviceName() = default;
   BluetoothDeviceName(Version version, Pcp pcp, absl::string_view endpoint_id,
                       const ByteArray& service_id_hash,
                       const ByteArray& endpoint_info,
                       const ByteArray& uwb_address, WebRtcState web_rtc_state);
   explicit BluetoothDeviceName(absl::string_view bluetooth_device_name_string);
+  explicit BluetoothDeviceName(const View& view);
   BluetoothDeviceName(const BluetoothDeviceName&) = default;
   BluetoothDeviceName& operator=(const BluetoothDeviceName&) = default;
   BluetoothDeviceName(BluetoothDeviceName&&) = default;
   BluetoothDeviceName& operator=(BluetoothDeviceName&&) = default;
   ~BluetoothDeviceName() = default;
 
+  // Returns false if |bluetooth_device_name_string| can't be a valid name for
+  // |pcp| and |service_id_hash|. Only the fixed-size header is decoded,
+  // without allocating, so foreign devices can be dropped as soon as they're
+  // discovered.
+  static bool MayMatch(absl::string_view bluetooth_device_name_string, Pcp pcp,
+                       const ByteArray& service_id_hash);
+
   explicit operator std::string() const;
 
+  // Writes the base64 encoded name into |buffer|, and returns its size; or 0
+  // if the name is invalid, or doesn't fit in |size| characters.
+  // kMaxBluetoothDeviceNameLength characters are always enough.
+  std::size_t SerializeTo(char* buffer, std::size_t size) const;
+
   bool IsValid() const { return !endpoint_id_.empty(); }
   Version GetVersion() const { return version_; }
   Pcp GetPcp() const { return pcp_; }
-  std::string GetEndpointId() const { return endpoint_id_; }
-  ByteArray GetServiceIdHash() const { return service_id_hash_; }
-  ByteArray GetEndpointInfo() const { return endpoint_info_; }
-  ByteArray GetUwbAddress() const { return uwb_address_; }
+  const std::string& GetEndpointId() const { return endpoint_id_; }
+  const ByteArray& GetServiceIdHash() const { return service_id_hash_; }
+  const ByteArray& GetEndpointInfo() const { return endpoint_info_; }
+  const ByteArray& GetUwbAddress() const { return uwb_address_; }
   WebRtcState GetWebRtcState() const { return web_rtc_state_; }
 
  private:
-  static constexpr int kEndpointIdLength = 4;
-  static constexpr int kReservedLength = 6;
-  static constexpr int kMaxEndpointInfoLength = 131;
-  static constexpr int kMinBluetoothDeviceNameLength = 16;
+  // Version and PCP, endpoint_id, and service_id_hash.
+  static constexpr int kHeaderLength =
+      1 + kEndpointIdLength + kServiceIdHashLength;
 
   static constexpr int kVersionBitmask = 0x0E0;
   static constexpr int kPcpBitmask = 0x01F;
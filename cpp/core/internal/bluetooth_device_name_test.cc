@@ -201,6 +201,82 @@ TEST(BluetoothDeviceNameTest, CanParseGeneratedName) {
   EXPECT_EQ(name1.GetWebRtcState(), name2.GetWebRtcState());
 }
 
+TEST(BluetoothDeviceNameTest, ViewParsesGeneratedName) {
+  ByteArray service_id_hash{std::string(kServiceIDHashBytes)};
+  ByteArray endpoint_info{std::string(kEndPointName)};
+  BluetoothDeviceName name{kVersion,        kPcp,          kEndPointID,
+                           service_id_hash, endpoint_info, ByteArray{},
+                           kWebRtcState};
+  std::string name_string(name);
+
+  BluetoothDeviceName::View view{name_string};
+
+  EXPECT_TRUE(view.IsValid());
+  EXPECT_EQ(kVersion, view.GetVersion());
+  EXPECT_EQ(kPcp, view.GetPcp());
+  EXPECT_EQ(kEndPointID, view.GetEndpointId());
+  EXPECT_EQ(kServiceIDHashBytes, view.GetServiceIdHash());
+  EXPECT_EQ(kEndPointName, view.GetEndpointInfo());
+  EXPECT_EQ(kWebRtcState, view.GetWebRtcState());
+
+  BluetoothDeviceName name_from_view{view};
+
+  EXPECT_TRUE(name_from_view.IsValid());
+  EXPECT_EQ(kEndPointID, name_from_view.GetEndpointId());
+  EXPECT_EQ(endpoint_info, name_from_view.GetEndpointInfo());
+  EXPECT_FALSE(BluetoothDeviceName::View{"My phone (2)"}.IsValid());
+}
+
+TEST(BluetoothDeviceNameTest, SerializeToMatchesString) {
+  ByteArray service_id_hash{std::string(kServiceIDHashBytes)};
+  ByteArray endpoint_info{std::string(kEndPointName)};
+  BluetoothDeviceName name{kVersion,        kPcp,          kEndPointID,
+                           service_id_hash, endpoint_info, ByteArray{},
+                           kWebRtcState};
+  char buffer[BluetoothDeviceName::kMaxBluetoothDeviceNameLength];
+
+  std::size_t size = name.SerializeTo(buffer, sizeof(buffer));
+
+  EXPECT_EQ(std::string(name), std::string(buffer, size));
+  // Nothing is written if the buffer is too small.
+  EXPECT_EQ(0, name.SerializeTo(buffer, size - 1));
+}
+
+TEST(BluetoothDeviceNameTest, MayMatchAcceptsMatchingName) {
+  ByteArray service_id_hash{std::string(kServiceIDHashBytes)};
+  ByteArray endpoint_info{std::string(kEndPointName)};
+  BluetoothDeviceName name{kVersion,        kPcp,          kEndPointID,
+                           service_id_hash, endpoint_info, ByteArray{},
+                           kWebRtcState};
+
+  EXPECT_TRUE(
+      BluetoothDeviceName::MayMatch(std::string(name), kPcp, service_id_hash));
+}
+
+TEST(BluetoothDeviceNameTest, MayMatchRejectsOtherPcpAndServiceIdHash) {
+  ByteArray service_id_hash{std::string(kServiceIDHashBytes)};
+  ByteArray endpoint_info{std::string(kEndPointName)};
+  BluetoothDeviceName name{kVersion,        kPcp,          kEndPointID,
+                           service_id_hash, endpoint_info, ByteArray{},
+                           kWebRtcState};
+  ByteArray other_service_id_hash{std::string("\x0a\x0b\x0d")};
+
+  EXPECT_FALSE(BluetoothDeviceName::MayMatch(std::string(name), Pcp::kP2pStar,
+                                             service_id_hash));
+  EXPECT_FALSE(BluetoothDeviceName::MayMatch(std::string(name), kPcp,
+                                             other_service_id_hash));
+}
+
+TEST(BluetoothDeviceNameTest, MayMatchLeavesUnusualNamesToTheParser) {
+  ByteArray service_id_hash{std::string(kServiceIDHashBytes)};
+
+  // Too short, or not base64: only the full parse can tell.
+  EXPECT_TRUE(BluetoothDeviceName::MayMatch("Pixel", kPcp, service_id_hash));
+  EXPECT_TRUE(
+      BluetoothDeviceName::MayMatch("My phone (2)", kPcp, service_id_hash));
+  EXPECT_FALSE(BluetoothDeviceName{"My phone (2)"}.IsValid());
+}
+
 }  // namespace
 }  // namespace connections
 }  // namespace nearby
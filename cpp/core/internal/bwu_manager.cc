@@ -27,6 +27,7 @@
 #include "platform/base/byte_array.h"
 #include "platform/base/feature_flags.h"
 #include "platform/public/count_down_latch.h"
+#include "platform/public/tracing.h"
 #include "proto/connections_enums.pb.h"
 
 namespace location {
@@ -147,6 +148,7 @@ void BwuManager::InitiateBwuForEndpoint(ClientProxy* client,
   NEARBY_LOGS(INFO) << "InitiateBwuForEndpoint for endpoint " << endpoint_id
                     << " with medium " << new_medium;
   RunOnBwuManagerThread("bwu-init", [this, client, endpoint_id, new_medium]() {
+    NEARBY_TRACE_SPAN("bwu", "initiate_bwu", endpoint_id);
     Medium proposed_medium = ChooseBestUpgradeMedium(
         client->GetUpgradeMediums(endpoint_id).GetMediums(true));
     if (new_medium != Medium::UNKNOWN_MEDIUM) {
@@ -379,6 +381,7 @@ void BwuManager::OnIncomingConnection(
       mutable_connection.release());
   RunOnBwuManagerThread(
       "bwu-on-incoming-connection", [this, client, connection]() {
+        NEARBY_TRACE_SPAN("bwu", "incoming_connection");
         absl::Time connection_attempt_start_time =
             SystemClock::ElapsedRealtime();
         EndpointChannel* channel = connection->channel.get();
@@ -473,6 +476,7 @@ void BwuManager::RunUpgradeProtocol(
   NEARBY_LOGS(INFO) << "RunUpgradeProtocol new channel @" << new_channel.get()
                     << " name: " << new_channel->GetName()
                     << ", medium: " << new_channel->GetMedium();
+  NEARBY_TRACE_SPAN("bwu", "upgrade_protocol", endpoint_id);
   // First, register this new EndpointChannel as *the* EndpointChannel to use
   // for this endpoint here onwards. NOTE: We pause this new EndpointChannel
   // until we've completely drained the old EndpointChannel to avoid out of
@@ -538,6 +542,7 @@ void BwuManager::ProcessBwuPathAvailableEvent(
                     << endpoint_id << " medium "
                     << parser::UpgradePathInfoMediumToMedium(
                            upgrade_path_info.medium());
+  NEARBY_TRACE_SPAN("bwu", "path_available", endpoint_id);
   if (in_progress_upgrades_.contains(endpoint_id)) {
     NEARBY_LOGS(ERROR)
         << "BwuManager received a duplicate bandwidth upgrade for endpoint "
@@ -877,6 +882,7 @@ void BwuManager::ProcessSafeToClosePriorChannelEvent(
     ClientProxy* client, const std::string& endpoint_id) {
   NEARBY_LOGS(INFO) << "ProcessSafeToClosePriorChannelEvent for endpoint "
                     << endpoint_id;
+  NEARBY_TRACE_SPAN("bwu", "close_prior_channel", endpoint_id);
   // By this point in the upgrade protocol, there's no more writes happening
   // over the prior EndpointChannel, and the remote device has given us the
   // go-ahead to close this EndpointChannel [1], so we can safely close it
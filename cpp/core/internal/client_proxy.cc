@@ -562,6 +562,24 @@ bool ClientProxy::RemoteConnectionIsAccepted(std::string endpoint_id) const {
       endpoint_id, ClientProxy::Connection::kRemoteEndpointAccepted);
 }
 
+void ClientProxy::SetRemotePayloadCompressionSupported(
+    const std::string& endpoint_id, bool supported) {
+  MutexLock lock(&mutex_);
+
+  Connection* item = LookupConnection(endpoint_id);
+  if (item != nullptr) {
+    item->supports_payload_compression = supported;
+  }
+}
+
+bool ClientProxy::IsRemotePayloadCompressionSupported(
+    const std::string& endpoint_id) const {
+  MutexLock lock(&mutex_);
+
+  const Connection* item = LookupConnection(endpoint_id);
+  return item != nullptr && item->supports_payload_compression;
+}
+
 void ClientProxy::AddCancellationFlag(const std::string& endpoint_id) {
   // Don't insert the CancellationFlag to the map if feature flag is disabled.
   if (!FeatureFlags::GetInstance().GetFlags().enable_cancellation_flag) {
@@ -169,6 +169,14 @@ class ClientProxy final {
   bool LocalConnectionIsAccepted(std::string endpoint_id) const;
   bool RemoteConnectionIsAccepted(std::string endpoint_id) const;
 
+  // Records whether the remote endpoint announced that it can read compressed
+  // payload chunks.
+  void SetRemotePayloadCompressionSupported(const std::string& endpoint_id,
+                                            bool supported);
+  // Returns true if compressed payload chunks may be sent to this endpoint.
+  bool IsRemotePayloadCompressionSupported(
+      const std::string& endpoint_id) const;
+
   // Adds a CancellationFlag for endpoint id.
   void AddCancellationFlag(const std::string& endpoint_id);
   // Returns the CancellationFlag for endpoint id,
@@ -216,6 +224,7 @@ class ClientProxy final {
     PayloadListener payload_listener;
     ConnectionOptions connection_options;
     std::string connection_token;
+    bool supports_payload_compression{false};
   };
 
   struct AdvertisingInfo {
@@ -0,0 +1,59 @@
+// Copyright 2021 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "core/internal/content_hasher.h"
+
+#include <algorithm>
+
+#include "platform/public/crypto.h"
+
+namespace location {
+namespace nearby {
+namespace connections {
+
+// C++14 requires to declare this.
+// TODO(apolyudov): remove when migration to c++17 is possible.
+constexpr std::size_t ContentHasher::kBlockSize;
+constexpr std::size_t ContentHasher::kHashSize;
+
+void ContentHasher::Update(const ByteArray& data) {
+  const char* next = data.data();
+  std::size_t remaining = data.size();
+  size_ += remaining;
+  while (remaining > 0) {
+    std::size_t take =
+        std::min(remaining, kBlockSize - pending_block_.size());
+    pending_block_.append(next, take);
+    next += take;
+    remaining -= take;
+    if (pending_block_.size() == kBlockSize) {
+      state_ = std::string(Crypto::Sha256(state_ + pending_block_));
+      pending_block_.clear();
+    }
+  }
+}
+
+ByteArray ContentHasher::GetHash() const {
+  // Mix in the total size, so content that ends on a block boundary hashes
+  // differently from the same content followed by an empty tail.
+  std::string size_bytes(sizeof(size_), '\0');
+  for (std::size_t i = 0; i < sizeof(size_); i++) {
+    size_bytes[i] = static_cast<char>(size_ >> (8 * i));
+  }
+  return Crypto::Sha256(state_ + pending_block_ + size_bytes);
+}
+
+}  // namespace connections
+}  // namespace nearby
+}  // namespace location
@@ -0,0 +1,57 @@
+// Copyright 2021 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef CORE_INTERNAL_CONTENT_HASHER_H_
+#define CORE_INTERNAL_CONTENT_HASHER_H_
+
+#include <cstdint>
+#include <string>
+
+#include "platform/base/byte_array.h"
+
+namespace location {
+namespace nearby {
+namespace connections {
+
+// Computes a SHA-256 based hash of a payload's content, one chunk at a time.
+//
+// Data is hashed in fixed size blocks, each folded into the hash of the
+// blocks before it, so the result does not depend on how the content was
+// split into chunks and only one block is ever buffered. Not thread safe.
+class ContentHasher {
+ public:
+  static constexpr std::size_t kBlockSize = 64 * 1024;
+  static constexpr std::size_t kHashSize = 32;
+
+  // Appends |data| to the hashed content.
+  void Update(const ByteArray& data);
+
+  // Returns the hash of all data passed to Update() so far.
+  ByteArray GetHash() const;
+
+  // Returns the number of bytes hashed so far.
+  std::int64_t GetSize() const { return size_; }
+
+ private:
+  // Hash of all complete blocks; empty before the first one.
+  std::string state_;
+  std::string pending_block_;
+  std::int64_t size_ = 0;
+};
+
+}  // namespace connections
+}  // namespace nearby
+}  // namespace location
+
+#endif  // CORE_INTERNAL_CONTENT_HASHER_H_
@@ -0,0 +1,78 @@
+// Copyright 2021 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "core/internal/content_hasher.h"
+
+#include <string>
+
+#include "gtest/gtest.h"
+#include "platform/public/crypto.h"
+
+namespace location {
+namespace nearby {
+namespace connections {
+namespace {
+
+std::string MakeContent(std::size_t size) {
+  std::string content(size, '\0');
+  for (std::size_t i = 0; i < size; i++) {
+    content[i] = static_cast<char>(i * 13 + i / 251);
+  }
+  return content;
+}
+
+ByteArray HashInChunks(const std::string& content, std::size_t chunk_size) {
+  ContentHasher hasher;
+  for (std::size_t offset = 0; offset < content.size(); offset += chunk_size) {
+    hasher.Update(ByteArray(content.substr(offset, chunk_size)));
+  }
+  return hasher.GetHash();
+}
+
+TEST(ContentHasherTest, SmallContentIsSha256OfContentAndSize) {
+  ContentHasher hasher;
+  hasher.Update(ByteArray(std::string("abc")));
+  std::string size_bytes("\x03\0\0\0\0\0\0\0", 8);
+
+  EXPECT_EQ(hasher.GetSize(), 3);
+  EXPECT_EQ(hasher.GetHash(), Crypto::Sha256("abc" + size_bytes));
+}
+
+TEST(ContentHasherTest, EmptyContentIsSha256OfSize) {
+  EXPECT_EQ(ContentHasher().GetHash(), Crypto::Sha256(std::string(8, '\0')));
+}
+
+TEST(ContentHasherTest, HashDoesNotDependOnChunking) {
+  std::string content = MakeContent(3 * ContentHasher::kBlockSize + 1234);
+  ByteArray expected = HashInChunks(content, content.size());
+
+  EXPECT_EQ(expected.size(), ContentHasher::kHashSize);
+  for (std::size_t chunk_size : {1000, 4096, 65536, 100000}) {
+    EXPECT_EQ(HashInChunks(content, chunk_size), expected)
+        << "chunk_size=" << chunk_size;
+  }
+}
+
+TEST(ContentHasherTest, DifferentContentHashesDifferently) {
+  std::string content = MakeContent(ContentHasher::kBlockSize + 10);
+  std::string changed = content;
+  changed[5] ^= 1;
+
+  EXPECT_NE(HashInChunks(content, 4096), HashInChunks(changed, 4096));
+}
+
+}  // namespace
+}  // namespace connections
+}  // namespace nearby
+}  // namespace location
@@ -0,0 +1,172 @@
+// Copyright 2021 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "core/internal/data_frame_cipher.h"
+
+#include <cstring>
+#include <limits>
+#include <string>
+
+#include "absl/memory/memory.h"
+#include "core/internal/session_keys.h"
+#include "platform/public/logging.h"
+#include "openssl/evp.h"
+
+namespace location {
+namespace nearby {
+namespace connections {
+
+// C++14 requires to declare this.
+// TODO(apolyudov): remove when migration to c++17 is possible.
+constexpr std::int32_t DataFrameCipher::kVersion;
+constexpr int DataFrameCipher::kOverhead;
+constexpr int DataFrameCipher::kKeySize;
+
+namespace {
+
+constexpr int kNonceSize = 12;
+constexpr int kTagSize = 16;
+constexpr unsigned char kVersionByte = DataFrameCipher::kVersion;
+
+constexpr char kHkdfSalt[] = "Nearby Connections data frames";
+constexpr char kHkdfInfo[] = "AES-256-GCM v1";
+
+EVP_CIPHER_CTX* CreateContext(const ByteArray& secret, bool seal) {
+  if (secret.size() != DataFrameCipher::kKeySize) return nullptr;
+  ByteArray key = SessionKeys::Hkdf(secret, ByteArray(kHkdfSalt), kHkdfInfo);
+  if (key.size() != DataFrameCipher::kKeySize) return nullptr;
+  EVP_CIPHER_CTX* context = EVP_CIPHER_CTX_new();
+  if (context == nullptr) return nullptr;
+  // The key schedule is set up once here; each frame only sets a new nonce.
+  if (EVP_CipherInit_ex(context, EVP_aes_256_gcm(), nullptr,
+                        reinterpret_cast<const unsigned char*>(key.data()),
+                        nullptr, seal ? 1 : 0) != 1) {
+    EVP_CIPHER_CTX_free(context);
+    return nullptr;
+  }
+  return context;
+}
+
+// Nonces are 4 zero bytes followed by the big-endian frame counter.
+void CounterToNonce(std::uint64_t counter, unsigned char nonce[kNonceSize]) {
+  std::memset(nonce, 0, kNonceSize);
+  for (int i = kNonceSize - 1; i >= kNonceSize - 8; i--) {
+    nonce[i] = static_cast<unsigned char>(counter & 0xFF);
+    counter >>= 8;
+  }
+}
+
+}  // namespace
+
+std::unique_ptr<DataFrameCipher> DataFrameCipher::Create(
+    EncryptionContext& context) {
+  ByteArray encode_key;
+  ByteArray decode_key;
+  if (!SessionKeys::Read(context, &encode_key, &decode_key)) {
+    NEARBY_LOGS(WARNING) << "Unable to read session keys; not using AEAD "
+                            "data frames.";
+    return nullptr;
+  }
+  return Create(encode_key, decode_key);
+}
+
+std::unique_ptr<DataFrameCipher> DataFrameCipher::Create(
+    const ByteArray& encode_secret, const ByteArray& decode_secret) {
+  EVP_CIPHER_CTX* seal_context = CreateContext(encode_secret, /*seal=*/true);
+  EVP_CIPHER_CTX* open_context = CreateContext(decode_secret, /*seal=*/false);
+  if (seal_context == nullptr || open_context == nullptr) {
+    EVP_CIPHER_CTX_free(seal_context);
+    EVP_CIPHER_CTX_free(open_context);
+    return nullptr;
+  }
+  return absl::WrapUnique(new DataFrameCipher(seal_context, open_context));
+}
+
+DataFrameCipher::DataFrameCipher(evp_cipher_ctx_st* seal_context,
+                                 evp_cipher_ctx_st* open_context)
+    : seal_context_(seal_context), open_context_(open_context) {}
+
+DataFrameCipher::~DataFrameCipher() {
+  EVP_CIPHER_CTX_free(seal_context_);
+  EVP_CIPHER_CTX_free(open_context_);
+}
+
+bool DataFrameCipher::IsSealed(const ByteArray& data) {
+  return data.size() >= kOverhead &&
+         static_cast<unsigned char>(data.data()[0]) == kVersionByte;
+}
+
+ByteArray DataFrameCipher::Seal(const ByteArray& data) {
+  if (seal_counter_ == std::numeric_limits<std::uint64_t>::max() ||
+      data.size() > static_cast<std::size_t>(std::numeric_limits<int>::max() -
+                                             kOverhead)) {
+    return {};
+  }
+  unsigned char nonce[kNonceSize];
+  CounterToNonce(seal_counter_, nonce);
+
+  // Encrypt straight into the outgoing frame.
+  ByteArray frame(data.size() + kOverhead);
+  auto* out = reinterpret_cast<unsigned char*>(frame.data());
+  out[0] = kVersionByte;
+  int size = 0;
+  int final_size = 0;
+  if (EVP_EncryptInit_ex(seal_context_, nullptr, nullptr, nullptr, nonce) !=
+          1 ||
+      EVP_EncryptUpdate(seal_context_, nullptr, &size, out, 1) != 1 ||
+      EVP_EncryptUpdate(seal_context_, out + 1, &size,
+                        reinterpret_cast<const unsigned char*>(data.data()),
+                        static_cast<int>(data.size())) != 1 ||
+      EVP_EncryptFinal_ex(seal_context_, out + 1 + size, &final_size) != 1 ||
+      EVP_CIPHER_CTX_ctrl(seal_context_, EVP_CTRL_GCM_GET_TAG, kTagSize,
+                          out + 1 + data.size()) != 1) {
+    return {};
+  }
+  seal_counter_++;
+  return frame;
+}
+
+ExceptionOr<ByteArray> DataFrameCipher::Open(const ByteArray& frame) {
+  if (!IsSealed(frame) ||
+      open_counter_ == std::numeric_limits<std::uint64_t>::max()) {
+    return {Exception::kInvalidProtocolBuffer};
+  }
+  unsigned char nonce[kNonceSize];
+  CounterToNonce(open_counter_, nonce);
+
+  const auto* in = reinterpret_cast<const unsigned char*>(frame.data());
+  const std::size_t data_size = frame.size() - kOverhead;
+  unsigned char tag[kTagSize];
+  std::memcpy(tag, in + 1 + data_size, kTagSize);
+  ByteArray data(data_size);
+  auto* out = reinterpret_cast<unsigned char*>(data.data());
+  int size = 0;
+  int final_size = 0;
+  if (EVP_DecryptInit_ex(open_context_, nullptr, nullptr, nullptr, nonce) !=
+          1 ||
+      EVP_DecryptUpdate(open_context_, nullptr, &size, in, 1) != 1 ||
+      EVP_DecryptUpdate(open_context_, out, &size, in + 1,
+                        static_cast<int>(data_size)) != 1 ||
+      EVP_CIPHER_CTX_ctrl(open_context_, EVP_CTRL_GCM_SET_TAG, kTagSize,
+                          tag) != 1 ||
+      EVP_DecryptFinal_ex(open_context_, out + size, &final_size) != 1) {
+    return {Exception::kInvalidProtocolBuffer};
+  }
+  open_counter_++;
+  return ExceptionOr<ByteArray>(std::move(data));
+}
+
+}  // namespace connections
+}  // namespace nearby
+}  // namespace location
@@ -0,0 +1,95 @@
+// Copyright 2021 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef CORE_INTERNAL_DATA_FRAME_CIPHER_H_
+#define CORE_INTERNAL_DATA_FRAME_CIPHER_H_
+
+#include <cstdint>
+#include <memory>
+
+#include "securegcm/d2d_connection_context_v1.h"
+#include "platform/base/byte_array.h"
+#include "platform/base/exception.h"
+
+// Forward declaration, to keep OpenSSL headers out of this one.
+struct evp_cipher_ctx_st;
+
+namespace location {
+namespace nearby {
+namespace connections {
+
+// Seals data frames with AES-256-GCM directly, instead of wrapping each of
+// them in a signed D2D SecureMessage.
+//
+// Keys are derived from the directional UKEY2 session keys, so both ends of a
+// connection agree on them without extra messages. Nonces are implicit frame
+// counters, one per direction, so frames must be opened in the order they were
+// sealed, just like D2D messages.
+//
+// A sealed frame is: version byte | ciphertext | 16-byte tag. The version byte
+// is authenticated, and never collides with the first byte of a serialized
+// OfflineFrame or D2D message, so readers can tell the formats apart.
+//
+// Seal() and Open() may run concurrently with each other; concurrent calls to
+// the same one must be serialized by the caller.
+class DataFrameCipher {
+ public:
+  using EncryptionContext = ::securegcm::D2DConnectionContextV1;
+
+  // Highest data frame format version this implementation can read and write.
+  static constexpr std::int32_t kVersion = 1;
+  // Bytes added by Seal() to each frame.
+  static constexpr int kOverhead = 17;
+  static constexpr int kKeySize = 32;
+
+  // Returns a cipher keyed from the session keys in |context|, or nullptr if
+  // they can't be extracted; callers then keep using |context| on its own.
+  static std::unique_ptr<DataFrameCipher> Create(EncryptionContext& context);
+
+  // Returns a cipher keyed from kKeySize-byte secrets for each direction; a
+  // peer's |encode_secret| is the local |decode_secret|, and vice versa.
+  // Returns nullptr if the secrets are malformed.
+  static std::unique_ptr<DataFrameCipher> Create(
+      const ByteArray& encode_secret, const ByteArray& decode_secret);
+
+  ~DataFrameCipher();
+  DataFrameCipher(const DataFrameCipher&) = delete;
+  DataFrameCipher& operator=(const DataFrameCipher&) = delete;
+
+  // Returns true if |data| is a frame produced by Seal().
+  static bool IsSealed(const ByteArray& data);
+
+  // Returns |data| sealed for the peer, or an empty ByteArray on failure.
+  ByteArray Seal(const ByteArray& data);
+
+  // Returns the contents of |frame|, sealed by the peer. Fails with
+  // Exception::kInvalidProtocolBuffer if it doesn't authenticate, including
+  // when it was replayed, dropped or reordered.
+  ExceptionOr<ByteArray> Open(const ByteArray& frame);
+
+ private:
+  DataFrameCipher(evp_cipher_ctx_st* seal_context,
+                  evp_cipher_ctx_st* open_context);
+
+  evp_cipher_ctx_st* const seal_context_;
+  std::uint64_t seal_counter_ = 0;
+  evp_cipher_ctx_st* const open_context_;
+  std::uint64_t open_counter_ = 0;
+};
+
+}  // namespace connections
+}  // namespace nearby
+}  // namespace location
+
+#endif  // CORE_INTERNAL_DATA_FRAME_CIPHER_H_
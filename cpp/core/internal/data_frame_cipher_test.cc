@@ -0,0 +1,121 @@
+// Copyright 2021 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "core/internal/data_frame_cipher.h"
+
+#include <memory>
+#include <string>
+
+#include "gtest/gtest.h"
+
+namespace location {
+namespace nearby {
+namespace connections {
+namespace {
+
+const ByteArray kSecretA(std::string(DataFrameCipher::kKeySize, 'a'));
+const ByteArray kSecretB(std::string(DataFrameCipher::kKeySize, 'b'));
+
+struct CipherPair {
+  std::unique_ptr<DataFrameCipher> local;
+  std::unique_ptr<DataFrameCipher> remote;
+};
+
+CipherPair CreateCipherPair() {
+  return {DataFrameCipher::Create(kSecretA, kSecretB),
+          DataFrameCipher::Create(kSecretB, kSecretA)};
+}
+
+TEST(DataFrameCipherTest, OpensWhatPeerSealed) {
+  CipherPair ciphers = CreateCipherPair();
+  ASSERT_NE(ciphers.local, nullptr);
+  ASSERT_NE(ciphers.remote, nullptr);
+
+  for (const std::string& message : {std::string("first"), std::string(),
+                                     std::string(70000, 'x')}) {
+    ByteArray frame = ciphers.local->Seal(ByteArray(message));
+    ASSERT_EQ(frame.size(), message.size() + DataFrameCipher::kOverhead);
+    EXPECT_TRUE(DataFrameCipher::IsSealed(frame));
+    EXPECT_EQ(std::string(frame).find("first"), std::string::npos);
+
+    ExceptionOr<ByteArray> opened = ciphers.remote->Open(frame);
+    ASSERT_TRUE(opened.ok());
+    EXPECT_EQ(std::string(opened.result()), message);
+  }
+}
+
+TEST(DataFrameCipherTest, DirectionsUseDifferentKeys) {
+  CipherPair ciphers = CreateCipherPair();
+  ByteArray data("same data");
+
+  ByteArray local_frame = ciphers.local->Seal(data);
+  ByteArray remote_frame = ciphers.remote->Seal(data);
+
+  EXPECT_NE(local_frame, remote_frame);
+  // A frame can't be reflected back to its sender.
+  EXPECT_FALSE(ciphers.local->Open(local_frame).ok());
+}
+
+TEST(DataFrameCipherTest, NonceAdvancesPerFrame) {
+  CipherPair ciphers = CreateCipherPair();
+  ByteArray data("repeated");
+
+  ByteArray first = ciphers.local->Seal(data);
+  ByteArray second = ciphers.local->Seal(data);
+
+  EXPECT_NE(first, second);
+  EXPECT_TRUE(ciphers.remote->Open(first).ok());
+  EXPECT_TRUE(ciphers.remote->Open(second).ok());
+}
+
+TEST(DataFrameCipherTest, RejectsReplayedAndReorderedFrames) {
+  CipherPair ciphers = CreateCipherPair();
+  ByteArray first = ciphers.local->Seal(ByteArray("first"));
+  ByteArray second = ciphers.local->Seal(ByteArray("second"));
+
+  EXPECT_FALSE(ciphers.remote->Open(second).ok());
+  EXPECT_TRUE(ciphers.remote->Open(first).ok());
+  EXPECT_FALSE(ciphers.remote->Open(first).ok());
+  EXPECT_TRUE(ciphers.remote->Open(second).ok());
+}
+
+TEST(DataFrameCipherTest, RejectsTamperedFrames) {
+  CipherPair ciphers = CreateCipherPair();
+  ByteArray frame = ciphers.local->Seal(ByteArray("untouched"));
+
+  for (std::size_t i = 1; i < frame.size(); i++) {
+    ByteArray tampered = frame;
+    tampered.data()[i] ^= 0x01;
+    EXPECT_FALSE(ciphers.remote->Open(tampered).ok()) << "byte " << i;
+  }
+  EXPECT_TRUE(ciphers.remote->Open(frame).ok());
+}
+
+TEST(DataFrameCipherTest, UnsealedDataIsRecognized) {
+  EXPECT_FALSE(DataFrameCipher::IsSealed(ByteArray()));
+  // Serialized OfflineFrames start with their version field.
+  EXPECT_FALSE(DataFrameCipher::IsSealed(ByteArray(std::string(32, '\x08'))));
+  // D2D messages are serialized SecureMessages, starting with their header.
+  EXPECT_FALSE(DataFrameCipher::IsSealed(ByteArray(std::string(32, '\x0a'))));
+}
+
+TEST(DataFrameCipherTest, RejectsMalformedSecrets) {
+  EXPECT_EQ(DataFrameCipher::Create(ByteArray("short"), kSecretB), nullptr);
+  EXPECT_EQ(DataFrameCipher::Create(kSecretA, ByteArray()), nullptr);
+}
+
+}  // namespace
+}  // namespace connections
+}  // namespace nearby
+}  // namespace location
@@ -0,0 +1,231 @@
+// Copyright 2021 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef CORE_INTERNAL_DISCOVERED_ENDPOINT_INDEX_H_
+#define CORE_INTERNAL_DISCOVERED_ENDPOINT_INDEX_H_
+
+#include <cstddef>
+#include <deque>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "absl/container/flat_hash_map.h"
+#include "absl/container/inlined_vector.h"
+#include "proto/connections_enums.pb.h"
+
+namespace location {
+namespace nearby {
+namespace connections {
+
+// Holds the endpoints found during discovery, at most one per endpoint id and
+// medium, indexed by endpoint id and by medium.
+//
+// Finding, adding or removing an endpoint takes constant time, however many
+// endpoints were discovered, and so does listing the endpoints of an id or
+// medium, relative to the size of the result. Index entries are recycled
+// rather than freed, since discovery keeps finding and losing endpoints.
+//
+// Returned pointers stay valid until the endpoint is removed.
+//
+// Note: Endpoint must have |endpoint_id| and |medium| fields.
+template <typename Endpoint>
+class DiscoveredEndpointIndex {
+ public:
+  using Medium = proto::connections::Medium;
+
+  DiscoveredEndpointIndex() = default;
+  DiscoveredEndpointIndex(const DiscoveredEndpointIndex&) = delete;
+  DiscoveredEndpointIndex& operator=(const DiscoveredEndpointIndex&) = delete;
+
+  // Adds |endpoint|. Returns nullptr, and leaves the index unchanged, if
+  // there's already an endpoint with the same id and medium.
+  Endpoint* Add(std::shared_ptr<Endpoint> endpoint);
+
+  // Removes the endpoint with this id and medium, and returns it, so that the
+  // caller can keep using it for a while; or nullptr if there's none.
+  std::shared_ptr<Endpoint> Remove(const std::string& endpoint_id,
+                                   Medium medium);
+
+  void Clear();
+
+  // Returns the endpoint with this id and medium, or nullptr.
+  Endpoint* Find(const std::string& endpoint_id, Medium medium) const;
+
+  // Returns the first endpoint found with this id, or nullptr.
+  Endpoint* FindFirst(const std::string& endpoint_id) const;
+
+  // Returns the endpoints with this id, in the order they were found.
+  std::vector<Endpoint*> FindAll(const std::string& endpoint_id) const;
+
+  // Returns the endpoints found over |medium|, in no particular order.
+  std::vector<Endpoint*> FindAll(Medium medium) const;
+
+  bool Contains(const std::string& endpoint_id) const {
+    return by_endpoint_id_.contains(endpoint_id);
+  }
+  std::size_t Size() const { return size_; }
+
+ private:
+  struct Entry {
+    std::shared_ptr<Endpoint> endpoint;
+    // Position in by_medium_[endpoint->medium].
+    std::size_t medium_position = 0;
+  };
+
+  // Endpoints are rarely found over more than a couple of mediums.
+  using EndpointIdEntries = absl::InlinedVector<Entry*, 2>;
+
+  Entry* FindEntry(const std::string& endpoint_id, Medium medium) const;
+  Entry* AllocateEntry();
+
+  absl::flat_hash_map<std::string, EndpointIdEntries> by_endpoint_id_;
+  absl::flat_hash_map<Medium, std::vector<Entry*>> by_medium_;
+  std::size_t size_ = 0;
+
+  // Entries live here, and are reused through free_entries_ once removed;
+  // a deque never moves its elements as it grows.
+  std::deque<Entry> entries_;
+  std::vector<Entry*> free_entries_;
+};
+
+template <typename Endpoint>
+Endpoint* DiscoveredEndpointIndex<Endpoint>::Add(
+    std::shared_ptr<Endpoint> endpoint) {
+  EndpointIdEntries& id_entries = by_endpoint_id_[endpoint->endpoint_id];
+  for (const Entry* entry : id_entries) {
+    if (entry->endpoint->medium == endpoint->medium) return nullptr;
+  }
+
+  Entry* entry = AllocateEntry();
+  entry->endpoint = std::move(endpoint);
+  std::vector<Entry*>& medium_entries = by_medium_[entry->endpoint->medium];
+  entry->medium_position = medium_entries.size();
+  medium_entries.push_back(entry);
+  id_entries.push_back(entry);
+  size_++;
+  return entry->endpoint.get();
+}
+
+template <typename Endpoint>
+std::shared_ptr<Endpoint> DiscoveredEndpointIndex<Endpoint>::Remove(
+    const std::string& endpoint_id, Medium medium) {
+  auto id_item = by_endpoint_id_.find(endpoint_id);
+  if (id_item == by_endpoint_id_.end()) return nullptr;
+  EndpointIdEntries& id_entries = id_item->second;
+  Entry* entry = nullptr;
+  for (auto it = id_entries.begin(); it != id_entries.end(); ++it) {
+    if ((*it)->endpoint->medium == medium) {
+      entry = *it;
+      id_entries.erase(it);
+      break;
+    }
+  }
+  if (entry == nullptr) return nullptr;
+  if (id_entries.empty()) by_endpoint_id_.erase(id_item);
+
+  // Swap the last entry of the medium into the removed entry's place.
+  std::vector<Entry*>& medium_entries = by_medium_[medium];
+  Entry* last = medium_entries.back();
+  medium_entries[entry->medium_position] = last;
+  last->medium_position = entry->medium_position;
+  medium_entries.pop_back();
+
+  size_--;
+  std::shared_ptr<Endpoint> endpoint = std::move(entry->endpoint);
+  entry->endpoint = nullptr;
+  free_entries_.push_back(entry);
+  return endpoint;
+}
+
+template <typename Endpoint>
+void DiscoveredEndpointIndex<Endpoint>::Clear() {
+  by_endpoint_id_.clear();
+  by_medium_.clear();
+  size_ = 0;
+  entries_.clear();
+  free_entries_.clear();
+}
+
+template <typename Endpoint>
+Endpoint* DiscoveredEndpointIndex<Endpoint>::Find(
+    const std::string& endpoint_id, Medium medium) const {
+  Entry* entry = FindEntry(endpoint_id, medium);
+  return entry != nullptr ? entry->endpoint.get() : nullptr;
+}
+
+template <typename Endpoint>
+Endpoint* DiscoveredEndpointIndex<Endpoint>::FindFirst(
+    const std::string& endpoint_id) const {
+  auto item = by_endpoint_id_.find(endpoint_id);
+  if (item == by_endpoint_id_.end()) return nullptr;
+  return item->second.front()->endpoint.get();
+}
+
+template <typename Endpoint>
+std::vector<Endpoint*> DiscoveredEndpointIndex<Endpoint>::FindAll(
+    const std::string& endpoint_id) const {
+  std::vector<Endpoint*> result;
+  auto item = by_endpoint_id_.find(endpoint_id);
+  if (item == by_endpoint_id_.end()) return result;
+  result.reserve(item->second.size());
+  for (const Entry* entry : item->second) {
+    result.push_back(entry->endpoint.get());
+  }
+  return result;
+}
+
+template <typename Endpoint>
+std::vector<Endpoint*> DiscoveredEndpointIndex<Endpoint>::FindAll(
+    Medium medium) const {
+  std::vector<Endpoint*> result;
+  auto item = by_medium_.find(medium);
+  if (item == by_medium_.end()) return result;
+  result.reserve(item->second.size());
+  for (const Entry* entry : item->second) {
+    result.push_back(entry->endpoint.get());
+  }
+  return result;
+}
+
+template <typename Endpoint>
+typename DiscoveredEndpointIndex<Endpoint>::Entry*
+DiscoveredEndpointIndex<Endpoint>::FindEntry(const std::string& endpoint_id,
+                                             Medium medium) const {
+  auto item = by_endpoint_id_.find(endpoint_id);
+  if (item == by_endpoint_id_.end()) return nullptr;
+  for (Entry* entry : item->second) {
+    if (entry->endpoint->medium == medium) return entry;
+  }
+  return nullptr;
+}
+
+template <typename Endpoint>
+typename DiscoveredEndpointIndex<Endpoint>::Entry*
+DiscoveredEndpointIndex<Endpoint>::AllocateEntry() {
+  if (free_entries_.empty()) {
+    entries_.emplace_back();
+    return &entries_.back();
+  }
+  Entry* entry = free_entries_.back();
+  free_entries_.pop_back();
+  return entry;
+}
+
+}  // namespace connections
+}  // namespace nearby
+}  // namespace location
+
+#endif  // CORE_INTERNAL_DISCOVERED_ENDPOINT_INDEX_H_
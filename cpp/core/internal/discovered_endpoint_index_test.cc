@@ -0,0 +1,129 @@
+// Copyright 2021 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "core/internal/discovered_endpoint_index.h"
+
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+#include "absl/strings/str_cat.h"
+
+namespace location {
+namespace nearby {
+namespace connections {
+namespace {
+
+using ::location::nearby::proto::connections::Medium;
+using ::testing::ElementsAre;
+using ::testing::IsEmpty;
+using ::testing::UnorderedElementsAre;
+
+struct TestEndpoint {
+  TestEndpoint(std::string endpoint_id, Medium medium)
+      : endpoint_id(std::move(endpoint_id)), medium(medium) {}
+
+  std::string endpoint_id;
+  Medium medium;
+};
+
+using Index = DiscoveredEndpointIndex<TestEndpoint>;
+
+TestEndpoint* Add(Index& index, const std::string& endpoint_id, Medium medium) {
+  return index.Add(std::make_shared<TestEndpoint>(endpoint_id, medium));
+}
+
+TEST(DiscoveredEndpointIndexTest, FindsEndpointsByIdAndMedium) {
+  Index index;
+  TestEndpoint* ble = Add(index, "ABCD", Medium::BLE);
+  TestEndpoint* bluetooth = Add(index, "ABCD", Medium::BLUETOOTH);
+  TestEndpoint* other = Add(index, "WXYZ", Medium::BLE);
+
+  EXPECT_EQ(index.Size(), 3);
+  EXPECT_TRUE(index.Contains("ABCD"));
+  EXPECT_FALSE(index.Contains("1234"));
+  EXPECT_EQ(index.Find("ABCD", Medium::BLUETOOTH), bluetooth);
+  EXPECT_EQ(index.Find("ABCD", Medium::WIFI_LAN), nullptr);
+  EXPECT_EQ(index.FindFirst("ABCD"), ble);
+  EXPECT_EQ(index.FindFirst("1234"), nullptr);
+  EXPECT_THAT(index.FindAll("ABCD"), ElementsAre(ble, bluetooth));
+  EXPECT_THAT(index.FindAll(Medium::BLE), UnorderedElementsAre(ble, other));
+  EXPECT_THAT(index.FindAll(Medium::WIFI_LAN), IsEmpty());
+}
+
+TEST(DiscoveredEndpointIndexTest, RejectsDuplicateIdAndMedium) {
+  Index index;
+  TestEndpoint* ble = Add(index, "ABCD", Medium::BLE);
+
+  EXPECT_EQ(Add(index, "ABCD", Medium::BLE), nullptr);
+  EXPECT_EQ(index.Size(), 1);
+  EXPECT_EQ(index.Find("ABCD", Medium::BLE), ble);
+}
+
+TEST(DiscoveredEndpointIndexTest, RemovesOnlyTheGivenMedium) {
+  Index index;
+  Add(index, "ABCD", Medium::BLE);
+  TestEndpoint* bluetooth = Add(index, "ABCD", Medium::BLUETOOTH);
+  TestEndpoint* other = Add(index, "WXYZ", Medium::BLE);
+
+  std::shared_ptr<TestEndpoint> removed = index.Remove("ABCD", Medium::BLE);
+
+  ASSERT_NE(removed, nullptr);
+  EXPECT_EQ(removed->medium, Medium::BLE);
+  EXPECT_EQ(index.Size(), 2);
+  EXPECT_TRUE(index.Contains("ABCD"));
+  EXPECT_THAT(index.FindAll("ABCD"), ElementsAre(bluetooth));
+  EXPECT_THAT(index.FindAll(Medium::BLE), ElementsAre(other));
+  EXPECT_EQ(index.Remove("ABCD", Medium::BLE), nullptr);
+
+  index.Remove("ABCD", Medium::BLUETOOTH);
+
+  EXPECT_FALSE(index.Contains("ABCD"));
+  EXPECT_EQ(index.FindFirst("ABCD"), nullptr);
+}
+
+TEST(DiscoveredEndpointIndexTest, ReusesRemovedEntries) {
+  Index index;
+  for (int i = 0; i < 1000; i++) {
+    std::string endpoint_id = absl::StrCat(i);
+    Add(index, endpoint_id, Medium::WIFI_LAN);
+    if (i >= 10) index.Remove(absl::StrCat(i - 10), Medium::WIFI_LAN);
+  }
+
+  EXPECT_EQ(index.Size(), 10);
+  EXPECT_EQ(index.FindAll(Medium::WIFI_LAN).size(), 10);
+  EXPECT_NE(index.Find("999", Medium::WIFI_LAN), nullptr);
+  EXPECT_EQ(index.Find("989", Medium::WIFI_LAN), nullptr);
+}
+
+TEST(DiscoveredEndpointIndexTest, ClearRemovesEverything) {
+  Index index;
+  Add(index, "ABCD", Medium::BLE);
+  Add(index, "WXYZ", Medium::WIFI_LAN);
+
+  index.Clear();
+
+  EXPECT_EQ(index.Size(), 0);
+  EXPECT_FALSE(index.Contains("ABCD"));
+  EXPECT_THAT(index.FindAll(Medium::BLE), IsEmpty());
+  EXPECT_NE(Add(index, "ABCD", Medium::BLE), nullptr);
+}
+
+}  // namespace
+}  // namespace connections
+}  // namespace nearby
+}  // namespace location
@@ -0,0 +1,84 @@
+// Copyright 2021 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "core/internal/discovery_scheduler.h"
+
+#include <algorithm>
+
+namespace location {
+namespace nearby {
+namespace connections {
+
+DiscoveryScheduler::DiscoveryScheduler(const ScanDutyCycle& duty_cycle)
+    : continuous_(duty_cycle.IsContinuous()),
+      scan_window_(absl::Milliseconds(duty_cycle.scan_window_millis)),
+      min_interval_(absl::Milliseconds(duty_cycle.scan_interval_millis)),
+      max_interval_(std::max(
+          min_interval_,
+          absl::Milliseconds(duty_cycle.max_scan_interval_millis))),
+      continuous_scan_(absl::Milliseconds(
+          std::max(duty_cycle.continuous_scan_millis, 0))),
+      interval_(min_interval_) {}
+
+void DiscoveryScheduler::Start(absl::Time now) {
+  interval_ = min_interval_;
+  if (continuous_) {
+    scanning_ = true;
+    next_update_time_ = absl::InfiniteFuture();
+    return;
+  }
+  StartWindow(now);
+}
+
+void DiscoveryScheduler::OnEndpointFound(absl::Time now) {
+  if (continuous_) return;
+  found_in_window_ = true;
+  interval_ = min_interval_;
+  if (continuous_scan_ == absl::ZeroDuration()) return;
+  absl::Time scan_until = now + continuous_scan_;
+  if (scanning_ && scan_until <= next_update_time_) return;
+  scanning_ = true;
+  next_update_time_ = scan_until;
+}
+
+void DiscoveryScheduler::Update(absl::Time now) {
+  if (now < next_update_time_) return;
+  if (scanning_) {
+    EndWindow(now);
+  } else {
+    StartWindow(now);
+  }
+}
+
+void DiscoveryScheduler::StartWindow(absl::Time now) {
+  scanning_ = true;
+  found_in_window_ = false;
+  next_update_time_ = now + scan_window_;
+}
+
+void DiscoveryScheduler::EndWindow(absl::Time now) {
+  // A window that found nothing new backs off the next one; a window that
+  // found something starts over.
+  if (found_in_window_) {
+    interval_ = min_interval_;
+  } else {
+    interval_ = std::min(interval_ * 2, max_interval_);
+  }
+  scanning_ = false;
+  next_update_time_ = now + (interval_ - scan_window_);
+}
+
+}  // namespace connections
+}  // namespace nearby
+}  // namespace location
@@ -0,0 +1,78 @@
+// Copyright 2021 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef CORE_INTERNAL_DISCOVERY_SCHEDULER_H_
+#define CORE_INTERNAL_DISCOVERY_SCHEDULER_H_
+
+#include "absl/time/time.h"
+#include "core/options.h"
+
+namespace location {
+namespace nearby {
+namespace connections {
+
+// Decides when discovery mediums should scan, following a ScanDutyCycle.
+//
+// The scheduler doesn't keep time itself: callers pass in the current time,
+// call Update() once GetNextUpdateTime() is reached, and start or stop their
+// mediums whenever IsScanning() changes. That keeps it deterministic, and
+// lets tests walk through a schedule without waiting.
+//
+// Not thread safe; P2pClusterPcpHandler only uses it on the PCP handler
+// thread.
+class DiscoveryScheduler {
+ public:
+  explicit DiscoveryScheduler(const ScanDutyCycle& duty_cycle);
+
+  // Starts the first scan window.
+  void Start(absl::Time now);
+
+  // Records that discovery found a new endpoint. Scanning goes on, or
+  // resumes, for continuous_scan_millis, and the interval is reset.
+  void OnEndpointFound(absl::Time now);
+
+  // Moves on to the next phase, if GetNextUpdateTime() was reached.
+  void Update(absl::Time now);
+
+  bool IsScanning() const { return scanning_; }
+
+  // Returns when Update() has to be called next; absl::InfiniteFuture() if
+  // mediums scan continuously.
+  absl::Time GetNextUpdateTime() const { return next_update_time_; }
+
+  // Returns the time between the starts of the current and next windows.
+  absl::Duration GetInterval() const { return interval_; }
+
+ private:
+  void StartWindow(absl::Time now);
+  void EndWindow(absl::Time now);
+
+  const bool continuous_;
+  const absl::Duration scan_window_;
+  const absl::Duration min_interval_;
+  const absl::Duration max_interval_;
+  const absl::Duration continuous_scan_;
+
+  bool scanning_ = false;
+  // Whether a new endpoint was found since the current window started.
+  bool found_in_window_ = false;
+  absl::Duration interval_;
+  absl::Time next_update_time_ = absl::InfiniteFuture();
+};
+
+}  // namespace connections
+}  // namespace nearby
+}  // namespace location
+
+#endif  // CORE_INTERNAL_DISCOVERY_SCHEDULER_H_
@@ -0,0 +1,129 @@
+// Copyright 2021 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "core/internal/discovery_scheduler.h"
+
+#include "gtest/gtest.h"
+#include "absl/time/time.h"
+#include "core/options.h"
+
+namespace location {
+namespace nearby {
+namespace connections {
+namespace {
+
+constexpr absl::Time kStart = absl::UnixEpoch();
+
+constexpr ScanDutyCycle kDutyCycle{
+    .scan_window_millis = 1000,
+    .scan_interval_millis = 4000,
+    .max_scan_interval_millis = 16000,
+    .continuous_scan_millis = 5000,
+};
+
+TEST(DiscoverySchedulerTest, ScansContinuouslyByDefault) {
+  DiscoveryScheduler scheduler{ScanDutyCycle{}};
+
+  scheduler.Start(kStart);
+
+  EXPECT_TRUE(scheduler.IsScanning());
+  EXPECT_EQ(scheduler.GetNextUpdateTime(), absl::InfiniteFuture());
+  scheduler.Update(kStart + absl::Hours(1));
+  EXPECT_TRUE(scheduler.IsScanning());
+}
+
+TEST(DiscoverySchedulerTest, ScansInWindows) {
+  DiscoveryScheduler scheduler{kDutyCycle};
+
+  scheduler.Start(kStart);
+  EXPECT_TRUE(scheduler.IsScanning());
+  EXPECT_EQ(scheduler.GetNextUpdateTime(), kStart + absl::Seconds(1));
+
+  // Too early: nothing changes.
+  scheduler.Update(kStart + absl::Milliseconds(999));
+  EXPECT_TRUE(scheduler.IsScanning());
+
+  scheduler.OnEndpointFound(kStart + absl::Milliseconds(500));
+  scheduler.Update(kStart + absl::Milliseconds(5500));
+  EXPECT_FALSE(scheduler.IsScanning());
+  EXPECT_EQ(scheduler.GetInterval(), absl::Seconds(4));
+  EXPECT_EQ(scheduler.GetNextUpdateTime(), kStart + absl::Milliseconds(8500));
+
+  scheduler.Update(kStart + absl::Milliseconds(8500));
+  EXPECT_TRUE(scheduler.IsScanning());
+  EXPECT_EQ(scheduler.GetNextUpdateTime(), kStart + absl::Milliseconds(9500));
+}
+
+TEST(DiscoverySchedulerTest, BacksOffWhenNothingIsFound) {
+  DiscoveryScheduler scheduler{kDutyCycle};
+  absl::Time now = kStart;
+  scheduler.Start(now);
+
+  for (absl::Duration expected_interval :
+       {absl::Seconds(8), absl::Seconds(16), absl::Seconds(16)}) {
+    // End of the window.
+    now = scheduler.GetNextUpdateTime();
+    scheduler.Update(now);
+    EXPECT_FALSE(scheduler.IsScanning());
+    EXPECT_EQ(scheduler.GetInterval(), expected_interval);
+    EXPECT_EQ(scheduler.GetNextUpdateTime(),
+              now + expected_interval - absl::Seconds(1));
+
+    // Start of the next one.
+    now = scheduler.GetNextUpdateTime();
+    scheduler.Update(now);
+    EXPECT_TRUE(scheduler.IsScanning());
+  }
+}
+
+TEST(DiscoverySchedulerTest, NewEndpointResumesContinuousScanning) {
+  DiscoveryScheduler scheduler{kDutyCycle};
+  scheduler.Start(kStart);
+  scheduler.Update(kStart + absl::Seconds(1));
+  ASSERT_FALSE(scheduler.IsScanning());
+  ASSERT_EQ(scheduler.GetInterval(), absl::Seconds(8));
+
+  // An endpoint found by another medium, or a scan that hasn't been stopped
+  // yet, brings scanning back right away.
+  scheduler.OnEndpointFound(kStart + absl::Seconds(2));
+
+  EXPECT_TRUE(scheduler.IsScanning());
+  EXPECT_EQ(scheduler.GetInterval(), absl::Seconds(4));
+  EXPECT_EQ(scheduler.GetNextUpdateTime(), kStart + absl::Seconds(7));
+
+  // Each new endpoint extends the continuous scan.
+  scheduler.OnEndpointFound(kStart + absl::Seconds(6));
+  EXPECT_EQ(scheduler.GetNextUpdateTime(), kStart + absl::Seconds(11));
+
+  scheduler.Update(kStart + absl::Seconds(11));
+  EXPECT_FALSE(scheduler.IsScanning());
+  EXPECT_EQ(scheduler.GetInterval(), absl::Seconds(4));
+}
+
+TEST(DiscoverySchedulerTest, LowPowerProfileIsDutyCycled) {
+  ScanDutyCycle low_power = ScanDutyCycle::LowPower();
+  DiscoveryScheduler scheduler{low_power};
+
+  scheduler.Start(kStart);
+
+  EXPECT_FALSE(low_power.IsContinuous());
+  EXPECT_TRUE(scheduler.IsScanning());
+  EXPECT_EQ(scheduler.GetNextUpdateTime(),
+            kStart + absl::Milliseconds(low_power.scan_window_millis));
+}
+
+}  // namespace
+}  // namespace connections
+}  // namespace nearby
+}  // namespace location
@@ -14,8 +14,10 @@
 
 #include "core/internal/encryption_runner.h"
 
+#include <algorithm>
 #include <cinttypes>
 #include <cstdint>
+#include <functional>
 #include <memory>
 
 #include "securegcm/ukey2_handshake.h"
@@ -25,8 +27,12 @@
 #include "platform/base/base64_utils.h"
 #include "platform/base/byte_array.h"
 #include "platform/base/exception.h"
+#include "platform/base/feature_flags.h"
 #include "platform/public/cancelable_alarm.h"
 #include "platform/public/logging.h"
+#include "platform/public/mutex_lock.h"
+#include "platform/public/system_clock.h"
+#include "platform/public/tracing.h"
 
 namespace location {
 namespace nearby {
@@ -39,6 +45,8 @@ constexpr std::int32_t kTokenLength = 5;
 constexpr securegcm::UKey2Handshake::HandshakeCipher kCipher =
     securegcm::UKey2Handshake::HandshakeCipher::P256_SHA512;
 
+using HandshakeLatencyCallback = std::function<void(absl::Duration latency)>;
+
 // Transforms a raw UKEY2 token (which is a random ByteArray that's
 // kMaxUkey2VerificationStringLength long) into a kTokenLength string that only
 // uses [A-Z], [0-9], '_', '-' for each character.
@@ -66,6 +74,14 @@ bool HandleEncryptionSuccess(const std::string& endpoint_id,
   return true;
 }
 
+void HandleResumptionSuccess(const std::string& endpoint_id,
+                             SessionResumption::Session session,
+                             const EncryptionRunner::ResultListener& listener) {
+  listener.on_resumed_cb(endpoint_id, std::move(session.context),
+                         ToHumanReadableString(session.raw_auth_token),
+                         session.raw_auth_token);
+}
+
 void CancelableAlarmRunnable(ClientProxy* client,
                              const std::string& endpoint_id,
                              EndpointChannel* endpoint_channel) {
@@ -79,31 +95,50 @@ void CancelableAlarmRunnable(ClientProxy* client,
 class ServerRunnable final {
  public:
   ServerRunnable(ClientProxy* client, ScheduledExecutor* alarm_executor,
+                 SessionResumption* resumption, Ukey2HandshakePool* pool,
+                 HandshakeLatencyCallback on_handshake,
                  const std::string& endpoint_id, EndpointChannel* channel,
                  EncryptionRunner::ResultListener&& listener)
       : client_(client),
         alarm_executor_(alarm_executor),
+        resumption_(resumption),
+        pool_(pool),
+        on_handshake_(std::move(on_handshake)),
         endpoint_id_(endpoint_id),
         channel_(channel),
-        listener_(std::move(listener)) {}
+        listener_(std::move(listener)),
+        start_time_(SystemClock::ElapsedRealtime()) {}
 
   void operator()() const {
+    NEARBY_TRACE_SPAN("encryption", "ukey2_server", endpoint_id_);
     CancelableAlarm timeout_alarm(
         "EncryptionRunner.StartServer() timeout",
         [this]() { CancelableAlarmRunnable(client_, endpoint_id_, channel_); },
         kTimeout, alarm_executor_);
 
-    std::unique_ptr<securegcm::UKey2Handshake> server =
-        securegcm::UKey2Handshake::ForResponder(kCipher);
-    if (server == nullptr) {
+    // Message 1 (Client Init), or a request to resume an earlier session.
+    ExceptionOr<ByteArray> client_init = channel_->Read();
+    if (!client_init.ok()) {
       LogException();
       HandleHandshakeOrIoException(&timeout_alarm);
       return;
     }
 
-    // Message 1 (Client Init)
-    ExceptionOr<ByteArray> client_init = channel_->Read();
-    if (!client_init.ok()) {
+    if (SessionResumption::IsResumptionMessage(client_init.result())) {
+      if (HandleResumptionRequest(client_init.result(), &timeout_alarm)) {
+        return;
+      }
+      // The client follows up with a full handshake.
+      client_init = channel_->Read();
+      if (!client_init.ok()) {
+        LogException();
+        HandleHandshakeOrIoException(&timeout_alarm);
+        return;
+      }
+    }
+
+    std::unique_ptr<securegcm::UKey2Handshake> server = pool_->Take();
+    if (server == nullptr) {
       LogException();
       HandleHandshakeOrIoException(&timeout_alarm);
       return;
@@ -176,6 +211,11 @@ class ServerRunnable final {
         << endpoint_id_ << ").";
 
     timeout_alarm.Cancel();
+    absl::Duration latency = SystemClock::ElapsedRealtime() - start_time_;
+    NEARBY_LOGS(INFO) << "In StartServer(), UKEY2 with endpoint(id="
+                      << endpoint_id_ << ") took "
+                      << absl::FormatDuration(latency) << ".";
+    on_handshake_(latency);
 
     if (!HandleEncryptionSuccess(endpoint_id_, std::move(server), listener_)) {
       LogException();
@@ -185,6 +225,30 @@ class ServerRunnable final {
   }
 
  private:
+  // Answers a request to resume an earlier session. Returns true if that
+  // finished encryption, successfully or not, and false if the client falls
+  // back to a full handshake.
+  bool HandleResumptionRequest(const ByteArray& request,
+                               CancelableAlarm* timeout_alarm) const {
+    NEARBY_TRACE_SPAN("encryption", "session_resumption", endpoint_id_);
+    SessionResumption::Session session;
+    ByteArray response = resumption_->HandleRequest(
+        endpoint_id_, request, SystemClock::ElapsedRealtime(), &session);
+    Exception write_exception = channel_->Write(response);
+    if (!write_exception.Ok()) {
+      LogException();
+      HandleHandshakeOrIoException(timeout_alarm);
+      return true;
+    }
+    if (!session.context) return false;
+
+    NEARBY_LOGS(INFO) << "In StartServer(), resumed session with endpoint(id="
+                      << endpoint_id_ << ").";
+    timeout_alarm->Cancel();
+    HandleResumptionSuccess(endpoint_id_, std::move(session), listener_);
+    return true;
+  }
+
   void LogException() const {
     NEARBY_LOGS(ERROR) << "In StartServer(), UKEY2 failed with endpoint(id="
                        << endpoint_id_ << ").";
@@ -209,30 +273,43 @@ class ServerRunnable final {
 
   ClientProxy* client_;
   ScheduledExecutor* alarm_executor_;
+  SessionResumption* resumption_;
+  Ukey2HandshakePool* pool_;
+  HandshakeLatencyCallback on_handshake_;
   const std::string endpoint_id_;
   EndpointChannel* channel_;
   EncryptionRunner::ResultListener listener_;
+  // When encryption was requested; queueing behind other handshakes counts.
+  const absl::Time start_time_;
 };
 
 class ClientRunnable final {
  public:
   ClientRunnable(ClientProxy* client, ScheduledExecutor* alarm_executor,
+                 SessionResumption* resumption, Ukey2HandshakePool* pool,
+                 HandshakeLatencyCallback on_handshake,
                  const std::string& endpoint_id, EndpointChannel* channel,
                  EncryptionRunner::ResultListener&& listener)
       : client_(client),
         alarm_executor_(alarm_executor),
+        resumption_(resumption),
+        pool_(pool),
+        on_handshake_(std::move(on_handshake)),
         endpoint_id_(endpoint_id),
         channel_(channel),
-        listener_(std::move(listener)) {}
+        listener_(std::move(listener)),
+        start_time_(SystemClock::ElapsedRealtime()) {}
 
   void operator()() const {
+    NEARBY_TRACE_SPAN("encryption", "ukey2_client", endpoint_id_);
     CancelableAlarm timeout_alarm(
         "EncryptionRunner.StartClient() timeout",
         [this]() { CancelableAlarmRunnable(client_, endpoint_id_, channel_); },
         kTimeout, alarm_executor_);
 
-    std::unique_ptr<securegcm::UKey2Handshake> crypto =
-        securegcm::UKey2Handshake::ForInitiator(kCipher);
+    if (TryResumption(&timeout_alarm)) return;
+
+    std::unique_ptr<securegcm::UKey2Handshake> crypto = pool_->Take();
 
     // Java code throws a HandshakeException.
     if (crypto == nullptr) {
@@ -313,6 +390,11 @@ class ClientRunnable final {
         << endpoint_id_ << ").";
 
     timeout_alarm.Cancel();
+    absl::Duration latency = SystemClock::ElapsedRealtime() - start_time_;
+    NEARBY_LOGS(INFO) << "In StartClient(), UKEY2 with endpoint(id="
+                      << endpoint_id_ << ") took "
+                      << absl::FormatDuration(latency) << ".";
+    on_handshake_(latency);
 
     if (!HandleEncryptionSuccess(endpoint_id_, std::move(crypto), listener_)) {
       LogException();
@@ -322,6 +404,51 @@ class ClientRunnable final {
   }
 
  private:
+  // Tries to resume an earlier session with the server. Returns true if that
+  // finished encryption, successfully or not, and false if a full handshake
+  // is needed.
+  bool TryResumption(CancelableAlarm* timeout_alarm) const {
+    SessionResumption::Attempt attempt;
+    ByteArray request = resumption_->CreateRequest(
+        endpoint_id_, SystemClock::ElapsedRealtime(), &attempt);
+    if (request.Empty()) return false;
+    NEARBY_TRACE_SPAN("encryption", "session_resumption", endpoint_id_);
+
+    Exception write_exception = channel_->Write(request);
+    if (!write_exception.Ok()) {
+      LogException();
+      HandleHandshakeOrIoException(timeout_alarm);
+      return true;
+    }
+    ExceptionOr<ByteArray> response = channel_->Read();
+    if (!response.ok()) {
+      LogException();
+      HandleHandshakeOrIoException(timeout_alarm);
+      return true;
+    }
+
+    SessionResumption::Session session;
+    switch (SessionResumption::HandleResponse(attempt, response.result(),
+                                              &session)) {
+      case SessionResumption::Outcome::kResumed:
+        break;
+      case SessionResumption::Outcome::kRejected:
+        NEARBY_LOGS(INFO) << "In StartClient(), endpoint(id=" << endpoint_id_
+                          << ") can't resume the session; running UKEY2.";
+        return false;
+      case SessionResumption::Outcome::kFailed:
+        LogException();
+        HandleHandshakeOrIoException(timeout_alarm);
+        return true;
+    }
+
+    NEARBY_LOGS(INFO) << "In StartClient(), resumed session with endpoint(id="
+                      << endpoint_id_ << ").";
+    timeout_alarm->Cancel();
+    HandleResumptionSuccess(endpoint_id_, std::move(session), listener_);
+    return true;
+  }
+
   void LogException() const {
     NEARBY_LOGS(ERROR) << "In StartClient(), UKEY2 failed with endpoint(id="
                        << endpoint_id_ << ").";
@@ -346,13 +473,28 @@ class ClientRunnable final {
 
   ClientProxy* client_;
   ScheduledExecutor* alarm_executor_;
+  SessionResumption* resumption_;
+  Ukey2HandshakePool* pool_;
+  HandshakeLatencyCallback on_handshake_;
   const std::string endpoint_id_;
   EndpointChannel* channel_;
   EncryptionRunner::ResultListener listener_;
+  // When encryption was requested; queueing behind other handshakes counts.
+  const absl::Time start_time_;
 };
 
 }  // namespace
 
+EncryptionRunner::EncryptionRunner()
+    : initiator_pool_(
+          []() { return securegcm::UKey2Handshake::ForInitiator(kCipher); },
+          FeatureFlags::GetInstance().GetFlags().ukey2_key_pool_size,
+          FeatureFlags::GetInstance().GetFlags().ukey2_key_pool_lifetime),
+      responder_pool_(
+          []() { return securegcm::UKey2Handshake::ForResponder(kCipher); },
+          FeatureFlags::GetInstance().GetFlags().ukey2_key_pool_size,
+          FeatureFlags::GetInstance().GetFlags().ukey2_key_pool_lifetime) {}
+
 EncryptionRunner::~EncryptionRunner() {
   // Stop all the ongoing Runnables (as gracefully as possible).
   client_executor_.Shutdown();
@@ -366,8 +508,10 @@ void EncryptionRunner::StartServer(
     EncryptionRunner::ResultListener&& listener) {
   server_executor_.Execute(
       "encryption-server",
-      [runnable{ServerRunnable(client, &alarm_executor_, endpoint_id,
-                               endpoint_channel, std::move(listener))}]() {
+      [runnable{ServerRunnable(
+          client, &alarm_executor_, &resumption_, &responder_pool_,
+          [this](absl::Duration latency) { RecordHandshake(latency); },
+          endpoint_id, endpoint_channel, std::move(listener))}]() {
         runnable();
       });
 }
@@ -378,12 +522,43 @@ void EncryptionRunner::StartClient(
     EncryptionRunner::ResultListener&& listener) {
   client_executor_.Execute(
       "encryption-client",
-      [runnable{ClientRunnable(client, &alarm_executor_, endpoint_id,
-                               endpoint_channel, std::move(listener))}]() {
+      [runnable{ClientRunnable(
+          client, &alarm_executor_, &resumption_, &initiator_pool_,
+          [this](absl::Duration latency) { RecordHandshake(latency); },
+          endpoint_id, endpoint_channel, std::move(listener))}]() {
         runnable();
       });
 }
 
+void EncryptionRunner::SaveResumptionSecret(const std::string& endpoint_id,
+                                            EncryptionContext& context,
+                                            bool is_client) {
+  resumption_.Save(
+      endpoint_id, context, is_client,
+      SystemClock::ElapsedRealtime() +
+          FeatureFlags::GetInstance().GetFlags().session_resumption_lifetime);
+}
+
+EncryptionRunner::HandshakeStats EncryptionRunner::GetHandshakeStats() const {
+  HandshakeStats stats;
+  {
+    MutexLock lock(&stats_mutex_);
+    stats = stats_;
+  }
+  stats.pooled_key_pairs =
+      initiator_pool_.GetHits() + responder_pool_.GetHits();
+  stats.generated_key_pairs =
+      initiator_pool_.GetMisses() + responder_pool_.GetMisses();
+  return stats;
+}
+
+void EncryptionRunner::RecordHandshake(absl::Duration latency) {
+  MutexLock lock(&stats_mutex_);
+  stats_.handshakes++;
+  stats_.total_latency += latency;
+  stats_.max_latency = std::max(stats_.max_latency, latency);
+}
+
 }  // namespace connections
 }  // namespace nearby
 }  // namespace location
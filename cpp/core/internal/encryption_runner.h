@@ -15,13 +15,19 @@
 #ifndef CORE_INTERNAL_ENCRYPTION_RUNNER_H_
 #define CORE_INTERNAL_ENCRYPTION_RUNNER_H_
 
+#include <cstdint>
 #include <string>
 
 #include "securegcm/ukey2_handshake.h"
+#include "absl/base/thread_annotations.h"
+#include "absl/time/time.h"
 #include "core/internal/client_proxy.h"
 #include "core/internal/endpoint_channel.h"
+#include "core/internal/session_resumption.h"
+#include "core/internal/ukey2_handshake_pool.h"
 #include "core/listeners.h"
 #include "platform/base/byte_array.h"
+#include "platform/public/mutex.h"
 #include "platform/public/scheduled_executor.h"
 #include "platform/public/single_thread_executor.h"
 
@@ -29,14 +35,30 @@ namespace location {
 namespace nearby {
 namespace connections {
 
-// Encrypts a connection over UKEY2.
+// Encrypts a connection over UKEY2, or by resuming an earlier session with the
+// same endpoint; see SessionResumption.
 //
 // NOTE: Stalled EndpointChannels will be disconnected after kTimeout.
 // This is to prevent unverified endpoints from maintaining an
 // indefinite connection to us.
 class EncryptionRunner {
  public:
-  EncryptionRunner() = default;
+  using EncryptionContext = EndpointChannel::EncryptionContext;
+
+  // Latency of successful UKEY2 handshakes, from StartServer() or
+  // StartClient() until encryption succeeds, including time spent waiting
+  // behind other handshakes. Resumed sessions aren't counted.
+  struct HandshakeStats {
+    std::int32_t handshakes = 0;
+    absl::Duration total_latency = absl::ZeroDuration();
+    absl::Duration max_latency = absl::ZeroDuration();
+    // Handshakes that started with an ephemeral key pair from the pool, and
+    // that had to generate one; see Ukey2HandshakePool.
+    std::int32_t pooled_key_pairs = 0;
+    std::int32_t generated_key_pairs = 0;
+  };
+
+  EncryptionRunner();
   ~EncryptionRunner();
 
   struct ResultListener {
@@ -62,6 +84,19 @@ class EncryptionRunner {
     std::function<void(const std::string& endpoint_id,
                        EndpointChannel* channel)>
         on_failure_cb = DefaultCallback<const std::string&, EndpointChannel*>();
+
+    // An earlier session was resumed without a UKEY2 handshake. |context| is
+    // ready to use; no handshake verification is needed.
+    //
+    // @EncryptionRunnerThread
+    std::function<void(const std::string& endpoint_id,
+                       std::unique_ptr<EncryptionContext> context,
+                       const std::string& auth_token,
+                       const ByteArray& raw_auth_token)>
+        on_resumed_cb =
+            DefaultCallback<const std::string&,
+                            std::unique_ptr<EncryptionContext>,
+                            const std::string&, const ByteArray&>();
   };
 
   // @AnyThread
@@ -73,7 +108,26 @@ class EncryptionRunner {
                    EndpointChannel* endpoint_channel,
                    ResultListener&& result_listener);
 
+  // Remembers how to resume the session in |context| with |endpoint_id| on
+  // the next connection to it. |is_client| tells whether we initiated this
+  // one.
+  // @AnyThread
+  void SaveResumptionSecret(const std::string& endpoint_id,
+                            EncryptionContext& context, bool is_client);
+
+  // @AnyThread
+  HandshakeStats GetHandshakeStats() const ABSL_LOCKS_EXCLUDED(stats_mutex_);
+
  private:
+  void RecordHandshake(absl::Duration latency)
+      ABSL_LOCKS_EXCLUDED(stats_mutex_);
+
+  SessionResumption resumption_;
+  // Handshakes with pre-generated ephemeral key pairs, for each role.
+  Ukey2HandshakePool initiator_pool_;
+  Ukey2HandshakePool responder_pool_;
+  mutable Mutex stats_mutex_;
+  HandshakeStats stats_ ABSL_GUARDED_BY(stats_mutex_);
   ScheduledExecutor alarm_executor_;
   SingleThreadExecutor server_executor_;
   SingleThreadExecutor client_executor_;
@@ -19,6 +19,7 @@
 #include "absl/time/clock.h"
 #include "core/internal/client_proxy.h"
 #include "core/internal/endpoint_channel.h"
+#include "core/internal/session_keys.h"
 #include "platform/base/byte_array.h"
 #include "platform/public/count_down_latch.h"
 #include "platform/public/pipe.h"
@@ -70,6 +71,8 @@ class FakeEndpointChannel : public EndpointChannel {
   Medium GetMedium() const override { return Medium::BLE; }
   int GetMaxTransmitPacketSize() const override { return 512; }
   void EnableEncryption(std::shared_ptr<EncryptionContext> context) override {}
+  void EnableDataFrameCipher(std::shared_ptr<DataFrameCipher> cipher) override {
+  }
   void DisableEncryption() override {}
   bool IsPaused() const override { return false; }
   void Pause() override {}
@@ -100,6 +103,7 @@ struct Response {
     kUnknown = 0,
     kDone = 1,
     kFailed = 2,
+    kResumed = 3,
   };
 
   CountDownLatch latch{2};
@@ -155,6 +159,120 @@ TEST(EncryptionRunnerTest, ReadWrite) {
   EXPECT_TRUE(response.latch.Await(absl::Milliseconds(5000)).result());
   EXPECT_EQ(response.server_status, Response::Status::kDone);
   EXPECT_EQ(response.client_status, Response::Status::kDone);
+  EncryptionRunner::HandshakeStats stats = user_a.crypto.GetHandshakeStats();
+  EXPECT_EQ(stats.handshakes, 1);
+  EXPECT_GT(stats.total_latency, absl::ZeroDuration());
+  EXPECT_EQ(stats.max_latency, stats.total_latency);
+  EXPECT_EQ(stats.pooled_key_pairs + stats.generated_key_pairs, 1);
+}
+
+// Starts encryption on both users, recording which way each side finished.
+void RunEncryption(User* server, User* client, Response* response,
+                   ByteArray* server_token, ByteArray* client_token) {
+  server->crypto.StartServer(
+      &server->client, "client_id", &server->channel,
+      {
+          .on_success_cb =
+              [response](const std::string& endpoint_id,
+                         std::unique_ptr<securegcm::UKey2Handshake> ukey2,
+                         const std::string& auth_token,
+                         const ByteArray& raw_auth_token) {
+                response->server_status = Response::Status::kDone;
+                response->latch.CountDown();
+              },
+          .on_failure_cb =
+              [response](const std::string& endpoint_id,
+                         EndpointChannel* channel) {
+                response->server_status = Response::Status::kFailed;
+                response->latch.CountDown();
+              },
+          .on_resumed_cb =
+              [response, server_token](
+                  const std::string& endpoint_id,
+                  std::unique_ptr<EncryptionRunner::EncryptionContext> context,
+                  const std::string& auth_token,
+                  const ByteArray& raw_auth_token) {
+                response->server_status = Response::Status::kResumed;
+                *server_token = raw_auth_token;
+                response->latch.CountDown();
+              },
+      });
+  client->crypto.StartClient(
+      &client->client, "server_id", &client->channel,
+      {
+          .on_success_cb =
+              [response](const std::string& endpoint_id,
+                         std::unique_ptr<securegcm::UKey2Handshake> ukey2,
+                         const std::string& auth_token,
+                         const ByteArray& raw_auth_token) {
+                response->client_status = Response::Status::kDone;
+                response->latch.CountDown();
+              },
+          .on_failure_cb =
+              [response](const std::string& endpoint_id,
+                         EndpointChannel* channel) {
+                response->client_status = Response::Status::kFailed;
+                response->latch.CountDown();
+              },
+          .on_resumed_cb =
+              [response, client_token](
+                  const std::string& endpoint_id,
+                  std::unique_ptr<EncryptionRunner::EncryptionContext> context,
+                  const std::string& auth_token,
+                  const ByteArray& raw_auth_token) {
+                response->client_status = Response::Status::kResumed;
+                *client_token = raw_auth_token;
+                response->latch.CountDown();
+              },
+      });
+}
+
+TEST(EncryptionRunnerTest, ResumesSavedSession) {
+  Pipe from_a_to_b;
+  Pipe from_b_to_a;
+  User server(/*reader=*/&from_b_to_a, /*writer=*/&from_a_to_b);
+  User client(/*reader=*/&from_a_to_b, /*writer=*/&from_b_to_a);
+  ByteArray client_to_server(std::string(SessionKeys::kKeySize, 'c'));
+  ByteArray server_to_client(std::string(SessionKeys::kKeySize, 's'));
+  server.crypto.SaveResumptionSecret(
+      "client_id", *SessionKeys::ToContext(server_to_client, client_to_server),
+      /*is_client=*/false);
+  client.crypto.SaveResumptionSecret(
+      "server_id", *SessionKeys::ToContext(client_to_server, server_to_client),
+      /*is_client=*/true);
+  Response response;
+  ByteArray server_token;
+  ByteArray client_token;
+
+  RunEncryption(&server, &client, &response, &server_token, &client_token);
+
+  EXPECT_TRUE(response.latch.Await(absl::Milliseconds(5000)).result());
+  EXPECT_EQ(response.server_status, Response::Status::kResumed);
+  EXPECT_EQ(response.client_status, Response::Status::kResumed);
+  EXPECT_FALSE(client_token.Empty());
+  EXPECT_EQ(server_token, client_token);
+}
+
+TEST(EncryptionRunnerTest, FallsBackToUkey2WhenServerCannotResume) {
+  Pipe from_a_to_b;
+  Pipe from_b_to_a;
+  User server(/*reader=*/&from_b_to_a, /*writer=*/&from_a_to_b);
+  User client(/*reader=*/&from_a_to_b, /*writer=*/&from_b_to_a);
+  client.crypto.SaveResumptionSecret(
+      "server_id",
+      *SessionKeys::ToContext(
+          ByteArray(std::string(SessionKeys::kKeySize, 'c')),
+          ByteArray(std::string(SessionKeys::kKeySize, 's'))),
+      /*is_client=*/true);
+  Response response;
+  ByteArray server_token;
+  ByteArray client_token;
+
+  RunEncryption(&server, &client, &response, &server_token, &client_token);
+
+  EXPECT_TRUE(response.latch.Await(absl::Milliseconds(5000)).result());
+  EXPECT_EQ(response.server_status, Response::Status::kDone);
+  EXPECT_EQ(response.client_status, Response::Status::kDone);
 }
 
 }  // namespace
@@ -21,6 +21,7 @@
 #include "securegcm/d2d_connection_context_v1.h"
 #include "absl/time/clock.h"
 #include "analytics/analytics_recorder.h"
+#include "core/internal/data_frame_cipher.h"
 #include "platform/base/byte_array.h"
 #include "platform/base/exception.h"
 #include "platform/public/mutex.h"
@@ -76,6 +77,12 @@ class EndpointChannel {
   // Enables encryption on the EndpointChannel.
   virtual void EnableEncryption(std::shared_ptr<EncryptionContext> context) = 0;
 
+  // Seals data frames with |cipher| rather than the EncryptionContext, for
+  // peers that negotiated AEAD data frames. Only used while encryption is
+  // enabled.
+  virtual void EnableDataFrameCipher(
+      std::shared_ptr<DataFrameCipher> cipher) = 0;
+
   // Disables encryption on the EndpointChannel.
   virtual void DisableEncryption() = 0;
 
@@ -70,12 +70,12 @@ void EndpointChannelManager::ReplaceChannelForEndpoint(
 }
 
 bool EndpointChannelManager::EncryptChannelForEndpoint(
-    const std::string& endpoint_id,
-    std::unique_ptr<EncryptionContext> context) {
+    const std::string& endpoint_id, std::unique_ptr<EncryptionContext> context,
+    std::unique_ptr<DataFrameCipher> data_frame_cipher) {
   MutexLock lock(&mutex_);
 
-  channel_state_.UpdateEncryptionContextForEndpoint(endpoint_id,
-                                                    std::move(context));
+  channel_state_.UpdateEncryptionContextForEndpoint(
+      endpoint_id, std::move(context), std::move(data_frame_cipher));
   auto* endpoint = channel_state_.LookupEndpointData(endpoint_id);
   return channel_state_.EncryptChannel(endpoint);
 }
@@ -118,6 +118,9 @@ bool EndpointChannelManager::ChannelState::EncryptChannel(
   if (endpoint != nullptr && endpoint->channel != nullptr &&
       endpoint->context != nullptr) {
     endpoint->channel->EnableEncryption(endpoint->context);
+    if (endpoint->data_frame_cipher != nullptr) {
+      endpoint->channel->EnableDataFrameCipher(endpoint->data_frame_cipher);
+    }
     return true;
   }
   return false;
@@ -138,9 +141,12 @@ void EndpointChannelManager::ChannelState::UpdateChannelForEndpoint(
 
 void EndpointChannelManager::ChannelState::UpdateEncryptionContextForEndpoint(
     const std::string& endpoint_id,
-    std::unique_ptr<EncryptionContext> context) {
+    std::unique_ptr<EncryptionContext> context,
+    std::unique_ptr<DataFrameCipher> data_frame_cipher) {
   // Create EndpointData instance, if necessary, and populate crypto context.
-  endpoints_[endpoint_id].context = std::move(context);
+  auto& endpoint = endpoints_[endpoint_id];
+  endpoint.context = std::move(context);
+  endpoint.data_frame_cipher = std::move(data_frame_cipher);
 }
 
 bool EndpointChannelManager::ChannelState::RemoveEndpoint(
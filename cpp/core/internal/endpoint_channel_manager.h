@@ -21,6 +21,7 @@
 #include "securegcm/d2d_connection_context_v1.h"
 #include "absl/container/flat_hash_map.h"
 #include "core/internal/client_proxy.h"
+#include "core/internal/data_frame_cipher.h"
 #include "core/internal/endpoint_channel.h"
 #include "platform/public/logging.h"
 #include "platform/public/mutex.h"
@@ -65,8 +66,13 @@ class EndpointChannelManager final {
                                  std::unique_ptr<EndpointChannel> channel)
       ABSL_LOCKS_EXCLUDED(mutex_);
 
-  bool EncryptChannelForEndpoint(const std::string& endpoint_id,
-                                 std::unique_ptr<EncryptionContext> context)
+  // Encrypts the endpoint's channel, and any channel replacing it, with
+  // |context|. Data frames are sealed with |data_frame_cipher| instead, if
+  // one is given.
+  bool EncryptChannelForEndpoint(
+      const std::string& endpoint_id,
+      std::unique_ptr<EncryptionContext> context,
+      std::unique_ptr<DataFrameCipher> data_frame_cipher = nullptr)
       ABSL_LOCKS_EXCLUDED(mutex_);
 
   // NOTE(shared_ptr<> usage):
@@ -117,6 +123,7 @@ class EndpointChannelManager final {
 
       std::shared_ptr<EndpointChannel> channel;
       std::shared_ptr<EncryptionContext> context;
+      std::shared_ptr<DataFrameCipher> data_frame_cipher;
       proto::connections::DisconnectionReason disconnect_reason =
           proto::connections::DisconnectionReason::UNKNOWN_DISCONNECTION_REASON;
     };
@@ -140,7 +147,8 @@ class EndpointChannelManager final {
     // Prevoius one is destroyed, if it existed.
     void UpdateEncryptionContextForEndpoint(
         const std::string& endpoint_id,
-        std::unique_ptr<EncryptionContext> context);
+        std::unique_ptr<EncryptionContext> context,
+        std::unique_ptr<DataFrameCipher> data_frame_cipher);
 
     // Removes all knowledge of this endpoint, cleaning up as necessary.
     // Returns false if the endpoint was not found.
@@ -14,11 +14,14 @@
 
 #include "core/internal/endpoint_manager.h"
 
+#include <algorithm>
 #include <memory>
 #include <utility>
 
+#include "absl/strings/str_cat.h"
 #include "core/internal/endpoint_channel.h"
 #include "core/internal/offline_frames.h"
+#include "platform/base/binary_log.h"
 #include "platform/base/exception.h"
 #include "platform/public/count_down_latch.h"
 #include "platform/public/logging.h"
@@ -33,6 +36,39 @@ using ::location::nearby::proto::connections::Medium;
 
 constexpr absl::Duration EndpointManager::kProcessEndpointDisconnectionTimeout;
 constexpr absl::Time EndpointManager::kInvalidTimestamp;
+constexpr int EndpointManager::kDataSendRatePercent;
+constexpr absl::Duration EndpointManager::kSendRateBurst;
+constexpr absl::Duration EndpointManager::kMaxSendBacklog;
+
+namespace {
+
+std::int64_t GetForMedium(const MediumSelector<std::int64_t>& selector,
+                          Medium medium) {
+  switch (medium) {
+    case Medium::BLUETOOTH:
+      return selector.bluetooth;
+    case Medium::BLE:
+      return selector.ble;
+    case Medium::WEB_RTC:
+      return selector.web_rtc;
+    case Medium::WIFI_LAN:
+      return selector.wifi_lan;
+    default:
+      return 0;
+  }
+}
+
+// Returns a bucket for the payload data share of |bytes_per_second|.
+std::unique_ptr<TokenBucket> CreateDataBucket(std::int64_t bytes_per_second) {
+  std::int64_t data_bytes_per_second =
+      bytes_per_second * EndpointManager::kDataSendRatePercent / 100;
+  return std::make_unique<TokenBucket>(
+      data_bytes_per_second,
+      data_bytes_per_second *
+          absl::ToInt64Milliseconds(EndpointManager::kSendRateBurst) / 1000);
+}
+
+}  // namespace
 
 class EndpointManager::LockedFrameProcessor {
  public:
@@ -175,8 +211,9 @@ ExceptionOr<bool> EndpointManager::HandleData(
     if (!wrapped_frame.ok()) {
       if (wrapped_frame.GetException().Raised(
               Exception::kInvalidProtocolBuffer)) {
-        NEARBY_LOG(INFO, "Failed to decode; endpoint=%s; channel=%s; skip",
-                   endpoint_id.c_str(), endpoint_channel->GetType().c_str());
+        NEARBY_LOGS_EVERY_N_SEC(INFO, 1)
+            << "Failed to decode; endpoint=" << endpoint_id
+            << "; channel=" << endpoint_channel->GetType() << "; skip";
         continue;
       } else {
         NEARBY_LOG(INFO, "Stop reading on parse-time exception: %d",
@@ -187,14 +224,15 @@ ExceptionOr<bool> EndpointManager::HandleData(
     OfflineFrame& frame = wrapped_frame.result();
 
     // Route the incoming offlineFrame to its registered processor.
+    absl::Time dispatch_start_time = SystemClock::ElapsedRealtime();
     V1Frame::FrameType frame_type = parser::GetFrameType(frame);
     LockedFrameProcessor frame_processor = GetFrameProcessor(frame_type);
     if (!frame_processor) {
       // report messages without handlers, except KEEP_ALIVE, which has
       // no explicit handler.
       if (frame_type == V1Frame::KEEP_ALIVE) {
-        NEARBY_LOG(INFO, "KeepAlive message for endpoint %s",
-                   endpoint_id.c_str());
+        NEARBY_BINARY_LOG(INFO, "KeepAlive message for endpoint $0",
+                          endpoint_id);
       } else if (frame_type == V1Frame::DISCONNECTION) {
         NEARBY_LOG(INFO, "Disconnect message for endpoint %s",
                    endpoint_id.c_str());
@@ -209,6 +247,8 @@ ExceptionOr<bool> EndpointManager::HandleData(
 
     frame_processor->OnIncomingFrame(frame, endpoint_id, client,
                                      endpoint_channel->GetMedium());
+    dispatch_latency_->Record(SystemClock::ElapsedRealtime() -
+                              dispatch_start_time);
   }
 }
 
@@ -277,6 +317,15 @@ EndpointManager::EndpointManager(EndpointChannelManager* manager)
 
 EndpointManager::~EndpointManager() {
   NEARBY_LOG(INFO, "Initiating shutdown of EndpointManager.");
+  absl::flat_hash_map<std::string, SendRateLimit> send_rate_limits;
+  {
+    // Releases senders, and queued frames, held back by a send rate limit.
+    MutexLock lock(&send_rate_limits_mutex_);
+    send_rate_limits = std::move(send_rate_limits_);
+    send_rate_limits_.clear();
+    medium_send_rates_.clear();
+    send_rate_limits_cond_.Notify();
+  }
   CountDownLatch latch(1);
   RunOnEndpointManagerThread("bring-down-endpoints", [this, &latch]() {
     NEARBY_LOG(INFO, "Bringing down endpoints");
@@ -284,6 +333,9 @@ EndpointManager::~EndpointManager() {
     latch.CountDown();
   });
   latch.Await();
+  // Rate limited writers are joined once their channels are closed.
+  send_rate_limits.clear();
+  BinaryLog::GetInstance().Flush();
 
   NEARBY_LOG(INFO, "Bringing down control thread");
   serial_executor_.Shutdown();
@@ -349,6 +401,17 @@ EndpointManager::LockedFrameProcessor EndpointManager::GetFrameProcessor(
 void EndpointManager::RemoveEndpointState(const std::string& endpoint_id) {
   NEARBY_LOGS(VERBOSE) << "EnsureWorkersTerminated for endpoint "
                        << endpoint_id;
+  SendRateLimit send_rate_limit;
+  {
+    MutexLock lock(&send_rate_limits_mutex_);
+    auto limit = send_rate_limits_.find(endpoint_id);
+    if (limit != send_rate_limits_.end()) {
+      send_rate_limit = std::move(limit->second);
+      send_rate_limits_.erase(limit);
+      UpdateMediumSendRatesLocked();
+    }
+    send_rate_limits_cond_.Notify();
+  }
   auto item = endpoints_.find(endpoint_id);
   if (item != endpoints_.end()) {
     NEARBY_LOGS(INFO) << "EndpointState found for endpoint " << endpoint_id;
@@ -359,6 +422,11 @@ void EndpointManager::RemoveEndpointState(const std::string& endpoint_id) {
   } else {
     NEARBY_LOGS(INFO) << "EndpointState not found for endpoint " << endpoint_id;
   }
+  // The rate limited writer drops its queued frames. It is joined once the
+  // channel is closed, so a write blocked on the channel can't hold this up.
+  send_rate_limit.writer.reset();
+  // Keep-alive records of this endpoint are logged through the binary log.
+  BinaryLog::GetInstance().Flush();
 }
 
 void EndpointManager::RegisterEndpoint(ClientProxy* client,
@@ -411,6 +479,24 @@ void EndpointManager::RegisterEndpoint(ClientProxy* client,
             .emplace(endpoint_id, EndpointState(endpoint_id, channel_manager_))
             .first->second;
 
+    if (options.max_send_bytes_per_second > 0 ||
+        !options.max_send_bytes_per_second_per_medium.All(0)) {
+      NEARBY_LOGS(INFO) << "Limiting send rate: endpoint " << endpoint_id
+                        << "; max_send_bytes_per_second="
+                        << options.max_send_bytes_per_second;
+    }
+    {
+      MutexLock lock(&send_rate_limits_mutex_);
+      SendRateLimit& limit = send_rate_limits_[endpoint_id];
+      limit.id = ++last_send_rate_limit_id_;
+      limit.max_send_bytes_per_second_per_medium =
+          options.max_send_bytes_per_second_per_medium;
+      if (options.max_send_bytes_per_second > 0) {
+        limit.bucket = CreateDataBucket(options.max_send_bytes_per_second);
+      }
+      UpdateMediumSendRatesLocked();
+    }
+
     NEARBY_LOGS(INFO) << "Starting workers: endpoint " << endpoint_id;
     // For every endpoint, there's normally only one Read handler instance
     // running on a dedicated thread. This instance reads data from the
@@ -496,11 +582,12 @@ std::vector<std::string> EndpointManager::SendPayloadChunk(
   ByteArray bytes =
       parser::ForDataPayloadTransfer(payload_header, payload_chunk);
 
-  return SendTransferFrameBytes(
-      endpoint_ids, bytes, payload_header.id(),
-      /*offset=*/payload_chunk.offset(),
-      /*packet_type=*/
-      PayloadTransferFrame::PacketType_Name(PayloadTransferFrame::DATA));
+  bool is_last_chunk = (payload_chunk.flags() &
+                        PayloadTransferFrame::PayloadChunk::LAST_CHUNK) != 0;
+  return SendTransferFrameBytes(endpoint_ids, bytes, payload_header.id(),
+                                /*offset=*/payload_chunk.offset(),
+                                /*packet_type=*/PayloadTransferFrame::DATA,
+                                /*wait_until_written=*/is_last_chunk);
 }
 
 // Designed to run asynchronously. It is called from IO thread pools, and
@@ -521,11 +608,10 @@ std::vector<std::string> EndpointManager::SendControlMessage(
     const std::vector<std::string>& endpoint_ids) {
   ByteArray bytes = parser::ForControlPayloadTransfer(header, control);
 
-  return SendTransferFrameBytes(
-      endpoint_ids, bytes, header.id(),
-      /*offset=*/control.offset(),
-      /*packet_type=*/
-      PayloadTransferFrame::PacketType_Name(PayloadTransferFrame::CONTROL));
+  return SendTransferFrameBytes(endpoint_ids, bytes, header.id(),
+                                /*offset=*/control.offset(),
+                                /*packet_type=*/PayloadTransferFrame::CONTROL,
+                                /*wait_until_written=*/false);
 }
 
 // @EndpointManagerThread
@@ -548,6 +634,8 @@ void EndpointManager::RemoveEndpoint(ClientProxy* client,
     NEARBY_LOGS(INFO) << "Removed endpoint for endpoint " << endpoint_id;
   }
   RemoveEndpointState(endpoint_id);
+  MetricsRegistry::GetInstance().RemoveMetrics(
+      absl::StrCat("endpoint/", endpoint_id, "/"));
 }
 
 // @EndpointManagerThread
@@ -604,7 +692,15 @@ CountDownLatch EndpointManager::NotifyFrameProcessorsOnEndpointDisconnect(
 std::vector<std::string> EndpointManager::SendTransferFrameBytes(
     const std::vector<std::string>& endpoint_ids, const ByteArray& bytes,
     std::int64_t payload_id, std::int64_t offset,
-    const std::string& packet_type) {
+    PayloadTransferFrame::PacketType packet_type, bool wait_until_written) {
+  // Endpoints whose rate limit queued the frame, with the SendRateLimit::id
+  // and the place in the queue it got.
+  struct QueuedFrame {
+    std::string endpoint_id;
+    std::int64_t limit_id = 0;
+    std::int64_t frame = 0;
+  };
+  std::vector<QueuedFrame> queued_frames;
   std::vector<std::string> failed_endpoint_ids;
   for (const std::string& endpoint_id : endpoint_ids) {
     std::shared_ptr<EndpointChannel> channel =
@@ -615,7 +711,8 @@ std::vector<std::string> EndpointManager::SendTransferFrameBytes(
       // unregistered, or a read/write error made us unregister it internally).
       NEARBY_LOGS(ERROR) << "EndpointManager failed to find EndpointChannel "
                             "over which to write "
-                         << packet_type << " at offset " << offset
+                         << PayloadTransferFrame::PacketType_Name(packet_type)
+                         << " at offset " << offset
                          << " of Payload " << payload_id << " to endpoint "
                          << endpoint_id;
 
@@ -623,17 +720,225 @@ std::vector<std::string> EndpointManager::SendTransferFrameBytes(
       continue;
     }
 
+    // Only payload data is shaped, so control and keep-alive frames keep
+    // flowing during a bulk transfer.
+    if (packet_type == PayloadTransferFrame::DATA) {
+      QueuedFrame queued{endpoint_id};
+      ShapingResult result =
+          ShapeDataFrame(endpoint_id, channel->GetMedium(), bytes,
+                         &queued.limit_id, &queued.frame);
+      if (result == ShapingResult::kQueued) {
+        queued_frames.push_back(std::move(queued));
+        continue;
+      }
+      if (result == ShapingResult::kFailed) {
+        NEARBY_LOGS(INFO) << "Endpoint " << endpoint_id
+                          << " can't take DATA at offset " << offset
+                          << " of Payload " << payload_id;
+        failed_endpoint_ids.push_back(endpoint_id);
+        continue;
+      }
+    }
+
     Exception write_exception = channel->Write(bytes);
     if (!write_exception.Ok()) {
       failed_endpoint_ids.push_back(endpoint_id);
-      NEARBY_LOGS(INFO) << "Failed to send packet; endpoint_id=" << endpoint_id;
+      NEARBY_LOGS_EVERY_N_SEC(INFO, 1)
+          << "Failed to send packet; endpoint_id=" << endpoint_id;
       continue;
     }
   }
 
+  // Only now that every endpoint has the frame, wait for the ones that are
+  // held back, so that they don't hold up the others.
+  for (const QueuedFrame& queued : queued_frames) {
+    if (!WaitForQueuedDataFrames(queued.endpoint_id, queued.limit_id,
+                                 queued.frame, wait_until_written)) {
+      NEARBY_LOGS(INFO) << "Endpoint " << queued.endpoint_id
+                        << " went away while DATA at offset " << offset
+                        << " of Payload " << payload_id << " was held back";
+      failed_endpoint_ids.push_back(queued.endpoint_id);
+    }
+  }
+
   return failed_endpoint_ids;
 }
 
+EndpointManager::ShapingResult EndpointManager::ShapeDataFrame(
+    const std::string& endpoint_id, Medium medium, const ByteArray& bytes,
+    std::int64_t* limit_id, std::int64_t* frame) {
+  MutexLock lock(&send_rate_limits_mutex_);
+  auto item = send_rate_limits_.find(endpoint_id);
+  if (item == send_rate_limits_.end()) return ShapingResult::kSendNow;
+  SendRateLimit& limit = item->second;
+  if (limit.write_failed) return ShapingResult::kFailed;
+
+  // The frame counts against both the endpoint's own limit and the cap of its
+  // medium, which all endpoints on that medium share.
+  absl::Time now = SystemClock::ElapsedRealtime();
+  absl::Duration delay = absl::ZeroDuration();
+  if (limit.bucket) delay = limit.bucket->Take(bytes.size(), now);
+  auto medium_rate = medium_send_rates_.find(medium);
+  if (medium_rate != medium_send_rates_.end()) {
+    delay =
+        std::max(delay, medium_rate->second.bucket->Take(bytes.size(), now));
+  }
+  if (delay == absl::ZeroDuration() &&
+      limit.last_queued_frame == limit.last_written_frame) {
+    return ShapingResult::kSendNow;
+  }
+
+  limit.ready_time = std::max(limit.ready_time, now + delay);
+  *limit_id = limit.id;
+  *frame = ++limit.last_queued_frame;
+  if (!limit.writer) limit.writer = std::make_unique<SingleThreadExecutor>();
+  limit.writer->Execute(
+      "rate-limited-write",
+      [this, endpoint_id, limit_id = limit.id, frame = *frame, bytes,
+       deadline = limit.ready_time]() {
+        WriteQueuedDataFrame(endpoint_id, limit_id, frame, bytes, deadline);
+      });
+  return ShapingResult::kQueued;
+}
+
+void EndpointManager::WriteQueuedDataFrame(const std::string& endpoint_id,
+                                           std::int64_t limit_id,
+                                           std::int64_t frame,
+                                           const ByteArray& bytes,
+                                           absl::Time deadline) {
+  {
+    MutexLock lock(&send_rate_limits_mutex_);
+    while (true) {
+      // Removal of the endpoint, shutdown, or an earlier failed write drops
+      // the frame.
+      auto item = send_rate_limits_.find(endpoint_id);
+      if (item == send_rate_limits_.end() || item->second.id != limit_id ||
+          item->second.write_failed) {
+        return;
+      }
+      absl::Time now = SystemClock::ElapsedRealtime();
+      if (now >= deadline) break;
+      send_rate_limits_cond_.Wait(deadline - now);
+    }
+  }
+
+  // The channel is looked up only now, since a bandwidth upgrade may have
+  // moved the endpoint to another one while the frame was queued.
+  std::shared_ptr<EndpointChannel> channel =
+      channel_manager_->GetChannelForEndpoint(endpoint_id);
+  Exception write_exception{Exception::kSuccess};
+  if (channel) {
+    write_exception = channel->Write(bytes);
+  } else {
+    NEARBY_LOGS_EVERY_N_SEC(INFO, 1)
+        << "Dropping queued packet, no channel left; endpoint_id="
+        << endpoint_id;
+  }
+  bool backlog_cleared = false;
+  {
+    MutexLock lock(&send_rate_limits_mutex_);
+    auto item = send_rate_limits_.find(endpoint_id);
+    if (item == send_rate_limits_.end() || item->second.id != limit_id) {
+      return;
+    }
+    SendRateLimit& limit = item->second;
+    limit.last_written_frame = frame;
+    if (!write_exception.Ok()) {
+      NEARBY_LOGS_EVERY_N_SEC(INFO, 1)
+          << "Failed to send packet; endpoint_id=" << endpoint_id;
+      limit.write_failed = true;
+    }
+    if (limit.backlog_reported &&
+        !IsSendBackloggedLocked(limit, SystemClock::ElapsedRealtime())) {
+      limit.backlog_reported = false;
+      backlog_cleared = true;
+    }
+    send_rate_limits_cond_.Notify();
+  }
+  if (backlog_cleared) NotifyFrameProcessorsOnSendBacklogCleared(endpoint_id);
+}
+
+bool EndpointManager::WaitForQueuedDataFrames(const std::string& endpoint_id,
+                                              std::int64_t limit_id,
+                                              std::int64_t frame,
+                                              bool until_written) {
+  MutexLock lock(&send_rate_limits_mutex_);
+  while (true) {
+    auto item = send_rate_limits_.find(endpoint_id);
+    if (item == send_rate_limits_.end() || item->second.id != limit_id ||
+        item->second.write_failed) {
+      return false;
+    }
+    const SendRateLimit& limit = item->second;
+    if (until_written) {
+      if (limit.last_written_frame >= frame) return true;
+      // Notified for every frame written, and on removal.
+      send_rate_limits_cond_.Wait();
+    } else {
+      absl::Time now = SystemClock::ElapsedRealtime();
+      if (!IsSendBackloggedLocked(limit, now)) return true;
+      send_rate_limits_cond_.Wait(limit.ready_time - kMaxSendBacklog - now);
+    }
+  }
+}
+
+bool EndpointManager::IsSendBacklogged(
+    const std::vector<std::string>& endpoint_ids) {
+  if (endpoint_ids.empty()) return false;
+  MutexLock lock(&send_rate_limits_mutex_);
+  absl::Time now = SystemClock::ElapsedRealtime();
+  for (const std::string& endpoint_id : endpoint_ids) {
+    auto item = send_rate_limits_.find(endpoint_id);
+    if (item == send_rate_limits_.end() ||
+        !IsSendBackloggedLocked(item->second, now)) {
+      return false;
+    }
+  }
+  for (const std::string& endpoint_id : endpoint_ids) {
+    send_rate_limits_[endpoint_id].backlog_reported = true;
+  }
+  return true;
+}
+
+bool EndpointManager::IsSendBackloggedLocked(const SendRateLimit& limit,
+                                             absl::Time now) const {
+  return !limit.write_failed &&
+         limit.last_queued_frame != limit.last_written_frame &&
+         limit.ready_time - now > kMaxSendBacklog;
+}
+
+void EndpointManager::UpdateMediumSendRatesLocked() {
+  for (Medium medium : {Medium::BLUETOOTH, Medium::BLE, Medium::WEB_RTC,
+                        Medium::WIFI_LAN}) {
+    std::int64_t bytes_per_second = 0;
+    for (const auto& item : send_rate_limits_) {
+      std::int64_t cap = GetForMedium(
+          item.second.max_send_bytes_per_second_per_medium, medium);
+      if (cap > 0 && (bytes_per_second == 0 || cap < bytes_per_second)) {
+        bytes_per_second = cap;
+      }
+    }
+    if (bytes_per_second == 0) {
+      medium_send_rates_.erase(medium);
+      continue;
+    }
+    // An unchanged cap keeps its bucket, and with it the data already sent.
+    MediumSendRate& rate = medium_send_rates_[medium];
+    if (rate.max_send_bytes_per_second == bytes_per_second) continue;
+    rate.max_send_bytes_per_second = bytes_per_second;
+    rate.bucket = CreateDataBucket(bytes_per_second);
+  }
+}
+
+void EndpointManager::NotifyFrameProcessorsOnSendBacklogCleared(
+    const std::string& endpoint_id) {
+  MutexLock lock(&frame_processors_lock_);
+  for (auto& item : frame_processors_) {
+    LockedFrameProcessor processor(&item.second);
+    if (processor) processor->OnSendBacklogCleared(endpoint_id);
+  }
+}
+
 EndpointManager::EndpointState::~EndpointState() {
   // We must unregister the endpoint first to signal the runnables that they
   // should exit their loops. SingleThreadExecutor destructors will wait for the
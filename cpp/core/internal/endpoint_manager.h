@@ -25,12 +25,15 @@
 #include "core/internal/client_proxy.h"
 #include "core/internal/endpoint_channel.h"
 #include "core/internal/endpoint_channel_manager.h"
+#include "core/internal/token_bucket.h"
 #include "core/listeners.h"
 #include "platform/base/byte_array.h"
 #include "platform/base/runnable.h"
 #include "platform/public/condition_variable.h"
 #include "platform/public/count_down_latch.h"
+#include "platform/public/metrics_registry.h"
 #include "platform/public/multi_thread_executor.h"
+#include "platform/public/mutex.h"
 #include "platform/public/single_thread_executor.h"
 #include "platform/public/system_clock.h"
 
@@ -83,11 +86,29 @@ class EndpointManager {
     virtual void OnEndpointDisconnect(ClientProxy* client,
                                       const std::string& endpoint_id,
                                       CountDownLatch barrier) = 0;
+
+    // Called once payload data waiting for the send rate limit of this
+    // endpoint has gone down to kMaxSendBacklog, after IsSendBacklogged()
+    // returned true for it.
+    //
+    // @EndpointManagerRateLimitedWriterThread
+    virtual void OnSendBacklogCleared(const std::string& endpoint_id) {}
   };
 
   explicit EndpointManager(EndpointChannelManager* manager);
   ~EndpointManager();
 
+  // Share of an endpoint's send rate limit that payload data may use. The rest
+  // is left for control and keep-alive frames, which are not shaped.
+  static constexpr int kDataSendRatePercent = 90;
+  // How much data may go out back to back after an idle period.
+  static constexpr absl::Duration kSendRateBurst = absl::Milliseconds(100);
+  // How far ahead payload data may be queued for an endpoint whose send rate
+  // limit holds it back. Senders should stop producing data for the endpoint
+  // while IsSendBacklogged(); SendPayloadChunk() waits for the backlog to
+  // shrink otherwise.
+  static constexpr absl::Duration kMaxSendBacklog = absl::Seconds(1);
+
   // Invoked from the constructors of the various *Manager components that make
   // up the OfflineServiceController implementation.
   // FrameProcessor* instances are of dynamic duration and survive all sessions.
@@ -116,6 +137,11 @@ class EndpointManager {
 
   // Returns the list of endpoints to which sending this chunk failed.
   //
+  // A chunk held back by the send rate limit of an endpoint is written later,
+  // in order, by a writer thread of that endpoint; other endpoints get the
+  // chunk right away. The last chunk of a payload is only reported as sent
+  // once it has been written to every endpoint.
+  //
   // Invoked from the PayloadManager's sendPayload() method.
   std::vector<std::string> SendPayloadChunk(
       const PayloadTransferFrame::PayloadHeader& payload_header,
@@ -126,6 +152,12 @@ class EndpointManager {
       const PayloadTransferFrame::ControlMessage& control_message,
       const std::vector<std::string>& endpoint_ids);
 
+  // Returns true if payload data for each of |endpoint_ids| is held back by
+  // its send rate limit for longer than kMaxSendBacklog. FrameProcessors get
+  // OnSendBacklogCleared() once that is no longer the case.
+  bool IsSendBacklogged(const std::vector<std::string>& endpoint_ids)
+      ABSL_LOCKS_EXCLUDED(send_rate_limits_mutex_);
+
   // Called when we internally want to get rid of the endpoint, without the
   // client directly telling us to. For example...
   //    a) We failed to read from the endpoint in its dedicated reader thread.
@@ -187,6 +219,37 @@ class EndpointManager {
     SingleThreadExecutor keep_alive_thread_;
   };
 
+  // Shapes payload data sent to one endpoint; see
+  // ConnectionOptions::max_send_bytes_per_second.
+  struct SendRateLimit {
+    // Tells a registration apart from a later one of the same endpoint.
+    std::int64_t id = 0;
+    // Caps on all data sent over each medium, from the endpoint's options.
+    MediumSelector<std::int64_t> max_send_bytes_per_second_per_medium{
+        MediumSelector<std::int64_t>().SetAll(0)};
+    // Limits data to this endpoint alone; null if unlimited.
+    std::unique_ptr<TokenBucket> bucket;
+    // Data frames held back by a rate limit are written by |writer|, in
+    // order. Once one is pending, later ones queue up behind it.
+    std::unique_ptr<SingleThreadExecutor> writer;
+    std::int64_t last_queued_frame = 0;
+    std::int64_t last_written_frame = 0;
+    // When the last queued frame is due to be written.
+    absl::Time ready_time = absl::InfinitePast();
+    // A queued frame failed to be written; the endpoint is reported as failed
+    // from then on.
+    bool write_failed = false;
+    // IsSendBacklogged() returned true, so FrameProcessors are told once the
+    // backlog is gone.
+    bool backlog_reported = false;
+  };
+
+  // Shapes payload data sent over one medium, to all endpoints together.
+  struct MediumSendRate {
+    std::int64_t max_send_bytes_per_second = 0;
+    std::unique_ptr<TokenBucket> bucket;
+  };
+
   // RAII accessor for FrameProcessor
   class LockedFrameProcessor;
 
@@ -254,7 +317,48 @@ class EndpointManager {
   std::vector<std::string> SendTransferFrameBytes(
       const std::vector<std::string>& endpoint_ids,
       const ByteArray& payload_transfer_frame_bytes, std::int64_t payload_id,
-      std::int64_t offset, const std::string& packet_type);
+      std::int64_t offset, PayloadTransferFrame::PacketType packet_type,
+      bool wait_until_written);
+
+  enum class ShapingResult {
+    kSendNow,
+    // Handed to the endpoint's writer thread.
+    kQueued,
+    // The endpoint went away, or failed to send an earlier frame.
+    kFailed,
+  };
+  // Takes tokens for a data frame to |endpoint_id| from its send rate limits,
+  // and those of |medium|, and queues the frame with its writer thread if it
+  // has to wait for them. Fills |frame| with the frame's place in the queue,
+  // and |limit_id| with the SendRateLimit::id it was queued with.
+  ShapingResult ShapeDataFrame(const std::string& endpoint_id, Medium medium,
+                               const ByteArray& bytes, std::int64_t* limit_id,
+                               std::int64_t* frame)
+      ABSL_LOCKS_EXCLUDED(send_rate_limits_mutex_);
+  // Writes a queued data frame once |deadline| has passed, over the channel
+  // the endpoint has at that time. The frame is dropped if it has none.
+  //
+  // @EndpointManagerRateLimitedWriterThread
+  void WriteQueuedDataFrame(const std::string& endpoint_id,
+                            std::int64_t limit_id, std::int64_t frame,
+                            const ByteArray& bytes, absl::Time deadline)
+      ABSL_LOCKS_EXCLUDED(send_rate_limits_mutex_);
+  // Waits until the queued data frame |frame| of |endpoint_id| has been
+  // written if |until_written|, or else until its backlog is down to
+  // kMaxSendBacklog. Returns false if the endpoint went away, or failed to
+  // write a queued frame, in the meantime.
+  bool WaitForQueuedDataFrames(const std::string& endpoint_id,
+                               std::int64_t limit_id, std::int64_t frame,
+                               bool until_written)
+      ABSL_LOCKS_EXCLUDED(send_rate_limits_mutex_);
+  bool IsSendBackloggedLocked(const SendRateLimit& limit, absl::Time now) const
+      ABSL_EXCLUSIVE_LOCKS_REQUIRED(send_rate_limits_mutex_);
+  // Re-sizes |medium_send_rates_| to the smallest per-medium cap of the
+  // registered endpoints.
+  void UpdateMediumSendRatesLocked()
+      ABSL_EXCLUSIVE_LOCKS_REQUIRED(send_rate_limits_mutex_);
+  void NotifyFrameProcessorsOnSendBacklogCleared(
+      const std::string& endpoint_id);
 
   // Executes all jobs sequentially, on a serial_executor_.
   void RunOnEndpointManagerThread(const std::string& name, Runnable runnable);
@@ -268,7 +372,25 @@ class EndpointManager {
   // We keep track of all registered channel endpoints here.
   absl::flat_hash_map<std::string, EndpointState> endpoints_;
 
-  SingleThreadExecutor serial_executor_;
+  // Every registered endpoint is tracked here, since the cap of its medium
+  // applies to it even without a limit of its own.
+  Mutex send_rate_limits_mutex_;
+  // Notified when an entry is removed from send_rate_limits_, and when a
+  // queued data frame has been written.
+  ConditionVariable send_rate_limits_cond_{&send_rate_limits_mutex_};
+  absl::flat_hash_map<std::string, SendRateLimit> send_rate_limits_
+      ABSL_GUARDED_BY(send_rate_limits_mutex_);
+  absl::flat_hash_map<Medium, MediumSendRate> medium_send_rates_
+      ABSL_GUARDED_BY(send_rate_limits_mutex_);
+  std::int64_t last_send_rate_limit_id_
+      ABSL_GUARDED_BY(send_rate_limits_mutex_) = 0;
+
+  // Time for a frame processor to handle an incoming frame.
+  std::shared_ptr<Histogram> dispatch_latency_ =
+      MetricsRegistry::GetInstance().GetHistogram(
+          "endpoint_manager/dispatch_latency_us");
+
+  SingleThreadExecutor serial_executor_{"endpoint_manager"};
 };
 
 // Operator overloads when comparing FrameProcessor*.
@@ -14,10 +14,12 @@
 
 #include "core/internal/endpoint_manager.h"
 
+#include <algorithm>
 #include <atomic>
 #include <memory>
 #include <string>
 #include <utility>
+#include <vector>
 
 #include "gmock/gmock.h"
 #include "gtest/gtest.h"
@@ -30,9 +32,12 @@
 #include "core/options.h"
 #include "platform/base/byte_array.h"
 #include "platform/base/exception.h"
+#include "platform/impl/g3/virtual_clock.h"
 #include "platform/public/count_down_latch.h"
 #include "platform/public/logging.h"
 #include "platform/public/pipe.h"
+#include "platform/public/single_thread_executor.h"
+#include "platform/public/system_clock.h"
 #include "proto/connections_enums.pb.h"
 
 namespace location {
@@ -43,7 +48,10 @@ namespace {
 using ::location::nearby::proto::connections::DisconnectionReason;
 using ::location::nearby::proto::connections::Medium;
 using ::testing::_;
+using ::testing::Each;
+using ::testing::ElementsAre;
 using ::testing::MockFunction;
+using ::testing::NiceMock;
 using ::testing::Return;
 using ::testing::StrictMock;
 
@@ -69,6 +77,8 @@ class MockEndpointChannel : public EndpointChannel {
   MOCK_METHOD(int, GetMaxTransmitPacketSize, (), (const override));
   MOCK_METHOD(void, EnableEncryption,
               (std::shared_ptr<EncryptionContext> context), (override));
+  MOCK_METHOD(void, EnableDataFrameCipher,
+              (std::shared_ptr<DataFrameCipher> cipher), (override));
   MOCK_METHOD(void, DisableEncryption, (), (override));
   MOCK_METHOD(bool, IsPaused, (), (const override));
   MOCK_METHOD(void, Pause, (), (override));
@@ -275,6 +285,302 @@ TEST_F(EndpointManagerTest, SendControlMessageWorks) {
   NEARBY_LOG(INFO, "Will call destructors now");
 }
 
+TEST_F(EndpointManagerTest, SendPayloadChunkHonorsSendRateLimit) {
+  // 18000 bytes/s are left for payload data, with a 1800 byte burst. The
+  // first chunk fits the burst; the second one is held back for about a
+  // minute.
+  constexpr int kSmallChunkSize = 1000;
+  constexpr int kLargeChunkSize = 1024 * 1024;
+  options_.max_send_bytes_per_second = 20000;
+  auto endpoint_channel = std::make_unique<MockEndpointChannel>();
+  PayloadTransferFrame::PayloadHeader header;
+  header.set_id(12345);
+  header.set_type(PayloadTransferFrame::PayloadHeader::BYTES);
+  header.set_total_size(kSmallChunkSize + kLargeChunkSize);
+  PayloadTransferFrame::ControlMessage control;
+  control.set_event(PayloadTransferFrame::ControlMessage::PAYLOAD_CANCELED);
+
+  ON_CALL(*endpoint_channel, Read())
+      .WillByDefault([channel = endpoint_channel.get()]() {
+        if (channel->IsClosed()) return ExceptionOr<ByteArray>(Exception::kIo);
+        absl::SleepFor(absl::Milliseconds(100));
+        if (channel->IsClosed()) return ExceptionOr<ByteArray>(Exception::kIo);
+        return ExceptionOr<ByteArray>(ByteArray{});
+      });
+  ON_CALL(*endpoint_channel, Close(_))
+      .WillByDefault(
+          [channel = endpoint_channel.get()](DisconnectionReason reason) {
+            channel->DoClose();
+          });
+  // Sizes of the frames written, in order.
+  absl::Mutex mutex;
+  std::vector<std::size_t> written;
+  CountDownLatch first_chunk_written(1);
+  EXPECT_CALL(*endpoint_channel, Write(_))
+      .WillRepeatedly([&](const ByteArray& data) {
+        absl::MutexLock lock(&mutex);
+        written.push_back(data.size());
+        if (data.size() > kSmallChunkSize) first_chunk_written.CountDown();
+        return Exception{Exception::kSuccess};
+      });
+
+  RegisterEndpoint(std::move(endpoint_channel), false);
+  std::vector<std::string> first_failed;
+  std::vector<std::string> second_failed;
+  CountDownLatch data_done(1);
+  SingleThreadExecutor sender;
+  sender.Execute([&]() {
+    PayloadTransferFrame::PayloadChunk chunk;
+    chunk.set_body(std::string(kSmallChunkSize, 'x'));
+    first_failed =
+        em_.SendPayloadChunk(header, chunk, std::vector{endpoint_id_});
+    chunk.set_offset(kSmallChunkSize);
+    chunk.set_body(std::string(kLargeChunkSize, 'x'));
+    second_failed =
+        em_.SendPayloadChunk(header, chunk, std::vector{endpoint_id_});
+    data_done.CountDown();
+  });
+
+  // Control frames are not held back behind the data.
+  EXPECT_TRUE(first_chunk_written.Await(absl::Seconds(10)).result());
+  EXPECT_EQ(em_.SendControlMessage(header, control, std::vector{endpoint_id_}),
+            std::vector<std::string>{});
+  {
+    absl::MutexLock lock(&mutex);
+    ASSERT_EQ(written.size(), 2);
+    EXPECT_GT(written[0], kSmallChunkSize);
+    EXPECT_LT(written[1], kSmallChunkSize);
+  }
+
+  // Removing the endpoint drops the held back chunk, rather than waiting
+  // out the minute.
+  em_.UnregisterEndpoint(&client_, endpoint_id_);
+  EXPECT_TRUE(data_done.Await(absl::Seconds(10)).result());
+  EXPECT_EQ(first_failed, std::vector<std::string>{});
+  EXPECT_EQ(second_failed, std::vector<std::string>{endpoint_id_});
+  absl::MutexLock lock(&mutex);
+  for (std::size_t size : written) EXPECT_LT(size, kLargeChunkSize);
+}
+
+// Runs on virtual time, so that throughput can be asserted exactly.
+class EndpointManagerSendRateTest : public EndpointManagerTest {
+ protected:
+  static constexpr int kChunkSize = 1800;
+
+  // Everything written to one endpoint.
+  struct Endpoint {
+    std::string id;
+    CountDownLatch closed{1};
+    absl::Mutex mutex;
+    // When each payload data frame was written, relative to the test start.
+    std::vector<absl::Duration> data_writes;
+    std::vector<absl::Duration> other_writes;
+
+    std::vector<absl::Duration> DataWrites() {
+      absl::MutexLock lock(&mutex);
+      return data_writes;
+    }
+    std::vector<absl::Duration> OtherWrites() {
+      absl::MutexLock lock(&mutex);
+      return other_writes;
+    }
+  };
+
+  void SetUp() override {
+    g3::VirtualClock::Instance().Enable();
+    start_ = SystemClock::ElapsedRealtime();
+    header_.set_id(12345);
+    header_.set_type(PayloadTransferFrame::PayloadHeader::BYTES);
+    header_.set_total_size(10 * kChunkSize);
+  }
+
+  void TearDown() override {
+    for (const std::string& endpoint_id : endpoint_ids_) {
+      em_.UnregisterEndpoint(&client_, endpoint_id);
+    }
+    g3::VirtualClock::Instance().Disable();
+  }
+
+  Endpoint* AddEndpoint(const std::string& endpoint_id, Medium medium,
+                        const ConnectionOptions& options) {
+    endpoint_ids_.push_back(endpoint_id);
+    Endpoint* endpoint = NewEndpoint(endpoint_id);
+    EXPECT_CALL(mock_listener_.initiated_cb, Call(endpoint_id, _));
+    em_.RegisterEndpoint(&client_, endpoint_id, info_, options,
+                         CreateChannel(endpoint, medium), listener_,
+                         connection_token);
+    return endpoint;
+  }
+
+  // Moves |endpoint_id| over to a new channel, the way a bandwidth upgrade
+  // does, and closes the one it had.
+  Endpoint* ReplaceChannel(Endpoint* endpoint, Medium medium) {
+    Endpoint* replacement = NewEndpoint(endpoint->id);
+    ecm_.ReplaceChannelForEndpoint(&client_, endpoint->id,
+                                   CreateChannel(replacement, medium));
+    endpoint->closed.CountDown();
+    return replacement;
+  }
+
+  Endpoint* NewEndpoint(const std::string& endpoint_id) {
+    endpoints_.push_back(std::make_unique<Endpoint>());
+    Endpoint* endpoint = endpoints_.back().get();
+    endpoint->id = endpoint_id;
+    return endpoint;
+  }
+
+  std::unique_ptr<MockEndpointChannel> CreateChannel(Endpoint* endpoint,
+                                                     Medium medium) {
+    auto channel = std::make_unique<NiceMock<MockEndpointChannel>>();
+    // Reads block on a platform primitive, which lets virtual time move.
+    ON_CALL(*channel, Read()).WillByDefault([endpoint]() {
+      endpoint->closed.Await();
+      return ExceptionOr<ByteArray>(Exception::kIo);
+    });
+    ON_CALL(*channel, Close(_))
+        .WillByDefault([endpoint](DisconnectionReason reason) {
+          endpoint->closed.CountDown();
+        });
+    ON_CALL(*channel, Write(_))
+        .WillByDefault([this, endpoint](const ByteArray& data) {
+          absl::MutexLock lock(&endpoint->mutex);
+          (data.size() > kChunkSize ? endpoint->data_writes
+                                    : endpoint->other_writes)
+              .push_back(Elapsed());
+          return Exception{Exception::kSuccess};
+        });
+    ON_CALL(*channel, GetMedium()).WillByDefault(Return(medium));
+    ON_CALL(*channel, GetLastReadTimestamp()).WillByDefault(Return(start_));
+    ON_CALL(*channel, GetLastWriteTimestamp()).WillByDefault(Return(start_));
+    return channel;
+  }
+
+  // Sends chunk |index| of 10 to |endpoint_ids|.
+  std::vector<std::string> SendChunk(
+      int index, const std::vector<std::string>& endpoint_ids) {
+    PayloadTransferFrame::PayloadChunk chunk;
+    chunk.set_offset(index * kChunkSize);
+    chunk.set_body(std::string(kChunkSize, 'x'));
+    if (index == 9) {
+      chunk.set_flags(PayloadTransferFrame::PayloadChunk::LAST_CHUNK);
+    }
+    return em_.SendPayloadChunk(header_, chunk, endpoint_ids);
+  }
+
+  absl::Duration Elapsed() const {
+    return SystemClock::ElapsedRealtime() - start_;
+  }
+
+  absl::Time start_;
+  PayloadTransferFrame::PayloadHeader header_;
+  // One for each channel, outliving them.
+  std::vector<std::unique_ptr<Endpoint>> endpoints_;
+  std::vector<std::string> endpoint_ids_;
+};
+
+TEST_F(EndpointManagerSendRateTest, DataIsShapedToEndpointLimit) {
+  // 18000 bytes/s are left for payload data, with a 1800 byte burst.
+  ConnectionOptions options = options_;
+  options.max_send_bytes_per_second = 20000;
+  Endpoint* endpoint = AddEndpoint("endpoint", Medium::BLE, options);
+
+  // Chunks are queued rather than waited for, since they are due within
+  // kMaxSendBacklog.
+  for (int i = 0; i < 9; i++) {
+    EXPECT_EQ(SendChunk(i, {"endpoint"}), std::vector<std::string>{});
+  }
+  EXPECT_EQ(Elapsed(), absl::ZeroDuration());
+  EXPECT_FALSE(em_.IsSendBacklogged({"endpoint"}));
+
+  // Control frames are not held back behind the data.
+  PayloadTransferFrame::ControlMessage control;
+  control.set_event(PayloadTransferFrame::ControlMessage::PAYLOAD_CANCELED);
+  EXPECT_EQ(em_.SendControlMessage(header_, control, {"endpoint"}),
+            std::vector<std::string>{});
+  EXPECT_THAT(endpoint->OtherWrites(), ElementsAre(absl::ZeroDuration()));
+
+  // The last chunk is only reported once it is written.
+  EXPECT_EQ(SendChunk(9, {"endpoint"}), std::vector<std::string>{});
+  std::vector<absl::Duration> data_writes = endpoint->DataWrites();
+  ASSERT_EQ(data_writes.size(), 10);
+  EXPECT_EQ(Elapsed(), data_writes.back());
+
+  // All but the burst has to wait for tokens: (18000 - 1800) / 18000 s.
+  EXPECT_GE(data_writes.back(), absl::Milliseconds(900));
+  EXPECT_LT(data_writes.back(), absl::Seconds(1));
+  for (int i = 1; i < 10; i++) {
+    EXPECT_GE(data_writes[i], data_writes[i - 1]);
+  }
+}
+
+TEST_F(EndpointManagerSendRateTest, EndpointsShareMediumLimit) {
+  // Each endpoint alone would be done in under a second.
+  ConnectionOptions options = options_;
+  options.max_send_bytes_per_second_per_medium.ble = 20000;
+  Endpoint* first = AddEndpoint("first", Medium::BLE, options);
+  Endpoint* second = AddEndpoint("second", Medium::BLE, options);
+
+  for (int i = 0; i < 5; i++) {
+    EXPECT_EQ(SendChunk(i, {"first"}), std::vector<std::string>{});
+    EXPECT_EQ(SendChunk(i, {"second"}), std::vector<std::string>{});
+  }
+  for (int i = 5; i < 10; i++) {
+    EXPECT_EQ(SendChunk(i, {"first", "second"}), std::vector<std::string>{});
+  }
+
+  // Twice the data went out on BLE, which is capped at 18000 bytes/s of
+  // payload data in total.
+  std::vector<absl::Duration> first_writes = first->DataWrites();
+  std::vector<absl::Duration> second_writes = second->DataWrites();
+  ASSERT_EQ(first_writes.size(), 10);
+  ASSERT_EQ(second_writes.size(), 10);
+  EXPECT_GE(std::max(first_writes.back(), second_writes.back()),
+            absl::Milliseconds(1900));
+}
+
+TEST_F(EndpointManagerSendRateTest, LimitedEndpointDoesNotHoldUpOthers) {
+  ConnectionOptions limited_options = options_;
+  limited_options.max_send_bytes_per_second = 20000;
+  Endpoint* limited = AddEndpoint("limited", Medium::BLE, limited_options);
+  // Another medium, and no limit of its own.
+  Endpoint* unlimited = AddEndpoint("unlimited", Medium::WIFI_LAN, options_);
+
+  for (int i = 0; i < 9; i++) {
+    EXPECT_EQ(SendChunk(i, {"limited", "unlimited"}),
+              std::vector<std::string>{});
+  }
+  // The unlimited endpoint comes second, but gets every chunk right away.
+  EXPECT_THAT(unlimited->DataWrites(), Each(absl::ZeroDuration()));
+  EXPECT_EQ(unlimited->DataWrites().size(), 9);
+
+  EXPECT_EQ(SendChunk(9, {"limited", "unlimited"}),
+            std::vector<std::string>{});
+  EXPECT_EQ(unlimited->DataWrites().size(), 10);
+  EXPECT_EQ(unlimited->DataWrites().back(), absl::ZeroDuration());
+  ASSERT_EQ(limited->DataWrites().size(), 10);
+  EXPECT_GE(limited->DataWrites().back(), absl::Milliseconds(900));
+}
+
+TEST_F(EndpointManagerSendRateTest, QueuedDataGoesOutOverReplacedChannel) {
+  ConnectionOptions options = options_;
+  options.max_send_bytes_per_second = 20000;
+  Endpoint* bluetooth = AddEndpoint("endpoint", Medium::BLUETOOTH, options);
+  for (int i = 0; i < 5; i++) {
+    EXPECT_EQ(SendChunk(i, {"endpoint"}), std::vector<std::string>{});
+  }
+  std::size_t written_over_bluetooth = bluetooth->DataWrites().size();
+  ASSERT_LT(written_over_bluetooth, 5);
+
+  // The chunks still queued go out over the new channel, and the endpoint
+  // stays connected.
+  Endpoint* wifi_lan = ReplaceChannel(bluetooth, Medium::WIFI_LAN);
+  for (int i = 5; i < 10; i++) {
+    EXPECT_EQ(SendChunk(i, {"endpoint"}), std::vector<std::string>{});
+  }
+  EXPECT_EQ(bluetooth->DataWrites().size(), written_over_bluetooth);
+  EXPECT_EQ(wifi_lan->DataWrites().size(), 10 - written_over_bluetooth);
+}
+
 TEST_F(EndpointManagerTest, SingleReadOnInvalidPayload) {
   auto endpoint_channel = std::make_unique<MockEndpointChannel>();
   EXPECT_CALL(*endpoint_channel, Read())
@@ -0,0 +1,40 @@
+// Copyright 2021 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <cstddef>
+#include <cstdint>
+
+#include "absl/strings/string_view.h"
+#include "core/internal/ble_advertisement.h"
+
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t* data, size_t size) {
+  using location::nearby::connections::BleAdvertisement;
+
+  if (size == 0) return 0;
+  // The first byte picks between regular and fast advertisements.
+  bool fast_advertisement = data[0] & 1;
+  absl::string_view bytes(reinterpret_cast<const char*>(data + 1), size - 1);
+
+  BleAdvertisement::View view(fast_advertisement, bytes);
+  if (!view.IsValid()) return 0;
+
+  BleAdvertisement ble_advertisement(view);
+  char buffer[BleAdvertisement::kMaxAdvertisementLength];
+  std::size_t serialized_size =
+      ble_advertisement.SerializeTo(buffer, sizeof(buffer));
+  BleAdvertisement::View(fast_advertisement,
+                         absl::string_view(buffer, serialized_size));
+
+  return 0;
+}
@@ -0,0 +1,35 @@
+// Copyright 2021 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <cstddef>
+#include <cstdint>
+
+#include "absl/strings/string_view.h"
+#include "core/internal/bluetooth_device_name.h"
+
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t* data, size_t size) {
+  using location::nearby::connections::BluetoothDeviceName;
+
+  BluetoothDeviceName::View view(
+      absl::string_view(reinterpret_cast<const char*>(data), size));
+  if (!view.IsValid()) return 0;
+
+  BluetoothDeviceName bluetooth_device_name(view);
+  char buffer[BluetoothDeviceName::kMaxBluetoothDeviceNameLength];
+  std::size_t serialized_size =
+      bluetooth_device_name.SerializeTo(buffer, sizeof(buffer));
+  BluetoothDeviceName::View(absl::string_view(buffer, serialized_size));
+
+  return 0;
+}
@@ -0,0 +1,45 @@
+// Copyright 2021 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+
+#include "absl/strings/string_view.h"
+#include "core/internal/wifi_lan_service_info.h"
+
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t* data, size_t size) {
+  using location::nearby::connections::WifiLanServiceInfo;
+
+  if (size == 0) return 0;
+  // The first byte splits the input into the service name and the endpoint
+  // info TXT record.
+  absl::string_view input(reinterpret_cast<const char*>(data + 1), size - 1);
+  std::size_t service_name_size =
+      std::min(static_cast<std::size_t>(data[0]), input.size());
+  absl::string_view service_name = input.substr(0, service_name_size);
+  absl::string_view endpoint_info = input.substr(service_name_size);
+
+  WifiLanServiceInfo::View view(service_name, endpoint_info);
+  if (!view.IsValid()) return 0;
+
+  WifiLanServiceInfo wifi_lan_service_info(view);
+  char buffer[WifiLanServiceInfo::kMaxServiceNameLength];
+  std::size_t serialized_size =
+      wifi_lan_service_info.SerializeServiceNameTo(buffer, sizeof(buffer));
+  WifiLanServiceInfo::View(absl::string_view(buffer, serialized_size),
+                           endpoint_info);
+
+  return 0;
+}
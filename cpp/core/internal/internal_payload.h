@@ -87,6 +87,11 @@ class InternalPayload {
   // @return the offset really skipped
   virtual ExceptionOr<size_t> SkipToOffset(size_t offset) = 0;
 
+  // Returns the hash of the content of the Payload, computed while it was
+  // read or written in full; empty if that hasn't happened (yet), or if this
+  // kind of Payload doesn't compute one.
+  virtual ByteArray GetContentHash() const { return {}; }
+
   // Cleans up any resources used by this Payload. Called when we're stopping
   // early, e.g. after being cancelled or having no more recipients left.
   virtual void Close() {}
@@ -18,9 +18,11 @@
 #include <memory>
 
 #include "absl/memory/memory.h"
+#include "core/internal/content_hasher.h"
 #include "core/payload.h"
 #include "platform/base/byte_array.h"
 #include "platform/base/exception.h"
+#include "platform/base/feature_flags.h"
 #include "platform/public/condition_variable.h"
 #include "platform/public/file.h"
 #include "platform/public/logging.h"
@@ -178,9 +180,11 @@ class IncomingStreamInternalPayload : public InternalPayload {
 
 class OutgoingFileInternalPayload : public InternalPayload {
  public:
-  explicit OutgoingFileInternalPayload(Payload payload)
+  OutgoingFileInternalPayload(Payload payload, bool hash_content)
       : InternalPayload(std::move(payload)),
-        total_size_{payload_.AsFile()->GetTotalSize()} {}
+        total_size_{payload_.AsFile()->GetTotalSize()} {
+    if (hash_content) content_hasher_ = absl::make_unique<ContentHasher>();
+  }
 
   PayloadTransferFrame::PayloadHeader::PayloadType GetType() const override {
     return PayloadTransferFrame::PayloadHeader::FILE;
@@ -201,11 +205,13 @@ class OutgoingFileInternalPayload : public InternalPayload {
 
     if (bytes.Empty()) {
       // No more data for outgoing payload.
+      if (content_hasher_) content_hash_ = content_hasher_->GetHash();
 
       file->Close();
       return {};
     }
 
+    if (content_hasher_) content_hasher_->Update(bytes);
     return bytes;
   }
 
@@ -219,6 +225,8 @@ class OutgoingFileInternalPayload : public InternalPayload {
     if (!file) {
       return {Exception::kIo};
     }
+    // The skipped part won't be read, so the content can't be hashed.
+    content_hasher_.reset();
 
     ExceptionOr<size_t> real_offset = file->Skip(offset);
     if (real_offset.ok() && real_offset.GetResult() == offset) {
@@ -240,17 +248,23 @@ class OutgoingFileInternalPayload : public InternalPayload {
     if (file) file->Close();
   }
 
+  ByteArray GetContentHash() const override { return content_hash_; }
+
  private:
   std::int64_t total_size_;
+  std::unique_ptr<ContentHasher> content_hasher_;
+  ByteArray content_hash_;
 };
 
 class IncomingFileInternalPayload : public InternalPayload {
  public:
   IncomingFileInternalPayload(Payload payload, OutputFile output_file,
-                              std::int64_t total_size)
+                              std::int64_t total_size, bool hash_content)
       : InternalPayload(std::move(payload)),
         output_file_(std::move(output_file)),
-        total_size_(total_size) {}
+        total_size_(total_size) {
+    if (hash_content) content_hasher_ = absl::make_unique<ContentHasher>();
+  }
 
   PayloadTransferFrame::PayloadHeader::PayloadType GetType() const override {
     return PayloadTransferFrame::PayloadHeader::FILE;
@@ -263,10 +277,12 @@ class IncomingFileInternalPayload : public InternalPayload {
   Exception AttachNextChunk(const ByteArray& chunk) override {
     if (chunk.Empty()) {
       // Received null last chunk for incoming payload.
+      if (content_hasher_) content_hash_ = content_hasher_->GetHash();
       output_file_.Close();
       return {Exception::kSuccess};
     }
 
+    if (content_hasher_) content_hasher_->Update(chunk);
     return output_file_.Write(chunk);
   }
 
@@ -278,9 +294,13 @@ class IncomingFileInternalPayload : public InternalPayload {
 
   void Close() override { output_file_.Close(); }
 
+  ByteArray GetContentHash() const override { return content_hash_; }
+
  private:
   OutputFile output_file_;
   const std::int64_t total_size_;
+  std::unique_ptr<ContentHasher> content_hasher_;
+  ByteArray content_hash_;
 };
 
 }  // namespace
@@ -296,7 +316,11 @@ std::unique_ptr<InternalPayload> CreateOutgoingInternalPayload(
       const PayloadId file_payload_id = file ? file->GetPayloadId() : 0;
       const PayloadId payload_id = payload.GetId();
       CHECK(payload_id == file_payload_id);
-      return absl::make_unique<OutgoingFileInternalPayload>(std::move(payload));
+      return absl::make_unique<OutgoingFileInternalPayload>(
+          std::move(payload),
+          /*hash_content=*/FeatureFlags::GetInstance()
+              .GetFlags()
+              .enable_payload_content_dedup);
     }
 
     case Payload::Type::kStream:
@@ -335,9 +359,13 @@ std::unique_ptr<InternalPayload> CreateIncomingInternalPayload(
 
     case PayloadTransferFrame::PayloadHeader::FILE: {
       std::int64_t total_size = frame.payload_header().total_size();
+      // Incoming content is only hashed for the ContentCache.
+      const FeatureFlags::Flags& flags = FeatureFlags::GetInstance().GetFlags();
       return absl::make_unique<IncomingFileInternalPayload>(
           Payload(payload_id, InputFile(payload_id, total_size)),
-          OutputFile(payload_id), total_size);
+          OutputFile(payload_id), total_size,
+          /*hash_content=*/flags.enable_payload_content_dedup &&
+              flags.enable_shared_payload_content_cache);
     }
     default:
       DCHECK(false);  // This should never happen.
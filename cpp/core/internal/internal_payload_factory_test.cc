@@ -19,8 +19,11 @@
 
 #include "gmock/gmock.h"
 #include "gtest/gtest.h"
+#include "core/internal/content_hasher.h"
 #include "core/internal/offline_frames.h"
 #include "platform/base/byte_array.h"
+#include "platform/base/feature_flags.h"
+#include "platform/base/medium_environment.h"
 #include "platform/public/pipe.h"
 #include "proto/connections/offline_wire_formats.pb.h"
 
@@ -176,6 +179,74 @@ TEST(InternalPayloadFActoryTest,
   EXPECT_EQ(contents_after_skip, ByteArray("6789"));
 }
 
+TEST(InternalPayloadFActoryTest, OutgoingFilePayloadHashesContentWhenEnabled) {
+  FeatureFlags::Flags feature_flags;
+  feature_flags.enable_payload_content_dedup = true;
+  MediumEnvironment::Instance().SetFeatureFlags(feature_flags);
+  ByteArray contents("0123456789");
+  Payload::Id payload_id = Payload::GenerateId();
+  CreateFileWithContents(payload_id, contents);
+  std::unique_ptr<InternalPayload> internal_payload =
+      CreateOutgoingInternalPayload(
+          Payload{payload_id, InputFile(payload_id, contents.size())});
+  ContentHasher hasher;
+  hasher.Update(contents);
+
+  EXPECT_EQ(internal_payload->DetachNextChunk(4), ByteArray("0123"));
+  EXPECT_TRUE(internal_payload->GetContentHash().Empty());
+  EXPECT_EQ(internal_payload->DetachNextChunk(512), ByteArray("456789"));
+  EXPECT_TRUE(internal_payload->DetachNextChunk(512).Empty());
+
+  EXPECT_EQ(internal_payload->GetContentHash(), hasher.GetHash());
+  MediumEnvironment::Instance().SetFeatureFlags(FeatureFlags::Flags());
+}
+
+TEST(InternalPayloadFActoryTest, OutgoingFilePayloadSkipsHashAfterSkip) {
+  FeatureFlags::Flags feature_flags;
+  feature_flags.enable_payload_content_dedup = true;
+  MediumEnvironment::Instance().SetFeatureFlags(feature_flags);
+  ByteArray contents("0123456789");
+  Payload::Id payload_id = Payload::GenerateId();
+  CreateFileWithContents(payload_id, contents);
+  std::unique_ptr<InternalPayload> internal_payload =
+      CreateOutgoingInternalPayload(
+          Payload{payload_id, InputFile(payload_id, contents.size())});
+
+  EXPECT_TRUE(internal_payload->SkipToOffset(4).ok());
+  EXPECT_EQ(internal_payload->DetachNextChunk(512), ByteArray("456789"));
+  EXPECT_TRUE(internal_payload->DetachNextChunk(512).Empty());
+
+  EXPECT_TRUE(internal_payload->GetContentHash().Empty());
+  MediumEnvironment::Instance().SetFeatureFlags(FeatureFlags::Flags());
+}
+
+TEST(InternalPayloadFActoryTest, IncomingFilePayloadHashesContentWhenEnabled) {
+  FeatureFlags::Flags feature_flags;
+  feature_flags.enable_payload_content_dedup = true;
+  feature_flags.enable_shared_payload_content_cache = true;
+  MediumEnvironment::Instance().SetFeatureFlags(feature_flags);
+  ByteArray contents("0123456789");
+  Payload::Id payload_id = Payload::GenerateId();
+  PayloadTransferFrame frame;
+  frame.set_packet_type(PayloadTransferFrame::DATA);
+  frame.mutable_payload_header()->set_id(payload_id);
+  frame.mutable_payload_header()->set_type(
+      PayloadTransferFrame::PayloadHeader::FILE);
+  frame.mutable_payload_header()->set_total_size(contents.size());
+  std::unique_ptr<InternalPayload> internal_payload =
+      CreateIncomingInternalPayload(frame);
+  ContentHasher hasher;
+  hasher.Update(contents);
+
+  EXPECT_TRUE(internal_payload->AttachNextChunk(ByteArray("0123")).Ok());
+  EXPECT_TRUE(internal_payload->AttachNextChunk(ByteArray("456789")).Ok());
+  EXPECT_TRUE(internal_payload->GetContentHash().Empty());
+  EXPECT_TRUE(internal_payload->AttachNextChunk(ByteArray()).Ok());
+
+  EXPECT_EQ(internal_payload->GetContentHash(), hasher.GetHash());
+  MediumEnvironment::Instance().SetFeatureFlags(FeatureFlags::Flags());
+}
+
 }  // namespace
 }  // namespace connections
 }  // namespace nearby
@@ -14,8 +14,9 @@
 
 #include "core/internal/mediums/bloom_filter.h"
 
+#include <algorithm>
+
 #include "absl/numeric/int128.h"
-#include "absl/strings/numbers.h"
 #include "smhasher/src/MurmurHash3.h"
 
 namespace location {
@@ -23,64 +24,57 @@ namespace nearby {
 namespace connections {
 namespace mediums {
 
-BloomFilterBase::BloomFilterBase(const ByteArray& bytes, BitSet* bit_set)
-    : bits_(bit_set) {
-  const char* bytes_read_ptr = bytes.data();
-  for (size_t byte_index = 0; byte_index < bytes.size(); byte_index++) {
-    for (size_t bit_index = 0; bit_index < 8; bit_index++) {
-      bits_->Set((byte_index * 8) + bit_index,
-                 (*bytes_read_ptr >> bit_index) & 0x01);
-    }
-    bytes_read_ptr++;
-  }
-}
-
 BloomFilterBase::operator ByteArray() const {
-  // Gets a binary string representation of the bitset where the leftmost
-  // character corresponds to bitset position (total size) - 1.
-  //
-  // If the bitset's internal representation is:
-  //     [position 0]     0 0 1 1 0 0 0 1 0 1 0 1     [position 11]
-  // The string representation will be outputted like this:
-  //                     "1 0 1 0 1 0 0 0 1 1 0 0"
-  std::string bitset_binary_string = bits_->ToString();
-
   ByteArray result_bytes(GetMinBytesForBits());
   char* result_bytes_write_ptr = result_bytes.data();
-  // We go through the string backwards because the rightmost character
-  // corresponds to position 0 in the bitset.
-  for (size_t i = bits_->Size(); i > 0; i -= 8) {
-    std::string byte_binary_string = bitset_binary_string.substr(i - 8, 8);
-    std::uint32_t byte_value;
-    absl::numbers_internal::safe_strtou32_base(byte_binary_string, &byte_value,
-                                               /* base= */ 2);
-    *result_bytes_write_ptr = static_cast<char>(byte_value & 0x000000FF);
-    result_bytes_write_ptr++;
+  for (std::size_t i = 0; i < result_bytes.size(); i++) {
+    *result_bytes_write_ptr++ =
+        static_cast<char>((words_[i >> 3] >> ((i & 7) * 8)) & 0xFF);
   }
   return result_bytes;
 }
 
-void BloomFilterBase::Add(const std::string& s) {
-  std::vector<std::int32_t> hashes = GetHashes(s);
-  for (int32_t hash : hashes) {
-    size_t position = static_cast<size_t>(hash) % bits_->Size();
-    bits_->Set(position, true);
+void BloomFilterBase::SetBytes(const ByteArray& bytes) {
+  const char* bytes_read_ptr = bytes.data();
+  std::size_t size = std::min(bytes.size(), GetMinBytesForBits());
+  for (std::size_t i = 0; i < size; i++) {
+    words_[i >> 3] |=
+        static_cast<std::uint64_t>(static_cast<std::uint8_t>(*bytes_read_ptr++))
+        << ((i & 7) * 8);
+  }
+}
+
+void BloomFilterBase::Add(absl::string_view s) {
+  for (std::int32_t hash : GetHashes(s)) {
+    std::size_t position = static_cast<std::size_t>(hash) % bit_count_;
+    words_[position >> 6] |= std::uint64_t{1} << (position & 63);
+  }
+}
+
+bool BloomFilterBase::PossiblyContains(absl::string_view s) const {
+  return ContainsHashes(GetHashes(s));
+}
+
+bool BloomFilterBase::PossiblyContainsAny(
+    absl::Span<const absl::string_view> strings) const {
+  for (absl::string_view s : strings) {
+    if (ContainsHashes(GetHashes(s))) return true;
   }
+  return false;
 }
 
-bool BloomFilterBase::PossiblyContains(const std::string& s) {
-  std::vector<std::int32_t> hashes = GetHashes(s);
-  for (int32_t hash : hashes) {
-    size_t position = static_cast<size_t>(hash) % bits_->Size();
-    if (!bits_->Test(position)) {
-      return false;
-    }
+bool BloomFilterBase::ContainsHashes(const Hashes& hashes) const {
+  // Gather all the bits before testing them, rather than branching on each.
+  std::uint64_t missing = 0;
+  for (std::int32_t hash : hashes) {
+    std::size_t position = static_cast<std::size_t>(hash) % bit_count_;
+    missing |= ~words_[position >> 6] & (std::uint64_t{1} << (position & 63));
   }
-  return true;
+  return missing == 0;
 }
 
-std::vector<std::int32_t> BloomFilterBase::GetHashes(const std::string& s) {
-  std::vector<std::int32_t> hashes(kHasherNumberOfRepetitions, 0);
+BloomFilterBase::Hashes BloomFilterBase::GetHashes(absl::string_view s) {
+  Hashes hashes;
 
   absl::uint128 hash128;
   MurmurHash3_x64_128(s.data(), s.size(), 0, &hash128);
@@ -15,9 +15,12 @@
 #ifndef CORE_INTERNAL_MEDIUMS_BLOOM_FILTER_H_
 #define CORE_INTERNAL_MEDIUMS_BLOOM_FILTER_H_
 
-#include <bitset>
-#include <vector>
+#include <array>
+#include <cstddef>
+#include <cstdint>
 
+#include "absl/strings/string_view.h"
+#include "absl/types/span.h"
 #include "platform/base/byte_array.h"
 
 namespace location {
@@ -26,73 +29,75 @@ namespace connections {
 namespace mediums {
 
 /**
- * A bloom filter that gives access to the underlying BitSet. The implementation
+ * A bloom filter that gives access to the underlying bits. The implementation
  * is copied from our Java version of Bloom filter, which in turn copies from
  * Guava's BloomFilter.
  *
  * BloomFilter is templatized on the size of the byte array and not the size of
  * the bit set to ensure the bit set's length is a multiple of 8 (and can
  * neatly be returned as a ByteArray).
+ *
+ * Bits are kept in 64-bit words, bit i of the filter being bit (i % 64) of
+ * word (i / 64). As a ByteArray, bit i is bit (i % 8) of byte (i / 8).
  */
 class BloomFilterBase {
  public:
   explicit operator ByteArray() const;
 
-  void Add(const std::string& s);
-  bool PossiblyContains(const std::string& s);
+  void Add(absl::string_view s);
+  bool PossiblyContains(absl::string_view s) const;
+  // Returns true if any of |strings| is possibly in the filter; eg. to check
+  // all the service IDs we're discovering against an advertisement at once.
+  bool PossiblyContainsAny(absl::Span<const absl::string_view> strings) const;
 
  protected:
-  class BitSet {
-   public:
-    virtual ~BitSet() = default;
-    virtual std::string ToString() const = 0;
-    virtual void Set(size_t pos, bool value) = 0;
-    virtual bool Test(size_t pos) const = 0;
-    virtual size_t Size() const = 0;
-  };
-
-  BloomFilterBase(const ByteArray& bytes, BitSet* bit_set);
-  virtual ~BloomFilterBase() = default;
-
   constexpr static int kHasherNumberOfRepetitions = 5;
-  std::vector<std::int32_t> GetHashes(const std::string& s);
+  using Hashes = std::array<std::int32_t, kHasherNumberOfRepetitions>;
+
+  // |words| must hold at least |bit_count| bits, and outlive this object.
+  BloomFilterBase(std::uint64_t* words, std::size_t bit_count)
+      : words_(words), bit_count_(bit_count) {}
+  ~BloomFilterBase() = default;
+
+  // Copies |bytes| into the filter, ignoring any that don't fit.
+  void SetBytes(const ByteArray& bytes);
+  static Hashes GetHashes(absl::string_view s);
 
  private:
-  int GetMinBytesForBits() const { return (bits_->Size() + 7) >> 3; }
+  std::size_t GetMinBytesForBits() const { return (bit_count_ + 7) >> 3; }
+  bool ContainsHashes(const Hashes& hashes) const;
 
-  BitSet* bits_;
+  std::uint64_t* const words_;
+  const std::size_t bit_count_;
 };
 
 template <size_t CapacityInBytes>
 class BloomFilter final : public BloomFilterBase {
  public:
-  BloomFilter() : BloomFilterBase(ByteArray{}, &bits_) {}
+  BloomFilter() : BloomFilterBase(words_.data(), kBitCount) {}
   explicit BloomFilter(const ByteArray& bytes)
-      : BloomFilterBase(bytes, &bits_) {}
-  BloomFilter(const BloomFilter&) = default;
-  BloomFilter& operator=(const BloomFilter&) = default;
-  BloomFilter(BloomFilter&& other) : BloomFilterBase(ByteArray{}, &bits_) {
-    *this = std::move(other);
+      : BloomFilterBase(words_.data(), kBitCount) {
+    SetBytes(bytes);
   }
-  BloomFilter& operator=(BloomFilter&& other) {
-    std::swap((*this).bits_, other.bits_);
+  BloomFilter(const BloomFilter& other)
+      : BloomFilterBase(words_.data(), kBitCount), words_(other.words_) {}
+  BloomFilter& operator=(const BloomFilter& other) {
+    words_ = other.words_;
     return *this;
   }
-  ~BloomFilter() override = default;
+  ~BloomFilter() = default;
 
  private:
-  class BitSetImpl final : public BitSet {
-   public:
-    std::string ToString() const override { return bits_.to_string(); }
-    void Set(size_t pos, bool value) override { bits_.set(pos, value); }
-    bool Test(size_t pos) const override { return bits_.test(pos); }
-    size_t Size() const override { return bits_.size(); }
-
-   private:
-    std::bitset<CapacityInBytes * 8> bits_;
-  } bits_;
+  static constexpr std::size_t kBitCount = CapacityInBytes * 8;
+
+  std::array<std::uint64_t, (CapacityInBytes + 7) / 8> words_{};
 };
 
+// C++14 requires to declare this.
+// TODO(apolyudov): remove when migration to c++17 is possible.
+template <size_t CapacityInBytes>
+constexpr std::size_t BloomFilter<CapacityInBytes>::kBitCount;
+
 }  // namespace mediums
 }  // namespace connections
 }  // namespace nearby
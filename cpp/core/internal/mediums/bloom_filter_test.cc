@@ -15,8 +15,11 @@
 #include "core/internal/mediums/bloom_filter.h"
 
 #include <algorithm>
+#include <string>
+#include <vector>
 
 #include "gtest/gtest.h"
+#include "absl/strings/string_view.h"
 
 namespace location {
 namespace nearby {
@@ -200,6 +203,51 @@ TEST(BloomFilterTest, RandomnessFalsePositiveRate) {
   EXPECT_LE(false_positives, 5);
 }
 
+TEST(BloomFilterTest, BytesMatchBitSetLayout) {
+  BloomFilter<10> bloom_filter;
+
+  bloom_filter.Add("ELEMENT_1");
+  bloom_filter.Add("ELEMENT_2");
+  bloom_filter.Add("ELEMENT_3");
+
+  // What the filter looked like when it was backed by a std::bitset; peers
+  // read these bytes, so the layout can't change.
+  EXPECT_EQ(std::string(ByteArray(bloom_filter)),
+            std::string("\x00\x10\x14\x32\x0c\x04\x04\x62\x01\x00", 10));
+}
+
+TEST(BloomFilterTest, ConstructFromBytesSuccess) {
+  BloomFilter<10> bloom_filter;
+  bloom_filter.Add("ELEMENT_1");
+  ByteArray bloom_filter_bytes(bloom_filter);
+
+  BloomFilter<10> bloom_filter_copy(bloom_filter_bytes);
+
+  EXPECT_EQ(std::string(ByteArray(bloom_filter_copy)),
+            std::string(bloom_filter_bytes));
+  EXPECT_TRUE(bloom_filter_copy.PossiblyContains("ELEMENT_1"));
+}
+
+TEST(BloomFilterTest, ConstructFromLongBytesIgnoresExtraBytes) {
+  ByteArray bytes(std::string(12, '\xff'));
+
+  BloomFilter<10> bloom_filter(bytes);
+
+  EXPECT_EQ(std::string(ByteArray(bloom_filter)), std::string(10, '\xff'));
+}
+
+TEST(BloomFilterTest, PossiblyContainsAny) {
+  BloomFilter<kByteArrayLength> bloom_filter;
+
+  bloom_filter.Add("ELEMENT_2");
+
+  std::vector<absl::string_view> found = {"ELEMENT_1", "ELEMENT_2"};
+  std::vector<absl::string_view> missing = {"ELEMENT_1", "ELEMENT_3"};
+  EXPECT_TRUE(bloom_filter.PossiblyContainsAny(found));
+  EXPECT_FALSE(bloom_filter.PossiblyContainsAny(missing));
+  EXPECT_FALSE(bloom_filter.PossiblyContainsAny({}));
+}
+
 }  // namespace
 }  // namespace mediums
 }  // namespace connections
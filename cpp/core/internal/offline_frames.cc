@@ -68,7 +68,10 @@ ByteArray ForConnectionRequest(const std::string& endpoint_id,
                                const std::string& bssid,
                                const std::vector<Medium>& mediums,
                                std::int32_t keep_alive_interval_millis,
-                               std::int32_t keep_alive_timeout_millis) {
+                               std::int32_t keep_alive_timeout_millis,
+                               bool supports_payload_compression,
+                               std::int32_t aead_data_frame_version,
+                               bool supports_session_resumption) {
   OfflineFrame frame;
 
   frame.set_version(OfflineFrame::V1);
@@ -97,11 +100,23 @@ ByteArray ForConnectionRequest(const std::string& endpoint_id,
     connection_request->set_keep_alive_timeout_millis(
         keep_alive_timeout_millis);
   }
+  if (supports_payload_compression) {
+    connection_request->set_supports_payload_compression(true);
+  }
+  if (aead_data_frame_version > 0) {
+    connection_request->set_aead_data_frame_version(aead_data_frame_version);
+  }
+  if (supports_session_resumption) {
+    connection_request->set_supports_session_resumption(true);
+  }
 
   return ToBytes(std::move(frame));
 }
 
-ByteArray ForConnectionResponse(std::int32_t status) {
+ByteArray ForConnectionResponse(std::int32_t status,
+                                bool supports_payload_compression,
+                                std::int32_t aead_data_frame_version,
+                                bool supports_session_resumption) {
   OfflineFrame frame;
 
   frame.set_version(OfflineFrame::V1);
@@ -116,6 +131,15 @@ ByteArray ForConnectionResponse(std::int32_t status) {
   sub_frame->set_response(status == Status::kSuccess
                               ? ConnectionResponseFrame::ACCEPT
                               : ConnectionResponseFrame::REJECT);
+  if (supports_payload_compression) {
+    sub_frame->set_supports_payload_compression(true);
+  }
+  if (aead_data_frame_version > 0) {
+    sub_frame->set_aead_data_frame_version(aead_data_frame_version);
+  }
+  if (supports_session_resumption) {
+    sub_frame->set_supports_session_resumption(true);
+  }
 
   return ToBytes(std::move(frame));
 }
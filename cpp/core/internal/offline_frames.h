@@ -48,8 +48,14 @@ ByteArray ForConnectionRequest(const std::string& endpoint_id,
                                const std::string& bssid,
                                const std::vector<Medium>& mediums,
                                std::int32_t keep_alive_interval_millis,
-                               std::int32_t keep_alive_timeout_millis);
-ByteArray ForConnectionResponse(std::int32_t status);
+                               std::int32_t keep_alive_timeout_millis,
+                               bool supports_payload_compression = false,
+                               std::int32_t aead_data_frame_version = 0,
+                               bool supports_session_resumption = false);
+ByteArray ForConnectionResponse(std::int32_t status,
+                                bool supports_payload_compression = false,
+                                std::int32_t aead_data_frame_version = 0,
+                                bool supports_session_resumption = false);
 
 // Builds Payload transfer messages.
 ByteArray ForDataPayloadTransfer(
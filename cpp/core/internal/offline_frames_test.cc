@@ -134,6 +134,44 @@ TEST(OfflineFramesTest, CanGenerateConnectionResponse) {
   EXPECT_THAT(message, EqualsProto(kExpected));
 }
 
+TEST(OfflineFramesTest, CanGenerateConnectionResponseWithCompression) {
+  constexpr char kExpected[] =
+      R"pb(
+    version: V1
+    v1: <
+      type: CONNECTION_RESPONSE
+      connection_response: <
+        status: 0
+        response: ACCEPT
+        supports_payload_compression: true
+      >
+    >)pb";
+  ByteArray bytes = ForConnectionResponse(0, true);
+  auto response = FromBytes(bytes);
+  ASSERT_TRUE(response.ok());
+  OfflineFrame message = FromBytes(bytes).result();
+  EXPECT_THAT(message, EqualsProto(kExpected));
+}
+
+TEST(OfflineFramesTest, CanGenerateConnectionResponseWithAeadDataFrames) {
+  constexpr char kExpected[] =
+      R"pb(
+    version: V1
+    v1: <
+      type: CONNECTION_RESPONSE
+      connection_response: <
+        status: 0
+        response: ACCEPT
+        aead_data_frame_version: 1
+      >
+    >)pb";
+  ByteArray bytes = ForConnectionResponse(0, false, 1);
+  auto response = FromBytes(bytes);
+  ASSERT_TRUE(response.ok());
+  OfflineFrame message = FromBytes(bytes).result();
+  EXPECT_THAT(message, EqualsProto(kExpected));
+}
+
 TEST(OfflineFramesTest, CanGenerateControlPayloadTransfer) {
   PayloadTransferFrame::PayloadHeader header;
   PayloadTransferFrame::ControlMessage control;
@@ -14,7 +14,11 @@
 
 #include "core/internal/p2p_cluster_pcp_handler.h"
 
+#include <algorithm>
+#include <utility>
+
 #include "absl/functional/bind_front.h"
+#include "absl/memory/memory.h"
 #include "absl/strings/escaping.h"
 #include "core/internal/base_pcp_handler.h"
 #include "core/internal/ble_advertisement.h"
@@ -26,18 +30,45 @@
 #include "core/internal/wifi_lan_endpoint_channel.h"
 #include "platform/base/nsd_service_info.h"
 #include "platform/base/types.h"
+#include "platform/public/count_down_latch.h"
 #include "platform/public/crypto.h"
+#include "platform/public/system_clock.h"
+#include "platform/public/tracing.h"
 #include "proto/connections_enums.pb.h"
 
 namespace location {
 namespace nearby {
 namespace connections {
 
+// C++14 requires to declare this.
+// TODO(apolyudov): remove when migration to c++17 is possible.
+constexpr absl::Duration P2pClusterPcpHandler::kBleDiscoveryFlushInterval;
+
 ByteArray P2pClusterPcpHandler::GenerateHash(const std::string& source,
                                              size_t size) {
   return Utils::Sha256Hash(source, size);
 }
 
+ByteArray P2pClusterPcpHandler::GetServiceIdHash(
+    const std::string& service_id) const {
+  static_assert(
+      BluetoothDeviceName::kServiceIdHashLength ==
+              BleAdvertisement::kServiceIdHashLength &&
+          WifiLanServiceInfo::kServiceIdHashLength ==
+              BleAdvertisement::kServiceIdHashLength,
+      "All mediums are expected to share a service_id_hash");
+  MutexLock lock(&service_id_hashes_mutex_);
+  auto item = service_id_hashes_.find(service_id);
+  if (item == service_id_hashes_.end()) {
+    item = service_id_hashes_
+               .emplace(service_id,
+                        GenerateHash(service_id,
+                                     BleAdvertisement::kServiceIdHashLength))
+               .first;
+  }
+  return item->second;
+}
+
 bool P2pClusterPcpHandler::ShouldAdvertiseBluetoothMacOverBle(
     PowerLevel power_level) {
   return power_level == PowerLevel::kHighPower;
@@ -59,7 +90,30 @@ P2pClusterPcpHandler::P2pClusterPcpHandler(
       ble_medium_(mediums->GetBle()),
       wifi_lan_medium_(mediums->GetWifiLan()),
       webrtc_medium_(mediums->GetWebRtc()),
-      injected_bluetooth_device_store_(injected_bluetooth_device_store) {}
+      injected_bluetooth_device_store_(injected_bluetooth_device_store),
+      ble_discovery_batcher_(
+          kBleDiscoveryFlushInterval,
+          [this](std::vector<BleDiscoveryBatcher::Event> events) {
+            BleDiscoveryBatchHandler(std::move(events));
+          }) {}
+
+P2pClusterPcpHandler::~P2pClusterPcpHandler() {
+  // The duty cycle alarm posts to the PCP handler thread, which
+  // ~BasePcpHandler() only shuts down after our members are gone. Stop the
+  // alarm executor first, then drop the duty cycles on the PCP handler thread,
+  // behind any update the alarm already posted.
+  discovery_scheduler_executor_.Shutdown();
+  CountDownLatch latch(1);
+  RunOnPcpHandlerThread("stop-discovery-duty-cycle",
+                        [this, &latch]() RUN_ON_PCP_HANDLER_THREAD() {
+                          for (auto& item : duty_cycled_discoveries_) {
+                            item.second->alarm.Cancel();
+                          }
+                          duty_cycled_discoveries_.clear();
+                          latch.CountDown();
+                        });
+  latch.Await();
+}
 
 // Returns a vector or mediums sorted in order or decreasing priority for
 // all the supported mediums.
@@ -187,8 +241,7 @@ bool P2pClusterPcpHandler::IsRecognizedBluetoothEndpoint(
     return false;
   }
 
-  ByteArray expected_service_id_hash =
-      GenerateHash(service_id, BluetoothDeviceName::kServiceIdHashLength);
+  ByteArray expected_service_id_hash = GetServiceIdHash(service_id);
 
   if (name.GetServiceIdHash() != expected_service_id_hash) {
     NEARBY_LOGS(INFO) << name_string
@@ -205,6 +258,11 @@ bool P2pClusterPcpHandler::IsRecognizedBluetoothEndpoint(
 void P2pClusterPcpHandler::BluetoothDeviceDiscoveredHandler(
     ClientProxy* client, const std::string& service_id,
     BluetoothDevice device) {
+  // Drop devices that aren't ours right away, without queueing them.
+  if (!BluetoothDeviceName::MayMatch(device.GetName(), GetPcp(),
+                                     GetServiceIdHash(service_id))) {
+    return;
+  }
   RunOnPcpHandlerThread(
       "p2p-bt-device-discovered",
       [this, client, service_id, device]()
@@ -332,6 +390,10 @@ void P2pClusterPcpHandler::BluetoothDeviceLostHandler(
     ClientProxy* client, const std::string& service_id,
     BluetoothDevice& device) {
   const std::string& device_name_string = device.GetName();
+  if (!BluetoothDeviceName::MayMatch(device_name_string, GetPcp(),
+                                     GetServiceIdHash(service_id))) {
+    return;
+  }
   RunOnPcpHandlerThread(
       "p2p-bt-device-lost", [this, client, service_id,
                              device_name_string]() RUN_ON_PCP_HANDLER_THREAD() {
@@ -391,8 +453,7 @@ bool P2pClusterPcpHandler::IsRecognizedBleEndpoint(
   // Check ServiceId for normal advertisement.
   // ServiceIdHash is empty for fast advertisement.
   if (!advertisement.IsFastAdvertisement()) {
-    ByteArray expected_service_id_hash =
-        GenerateHash(service_id, BleAdvertisement::kServiceIdHashLength);
+    ByteArray expected_service_id_hash = GetServiceIdHash(service_id);
 
     if (advertisement.GetServiceIdHash() != expected_service_id_hash) {
       NEARBY_LOGS(INFO)
@@ -412,83 +473,93 @@ void P2pClusterPcpHandler::BlePeripheralDiscoveredHandler(
     ClientProxy* client, BlePeripheral& peripheral,
     const std::string& service_id, const ByteArray& advertisement_bytes,
     bool fast_advertisement) {
-  RunOnPcpHandlerThread(
-      "p2p-ble-device-discovered",
-      [this, client, &peripheral, service_id, advertisement_bytes,
-       fast_advertisement]() RUN_ON_PCP_HANDLER_THREAD() {
-        // Make sure we are still discovering before proceeding.
-        if (!client->IsDiscovering()) {
-          NEARBY_LOGS(WARNING)
-              << "Skipping discovery of BleAdvertisement header "
-              << absl::BytesToHexString(advertisement_bytes.data())
-              << " because we are no longer discovering.";
-          return;
-        }
-
-        // Parse the BLE advertisement bytes.
-        BleAdvertisement advertisement(fast_advertisement, advertisement_bytes);
-
-        // Make sure the BLE advertisement points to a valid
-        // endpoint we're discovering.
-        if (!IsRecognizedBleEndpoint(service_id, advertisement)) return;
+  // Drop advertisements that aren't ours right away, without queueing them.
+  if (!BleAdvertisement::MayMatch(fast_advertisement, advertisement_bytes,
+                                  GetPcp(), GetServiceIdHash(service_id))) {
+    return;
+  }
+  // Repeated sightings of the same advertisement are dropped by the batcher,
+  // which hands the rest to BleDiscoveryBatchHandler().
+  ble_discovery_batcher_.OnPeripheralDiscovered(
+      client, peripheral, service_id, advertisement_bytes, fast_advertisement);
+}
 
-        // Store all the state we need to be able to re-create a BleEndpoint
-        // in BlePeripheralLostHandler, since that isn't privy to
-        // the bytes of the ble advertisement itself.
-        found_ble_endpoints_.emplace(
-            peripheral.GetName(),
-            BleEndpointState(advertisement.GetEndpointId(),
-                             advertisement.GetEndpointInfo()));
+void P2pClusterPcpHandler::ProcessBlePeripheralDiscovered(
+    ClientProxy* client, BlePeripheral& peripheral,
+    const std::string& service_id, const ByteArray& advertisement_bytes,
+    bool fast_advertisement) {
+  // Make sure we are still discovering before proceeding.
+  if (!client->IsDiscovering()) {
+    NEARBY_LOGS(WARNING)
+        << "Skipping discovery of BleAdvertisement header "
+        << absl::BytesToHexString(advertisement_bytes.data())
+        << " because we are no longer discovering.";
+    return;
+  }
 
-        // Report the discovered endpoint to the client.
-        NEARBY_LOGS(INFO) << "Found BleAdvertisement "
-                          << absl::BytesToHexString(advertisement_bytes.data())
-                          << " (with endpoint_id="
-                          << advertisement.GetEndpointId()
-                          << ", and endpoint_info="
-                          << absl::BytesToHexString(
-                                 advertisement.GetEndpointInfo().data())
-                          << ").",
-            OnEndpointFound(client,
-                            std::make_shared<BleEndpoint>(BleEndpoint{
-                                {advertisement.GetEndpointId(),
-                                 advertisement.GetEndpointInfo(), service_id,
-                                 proto::connections::Medium::BLE,
-                                 advertisement.GetWebRtcState()},
-                                peripheral,
-                            }));
-
-        // Make sure we can connect to this device via Classic Bluetooth.
-        std::string remote_bluetooth_mac_address =
-            advertisement.GetBluetoothMacAddress();
-        if (remote_bluetooth_mac_address.empty()) {
-          NEARBY_LOGS(INFO)
-              << "No Bluetooth Classic MAC address found in advertisement.";
-          return;
-        }
+  // Parse the BLE advertisement bytes.
+  BleAdvertisement advertisement(fast_advertisement, advertisement_bytes);
+
+  // Make sure the BLE advertisement points to a valid
+  // endpoint we're discovering.
+  if (!IsRecognizedBleEndpoint(service_id, advertisement)) return;
+
+  // Store all the state we need to be able to re-create a BleEndpoint
+  // in BlePeripheralLostHandler, since that isn't privy to
+  // the bytes of the ble advertisement itself.
+  found_ble_endpoints_.emplace(
+      peripheral.GetName(),
+      BleEndpointState(advertisement.GetEndpointId(),
+                       advertisement.GetEndpointInfo()));
+
+  // Report the discovered endpoint to the client.
+  NEARBY_LOGS(INFO) << "Found BleAdvertisement "
+                    << absl::BytesToHexString(advertisement_bytes.data())
+                    << " (with endpoint_id="
+                    << advertisement.GetEndpointId()
+                    << ", and endpoint_info="
+                    << absl::BytesToHexString(
+                           advertisement.GetEndpointInfo().data())
+                    << ").",
+      OnEndpointFound(client,
+                      std::make_shared<BleEndpoint>(BleEndpoint{
+                          {advertisement.GetEndpointId(),
+                           advertisement.GetEndpointInfo(), service_id,
+                           proto::connections::Medium::BLE,
+                           advertisement.GetWebRtcState()},
+                          peripheral,
+                      }));
+
+  // Make sure we can connect to this device via Classic Bluetooth.
+  std::string remote_bluetooth_mac_address =
+      advertisement.GetBluetoothMacAddress();
+  if (remote_bluetooth_mac_address.empty()) {
+    NEARBY_LOGS(INFO)
+        << "No Bluetooth Classic MAC address found in advertisement.";
+    return;
+  }
 
-        BluetoothDevice remote_bluetooth_device =
-            bluetooth_medium_.GetRemoteDevice(remote_bluetooth_mac_address);
-        if (!remote_bluetooth_device.IsValid()) {
-          NEARBY_LOGS(INFO)
-              << "A valid Bluetooth device could not be derived from the MAC "
-                 "address "
-              << remote_bluetooth_mac_address;
-          return;
-        }
+  BluetoothDevice remote_bluetooth_device =
+      bluetooth_medium_.GetRemoteDevice(remote_bluetooth_mac_address);
+  if (!remote_bluetooth_device.IsValid()) {
+    NEARBY_LOGS(INFO)
+        << "A valid Bluetooth device could not be derived from the MAC "
+           "address "
+        << remote_bluetooth_mac_address;
+    return;
+  }
 
-        OnEndpointFound(client,
-                        std::make_shared<BluetoothEndpoint>(BluetoothEndpoint{
-                            {
-                                advertisement.GetEndpointId(),
-                                advertisement.GetEndpointInfo(),
-                                service_id,
-                                proto::connections::Medium::BLUETOOTH,
-                                advertisement.GetWebRtcState(),
-                            },
-                            remote_bluetooth_device,
-                        }));
-      });
+  OnEndpointFound(client,
+                  std::make_shared<BluetoothEndpoint>(BluetoothEndpoint{
+                      {
+                          advertisement.GetEndpointId(),
+                          advertisement.GetEndpointInfo(),
+                          service_id,
+                          proto::connections::Medium::BLUETOOTH,
+                          advertisement.GetWebRtcState(),
+                      },
+                      remote_bluetooth_device,
+                  }));
 }
 
 void P2pClusterPcpHandler::BlePeripheralLostHandler(
@@ -497,38 +568,61 @@ void P2pClusterPcpHandler::BlePeripheralLostHandler(
   std::string peripheral_name = peripheral.GetName();
   NEARBY_LOG(INFO, "Ble: [LOST, SCHED] peripheral_name=%s",
              peripheral_name.c_str());
-  RunOnPcpHandlerThread(
-      "p2p-ble-device-lost",
-      [this, client, service_id, &peripheral]() RUN_ON_PCP_HANDLER_THREAD() {
-        // Make sure we are still discovering before proceeding.
-        if (!client->IsDiscovering()) {
-          NEARBY_LOGS(WARNING)
-              << "Ignoring lost BlePeripheral " << peripheral.GetName()
-              << " because we are no longer discovering.";
-          return;
-        }
+  ble_discovery_batcher_.OnPeripheralLost(client, peripheral, service_id);
+}
 
-        // Remove this BlePeripheral from found_ble_endpoints_, and
-        // report the endpoint as lost to the client.
-        auto item = found_ble_endpoints_.find(peripheral.GetName());
-        if (item != found_ble_endpoints_.end()) {
-          BleEndpointState ble_endpoint_state(item->second);
-          found_ble_endpoints_.erase(item);
+void P2pClusterPcpHandler::ProcessBlePeripheralLost(
+    ClientProxy* client, BlePeripheral& peripheral,
+    const std::string& service_id) {
+  // Make sure we are still discovering before proceeding.
+  if (!client->IsDiscovering()) {
+    NEARBY_LOGS(WARNING)
+        << "Ignoring lost BlePeripheral " << peripheral.GetName()
+        << " because we are no longer discovering.";
+    return;
+  }
 
-          // Report the discovered endpoint to the client.
-          NEARBY_LOGS(INFO)
-              << "Lost BleEndpoint for BlePeripheral " << peripheral.GetName()
-              << " (with endpoint_id=" << ble_endpoint_state.endpoint_id
-              << " and endpoint_info="
-              << absl::BytesToHexString(ble_endpoint_state.endpoint_info.data())
-              << ").";
-          OnEndpointLost(client, DiscoveredEndpoint{
-                                     ble_endpoint_state.endpoint_id,
-                                     ble_endpoint_state.endpoint_info,
-                                     service_id,
-                                     proto::connections::Medium::BLE,
-                                     WebRtcState::kUndefined,
-                                 });
+  // Remove this BlePeripheral from found_ble_endpoints_, and
+  // report the endpoint as lost to the client.
+  auto item = found_ble_endpoints_.find(peripheral.GetName());
+  if (item != found_ble_endpoints_.end()) {
+    BleEndpointState ble_endpoint_state(item->second);
+    found_ble_endpoints_.erase(item);
+
+    // Report the discovered endpoint to the client.
+    NEARBY_LOGS(INFO)
+        << "Lost BleEndpoint for BlePeripheral " << peripheral.GetName()
+        << " (with endpoint_id=" << ble_endpoint_state.endpoint_id
+        << " and endpoint_info="
+        << absl::BytesToHexString(ble_endpoint_state.endpoint_info.data())
+        << ").";
+    OnEndpointLost(client, DiscoveredEndpoint{
+                               ble_endpoint_state.endpoint_id,
+                               ble_endpoint_state.endpoint_info,
+                               service_id,
+                               proto::connections::Medium::BLE,
+                               WebRtcState::kUndefined,
+                           });
+  }
+}
+
+void P2pClusterPcpHandler::BleDiscoveryBatchHandler(
+    std::vector<BleDiscoveryBatcher::Event> events) {
+  RunOnPcpHandlerThread(
+      "p2p-ble-discovery-batch",
+      [this, events = std::move(events)]() RUN_ON_PCP_HANDLER_THREAD() {
+        for (const BleDiscoveryBatcher::Event& event : events) {
+          switch (event.type) {
+            case BleDiscoveryBatcher::Event::Type::kFound:
+              ProcessBlePeripheralDiscovered(
+                  event.client, *event.peripheral, event.service_id,
+                  event.advertisement_bytes, event.fast_advertisement);
+              break;
+            case BleDiscoveryBatcher::Event::Type::kLost:
+              ProcessBlePeripheralLost(event.client, *event.peripheral,
+                                       event.service_id);
+              break;
+          }
         }
       });
 }
@@ -550,8 +644,7 @@ bool P2pClusterPcpHandler::IsRecognizedWifiLanEndpoint(
     return false;
   }
 
-  ByteArray expected_service_id_hash =
-      GenerateHash(service_id, WifiLanServiceInfo::kServiceIdHashLength);
+  ByteArray expected_service_id_hash = GetServiceIdHash(service_id);
 
   if (wifi_lan_service_info.GetServiceIdHash() != expected_service_id_hash) {
     NEARBY_LOGS(INFO)
@@ -569,6 +662,11 @@ bool P2pClusterPcpHandler::IsRecognizedWifiLanEndpoint(
 void P2pClusterPcpHandler::WifiLanServiceDiscoveredHandler(
     ClientProxy* client, NsdServiceInfo service_info,
     const std::string& service_id) {
+  // Drop services that aren't ours right away, without queueing them.
+  if (!WifiLanServiceInfo::MayMatch(service_info.GetServiceName(), GetPcp(),
+                                    GetServiceIdHash(service_id))) {
+    return;
+  }
   RunOnPcpHandlerThread(
       "p2p-wifi-service-discovered",
       [this, client, service_id, service_info]() RUN_ON_PCP_HANDLER_THREAD() {
@@ -614,6 +712,10 @@ void P2pClusterPcpHandler::WifiLanServiceDiscoveredHandler(
 void P2pClusterPcpHandler::WifiLanServiceLostHandler(
     ClientProxy* client, NsdServiceInfo service_info,
     const std::string& service_id) {
+  if (!WifiLanServiceInfo::MayMatch(service_info.GetServiceName(), GetPcp(),
+                                    GetServiceIdHash(service_id))) {
+    return;
+  }
   NEARBY_LOGS(INFO) << "WifiLan: [LOST, SCHED] service_info=" << &service_info
                     << ", service_name=" << service_info.GetServiceName();
   RunOnPcpHandlerThread(
@@ -665,6 +767,47 @@ BasePcpHandler::StartOperationResult P2pClusterPcpHandler::StartDiscoveryImpl(
             .mediums = options.allowed.GetMediums(true)};
   }
 
+  std::vector<proto::connections::Medium> mediums_started_successfully =
+      StartDiscoveryMediums(client, service_id, options);
+
+  if (mediums_started_successfully.empty()) {
+    NEARBY_LOGS(ERROR)
+        << "Failed StartDiscovery() for client=" << client->GetClientId()
+        << " because we couldn't scan on Bluetooth, BLE, or WifiLan for "
+           "service_id="
+        << service_id;
+    return {
+        .status = {Status::kBluetoothError},
+    };
+  }
+
+  if (!options.scan_duty_cycle.IsContinuous()) {
+    StopDiscoverySchedule(client);
+    auto discovery =
+        absl::make_unique<DutyCycledDiscovery>(client, service_id, options);
+    discovery->scheduler.Start(SystemClock::ElapsedRealtime());
+    duty_cycled_discoveries_.emplace(client, std::move(discovery));
+    UpdateDiscoverySchedule(client);
+  }
+
+  return {
+      .status = {Status::kSuccess},
+      .mediums = std::move(mediums_started_successfully),
+  };
+}
+
+Status P2pClusterPcpHandler::StopDiscoveryImpl(ClientProxy* client) {
+  StopDiscoverySchedule(client);
+  StopDiscoveryMediums(client, client->GetDiscoveryServiceId());
+  // Peripherals seen so far have to be reported again by the next discovery.
+  ble_discovery_batcher_.Reset(client);
+  return {Status::kSuccess};
+}
+
+std::vector<proto::connections::Medium>
+P2pClusterPcpHandler::StartDiscoveryMediums(ClientProxy* client,
+                                            const std::string& service_id,
+                                            const ConnectionOptions& options) {
   std::vector<proto::connections::Medium> mediums_started_successfully;
 
   if (options.allowed.wifi_lan) {
@@ -721,25 +864,12 @@ BasePcpHandler::StartOperationResult P2pClusterPcpHandler::StartDiscoveryImpl(
     }
   }
 
-  if (mediums_started_successfully.empty()) {
-    NEARBY_LOGS(ERROR)
-        << "Failed StartDiscovery() for client=" << client->GetClientId()
-        << " because we couldn't scan on Bluetooth, BLE, or WifiLan for "
-           "service_id="
-        << service_id;
-    return {
-        .status = {Status::kBluetoothError},
-    };
-  }
-
-  return {
-      .status = {Status::kSuccess},
-      .mediums = std::move(mediums_started_successfully),
-  };
+  return mediums_started_successfully;
 }
 
-Status P2pClusterPcpHandler::StopDiscoveryImpl(ClientProxy* client) {
-  wifi_lan_medium_.StopDiscovery(client->GetDiscoveryServiceId());
+void P2pClusterPcpHandler::StopDiscoveryMediums(ClientProxy* client,
+                                                const std::string& service_id) {
+  wifi_lan_medium_.StopDiscovery(service_id);
   if (client->GetClientId() == bluetooth_classic_discoverer_client_id_) {
     bluetooth_medium_.StopDiscovery();
     bluetooth_classic_discoverer_client_id_ = 0;
@@ -750,8 +880,72 @@ Status P2pClusterPcpHandler::StopDiscoveryImpl(ClientProxy* client) {
                       << bluetooth_classic_discoverer_client_id_;
   }
 
-  ble_medium_.StopScanning(client->GetDiscoveryServiceId());
-  return {Status::kSuccess};
+  ble_medium_.StopScanning(service_id);
+}
+
+void P2pClusterPcpHandler::OnNewEndpointDiscovered(ClientProxy* client) {
+  auto item = duty_cycled_discoveries_.find(client);
+  if (item == duty_cycled_discoveries_.end()) return;
+  item->second->scheduler.OnEndpointFound(SystemClock::ElapsedRealtime());
+  UpdateDiscoverySchedule(client);
+}
+
+void P2pClusterPcpHandler::StopDiscoverySchedule(ClientProxy* client) {
+  auto item = duty_cycled_discoveries_.find(client);
+  if (item == duty_cycled_discoveries_.end()) return;
+  item->second->alarm.Cancel();
+  duty_cycled_discoveries_.erase(item);
+}
+
+void P2pClusterPcpHandler::UpdateDiscoverySchedule(ClientProxy* client) {
+  auto item = duty_cycled_discoveries_.find(client);
+  if (item == duty_cycled_discoveries_.end()) return;
+  DutyCycledDiscovery& discovery = *item->second;
+  absl::Time now = SystemClock::ElapsedRealtime();
+  discovery.scheduler.Update(now);
+
+  bool scanning = discovery.scheduler.IsScanning();
+  if (scanning != discovery.mediums_scanning) {
+    NEARBY_LOGS(INFO) << "Discovery duty cycle: "
+                      << (scanning ? "resuming" : "pausing")
+                      << " scans for client="
+                      << discovery.client->GetClientId()
+                      << "; next interval="
+                      << discovery.scheduler.GetInterval();
+    if (scanning) {
+      if (StartDiscoveryMediums(discovery.client, discovery.service_id,
+                                discovery.options)
+              .empty()) {
+        // Left paused; the next window tries again.
+        NEARBY_LOGS(WARNING)
+            << "Discovery duty cycle: couldn't resume scans on Bluetooth, "
+               "BLE, or WifiLan for client="
+            << discovery.client->GetClientId()
+            << "; service_id=" << discovery.service_id;
+      } else {
+        discovery.mediums_scanning = true;
+      }
+    } else {
+      StopDiscoveryMediums(discovery.client, discovery.service_id);
+      discovery.mediums_scanning = false;
+    }
+  }
+
+  discovery.alarm.Cancel();
+  absl::Time next_update_time = discovery.scheduler.GetNextUpdateTime();
+  if (next_update_time == absl::InfiniteFuture()) return;
+  discovery.alarm = CancelableAlarm(
+      "discovery-duty-cycle",
+      [this, client]() {
+        RunOnPcpHandlerThread("discovery-duty-cycle",
+                              [this, client]() RUN_ON_PCP_HANDLER_THREAD() {
+                                // Does nothing if the client stopped
+                                // discovery since the alarm was set.
+                                UpdateDiscoverySchedule(client);
+                              });
+      },
+      std::max(next_update_time - now, absl::ZeroDuration()),
+      &discovery_scheduler_executor_);
 }
 
 Status P2pClusterPcpHandler::InjectEndpointImpl(
@@ -951,9 +1145,11 @@ BasePcpHandler::ConnectImplResult P2pClusterPcpHandler::BluetoothConnectImpl(
                        << endpoint->endpoint_id << ") over Bluetooth Classic.";
   BluetoothDevice& device = endpoint->bluetooth_device;
 
+  TraceSpan connect_span("medium", "bluetooth_connect", endpoint->endpoint_id);
   BluetoothSocket bluetooth_socket = bluetooth_medium_.Connect(
       device, endpoint->service_id,
       client->GetCancellationFlag(endpoint->endpoint_id));
+  connect_span.End();
   if (!bluetooth_socket.IsValid()) {
     NEARBY_LOGS(ERROR)
         << "In BluetoothConnectImpl(), failed to connect to Bluetooth device "
@@ -1180,9 +1376,11 @@ BasePcpHandler::ConnectImplResult P2pClusterPcpHandler::BleConnectImpl(
 
   BlePeripheral& peripheral = endpoint->ble_peripheral;
 
+  TraceSpan connect_span("medium", "ble_connect", endpoint->endpoint_id);
   BleSocket ble_socket =
       ble_medium_.Connect(peripheral, endpoint->service_id,
                           client->GetCancellationFlag(endpoint->endpoint_id));
+  connect_span.End();
   if (!ble_socket.IsValid()) {
     NEARBY_LOGS(ERROR)
         << "In BleConnectImpl(), failed to connect to BLE device "
@@ -1330,9 +1528,11 @@ BasePcpHandler::ConnectImplResult P2pClusterPcpHandler::WifiLanConnectImpl(
   NEARBY_LOGS(INFO) << "Client " << client->GetClientId()
                     << " is attempting to connect to endpoint(id="
                     << endpoint->endpoint_id << ") over WifiLan.";
+  TraceSpan connect_span("medium", "wifi_lan_connect", endpoint->endpoint_id);
   WifiLanSocket socket = wifi_lan_medium_.Connect(
       endpoint->service_id, endpoint->service_info,
       client->GetCancellationFlag(endpoint->endpoint_id));
+  connect_span.End();
   NEARBY_LOGS(ERROR) << "In WifiLanConnectImpl(), connect to service "
                      << " socket=" << &socket.GetImpl()
                      << " for endpoint(id=" << endpoint->endpoint_id << ").";
@@ -16,13 +16,18 @@
 #define CORE_INTERNAL_P2P_CLUSTER_PCP_HANDLER_H_
 
 #include <memory>
+#include <string>
 #include <vector>
 
+#include "absl/container/flat_hash_map.h"
+#include "absl/time/time.h"
 #include "core/internal/base_pcp_handler.h"
 #include "core/internal/ble_advertisement.h"
+#include "core/internal/ble_discovery_batcher.h"
 #include "core/internal/bluetooth_device_name.h"
 #include "core/internal/bwu_manager.h"
 #include "core/internal/client_proxy.h"
+#include "core/internal/discovery_scheduler.h"
 #include "core/internal/endpoint_channel_manager.h"
 #include "core/internal/endpoint_manager.h"
 #include "core/internal/injected_bluetooth_device_store.h"
@@ -41,6 +46,9 @@
 #include "core/strategy.h"
 #include "platform/base/byte_array.h"
 #include "platform/public/bluetooth_classic.h"
+#include "platform/public/cancelable_alarm.h"
+#include "platform/public/mutex.h"
+#include "platform/public/scheduled_executor.h"
 #include "platform/public/wifi_lan.h"
 
 namespace location {
@@ -61,7 +69,7 @@ class P2pClusterPcpHandler : public BasePcpHandler {
       EndpointChannelManager* channel_manager, BwuManager* bwu_manager,
       InjectedBluetoothDeviceStore& injected_bluetooth_device_store,
       Pcp pcp = Pcp::kP2pCluster);
-  ~P2pClusterPcpHandler() override = default;
+  ~P2pClusterPcpHandler() override;
 
  protected:
   std::vector<proto::connections::Medium> GetConnectionMediumsByPriority()
@@ -96,7 +104,30 @@ class P2pClusterPcpHandler : public BasePcpHandler {
       ClientProxy* client,
       BasePcpHandler::DiscoveredEndpoint* endpoint) override;
 
+  // @PCPHandlerThread
+  void OnNewEndpointDiscovered(ClientProxy* client) override;
+
  private:
+  // Discovery that only scans part of the time, following the
+  // ScanDutyCycle in its options.
+  struct DutyCycledDiscovery {
+    DutyCycledDiscovery(ClientProxy* client, std::string service_id,
+                        const ConnectionOptions& options)
+        : client(client),
+          service_id(std::move(service_id)),
+          options(options),
+          scheduler(options.scan_duty_cycle) {}
+
+    ClientProxy* client;
+    std::string service_id;
+    ConnectionOptions options;
+    DiscoveryScheduler scheduler;
+    // StartDiscoveryImpl() starts the mediums along with the scheduler. Stays
+    // false if none of them could resume, so the next window tries again.
+    bool mediums_scanning = true;
+    CancelableAlarm alarm;
+  };
+
   // Holds the state required to re-create a BleEndpoint we see on a
   // BlePeripheral, so BlePeripheralLostHandler can call
   // BasePcpHandler::OnEndpointLost() with the same information as was passed
@@ -121,8 +152,16 @@ class P2pClusterPcpHandler : public BasePcpHandler {
       BleAdvertisement::Version::kV1;
   static constexpr WifiLanServiceInfo::Version kWifiLanServiceInfoVersion =
       WifiLanServiceInfo::Version::kV1;
+  // How long BLE discovery events are batched before they're handed to the
+  // PCP handler thread.
+  static constexpr absl::Duration kBleDiscoveryFlushInterval =
+      absl::Milliseconds(100);
 
   static ByteArray GenerateHash(const std::string& source, size_t size);
+  // Returns the service_id_hash that advertisements for |service_id| carry.
+  // Discovery callbacks need it for every advertisement they see, so it's
+  // only computed once per service_id.
+  ByteArray GetServiceIdHash(const std::string& service_id) const;
   static bool ShouldAdvertiseBluetoothMacOverBle(PowerLevel power_level);
   static bool ShouldAcceptBluetoothConnections(
       const ConnectionOptions& options);
@@ -162,6 +201,16 @@ class P2pClusterPcpHandler : public BasePcpHandler {
                                       bool fast_advertisement);
   void BlePeripheralLostHandler(ClientProxy* client, BlePeripheral& peripheral,
                                 const std::string& service_id);
+  void BleDiscoveryBatchHandler(std::vector<BleDiscoveryBatcher::Event> events);
+  void ProcessBlePeripheralDiscovered(ClientProxy* client,
+                                      BlePeripheral& peripheral,
+                                      const std::string& service_id,
+                                      const ByteArray& advertisement_bytes,
+                                      bool fast_advertisement)
+      RUN_ON_PCP_HANDLER_THREAD();
+  void ProcessBlePeripheralLost(ClientProxy* client, BlePeripheral& peripheral,
+                                const std::string& service_id)
+      RUN_ON_PCP_HANDLER_THREAD();
   proto::connections::Medium StartBleAdvertising(
       ClientProxy* client, const std::string& service_id,
       const std::string& local_endpoint_id,
@@ -194,6 +243,24 @@ class P2pClusterPcpHandler : public BasePcpHandler {
   BasePcpHandler::ConnectImplResult WifiLanConnectImpl(
       ClientProxy* client, WifiLanEndpoint* endpoint);
 
+  // Starts scanning on the allowed mediums, and returns the ones that could.
+  std::vector<proto::connections::Medium> StartDiscoveryMediums(
+      ClientProxy* client, const std::string& service_id,
+      const ConnectionOptions& options) RUN_ON_PCP_HANDLER_THREAD();
+  void StopDiscoveryMediums(ClientProxy* client,
+                            const std::string& service_id)
+      RUN_ON_PCP_HANDLER_THREAD();
+  // Starts or stops the mediums as the scheduler of the duty cycle of
+  // |client| says, and sets the alarm for its next update. Does nothing if
+  // |client| discovers without a duty cycle.
+  void UpdateDiscoverySchedule(ClientProxy* client) RUN_ON_PCP_HANDLER_THREAD();
+  // Drops the duty cycle of |client|, if any.
+  void StopDiscoverySchedule(ClientProxy* client) RUN_ON_PCP_HANDLER_THREAD();
+
+  mutable Mutex service_id_hashes_mutex_;
+  mutable absl::flat_hash_map<std::string, ByteArray> service_id_hashes_
+      ABSL_GUARDED_BY(service_id_hashes_mutex_);
+
   BluetoothRadio& bluetooth_radio_;
   BluetoothClassic& bluetooth_medium_;
   Ble& ble_medium_;
@@ -202,6 +269,11 @@ class P2pClusterPcpHandler : public BasePcpHandler {
   InjectedBluetoothDeviceStore& injected_bluetooth_device_store_;
   std::int64_t bluetooth_classic_discoverer_client_id_{0};
   std::int64_t bluetooth_classic_advertiser_client_id_{0};
+  BleDiscoveryBatcher ble_discovery_batcher_;
+  // Clients discovering with a duty cycle.
+  absl::flat_hash_map<ClientProxy*, std::unique_ptr<DutyCycledDiscovery>>
+      duty_cycled_discoveries_;
+  ScheduledExecutor discovery_scheduler_executor_;
 };
 
 }  // namespace connections
@@ -25,6 +25,7 @@
 #include "platform/base/medium_environment.h"
 #include "platform/public/count_down_latch.h"
 #include "platform/public/logging.h"
+#include "platform/public/system_clock.h"
 
 namespace location {
 namespace nearby {
@@ -156,6 +157,150 @@ TEST_P(P2pClusterPcpHandlerTest, CanDiscover) {
   env_.Stop();
 }
 
+TEST_P(P2pClusterPcpHandlerTest, CanDiscoverWithDutyCycle) {
+  env_.Start();
+  std::string endpoint_name_a{"endpoint_name_a"};
+  std::string endpoint_name_c{"endpoint_name_c"};
+  Mediums mediums_a;
+  Mediums mediums_b;
+  Mediums mediums_c;
+  EndpointChannelManager ecm_a;
+  EndpointChannelManager ecm_b;
+  EndpointChannelManager ecm_c;
+  EndpointManager em_a(&ecm_a);
+  EndpointManager em_b(&ecm_b);
+  EndpointManager em_c(&ecm_c);
+  BwuManager bwu_a(mediums_a, em_a, ecm_a, {}, {});
+  BwuManager bwu_b(mediums_b, em_b, ecm_b, {}, {});
+  BwuManager bwu_c(mediums_c, em_c, ecm_c, {}, {});
+  InjectedBluetoothDeviceStore ibds_a;
+  InjectedBluetoothDeviceStore ibds_b;
+  InjectedBluetoothDeviceStore ibds_c;
+  P2pClusterPcpHandler handler_a(&mediums_a, &em_a, &ecm_a, &bwu_a, ibds_a);
+  P2pClusterPcpHandler handler_b(&mediums_b, &em_b, &ecm_b, &bwu_b, ibds_b);
+  P2pClusterPcpHandler handler_c(&mediums_c, &em_c, &ecm_c, &bwu_c, ibds_c);
+  ClientProxy client_c;
+  // Scans for 200ms out of every 2s.
+  ConnectionOptions discovery_options = options_;
+  discovery_options.scan_duty_cycle = {
+      .scan_window_millis = 200,
+      .scan_interval_millis = 2000,
+      .max_scan_interval_millis = 2000,
+  };
+  CountDownLatch found_a(1);
+  CountDownLatch found_c(1);
+  EXPECT_EQ(
+      handler_a.StartAdvertising(&client_a_, service_id_, options_,
+                                 {.endpoint_info = ByteArray{endpoint_name_a}}),
+      Status{Status::kSuccess});
+  EXPECT_EQ(handler_b.StartDiscovery(
+                &client_b_, service_id_, discovery_options,
+                {
+                    .endpoint_found_cb =
+                        [&](const std::string& endpoint_id,
+                            const ByteArray& endpoint_info,
+                            const std::string& service_id) {
+                          if (endpoint_info == ByteArray{endpoint_name_a}) {
+                            found_a.CountDown();
+                          } else if (endpoint_info ==
+                                     ByteArray{endpoint_name_c}) {
+                            found_c.CountDown();
+                          }
+                        },
+                }),
+            Status{Status::kSuccess});
+  // Found in the first window, which ends 200ms in; the next one starts 2s in.
+  EXPECT_TRUE(found_a.Await(absl::Milliseconds(1000)).result());
+  SystemClock::Sleep(absl::Milliseconds(500));
+
+  // An advertiser that shows up while scans are paused is only found once
+  // they resume.
+  EXPECT_EQ(
+      handler_c.StartAdvertising(&client_c, service_id_, options_,
+                                 {.endpoint_info = ByteArray{endpoint_name_c}}),
+      Status{Status::kSuccess});
+  EXPECT_FALSE(found_c.Await(absl::Milliseconds(1000)).result());
+  EXPECT_TRUE(found_c.Await(absl::Milliseconds(3000)).result());
+
+  handler_b.StopDiscovery(&client_b_);
+  env_.Stop();
+}
+
+TEST_P(P2pClusterPcpHandlerTest, StoppingOtherClientKeepsDutyCycle) {
+  env_.Start();
+  std::string endpoint_name_a{"endpoint_name_a"};
+  std::string endpoint_name_c{"endpoint_name_c"};
+  Mediums mediums_a;
+  Mediums mediums_b;
+  Mediums mediums_c;
+  EndpointChannelManager ecm_a;
+  EndpointChannelManager ecm_b;
+  EndpointChannelManager ecm_c;
+  EndpointManager em_a(&ecm_a);
+  EndpointManager em_b(&ecm_b);
+  EndpointManager em_c(&ecm_c);
+  BwuManager bwu_a(mediums_a, em_a, ecm_a, {}, {});
+  BwuManager bwu_b(mediums_b, em_b, ecm_b, {}, {});
+  BwuManager bwu_c(mediums_c, em_c, ecm_c, {}, {});
+  InjectedBluetoothDeviceStore ibds_a;
+  InjectedBluetoothDeviceStore ibds_b;
+  InjectedBluetoothDeviceStore ibds_c;
+  P2pClusterPcpHandler handler_a(&mediums_a, &em_a, &ecm_a, &bwu_a, ibds_a);
+  P2pClusterPcpHandler handler_b(&mediums_b, &em_b, &ecm_b, &bwu_b, ibds_b);
+  P2pClusterPcpHandler handler_c(&mediums_c, &em_c, &ecm_c, &bwu_c, ibds_c);
+  // Another client of handler_b, discovering another service.
+  ClientProxy client_b2;
+  ClientProxy client_c;
+  // Scans for 200ms out of every 2s.
+  ConnectionOptions discovery_options = options_;
+  discovery_options.scan_duty_cycle = {
+      .scan_window_millis = 200,
+      .scan_interval_millis = 2000,
+      .max_scan_interval_millis = 2000,
+  };
+  CountDownLatch found_a(1);
+  CountDownLatch found_c(1);
+  EXPECT_EQ(
+      handler_a.StartAdvertising(&client_a_, service_id_, options_,
+                                 {.endpoint_info = ByteArray{endpoint_name_a}}),
+      Status{Status::kSuccess});
+  EXPECT_EQ(handler_b.StartDiscovery(
+                &client_b_, service_id_, discovery_options,
+                {
+                    .endpoint_found_cb =
+                        [&](const std::string& endpoint_id,
+                            const ByteArray& endpoint_info,
+                            const std::string& service_id) {
+                          if (endpoint_info == ByteArray{endpoint_name_a}) {
+                            found_a.CountDown();
+                          } else if (endpoint_info ==
+                                     ByteArray{endpoint_name_c}) {
+                            found_c.CountDown();
+                          }
+                        },
+                }),
+            Status{Status::kSuccess});
+  EXPECT_TRUE(found_a.Await(absl::Milliseconds(1000)).result());
+  SystemClock::Sleep(absl::Milliseconds(500));
+
+  // The other client starts and stops discovery while the scans of client_b_
+  // are paused, which leaves the duty cycle of client_b_ alone.
+  EXPECT_EQ(
+      handler_b.StartDiscovery(&client_b2, "other_service", options_, {}),
+      Status{Status::kSuccess});
+  handler_b.StopDiscovery(&client_b2);
+
+  EXPECT_EQ(
+      handler_c.StartAdvertising(&client_c, service_id_, options_,
+                                 {.endpoint_info = ByteArray{endpoint_name_c}}),
+      Status{Status::kSuccess});
+  EXPECT_FALSE(found_c.Await(absl::Milliseconds(1000)).result());
+  EXPECT_TRUE(found_c.Await(absl::Milliseconds(3000)).result());
+
+  handler_b.StopDiscovery(&client_b_);
+  env_.Stop();
+}
+
 TEST_P(P2pClusterPcpHandlerTest, CanConnect) {
   env_.Start();
   std::string endpoint_name_a{"endpoint_name"};
@@ -0,0 +1,258 @@
+// Copyright 2021 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "core/internal/payload_compressor.h"
+
+#include <algorithm>
+#include <array>
+#include <cstring>
+#include <string>
+
+namespace location {
+namespace nearby {
+namespace connections {
+
+namespace {
+
+// LZ4 block format constants.
+constexpr std::size_t kMinMatch = 4;
+// The last 5 bytes of a block are always literals.
+constexpr std::size_t kLastLiterals = 5;
+// The last match must start at least 12 bytes before the end of the block.
+constexpr std::size_t kMatchFindLimit = 12;
+constexpr std::size_t kMaxOffset = 65535;
+constexpr int kHashLog = 12;
+constexpr std::uint8_t kRunMask = 0x0F;
+
+constexpr std::size_t kHeaderSize = sizeof(std::uint32_t);
+
+std::uint32_t Load32(const char* p) {
+  std::uint32_t value;
+  std::memcpy(&value, p, sizeof(value));
+  return value;
+}
+
+std::uint32_t Hash(std::uint32_t sequence) {
+  return (sequence * 2654435761U) >> (32 - kHashLog);
+}
+
+// Appends a length that did not fit into a token nibble.
+void AppendExtraLength(std::size_t length, std::string& out) {
+  while (length >= 255) {
+    out.push_back(static_cast<char>(255));
+    length -= 255;
+  }
+  out.push_back(static_cast<char>(length));
+}
+
+void AppendSequence(const char* literals, std::size_t literal_length,
+                    std::size_t offset, std::size_t match_length,
+                    std::string& out) {
+  std::size_t match_code = match_length - kMinMatch;
+  std::uint8_t token =
+      static_cast<std::uint8_t>(std::min<std::size_t>(literal_length, kRunMask)
+                                << 4) |
+      static_cast<std::uint8_t>(std::min<std::size_t>(match_code, kRunMask));
+  out.push_back(static_cast<char>(token));
+  if (literal_length >= kRunMask) {
+    AppendExtraLength(literal_length - kRunMask, out);
+  }
+  out.append(literals, literal_length);
+  out.push_back(static_cast<char>(offset & 0xFF));
+  out.push_back(static_cast<char>((offset >> 8) & 0xFF));
+  if (match_code >= kRunMask) {
+    AppendExtraLength(match_code - kRunMask, out);
+  }
+}
+
+void AppendLastLiterals(const char* literals, std::size_t literal_length,
+                        std::string& out) {
+  std::uint8_t token = static_cast<std::uint8_t>(
+      std::min<std::size_t>(literal_length, kRunMask) << 4);
+  out.push_back(static_cast<char>(token));
+  if (literal_length >= kRunMask) {
+    AppendExtraLength(literal_length - kRunMask, out);
+  }
+  out.append(literals, literal_length);
+}
+
+// Greedy single-pass LZ4 block compressor; output size is bounded by
+// size + size / 255 + 16.
+void CompressBlock(const char* src, std::size_t size, std::string& out) {
+  std::size_t anchor = 0;
+  if (size > kMatchFindLimit) {
+    std::array<std::uint32_t, 1 << kHashLog> table{};
+    const std::size_t match_start_limit = size - kMatchFindLimit;
+    const std::size_t match_end_limit = size - kLastLiterals;
+    std::size_t pos = 0;
+    while (pos < match_start_limit) {
+      std::uint32_t sequence = Load32(src + pos);
+      std::uint32_t& slot = table[Hash(sequence)];
+      std::size_t candidate = slot;
+      slot = static_cast<std::uint32_t>(pos);
+      if (candidate >= pos || pos - candidate > kMaxOffset ||
+          Load32(src + candidate) != sequence) {
+        // Skip faster over data that does not compress.
+        pos += 1 + ((pos - anchor) >> 6);
+        continue;
+      }
+      std::size_t match_length = kMinMatch;
+      while (pos + match_length < match_end_limit &&
+             src[candidate + match_length] == src[pos + match_length]) {
+        match_length++;
+      }
+      AppendSequence(src + anchor, pos - anchor, pos - candidate, match_length,
+                     out);
+      pos += match_length;
+      anchor = pos;
+    }
+  }
+  AppendLastLiterals(src + anchor, size - anchor, out);
+}
+
+// Reads a length continuation; returns false if input ends prematurely.
+bool ReadExtraLength(const std::uint8_t*& in, const std::uint8_t* in_end,
+                     std::size_t& length) {
+  std::uint8_t byte;
+  do {
+    if (in >= in_end) return false;
+    byte = *in++;
+    length += byte;
+  } while (byte == 255);
+  return true;
+}
+
+bool DecompressBlock(const std::uint8_t* in, const std::uint8_t* in_end,
+                     char* out, std::size_t out_size) {
+  std::size_t out_pos = 0;
+  while (in < in_end) {
+    std::uint8_t token = *in++;
+    std::size_t literal_length = token >> 4;
+    if (literal_length == kRunMask &&
+        !ReadExtraLength(in, in_end, literal_length)) {
+      return false;
+    }
+    if (literal_length > static_cast<std::size_t>(in_end - in) ||
+        literal_length > out_size - out_pos) {
+      return false;
+    }
+    std::memcpy(out + out_pos, in, literal_length);
+    in += literal_length;
+    out_pos += literal_length;
+
+    // The last sequence carries literals only.
+    if (in == in_end) break;
+
+    if (in_end - in < 2) return false;
+    std::size_t offset = in[0] | (in[1] << 8);
+    in += 2;
+    if (offset == 0 || offset > out_pos) return false;
+
+    std::size_t match_length = token & kRunMask;
+    if (match_length == kRunMask &&
+        !ReadExtraLength(in, in_end, match_length)) {
+      return false;
+    }
+    match_length += kMinMatch;
+    if (match_length > out_size - out_pos) return false;
+
+    // Matches may overlap the bytes they produce, so copy byte by byte.
+    const char* match = out + out_pos - offset;
+    for (std::size_t i = 0; i < match_length; i++) {
+      out[out_pos + i] = match[i];
+    }
+    out_pos += match_length;
+  }
+  return out_pos == out_size;
+}
+
+}  // namespace
+
+// C++14 requires to declare this.
+// TODO(apolyudov): remove when migration to c++17 is possible.
+constexpr int PayloadCompressor::kMaxSkippedChunks;
+
+ByteArray PayloadCompressor::Compress(const ByteArray& data) {
+  std::string out;
+  out.reserve(kHeaderSize + data.size() + data.size() / 255 + 16);
+  std::uint32_t size = static_cast<std::uint32_t>(data.size());
+  out.push_back(static_cast<char>((size >> 24) & 0xFF));
+  out.push_back(static_cast<char>((size >> 16) & 0xFF));
+  out.push_back(static_cast<char>((size >> 8) & 0xFF));
+  out.push_back(static_cast<char>(size & 0xFF));
+  CompressBlock(data.data(), data.size(), out);
+  if (out.size() >= data.size()) return {};
+  return ByteArray(std::move(out));
+}
+
+ExceptionOr<ByteArray> PayloadCompressor::Decompress(const ByteArray& data) {
+  if (data.size() <= kHeaderSize) {
+    return ExceptionOr<ByteArray>(Exception::kInvalidProtocolBuffer);
+  }
+  const auto* in = reinterpret_cast<const std::uint8_t*>(data.data());
+  std::size_t size = (static_cast<std::size_t>(in[0]) << 24) |
+                     (static_cast<std::size_t>(in[1]) << 16) |
+                     (static_cast<std::size_t>(in[2]) << 8) |
+                     static_cast<std::size_t>(in[3]);
+  if (size > kMaxDecompressedSize) {
+    return ExceptionOr<ByteArray>(Exception::kInvalidProtocolBuffer);
+  }
+  ByteArray result(size);
+  if (!DecompressBlock(in + kHeaderSize, in + data.size(), result.data(),
+                       size)) {
+    return ExceptionOr<ByteArray>(Exception::kInvalidProtocolBuffer);
+  }
+  return ExceptionOr<ByteArray>(std::move(result));
+}
+
+ByteArray PayloadCompressor::MaybeCompress(const ByteArray& chunk) {
+  if (chunk.size() < kMinCompressibleSize) return {};
+  if (chunks_to_skip_ > 0) {
+    chunks_to_skip_--;
+    return {};
+  }
+
+  // Probe a prefix first, so incompressible chunks cost a few KB of work
+  // rather than a full compression pass.
+  if (chunk.size() > 2 * kSampleSize) {
+    ByteArray sample = Compress(ByteArray(chunk.data(), kSampleSize));
+    if (sample.Empty() || !IsWorthSending(kSampleSize, sample.size())) {
+      OnIncompressibleChunk();
+      return {};
+    }
+  }
+
+  ByteArray compressed = Compress(chunk);
+  if (compressed.Empty() || !IsWorthSending(chunk.size(), compressed.size())) {
+    OnIncompressibleChunk();
+    return {};
+  }
+  skip_backoff_ = 0;
+  return compressed;
+}
+
+bool PayloadCompressor::IsWorthSending(std::size_t original_size,
+                                       std::size_t compressed_size) {
+  return compressed_size * 16 <= original_size * kMaxCompressedSixteenths;
+}
+
+void PayloadCompressor::OnIncompressibleChunk() {
+  skip_backoff_ =
+      skip_backoff_ == 0 ? 1 : std::min(skip_backoff_ * 2, kMaxSkippedChunks);
+  chunks_to_skip_ = skip_backoff_;
+}
+
+}  // namespace connections
+}  // namespace nearby
+}  // namespace location
@@ -0,0 +1,83 @@
+// Copyright 2021 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef CORE_INTERNAL_PAYLOAD_COMPRESSOR_H_
+#define CORE_INTERNAL_PAYLOAD_COMPRESSOR_H_
+
+#include <cstddef>
+#include <cstdint>
+
+#include "platform/base/byte_array.h"
+#include "platform/base/exception.h"
+
+namespace location {
+namespace nearby {
+namespace connections {
+
+// Compresses PayloadChunk bodies for endpoints that advertised support for
+// payload compression in their ConnectionRequestFrame/ConnectionResponseFrame.
+//
+// Compressed bodies are a 4-byte big-endian length of the original data,
+// followed by a single LZ4 block (https://github.com/lz4/lz4, block format).
+//
+// An instance keeps the adaptive state of a single outgoing payload and must
+// not be shared between payloads; it is not thread safe.
+class PayloadCompressor {
+ public:
+  // Chunks smaller than this are never compressed; the framing overhead eats
+  // the savings.
+  static constexpr std::size_t kMinCompressibleSize = 64;
+  // Upper bound of a decompressed chunk; protects the reader from inputs that
+  // claim absurd original sizes.
+  static constexpr std::size_t kMaxDecompressedSize = 1048576;  // 1MB
+  // How many bytes of a chunk are test-compressed before committing to the
+  // whole chunk.
+  static constexpr std::size_t kSampleSize = 4096;
+  // Compressed output must be at most this fraction of the input (in 1/16th)
+  // to be worth sending.
+  static constexpr std::size_t kMaxCompressedSixteenths = 14;
+  // Upper bound on the number of chunks skipped after an incompressible one.
+  static constexpr int kMaxSkippedChunks = 64;
+
+  // Returns |data| compressed, or an empty ByteArray if the compressed form
+  // is not smaller than the input.
+  static ByteArray Compress(const ByteArray& data);
+
+  // Returns the original data, or Exception::kInvalidProtocolBuffer if |data|
+  // is not a well-formed compressed body.
+  static ExceptionOr<ByteArray> Decompress(const ByteArray& data);
+
+  // Returns the compressed body for |chunk|, or an empty ByteArray if the
+  // chunk should go out uncompressed.
+  //
+  // Content that is already compressed (media, archives) is detected by
+  // compressing a sample of the chunk first. After an incompressible chunk,
+  // compression is skipped for an exponentially growing number of chunks, so
+  // the sender does not keep paying for a doomed attempt on every chunk.
+  ByteArray MaybeCompress(const ByteArray& chunk);
+
+ private:
+  static bool IsWorthSending(std::size_t original_size,
+                             std::size_t compressed_size);
+  void OnIncompressibleChunk();
+
+  int chunks_to_skip_ = 0;
+  int skip_backoff_ = 0;
+};
+
+}  // namespace connections
+}  // namespace nearby
+}  // namespace location
+
+#endif  // CORE_INTERNAL_PAYLOAD_COMPRESSOR_H_
@@ -0,0 +1,144 @@
+// Copyright 2021 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "core/internal/payload_compressor.h"
+
+#include <random>
+#include <string>
+
+#include "gtest/gtest.h"
+#include "absl/strings/str_cat.h"
+
+namespace location {
+namespace nearby {
+namespace connections {
+namespace {
+
+ByteArray MakeText(size_t size) {
+  std::string text;
+  int i = 0;
+  while (text.size() < size) {
+    absl::StrAppend(&text, "{\"id\":", i++,
+                    ",\"name\":\"nearby\",\"ok\":true}");
+  }
+  text.resize(size);
+  return ByteArray(std::move(text));
+}
+
+ByteArray MakeRandom(size_t size) {
+  std::mt19937 rng(42);
+  std::string data(size, '\0');
+  for (auto& c : data) c = static_cast<char>(rng());
+  return ByteArray(std::move(data));
+}
+
+TEST(PayloadCompressorTest, CompressesAndDecompressesText) {
+  ByteArray text = MakeText(32 * 1024);
+
+  ByteArray compressed = PayloadCompressor::Compress(text);
+
+  ASSERT_FALSE(compressed.Empty());
+  EXPECT_LT(compressed.size(), text.size() / 4);
+  ExceptionOr<ByteArray> decompressed =
+      PayloadCompressor::Decompress(compressed);
+  ASSERT_TRUE(decompressed.ok());
+  EXPECT_EQ(decompressed.result(), text);
+}
+
+TEST(PayloadCompressorTest, RoundTripsLongRunsAndShortInputs) {
+  for (size_t size : {20, 100, 300, 70000}) {
+    ByteArray data(std::string(size, 'a'));
+
+    ByteArray compressed = PayloadCompressor::Compress(data);
+
+    ASSERT_FALSE(compressed.Empty()) << size;
+    ExceptionOr<ByteArray> decompressed =
+        PayloadCompressor::Decompress(compressed);
+    ASSERT_TRUE(decompressed.ok()) << size;
+    EXPECT_EQ(decompressed.result(), data) << size;
+  }
+}
+
+TEST(PayloadCompressorTest, CompressReturnsEmptyForRandomData) {
+  EXPECT_TRUE(PayloadCompressor::Compress(MakeRandom(4096)).Empty());
+}
+
+TEST(PayloadCompressorTest, DecompressRejectsMalformedInput) {
+  ByteArray compressed = PayloadCompressor::Compress(MakeText(4096));
+  ASSERT_FALSE(compressed.Empty());
+
+  // Truncated.
+  EXPECT_FALSE(PayloadCompressor::Decompress(
+                   ByteArray(compressed.data(), compressed.size() - 3))
+                   .ok());
+  // Header only.
+  EXPECT_FALSE(
+      PayloadCompressor::Decompress(ByteArray(compressed.data(), 4)).ok());
+  // Wrong original size.
+  ByteArray wrong_size = compressed;
+  wrong_size.data()[3] ^= 0x01;
+  EXPECT_FALSE(PayloadCompressor::Decompress(wrong_size).ok());
+  // Absurd original size.
+  ByteArray too_big = compressed;
+  too_big.data()[0] = 0x7F;
+  EXPECT_FALSE(PayloadCompressor::Decompress(too_big).ok());
+}
+
+TEST(PayloadCompressorTest, DecompressNeverCrashesOnGarbage) {
+  ByteArray garbage = MakeRandom(2048);
+  // Claim a plausible size so the block decoder is exercised.
+  garbage.data()[0] = 0;
+  garbage.data()[1] = 0;
+  garbage.data()[2] = 0x10;
+  garbage.data()[3] = 0;
+
+  EXPECT_FALSE(PayloadCompressor::Decompress(garbage).ok());
+}
+
+TEST(PayloadCompressorTest, MaybeCompressSkipsSmallChunks) {
+  PayloadCompressor compressor;
+
+  EXPECT_TRUE(
+      compressor.MaybeCompress(ByteArray(std::string(32, 'a'))).Empty());
+}
+
+TEST(PayloadCompressorTest, MaybeCompressBacksOffOnIncompressibleData) {
+  PayloadCompressor compressor;
+  ByteArray text = MakeText(16 * 1024);
+  ByteArray random = MakeRandom(16 * 1024);
+
+  EXPECT_FALSE(compressor.MaybeCompress(text).Empty());
+  EXPECT_TRUE(compressor.MaybeCompress(random).Empty());
+  // The next chunk is skipped even though it would compress well.
+  EXPECT_TRUE(compressor.MaybeCompress(text).Empty());
+  EXPECT_FALSE(compressor.MaybeCompress(text).Empty());
+}
+
+TEST(PayloadCompressorTest, MaybeCompressBackoffGrowsExponentially) {
+  PayloadCompressor compressor;
+  ByteArray text = MakeText(16 * 1024);
+  ByteArray random = MakeRandom(16 * 1024);
+
+  EXPECT_TRUE(compressor.MaybeCompress(random).Empty());  // Skip 1.
+  EXPECT_TRUE(compressor.MaybeCompress(text).Empty());
+  EXPECT_TRUE(compressor.MaybeCompress(random).Empty());  // Skip 2.
+  EXPECT_TRUE(compressor.MaybeCompress(text).Empty());
+  EXPECT_TRUE(compressor.MaybeCompress(text).Empty());
+  EXPECT_FALSE(compressor.MaybeCompress(text).Empty());
+}
+
+}  // namespace
+}  // namespace connections
+}  // namespace nearby
+}  // namespace location
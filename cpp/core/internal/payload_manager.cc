@@ -23,6 +23,7 @@
 #include "absl/memory/memory.h"
 #include "absl/strings/str_cat.h"
 #include "absl/time/time.h"
+#include "core/internal/content_hasher.h"
 #include "core/internal/internal_payload_factory.h"
 #include "platform/public/count_down_latch.h"
 #include "platform/public/mutex_lock.h"
@@ -36,6 +37,37 @@ namespace connections {
 // C++14 requires to declare this.
 // TODO(apolyudov): remove when migration to c++17 is possible.
 constexpr const absl::Duration PayloadManager::kWaitCloseTimeout;
+constexpr int PayloadManager::kMaxConcurrentChunks;
+
+namespace {
+
+// Returns the content hash of |file|, read from its current position to the
+// end, or an empty ByteArray if reading fails.
+ByteArray HashFile(InputFile& file) {
+  ContentHasher hasher;
+  while (true) {
+    ExceptionOr<ByteArray> bytes = file.Read(ContentHasher::kBlockSize);
+    if (!bytes.ok()) return {};
+    if (bytes.result().Empty()) return hasher.GetHash();
+    hasher.Update(bytes.result());
+  }
+}
+
+// Whether incoming file payloads are completed from, and added to, the
+// ContentCache.
+bool IsContentCacheEnabled() {
+  const FeatureFlags::Flags& flags = FeatureFlags::GetInstance().GetFlags();
+  return flags.enable_payload_content_dedup &&
+         flags.enable_shared_payload_content_cache;
+}
+
+// Scopes ContentCache entries to the local client. Endpoint IDs are random
+// per session, so they can't tell whether content came from the same peer.
+std::string GetContentCacheScope(ClientProxy* client) {
+  return absl::StrCat(client->GetClientId());
+}
+
+}  // namespace
 
 bool PayloadManager::SendPayloadLoop(
     ClientProxy* client, PendingPayload& pending_payload,
@@ -49,9 +81,15 @@ bool PayloadManager::SendPayloadLoop(
 
   // First, handle any non-available endpoints.
   for (const auto& endpoint : unavailable_endpoints) {
+    proto::connections::PayloadStatus status =
+        EndpointInfoStatusToPayloadStatus(endpoint->status.Get());
+    // Endpoints that already had the content got all of it.
     HandleFinishedOutgoingPayload(
-        client, {endpoint->id}, payload_header, next_chunk_offset,
-        EndpointInfoStatusToPayloadStatus(endpoint->status.Get()));
+        client, {endpoint->id}, payload_header,
+        status == proto::connections::PayloadStatus::SUCCESS
+            ? payload_header.total_size()
+            : next_chunk_offset,
+        status);
   }
 
   // Update the still-active recipients of this payload.
@@ -109,6 +147,7 @@ bool PayloadManager::SendPayloadLoop(
   ByteArray next_chunk =
       pending_payload.GetInternalPayload()->DetachNextChunk(chunk_size);
   if (shutdown_.Get()) return false;
+  absl::Time chunk_start_time = SystemClock::ElapsedRealtime();
   // Save chunk size. We'll need it after we move next_chunk.
   auto next_chunk_size = next_chunk.size();
   if (!next_chunk_size &&
@@ -127,10 +166,45 @@ bool PayloadManager::SendPayloadLoop(
   // used to decide if the received chunk is the initial payload chunk.
   // In other cases, the offset should only be used in both side logs when error
   // happened.
+  bool add_checksums =
+      FeatureFlags::GetInstance().GetFlags().enable_payload_chunk_checksums;
+  if (add_checksums) pending_payload.ExtendDigest(next_chunk);
+  bool is_compressed = false;
+  if (next_chunk_size &&
+      CanCompressPayloadChunks(client, available_endpoint_ids)) {
+    ByteArray compressed_chunk =
+        pending_payload.GetCompressor().MaybeCompress(next_chunk);
+    if (!compressed_chunk.Empty()) {
+      next_chunk = std::move(compressed_chunk);
+      is_compressed = true;
+    }
+  }
+  if (!next_chunk_size && !payload_header.has_content_hash()) {
+    // Once a file has been read in full its content hash is known, so the
+    // receivers can cache the content for later sends.
+    ByteArray content_hash =
+        pending_payload.GetInternalPayload()->GetContentHash();
+    if (!content_hash.Empty()) {
+      payload_header.set_content_hash(std::string(content_hash));
+    }
+  }
   PayloadTransferFrame::PayloadChunk payload_chunk(CreatePayloadChunk(
       next_chunk_offset - resume_offset, std::move(next_chunk)));
+  if (is_compressed) {
+    payload_chunk.set_flags(payload_chunk.flags() |
+                            PayloadTransferFrame::PayloadChunk::COMPRESSED);
+  }
+  if (add_checksums) {
+    payload_chunk.set_crc32c(Crc32c::Value(payload_chunk.body().data(),
+                                           payload_chunk.body().size()));
+    if (!next_chunk_size) {
+      payload_chunk.set_payload_crc32c(pending_payload.GetDigest());
+    }
+  }
   const EndpointIds& failed_endpoint_ids = endpoint_manager_->SendPayloadChunk(
       payload_header, payload_chunk, available_endpoint_ids);
+  outgoing_chunk_latency_->Record(SystemClock::ElapsedRealtime() -
+                                  chunk_start_time);
   // Check whether at least one endpoint failed.
   if (!failed_endpoint_ids.empty()) {
     NEARBY_LOGS(INFO) << "Payload xfer: endpoints failed: payload_id="
@@ -150,7 +224,7 @@ bool PayloadManager::SendPayloadLoop(
                     endpoint_id) == failed_endpoint_ids.end()) {
         HandleSuccessfulOutgoingChunk(
             client, endpoint_id, payload_header, payload_chunk.flags(),
-            payload_chunk.offset(), payload_chunk.body().size());
+            payload_chunk.offset(), next_chunk_size);
       }
     }
     NEARBY_LOGS(VERBOSE) << "PayloadManager done sending chunk at offset "
@@ -247,6 +321,8 @@ std::string PayloadManager::ToString(EndpointInfo::Status status) {
       return std::string("Cancelled");
     case EndpointInfo::Status::kError:
       return std::string("Error");
+    case EndpointInfo::Status::kContentPresent:
+      return std::string("ContentPresent");
     case EndpointInfo::Status::kUnknown:
       return std::string("Unknown");
   }
@@ -287,6 +363,7 @@ void PayloadManager::CancelAllPayloads() {
       shutdown_barrier_ =
           absl::make_unique<CountDownLatch>(pending_outgoing_payloads);
     }
+    ResumeParkedPayloadsLocked();
   }
 
   if (shutdown_barrier_) {
@@ -309,9 +386,18 @@ PayloadManager::~PayloadManager() {
   CancelAllPayloads();
   NEARBY_LOG(INFO, "PayloadManager: turn down payload executors; self=%p",
              this);
-  bytes_payload_executor_.Shutdown();
+  content_hash_executor_.Shutdown();
+  scheduled_payload_executor_.Shutdown();
+  chunk_send_executor_.Shutdown();
   stream_payload_executor_.Shutdown();
-  file_payload_executor_.Shutdown();
+  // A copy from the content cache stops once it sees |shutdown_|; wait for
+  // that, since it uses a pending payload that is about to go away.
+  CountDownLatch content_cache_latch(1);
+  content_cache_executor_.Execute(
+      "~payload-manager",
+      [&content_cache_latch]() { content_cache_latch.CountDown(); });
+  content_cache_latch.Await();
+  content_cache_executor_.Shutdown();
 
   CountDownLatch stop_latch(1);
   // Clear our tracked pending payloads.
@@ -382,61 +468,233 @@ void PayloadManager::SendPayload(ClientProxy* client,
     return;
   }
 
-  // Each payload is sent in FCFS order within each Payload type, blocking any
-  // other payload of the same type from even starting until this one is
-  // completely done with. If we ever want to provide isolation across
-  // ClientProxy objects this will need to be significantly re-architected.
+  // Stream payloads block while waiting for data, so each one owns the stream
+  // executor until it is done. Bytes and file payloads are interleaved chunk
+  // by chunk by |payload_scheduler_|, so no payload has to wait for another
+  // one to finish, and their chunks are read and sent by a pool of chunk
+  // senders, so a slow endpoint doesn't hold up the others.
   Payload::Type payload_type = payload.GetType();
+  Payload::Priority priority = payload.GetPriority();
   size_t resume_offset =
       FeatureFlags::GetInstance().GetFlags().enable_send_payload_offset
           ? payload.GetOffset()
           : 0;
+  std::string content_key;
+  PayloadId file_id = 0;
+  if (payload_type == Payload::Type::kFile && resume_offset == 0 &&
+      FeatureFlags::GetInstance().GetFlags().enable_payload_content_dedup) {
+    content_key =
+        absl::StrCat(payload.AsFile()->GetFilePath(), ":", payload_total_size);
+    file_id = payload.AsFile()->GetPayloadId();
+  }
 
   Payload::Id payload_id =
       CreateOutgoingPayload(std::move(payload), endpoint_ids);
-  executor->Execute(
-      "send-payload", [this, client, endpoint_ids, payload_id, payload_type,
-                       resume_offset, payload_total_size]() {
-        if (shutdown_.Get()) return;
-        PendingPayload* pending_payload = GetPayload(payload_id);
-        if (!pending_payload) {
-          RecordInvalidPayloadAnalytics(client, endpoint_ids, payload_id,
-                                        payload_type, resume_offset,
-                                        payload_total_size);
-          NEARBY_LOGS(INFO)
-              << "PayloadManager failed to create InternalPayload for outgoing "
-                 "payload_id="
-              << payload_id << ", payload_type=" << ToString(payload_type)
-              << ", aborting sendPayload().";
-          return;
-        }
-        auto* internal_payload = pending_payload->GetInternalPayload();
-        if (!internal_payload) return;
-
-        RecordPayloadStartedAnalytics(client, endpoint_ids, payload_id,
-                                      payload_type, resume_offset,
-                                      internal_payload->GetTotalSize());
-
-        PayloadTransferFrame::PayloadHeader payload_header{
-            CreatePayloadHeader(*internal_payload, resume_offset)};
-        bool should_continue = true;
-        std::int64_t next_chunk_offset = 0;
-        while (should_continue && !shutdown_.Get()) {
-          should_continue =
-              SendPayloadLoop(client, *pending_payload, payload_header,
-                              next_chunk_offset, resume_offset);
-        }
-        RunOnStatusUpdateThread("destroy-payload",
-                                [this, payload_id]()
-                                    RUN_ON_PAYLOAD_STATUS_UPDATE_THREAD() {
-                                      DestroyPendingPayload(payload_id);
-                                    });
-      });
+  OutgoingPayload outgoing_payload;
+  outgoing_payload.client = client;
+  outgoing_payload.endpoint_ids = endpoint_ids;
+  outgoing_payload.type = payload_type;
+  outgoing_payload.priority = priority;
+  outgoing_payload.resume_offset = resume_offset;
+  outgoing_payload.total_size = payload_total_size;
+  outgoing_payload.content_key = std::move(content_key);
+  outgoing_payload.file_id = file_id;
+  if (payload_type == Payload::Type::kStream) {
+    executor->Execute("send-payload",
+                      [this, payload_id, outgoing_payload]() mutable {
+                        if (shutdown_.Get()) return;
+                        while (SendNextOutgoingChunk(payload_id,
+                                                     outgoing_payload)) {
+                        }
+                        FinishOutgoingPayload(payload_id, outgoing_payload);
+                      });
+  } else {
+    bool sent_before = false;
+    if (!outgoing_payload.content_key.empty()) {
+      MutexLock lock(&mutex_);
+      sent_before = sent_content_keys_.contains(outgoing_payload.content_key);
+    }
+    if (sent_before) {
+      // The file may have changed since it was last sent, so it's hashed
+      // afresh rather than advertising the hash of an earlier send. That reads
+      // all of it, so it's done before the payload is scheduled, off the
+      // executor that sends the chunks of all other payloads.
+      content_hash_executor_.Execute(
+          "hash-payload", [this, payload_id, outgoing_payload]() mutable {
+            if (shutdown_.Get()) return;
+            InputFile file(outgoing_payload.file_id,
+                           outgoing_payload.total_size);
+            outgoing_payload.content_hash = HashFile(file);
+            file.Close();
+            ScheduleOutgoingPayload(payload_id, std::move(outgoing_payload));
+          });
+    } else {
+      ScheduleOutgoingPayload(payload_id, std::move(outgoing_payload));
+    }
+  }
   NEARBY_LOGS(INFO) << "PayloadManager: xfer scheduled: self=" << this
                     << "; payload_id=" << payload_id
                     << ", payload_type=" << ToString(payload_type);
 }
 
+bool PayloadManager::SendNextOutgoingChunk(Payload::Id payload_id,
+                                           OutgoingPayload& outgoing_payload) {
+  if (shutdown_.Get()) return false;
+  PendingPayload* pending_payload = GetPayload(payload_id);
+  if (!outgoing_payload.started) {
+    if (!pending_payload) {
+      RecordInvalidPayloadAnalytics(
+          outgoing_payload.client, outgoing_payload.endpoint_ids, payload_id,
+          outgoing_payload.type, outgoing_payload.resume_offset,
+          outgoing_payload.total_size);
+      NEARBY_LOGS(INFO)
+          << "PayloadManager failed to create InternalPayload for outgoing "
+             "payload_id="
+          << payload_id << ", payload_type=" << ToString(outgoing_payload.type)
+          << ", aborting sendPayload().";
+      return false;
+    }
+    auto* internal_payload = pending_payload->GetInternalPayload();
+    if (!internal_payload) return false;
+
+    RecordPayloadStartedAnalytics(
+        outgoing_payload.client, outgoing_payload.endpoint_ids, payload_id,
+        outgoing_payload.type, outgoing_payload.resume_offset,
+        internal_payload->GetTotalSize());
+    outgoing_payload.payload_header =
+        CreatePayloadHeader(*internal_payload, outgoing_payload.resume_offset);
+    if (!outgoing_payload.content_hash.Empty()) {
+      outgoing_payload.payload_header.set_content_hash(
+          std::string(outgoing_payload.content_hash));
+    }
+    outgoing_payload.started = true;
+  }
+  if (!pending_payload) return false;
+
+  return SendPayloadLoop(outgoing_payload.client, *pending_payload,
+                         outgoing_payload.payload_header,
+                         outgoing_payload.next_chunk_offset,
+                         outgoing_payload.resume_offset);
+}
+
+void PayloadManager::ScheduleOutgoingPayload(
+    Payload::Id payload_id, OutgoingPayload outgoing_payload) {
+  {
+    MutexLock lock(&mutex_);
+    payload_scheduler_.Add(payload_id, outgoing_payload.priority);
+    scheduled_payloads_.emplace(
+        payload_id,
+        absl::make_unique<OutgoingPayload>(std::move(outgoing_payload)));
+  }
+  scheduled_payload_executor_.Execute(
+      "send-payload", [this]() { RunScheduledOutgoingPayloads(); });
+}
+
+void PayloadManager::FinishOutgoingPayload(
+    Payload::Id payload_id, const OutgoingPayload& outgoing_payload) {
+  if (!outgoing_payload.started) return;
+  PendingPayload* pending_payload = GetPayload(payload_id);
+  if (pending_payload && !outgoing_payload.content_key.empty() &&
+      !pending_payload->GetInternalPayload()->GetContentHash().Empty()) {
+    // The file was read in full and its receivers got its hash, so the next
+    // send of it is worth hashing up front.
+    MutexLock lock(&mutex_);
+    if (sent_content_keys_.size() >= ContentCache::kDefaultMaxEntries) {
+      sent_content_keys_.erase(sent_content_keys_.begin());
+    }
+    sent_content_keys_.insert(outgoing_payload.content_key);
+  }
+  RunOnStatusUpdateThread(
+      "destroy-payload",
+      [this, payload_id]() RUN_ON_PAYLOAD_STATUS_UPDATE_THREAD() {
+        DestroyPendingPayload(payload_id);
+      });
+}
+
+void PayloadManager::RunScheduledOutgoingPayloads() {
+  MutexLock lock(&mutex_);
+  // Payloads that have to wait for a chunk of another payload to one of their
+  // endpoints. They keep their place for when it is done.
+  std::vector<Payload::Id> waiting_payload_ids;
+  while (chunks_sending_ < kMaxConcurrentChunks &&
+         !payload_scheduler_.IsEmpty()) {
+    Payload::Id payload_id = payload_scheduler_.Next();
+    OutgoingPayload* outgoing_payload = scheduled_payloads_[payload_id].get();
+    // Sending to endpoints whose rate limit holds data back would only wait
+    // for them, and hold up a chunk sender. The payload sits out until one of
+    // them catches up. Checked under |mutex_|, so that OnSendBacklogCleared()
+    // can't come in before it is parked.
+    PendingPayload* pending_payload = pending_payloads_.GetPayload(payload_id);
+    if (outgoing_payload->started && pending_payload &&
+        !pending_payload->IsLocallyCanceled() &&
+        endpoint_manager_->IsSendBacklogged(outgoing_payload->endpoint_ids)) {
+      payload_scheduler_.Remove(payload_id);
+      parked_payloads_.insert(payload_id);
+      continue;
+    }
+
+    payload_scheduler_.Hold(payload_id);
+    bool endpoint_busy = false;
+    for (const std::string& endpoint_id : outgoing_payload->endpoint_ids) {
+      endpoint_busy |= endpoints_sending_.contains(endpoint_id);
+    }
+    if (endpoint_busy) {
+      waiting_payload_ids.push_back(payload_id);
+      continue;
+    }
+    for (const std::string& endpoint_id : outgoing_payload->endpoint_ids) {
+      endpoints_sending_.insert(endpoint_id);
+    }
+    chunks_sending_++;
+    chunk_send_executor_.Execute(
+        "send-payload-chunk", [this, payload_id, outgoing_payload]() {
+          SendScheduledChunk(payload_id, outgoing_payload);
+        });
+  }
+  for (Payload::Id payload_id : waiting_payload_ids) {
+    payload_scheduler_.Release(payload_id);
+  }
+}
+
+void PayloadManager::SendScheduledChunk(Payload::Id payload_id,
+                                        OutgoingPayload* outgoing_payload) {
+  // The payload is held on |payload_scheduler_| until this is done, and only
+  // this removes it, so |outgoing_payload| stays valid and no other chunk of
+  // it is sent in the meantime.
+  std::int64_t chunk_offset = outgoing_payload->next_chunk_offset;
+  bool should_continue = SendNextOutgoingChunk(payload_id, *outgoing_payload);
+
+  if (!should_continue) FinishOutgoingPayload(payload_id, *outgoing_payload);
+
+  {
+    MutexLock lock(&mutex_);
+    for (const std::string& endpoint_id : outgoing_payload->endpoint_ids) {
+      endpoints_sending_.erase(endpoint_id);
+    }
+    chunks_sending_--;
+    if (should_continue) {
+      payload_scheduler_.OnChunkSent(
+          payload_id, outgoing_payload->next_chunk_offset - chunk_offset);
+    } else {
+      payload_scheduler_.Remove(payload_id);
+      scheduled_payloads_.erase(payload_id);
+    }
+  }
+  scheduled_payload_executor_.Execute(
+      "send-payload", [this]() { RunScheduledOutgoingPayloads(); });
+}
+
+void PayloadManager::ResumeParkedPayloadsLocked() {
+  if (parked_payloads_.empty()) return;
+  for (Payload::Id payload_id : parked_payloads_) {
+    payload_scheduler_.Add(payload_id,
+                           scheduled_payloads_[payload_id]->priority);
+  }
+  parked_payloads_.clear();
+  scheduled_payload_executor_.Execute(
+      "send-payload", [this]() { RunScheduledOutgoingPayloads(); });
+}
+
 PayloadManager::PendingPayload* PayloadManager::GetPayload(
     Payload::Id payload_id) const {
   MutexLock lock(&mutex_);
@@ -454,6 +712,11 @@ Status PayloadManager::CancelPayload(ClientProxy* client,
 
   // Mark the payload as canceled.
   canceled_payload->MarkLocallyCanceled();
+  {
+    // A parked payload has to run to notice.
+    MutexLock lock(&mutex_);
+    ResumeParkedPayloadsLocked();
+  }
   NEARBY_LOGS(INFO) << "Cancelling "
                     << (canceled_payload->IsIncoming() ? "incoming"
                                                        : "outgoing")
@@ -488,6 +751,11 @@ void PayloadManager::OnIncomingFrame(
   }
 }
 
+void PayloadManager::OnSendBacklogCleared(const std::string& endpoint_id) {
+  MutexLock lock(&mutex_);
+  ResumeParkedPayloadsLocked();
+}
+
 void PayloadManager::OnEndpointDisconnect(ClientProxy* client,
                                           const std::string& endpoint_id,
                                           CountDownLatch barrier) {
@@ -539,6 +807,8 @@ void PayloadManager::OnEndpointDisconnect(ClientProxy* client,
                     proto::connections::ENDPOINT_IO_ERROR);
               }
             }
+            // Payloads parked for this endpoint's backlog go on without it.
+            ResumeParkedPayloadsLocked();
 
             barrier.CountDown();
           });
@@ -552,6 +822,7 @@ PayloadManager::EndpointInfoStatusToPayloadStatus(EndpointInfo::Status status) {
     case EndpointInfo::Status::kError:
       return proto::connections::PayloadStatus::REMOTE_ERROR;
     case EndpointInfo::Status::kAvailable:
+    case EndpointInfo::Status::kContentPresent:
       return proto::connections::PayloadStatus::SUCCESS;
     default:
       NEARBY_LOGS(INFO) << "PayloadManager: Unknown PayloadStatus";
@@ -590,9 +861,8 @@ SingleThreadExecutor* PayloadManager::GetOutgoingPayloadExecutor(
     Payload::Type payload_type) {
   switch (payload_type) {
     case Payload::Type::kBytes:
-      return &bytes_payload_executor_;
     case Payload::Type::kFile:
-      return &file_payload_executor_;
+      return &scheduled_payload_executor_;
     case Payload::Type::kStream:
       return &stream_payload_executor_;
     default:
@@ -609,6 +879,19 @@ int PayloadManager::GetOptimalChunkSize(EndpointIds endpoint_ids) {
   return minChunkSize;
 }
 
+bool PayloadManager::CanCompressPayloadChunks(
+    ClientProxy* client, const EndpointIds& endpoint_ids) {
+  if (!FeatureFlags::GetInstance().GetFlags().enable_payload_compression) {
+    return false;
+  }
+  for (const auto& endpoint_id : endpoint_ids) {
+    if (!client->IsRemotePayloadCompressionSupported(endpoint_id)) {
+      return false;
+    }
+  }
+  return true;
+}
+
 PayloadTransferFrame::PayloadHeader PayloadManager::CreatePayloadHeader(
     const InternalPayload& internal_payload, size_t offset) {
   PayloadTransferFrame::PayloadHeader payload_header;
@@ -777,6 +1060,7 @@ void PayloadManager::HandleFinishedOutgoingPayload(
         endpoint_manager_->DiscardEndpoint(client, endpoint_id);
       }
       break;
+    case proto::connections::PayloadStatus::SUCCESS:
     case proto::connections::PayloadStatus::REMOTE_ERROR:
     case proto::connections::PayloadStatus::REMOTE_CANCELLATION:
       // No special handling needed for these.
@@ -935,6 +1219,7 @@ void PayloadManager::ProcessDataPacket(
       *payload_transfer_frame.mutable_payload_header();
   PayloadTransferFrame::PayloadChunk& payload_chunk =
       *payload_transfer_frame.mutable_payload_chunk();
+  absl::Time chunk_start_time = SystemClock::ElapsedRealtime();
   NEARBY_LOGS(VERBOSE) << "PayloadManager got data OfflineFrame for payload_id="
                        << payload_header.id()
                        << " from endpoint_id=" << from_endpoint_id
@@ -991,6 +1276,16 @@ void PayloadManager::ProcessDataPacket(
     }
   }
 
+  if (pending_payload->IsCompletingFromCache()) {
+    // The sender stops once it gets PAYLOAD_CONTENT_PRESENT, but chunks it
+    // sent before then are still on their way. The payload doesn't need them.
+    NEARBY_LOGS(VERBOSE) << "ProcessDataPacket: [cache: drop] endpoint_id="
+                         << from_endpoint_id
+                         << "; payload_id=" << pending_payload->GetId()
+                         << "; offset=" << payload_chunk.offset();
+    return;
+  }
+
   if (pending_payload->IsLocallyCanceled()) {
     // This incoming payload was canceled by the client. Drop this frame and do
     // all the cleanup. See go/nc-cancel-payload
@@ -1011,10 +1306,60 @@ void PayloadManager::ProcessDataPacket(
   pending_payload->SetOffsetForEndpoint(from_endpoint_id,
                                         payload_chunk.offset());
 
+  if (payload_chunk.offset() == 0 && payload_header.has_content_hash() &&
+      IsContentCacheEnabled() &&
+      CompleteFromContentCache(to_client, from_endpoint_id, payload_header,
+                               *pending_payload)) {
+    return;
+  }
+
+  if (payload_chunk.has_crc32c() &&
+      Crc32c::Value(payload_chunk.body().data(), payload_chunk.body().size()) !=
+          payload_chunk.crc32c()) {
+    NEARBY_LOGS(ERROR) << "ProcessDataPacket: [checksum: mismatch] endpoint_id="
+                       << from_endpoint_id
+                       << "; payload_id=" << pending_payload->GetId()
+                       << "; offset=" << payload_chunk.offset();
+    HandleFinishedIncomingPayload(
+        to_client, from_endpoint_id, payload_header, payload_chunk.offset(),
+        proto::connections::PayloadStatus::LOCAL_ERROR);
+    return;
+  }
+
+  ByteArray payload_body(std::move(*payload_chunk.mutable_body()));
+  if (payload_chunk.flags() & PayloadTransferFrame::PayloadChunk::COMPRESSED) {
+    ExceptionOr<ByteArray> decompressed =
+        PayloadCompressor::Decompress(payload_body);
+    if (!decompressed.ok()) {
+      NEARBY_LOGS(ERROR)
+          << "ProcessDataPacket: [decompress: error] endpoint_id="
+          << from_endpoint_id << "; payload_id=" << pending_payload->GetId();
+      HandleFinishedIncomingPayload(
+          to_client, from_endpoint_id, payload_header, payload_chunk.offset(),
+          proto::connections::PayloadStatus::LOCAL_ERROR);
+      return;
+    }
+    payload_body = std::move(decompressed.result());
+  }
+
+  if (payload_chunk.has_crc32c()) {
+    pending_payload->ExtendDigest(payload_body);
+  }
+  if (payload_chunk.has_payload_crc32c() &&
+      pending_payload->GetDigest() != payload_chunk.payload_crc32c()) {
+    NEARBY_LOGS(ERROR)
+        << "ProcessDataPacket: [checksum: payload mismatch] endpoint_id="
+        << from_endpoint_id << "; payload_id=" << pending_payload->GetId();
+    HandleFinishedIncomingPayload(
+        to_client, from_endpoint_id, payload_header, payload_chunk.offset(),
+        proto::connections::PayloadStatus::LOCAL_ERROR);
+    return;
+  }
+
   // Save size of packet before we move it.
-  std::int64_t payload_body_size = payload_chunk.body().size();
+  std::int64_t payload_body_size = payload_body.size();
   if (pending_payload->GetInternalPayload()
-          ->AttachNextChunk(ByteArray(std::move(*payload_chunk.mutable_body())))
+          ->AttachNextChunk(std::move(payload_body))
           .Raised()) {
     NEARBY_LOGS(ERROR) << "ProcessDataPacket: [data: error] endpoint_id="
                        << from_endpoint_id
@@ -1025,11 +1370,142 @@ void PayloadManager::ProcessDataPacket(
     return;
   }
 
+  bool is_last_chunk = (payload_chunk.flags() &
+                        PayloadTransferFrame::PayloadChunk::LAST_CHUNK) != 0;
+  if (is_last_chunk && payload_header.has_content_hash() &&
+      IsContentCacheEnabled()) {
+    // Only cache content that matches the hash the sender claimed for it, so
+    // a bad sender can't plant content under somebody else's hash.
+    ByteArray content_hash =
+        pending_payload->GetInternalPayload()->GetContentHash();
+    if (!content_hash.Empty() &&
+        content_hash == ByteArray(payload_header.content_hash())) {
+      content_cache_.Add(GetContentCacheScope(to_client), content_hash,
+                         payload_header.id(), payload_header.total_size());
+    }
+  }
+
+  incoming_chunk_latency_->Record(SystemClock::ElapsedRealtime() -
+                                  chunk_start_time);
   HandleSuccessfulIncomingChunk(to_client, from_endpoint_id, payload_header,
                                 payload_chunk.flags(), payload_chunk.offset(),
                                 payload_body_size);
 }
 
+bool PayloadManager::CompleteFromContentCache(
+    ClientProxy* client, const std::string& endpoint_id,
+    const PayloadTransferFrame::PayloadHeader& payload_header,
+    PendingPayload& pending_payload) {
+  const std::string scope = GetContentCacheScope(client);
+  ByteArray content_hash(payload_header.content_hash());
+  std::unique_ptr<InputFile> cached_file =
+      content_cache_.Open(scope, content_hash);
+  if (!cached_file) return false;
+  if (cached_file->GetTotalSize() != payload_header.total_size()) {
+    NEARBY_LOGS(INFO) << "PayloadManager dropping stale ContentCache entry "
+                         "for payload_id="
+                      << payload_header.id();
+    content_cache_.Remove(scope, content_hash);
+    return false;
+  }
+
+  // Done in the same step as deciding to use the cache, so that no chunk of
+  // this payload is processed after this one.
+  pending_payload.MarkCompletingFromCache();
+  content_cache_executor_.Execute(
+      "complete-from-content-cache",
+      [this, client, endpoint_id, payload_header]() {
+        CopyFromContentCache(client, endpoint_id, payload_header);
+      });
+  return true;
+}
+
+// @PayloadManagerContentCacheThread
+void PayloadManager::CopyFromContentCache(
+    ClientProxy* client, const std::string& endpoint_id,
+    const PayloadTransferFrame::PayloadHeader& payload_header) {
+  // Nothing else destroys a payload that is completing from the cache, so
+  // |pending_payload| stays valid until this returns.
+  PendingPayload* pending_payload = GetPayload(payload_header.id());
+  if (shutdown_.Get() || !pending_payload) return;
+
+  // The application may have changed or removed the cached file since it was
+  // received, so it is hashed while being copied, and the payload only
+  // succeeds if it still holds the content. Chunks of the payload have been
+  // dropped already, so there is nothing to fall back to.
+  const std::string scope = GetContentCacheScope(client);
+  ByteArray content_hash(payload_header.content_hash());
+  std::unique_ptr<InputFile> cached_file =
+      content_cache_.Open(scope, content_hash);
+  if (!cached_file) {
+    HandleFinishedIncomingPayload(
+        client, endpoint_id, payload_header, 0,
+        proto::connections::PayloadStatus::LOCAL_ERROR);
+    return;
+  }
+
+  InternalPayload* internal_payload = pending_payload->GetInternalPayload();
+  ContentHasher hasher;
+  std::int64_t offset = 0;
+  while (true) {
+    if (shutdown_.Get()) return;
+    if (pending_payload->IsLocallyCanceled()) {
+      HandleFinishedIncomingPayload(
+          client, endpoint_id, payload_header, offset,
+          proto::connections::PayloadStatus::LOCAL_CANCELLATION);
+      return;
+    }
+    EndpointInfo::Status status =
+        pending_payload->GetEndpointStatus(endpoint_id);
+    if (status == EndpointInfo::Status::kUnknown) {
+      // The endpoint disconnected; OnEndpointDisconnect() told the client.
+      return;
+    }
+    if (status != EndpointInfo::Status::kAvailable) {
+      HandleFinishedIncomingPayload(client, endpoint_id, payload_header,
+                                    offset,
+                                    EndpointInfoStatusToPayloadStatus(status));
+      return;
+    }
+
+    ExceptionOr<ByteArray> bytes = cached_file->Read(ContentHasher::kBlockSize);
+    if (!bytes.ok() ||
+        internal_payload->AttachNextChunk(bytes.result()).Raised()) {
+      NEARBY_LOGS(ERROR) << "CopyFromContentCache: [cache: error] endpoint_id="
+                         << endpoint_id
+                         << "; payload_id=" << payload_header.id();
+      HandleFinishedIncomingPayload(
+          client, endpoint_id, payload_header, offset,
+          proto::connections::PayloadStatus::LOCAL_ERROR);
+      return;
+    }
+    if (bytes.result().Empty()) break;
+    hasher.Update(bytes.result());
+    offset += bytes.result().size();
+    pending_payload->SetOffsetForEndpoint(endpoint_id, offset);
+  }
+  if (hasher.GetHash() != content_hash) {
+    NEARBY_LOGS(INFO) << "PayloadManager dropping stale ContentCache entry "
+                         "for payload_id="
+                      << payload_header.id();
+    content_cache_.Remove(scope, content_hash);
+    HandleFinishedIncomingPayload(
+        client, endpoint_id, payload_header, offset,
+        proto::connections::PayloadStatus::LOCAL_ERROR);
+    return;
+  }
+
+  NEARBY_LOGS(INFO) << "PayloadManager completed payload_id="
+                    << payload_header.id() << " from endpoint_id="
+                    << endpoint_id << " with cached content";
+  SendControlMessage(
+      {endpoint_id}, payload_header, payload_header.total_size(),
+      PayloadTransferFrame::ControlMessage::PAYLOAD_CONTENT_PRESENT);
+  SendClientCallbacksForFinishedIncomingPayload(
+      client, endpoint_id, payload_header, payload_header.total_size(),
+      proto::connections::PayloadStatus::SUCCESS);
+}
+
 // @EndpointManagerDataPool
 void PayloadManager::ProcessControlPacket(
     ClientProxy* to_client, const std::string& from_endpoint_id,
@@ -1048,7 +1524,11 @@ void PayloadManager::ProcessControlPacket(
 
   switch (control_message.event()) {
     case PayloadTransferFrame::ControlMessage::PAYLOAD_CANCELED:
-      if (pending_payload->IsIncoming()) {
+      if (pending_payload->IsCompletingFromCache()) {
+        // CopyFromContentCache() finishes the payload once it sees this.
+        pending_payload->SetEndpointStatusFromControlMessage(from_endpoint_id,
+                                                             control_message);
+      } else if (pending_payload->IsIncoming()) {
         NEARBY_LOGS(INFO) << "Incoming PAYLOAD_CANCELED: from endpoint_id="
                           << from_endpoint_id << "; self=" << this;
         // No need to mark the pending payload as cancelled, since this is a
@@ -1072,7 +1552,11 @@ void PayloadManager::ProcessControlPacket(
           << " as canceled at request of endpoint_id=" << from_endpoint_id;
       break;
     case PayloadTransferFrame::ControlMessage::PAYLOAD_ERROR:
-      if (pending_payload->IsIncoming()) {
+      if (pending_payload->IsCompletingFromCache()) {
+        // CopyFromContentCache() finishes the payload once it sees this.
+        pending_payload->SetEndpointStatusFromControlMessage(from_endpoint_id,
+                                                             control_message);
+      } else if (pending_payload->IsIncoming()) {
         HandleFinishedIncomingPayload(
             to_client, from_endpoint_id, payload_header,
             control_message.offset(),
@@ -1082,6 +1566,20 @@ void PayloadManager::ProcessControlPacket(
                                                              control_message);
       }
       break;
+    case PayloadTransferFrame::ControlMessage::PAYLOAD_CONTENT_PRESENT:
+      if (pending_payload->IsIncoming()) {
+        NEARBY_LOGS(WARNING) << "Ignoring PAYLOAD_CONTENT_PRESENT for incoming "
+                                "payload_id="
+                             << payload_header.id();
+      } else {
+        NEARBY_LOGS(INFO)
+            << "Outgoing PAYLOAD_CONTENT_PRESENT: from endpoint_id="
+            << from_endpoint_id << "; payload_id=" << payload_header.id();
+        // The endpoint is done with this payload; the send loop reports it.
+        pending_payload->SetEndpointStatusFromControlMessage(from_endpoint_id,
+                                                             control_message);
+      }
+      break;
     default:
       NEARBY_LOGS(INFO) << "Unhandled control message "
                         << control_message.event() << " for payload_id="
@@ -1143,6 +1641,8 @@ PayloadManager::EndpointInfo::ControlMessageEventToEndpointInfoStatus(
       return Status::kError;
     case PayloadTransferFrame::ControlMessage::PAYLOAD_CANCELED:
       return Status::kCanceled;
+    case PayloadTransferFrame::ControlMessage::PAYLOAD_CONTENT_PRESENT:
+      return Status::kContentPresent;
     default:
       NEARBY_LOGS(INFO)
           << "Unknown EndpointInfo.Status for ControlMessage.EventType "
@@ -1195,6 +1695,14 @@ void PayloadManager::PendingPayload::MarkLocallyCanceled() {
   is_locally_canceled_.Set(true);
 }
 
+bool PayloadManager::PendingPayload::IsCompletingFromCache() const {
+  return is_completing_from_cache_.Get();
+}
+
+void PayloadManager::PendingPayload::MarkCompletingFromCache() {
+  is_completing_from_cache_.Set(true);
+}
+
 bool PayloadManager::PendingPayload::IsIncoming() const { return is_incoming_; }
 
 std::vector<const PayloadManager::EndpointInfo*>
@@ -1220,6 +1728,19 @@ PayloadManager::EndpointInfo* PayloadManager::PendingPayload::GetEndpoint(
   return &it->second;
 }
 
+PayloadManager::EndpointInfo::Status
+PayloadManager::PendingPayload::GetEndpointStatus(
+    const std::string& endpoint_id) const {
+  MutexLock lock(&mutex_);
+
+  auto it = endpoints_.find(endpoint_id);
+  if (it == endpoints_.end()) {
+    return EndpointInfo::Status::kUnknown;
+  }
+
+  return it->second.status.Get();
+}
+
 void PayloadManager::PendingPayload::RemoveEndpoints(
     const EndpointIds& endpoint_ids) {
   MutexLock lock(&mutex_);
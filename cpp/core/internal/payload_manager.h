@@ -21,16 +21,23 @@
 #include <vector>
 
 #include "absl/container/flat_hash_map.h"
+#include "absl/container/flat_hash_set.h"
 #include "core/internal/client_proxy.h"
 #include "core/internal/endpoint_manager.h"
 #include "core/internal/internal_payload.h"
+#include "core/internal/payload_compressor.h"
+#include "core/internal/payload_scheduler.h"
 #include "core/listeners.h"
 #include "core/payload.h"
 #include "core/status.h"
 #include "platform/base/byte_array.h"
+#include "platform/base/crc32c.h"
 #include "platform/public/atomic_boolean.h"
 #include "platform/public/atomic_reference.h"
 #include "platform/public/count_down_latch.h"
+#include "platform/public/file.h"
+#include "platform/public/metrics_registry.h"
+#include "platform/public/multi_thread_executor.h"
 #include "platform/public/mutex.h"
 
 namespace location {
@@ -47,6 +54,8 @@ class PayloadManager : public EndpointManager::FrameProcessor {
   using EndpointIds = std::vector<std::string>;
   constexpr static const absl::Duration kWaitCloseTimeout =
       absl::Milliseconds(5000);
+  // Most chunks of bytes and file payloads being read and sent at a time.
+  constexpr static int kMaxConcurrentChunks = 4;
 
   explicit PayloadManager(EndpointManager& endpoint_manager);
   ~PayloadManager() override;
@@ -65,6 +74,9 @@ class PayloadManager : public EndpointManager::FrameProcessor {
   void OnEndpointDisconnect(ClientProxy* client, const std::string& endpoint_id,
                             CountDownLatch barrier) override;
 
+  // @EndpointManagerRateLimitedWriterThread
+  void OnSendBacklogCleared(const std::string& endpoint_id) override;
+
   void DisconnectFromEndpointManager();
 
  private:
@@ -76,6 +88,8 @@ class PayloadManager : public EndpointManager::FrameProcessor {
       kAvailable,
       kCanceled,
       kError,
+      // The endpoint already had the content of the payload.
+      kContentPresent,
     };
 
     void SetStatusFromControlMessage(
@@ -103,8 +117,24 @@ class PayloadManager : public EndpointManager::FrameProcessor {
 
     InternalPayload* GetInternalPayload();
 
+    // Returns the compression state of an outgoing payload. Only accessed by
+    // the thread that runs SendPayloadLoop() for this payload.
+    PayloadCompressor& GetCompressor() { return compressor_; }
+
+    // Running CRC-32C over the uncompressed bytes sent or received so far.
+    // Only accessed by the thread that sends or receives this payload.
+    void ExtendDigest(const ByteArray& data) {
+      digest_ = Crc32c::Extend(digest_, data);
+    }
+    std::uint32_t GetDigest() const { return digest_; }
+
     bool IsLocallyCanceled() const;
     void MarkLocallyCanceled();
+    // Set once an incoming payload is being completed from the content cache.
+    // Its chunks are dropped from then on, and only the task copying the
+    // cached content finishes it.
+    bool IsCompletingFromCache() const;
+    void MarkCompletingFromCache();
     bool IsIncoming() const;
 
     // Gets the EndpointInfo objects for the endpoints (still) associated with
@@ -115,6 +145,11 @@ class PayloadManager : public EndpointManager::FrameProcessor {
     // endpoint is not associated with this payload.
     EndpointInfo* GetEndpoint(const std::string& endpoint_id)
         ABSL_LOCKS_EXCLUDED(mutex_);
+    // Returns the status of a given endpoint, or kUnknown if the endpoint is
+    // not associated with this payload. Safe to call while the endpoint may be
+    // removed concurrently.
+    EndpointInfo::Status GetEndpointStatus(const std::string& endpoint_id) const
+        ABSL_LOCKS_EXCLUDED(mutex_);
 
     // Removes the given endpoints, e.g. on error.
     void RemoveEndpoints(const EndpointIds& endpoint_ids_to_remove)
@@ -144,8 +179,11 @@ class PayloadManager : public EndpointManager::FrameProcessor {
     mutable Mutex mutex_;
     bool is_incoming_;
     AtomicBoolean is_locally_canceled_{false};
+    AtomicBoolean is_completing_from_cache_{false};
     CountDownLatch close_event_{1};
     std::unique_ptr<InternalPayload> internal_payload_;
+    PayloadCompressor compressor_;
+    std::uint32_t digest_ = 0;
     absl::flat_hash_map<std::string, EndpointInfo> endpoints_
         ABSL_GUARDED_BY(mutex_);
   };
@@ -171,6 +209,28 @@ class PayloadManager : public EndpointManager::FrameProcessor {
         pending_payloads_ ABSL_GUARDED_BY(mutex_);
   };
 
+  // Progress of an outgoing payload between two chunks; owned by the executor
+  // that sends it.
+  struct OutgoingPayload {
+    ClientProxy* client = nullptr;
+    EndpointIds endpoint_ids;
+    Payload::Type type = Payload::Type::kUnknown;
+    Payload::Priority priority = Payload::Priority::kNormal;
+    size_t resume_offset = 0;
+    std::int64_t total_size = 0;
+    bool started = false;
+    PayloadTransferFrame::PayloadHeader payload_header;
+    std::int64_t next_chunk_offset = 0;
+    // Identifies the file of a file payload across sends, for looking it up
+    // in |sent_content_keys_|; empty if not deduplicated.
+    std::string content_key;
+    // Opens the file again, for hashing it before it is sent.
+    PayloadId file_id = 0;
+    // Hash of the file, advertised from the first chunk on; empty if the
+    // file wasn't sent before.
+    ByteArray content_hash;
+  };
+
   using Endpoints = std::vector<const EndpointInfo*>;
   static std::string ToString(const EndpointIds& endpoint_ids);
   static std::string ToString(const Endpoints& endpoints);
@@ -190,6 +250,30 @@ class PayloadManager : public EndpointManager::FrameProcessor {
   bool SendPayloadLoop(ClientProxy* client, PendingPayload& pending_payload,
                        PayloadTransferFrame::PayloadHeader& payload_header,
                        std::int64_t& next_chunk_offset, size_t resume_offset);
+  // Sends the next chunk of an outgoing payload, starting the payload first if
+  // this is its first chunk. Returns false once there is nothing left to send.
+  bool SendNextOutgoingChunk(Payload::Id payload_id,
+                             OutgoingPayload& outgoing_payload);
+  // Hands a bytes or file payload to |payload_scheduler_|, and runs it.
+  void ScheduleOutgoingPayload(Payload::Id payload_id,
+                               OutgoingPayload outgoing_payload)
+      ABSL_LOCKS_EXCLUDED(mutex_);
+  void FinishOutgoingPayload(Payload::Id payload_id,
+                             const OutgoingPayload& outgoing_payload);
+  // Hands the next chunks of scheduled payloads, in the order picked by
+  // |payload_scheduler_|, to |chunk_send_executor_|. Only one chunk is sent
+  // to an endpoint at a time, so a slow endpoint ties up one chunk sender at
+  // most.
+  void RunScheduledOutgoingPayloads() ABSL_LOCKS_EXCLUDED(mutex_);
+  // Sends the next chunk of a scheduled payload, and runs the scheduler
+  // again.
+  //
+  // @PayloadManagerChunkSendThread
+  void SendScheduledChunk(Payload::Id payload_id,
+                          OutgoingPayload* outgoing_payload)
+      ABSL_LOCKS_EXCLUDED(mutex_);
+  // Puts |parked_payloads_| back on |payload_scheduler_|, and runs it.
+  void ResumeParkedPayloadsLocked() ABSL_EXCLUSIVE_LOCKS_REQUIRED(mutex_);
   void SendClientCallbacksForFinishedIncomingPayloadRunnable(
       ClientProxy* client, const std::string& endpoint_id,
       const PayloadTransferFrame::PayloadHeader& payload_header,
@@ -209,6 +293,11 @@ class PayloadManager : public EndpointManager::FrameProcessor {
       proto::connections::PayloadStatus status);
 
   int GetOptimalChunkSize(EndpointIds endpoint_ids);
+  // Returns true if payload chunks may be compressed, i.e. compression is
+  // enabled locally and every endpoint announced that it can read compressed
+  // chunks.
+  bool CanCompressPayloadChunks(ClientProxy* client,
+                                const EndpointIds& endpoint_ids);
 
   PayloadTransferFrame::PayloadHeader CreatePayloadHeader(
       const InternalPayload& payload, size_t offset);
@@ -263,6 +352,20 @@ class PayloadManager : public EndpointManager::FrameProcessor {
       std::int32_t payload_chunk_flags, std::int64_t payload_chunk_offset,
       std::int64_t payload_chunk_body_size);
 
+  // Starts completing a new incoming file payload from |content_cache_|, if
+  // it holds the content named by the payload header. Returns true if the
+  // payload is handled that way, and its chunks must not be processed.
+  bool CompleteFromContentCache(
+      ClientProxy* client, const std::string& endpoint_id,
+      const PayloadTransferFrame::PayloadHeader& payload_header,
+      PendingPayload& pending_payload);
+  // Copies the cached content into the payload, verifying it on the way, then
+  // finishes the payload. Runs on |content_cache_executor_|, so that reading
+  // and hashing files does not hold up the endpoint's reader thread.
+  void CopyFromContentCache(
+      ClientProxy* client, const std::string& endpoint_id,
+      const PayloadTransferFrame::PayloadHeader& payload_header);
+
   void ProcessDataPacket(ClientProxy* to_client,
                          const std::string& from_endpoint_id,
                          PayloadTransferFrame& payload_transfer_frame);
@@ -307,10 +410,40 @@ class PayloadManager : public EndpointManager::FrameProcessor {
   std::unique_ptr<CountDownLatch> shutdown_barrier_;
   int send_payload_count_ = 0;
   PendingPayloads pending_payloads_ ABSL_GUARDED_BY(mutex_);
-  SingleThreadExecutor bytes_payload_executor_;
-  SingleThreadExecutor file_payload_executor_;
-  SingleThreadExecutor stream_payload_executor_;
-  SingleThreadExecutor payload_status_update_executor_;
+  // Bytes and file payloads waiting to send their next chunk.
+  PayloadScheduler payload_scheduler_ ABSL_GUARDED_BY(mutex_);
+  absl::flat_hash_map<Payload::Id, std::unique_ptr<OutgoingPayload>>
+      scheduled_payloads_ ABSL_GUARDED_BY(mutex_);
+  // Chunks handed to |chunk_send_executor_| and not sent yet, and the
+  // endpoints they go to.
+  int chunks_sending_ ABSL_GUARDED_BY(mutex_) = 0;
+  absl::flat_hash_set<std::string> endpoints_sending_ ABSL_GUARDED_BY(mutex_);
+  // Payloads of |scheduled_payloads_| taken off |payload_scheduler_| while
+  // the send rate limits of all their endpoints hold data back.
+  absl::flat_hash_set<Payload::Id> parked_payloads_ ABSL_GUARDED_BY(mutex_);
+  // Files sent in full earlier, by OutgoingPayload::content_key. Their
+  // receivers may have cached them, so they are hashed before being sent
+  // again.
+  absl::flat_hash_set<std::string> sent_content_keys_ ABSL_GUARDED_BY(mutex_);
+  // Files received earlier, for completing repeated incoming file payloads.
+  ContentCache content_cache_;
+  // Time to prepare and send an outgoing chunk to all its endpoints, not
+  // counting waiting for stream data; and to store an incoming chunk.
+  std::shared_ptr<Histogram> outgoing_chunk_latency_ =
+      MetricsRegistry::GetInstance().GetHistogram(
+          "payload_manager/outgoing_chunk_us");
+  std::shared_ptr<Histogram> incoming_chunk_latency_ =
+      MetricsRegistry::GetInstance().GetHistogram(
+          "payload_manager/incoming_chunk_us");
+  SingleThreadExecutor scheduled_payload_executor_{
+      "payload_manager_scheduled"};
+  MultiThreadExecutor chunk_send_executor_{kMaxConcurrentChunks,
+                                           "payload_manager_chunk_send"};
+  SingleThreadExecutor stream_payload_executor_{"payload_manager_stream"};
+  SingleThreadExecutor content_hash_executor_{"payload_manager_content_hash"};
+  SingleThreadExecutor content_cache_executor_{"payload_manager_content_cache"};
+  SingleThreadExecutor payload_status_update_executor_{
+      "payload_manager_status_update"};
 
   EndpointManager* endpoint_manager_;
 };
@@ -14,19 +14,43 @@
 
 #include "core/internal/payload_manager.h"
 
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
 #include "gmock/gmock.h"
 #include "gtest/gtest.h"
 #include "absl/strings/string_view.h"
+#include "absl/synchronization/mutex.h"
+#include "core/internal/content_hasher.h"
+#include "core/internal/endpoint_channel.h"
+#include "core/internal/endpoint_channel_manager.h"
+#include "core/internal/endpoint_manager.h"
+#include "core/internal/offline_frames.h"
 #include "core/internal/simulation_user.h"
 #include "platform/base/byte_array.h"
+#include "platform/base/feature_flags.h"
+#include "platform/public/count_down_latch.h"
+#include "platform/public/file.h"
 #include "platform/public/pipe.h"
 #include "platform/public/system_clock.h"
+#include "proto/connections_enums.pb.h"
 
 namespace location {
 namespace nearby {
 namespace connections {
 namespace {
 
+using ::location::nearby::proto::connections::DisconnectionReason;
+using ::location::nearby::proto::connections::Medium;
+using ::testing::Contains;
+using ::testing::ElementsAre;
+using ::testing::NiceMock;
+using ::testing::Not;
+using ::testing::Pair;
+using ::testing::Return;
+
 constexpr absl::string_view kServiceId = "service-id";
 constexpr absl::string_view kDeviceA = "device-a";
 constexpr absl::string_view kDeviceB = "device-b";
@@ -367,6 +391,358 @@ TEST_P(PayloadManagerTest, SendPayloadWithSkip_StreamPayload) {
 INSTANTIATE_TEST_SUITE_P(ParametrisedPayloadManagerTest, PayloadManagerTest,
                          ::testing::ValuesIn(kTestCases));
 
+class MockEndpointChannel : public EndpointChannel {
+ public:
+  MOCK_METHOD(ExceptionOr<ByteArray>, Read, (), (override));
+  MOCK_METHOD(Exception, Write, (const ByteArray& data), (override));
+  MOCK_METHOD(void, Close, (), (override));
+  MOCK_METHOD(void, Close, (DisconnectionReason reason), (override));
+  MOCK_METHOD(proto::connections::ConnectionTechnology, GetTechnology, (),
+              (const override));
+  MOCK_METHOD(proto::connections::ConnectionBand, GetBand, (),
+              (const override));
+  MOCK_METHOD(int, GetFrequency, (), (const override));
+  MOCK_METHOD(int, GetTryCount, (), (const override));
+  MOCK_METHOD(std::string, GetType, (), (const override));
+  MOCK_METHOD(std::string, GetName, (), (const override));
+  MOCK_METHOD(Medium, GetMedium, (), (const override));
+  MOCK_METHOD(int, GetMaxTransmitPacketSize, (), (const override));
+  MOCK_METHOD(void, EnableEncryption,
+              (std::shared_ptr<EncryptionContext> context), (override));
+  MOCK_METHOD(void, EnableDataFrameCipher,
+              (std::shared_ptr<DataFrameCipher> cipher), (override));
+  MOCK_METHOD(void, DisableEncryption, (), (override));
+  MOCK_METHOD(bool, IsPaused, (), (const override));
+  MOCK_METHOD(void, Pause, (), (override));
+  MOCK_METHOD(void, Resume, (), (override));
+  MOCK_METHOD(absl::Time, GetLastReadTimestamp, (), (const override));
+  MOCK_METHOD(absl::Time, GetLastWriteTimestamp, (), (const override));
+  MOCK_METHOD(void, SetAnalyticsRecorder,
+              (analytics::AnalyticsRecorder*, const std::string&), (override));
+};
+
+// Hands incoming frames straight to PayloadManager, the way the reader thread
+// of an endpoint does, and records the control messages sent back to it.
+class PayloadManagerContentCacheTest : public ::testing::Test {
+ protected:
+  using Finished = std::pair<Payload::Id, PayloadProgressInfo::Status>;
+
+  PayloadManagerContentCacheTest() {
+    FeatureFlags::Flags feature_flags;
+    feature_flags.enable_payload_content_dedup = true;
+    feature_flags.enable_shared_payload_content_cache = true;
+    env_.SetFeatureFlags(feature_flags);
+
+    auto channel = std::make_unique<NiceMock<MockEndpointChannel>>();
+    ON_CALL(*channel, Read()).WillByDefault([this]() {
+      read_done_.Await();
+      return ExceptionOr<ByteArray>(Exception::kIo);
+    });
+    ON_CALL(*channel, Write).WillByDefault([this](const ByteArray& data) {
+      OnWrite(data);
+      return Exception{Exception::kSuccess};
+    });
+    ON_CALL(*channel, GetMedium()).WillByDefault(Return(Medium::BLE));
+    ON_CALL(*channel, GetLastReadTimestamp())
+        .WillByDefault(Return(SystemClock::ElapsedRealtime()));
+    ON_CALL(*channel, GetLastWriteTimestamp())
+        .WillByDefault(Return(SystemClock::ElapsedRealtime()));
+    CountDownLatch registered(1);
+    em_.RegisterEndpoint(
+        &client_, std::string(kDeviceB),
+        {.remote_endpoint_info = ByteArray{"info"},
+         .is_incoming_connection = true},
+        {.keep_alive_interval_millis = 5000,
+         .keep_alive_timeout_millis = 30000},
+        std::move(channel),
+        {.initiated_cb = [&registered](const std::string& endpoint_id,
+                                       const ConnectionResponseInfo& info) {
+           registered.CountDown();
+         }},
+        "conntokn");
+    EXPECT_TRUE(registered.Await(kDefaultTimeout).result());
+    client_.LocalEndpointAcceptedConnection(
+        std::string(kDeviceB),
+        {.payload_cb =
+             [this](const std::string& endpoint_id, Payload payload) {
+               if (payload.GetId() == held_payload_id_) release_.Await();
+             },
+         .payload_progress_cb =
+             [this](const std::string& endpoint_id,
+                    const PayloadProgressInfo& info) {
+               if (info.status == PayloadProgressInfo::Status::kInProgress) {
+                 return;
+               }
+               {
+                 absl::MutexLock lock(&mutex_);
+                 finished_.emplace_back(info.payload_id, info.status);
+               }
+               payloads_finished_.CountDown();
+             }});
+    client_.RemoteEndpointAcceptedConnection(std::string(kDeviceB));
+    client_.OnConnectionAccepted(std::string(kDeviceB));
+  }
+  ~PayloadManagerContentCacheTest() override {
+    release_.CountDown();
+    read_done_.CountDown();
+    env_.SetFeatureFlags(FeatureFlags::Flags());
+  }
+
+  // Passes one chunk of the file payload |payload_id| to PayloadManager.
+  void ReceiveChunk(Payload::Id payload_id, const ByteArray& contents,
+                    std::int64_t offset, std::int64_t size,
+                    const ByteArray& content_hash, bool last_chunk = false) {
+    PayloadTransferFrame::PayloadHeader header;
+    header.set_id(payload_id);
+    header.set_type(PayloadTransferFrame::PayloadHeader::FILE);
+    header.set_total_size(contents.size());
+    if (!content_hash.Empty()) {
+      header.set_content_hash(std::string(content_hash));
+    }
+    PayloadTransferFrame::PayloadChunk chunk;
+    chunk.set_offset(offset);
+    chunk.set_body(std::string(contents.data() + offset, size));
+    chunk.set_flags(last_chunk ? PayloadTransferFrame::PayloadChunk::LAST_CHUNK
+                               : 0);
+    OfflineFrame frame =
+        parser::FromBytes(parser::ForDataPayloadTransfer(header, chunk))
+            .result();
+    pm_.OnIncomingFrame(frame, std::string(kDeviceB), &client_, Medium::BLE);
+  }
+
+  std::vector<Finished> GetFinished() {
+    absl::MutexLock lock(&mutex_);
+    return finished_;
+  }
+
+  std::vector<PayloadTransferFrame::ControlMessage::EventType>
+  GetControlEvents() {
+    absl::MutexLock lock(&mutex_);
+    return control_events_;
+  }
+
+  // The client callback for the first chunk of this payload blocks the status
+  // update thread until |release_| counts down.
+  Payload::Id held_payload_id_ = 0;
+  CountDownLatch release_{1};
+  CountDownLatch content_present_{1};
+  CountDownLatch payloads_finished_{2};
+
+ private:
+  void OnWrite(const ByteArray& data) {
+    ExceptionOr<OfflineFrame> frame = parser::FromBytes(data);
+    if (!frame.ok() ||
+        parser::GetFrameType(frame.result()) != V1Frame::PAYLOAD_TRANSFER) {
+      return;
+    }
+    const PayloadTransferFrame& payload_transfer =
+        frame.result().v1().payload_transfer();
+    if (payload_transfer.packet_type() != PayloadTransferFrame::CONTROL) {
+      return;
+    }
+    PayloadTransferFrame::ControlMessage::EventType event =
+        payload_transfer.control_message().event();
+    {
+      absl::MutexLock lock(&mutex_);
+      control_events_.push_back(event);
+    }
+    if (event ==
+        PayloadTransferFrame::ControlMessage::PAYLOAD_CONTENT_PRESENT) {
+      content_present_.CountDown();
+    }
+  }
+
+  MediumEnvironment& env_{MediumEnvironment::Instance()};
+  CountDownLatch read_done_{1};
+  absl::Mutex mutex_;
+  std::vector<PayloadTransferFrame::ControlMessage::EventType> control_events_
+      ABSL_GUARDED_BY(mutex_);
+  std::vector<Finished> finished_ ABSL_GUARDED_BY(mutex_);
+  ClientProxy client_;
+  EndpointChannelManager ecm_;
+  EndpointManager em_{&ecm_};
+  PayloadManager pm_{em_};
+};
+
+TEST_F(PayloadManagerContentCacheTest, DropsChunksAfterContentPresent) {
+  const ByteArray contents("0123456789");
+  ContentHasher hasher;
+  hasher.Update(contents);
+  const ByteArray content_hash = hasher.GetHash();
+  Payload::Id first_id = Payload::GenerateId();
+  ReceiveChunk(first_id, contents, 0, 4, ByteArray());
+  ReceiveChunk(first_id, contents, 4, 6, ByteArray());
+  ReceiveChunk(first_id, contents, 10, 0, content_hash, /*last_chunk=*/true);
+
+  // The sender keeps sending chunks of the repeated payload until it gets
+  // PAYLOAD_CONTENT_PRESENT, so some arrive after that has been sent, while
+  // the payload is still being finished.
+  Payload::Id second_id = Payload::GenerateId();
+  held_payload_id_ = second_id;
+  ReceiveChunk(second_id, contents, 0, 4, content_hash);
+  ASSERT_TRUE(content_present_.Await(kDefaultTimeout).result());
+  ReceiveChunk(second_id, contents, 4, 6, content_hash);
+  ReceiveChunk(second_id, contents, 10, 0, content_hash, /*last_chunk=*/true);
+  release_.CountDown();
+
+  ASSERT_TRUE(payloads_finished_.Await(kDefaultTimeout).result());
+  EXPECT_THAT(GetFinished(),
+              ElementsAre(Pair(first_id, PayloadProgressInfo::Status::kSuccess),
+                          Pair(second_id,
+                               PayloadProgressInfo::Status::kSuccess)));
+  EXPECT_THAT(GetControlEvents(),
+              ElementsAre(PayloadTransferFrame::ControlMessage::
+                              PAYLOAD_CONTENT_PRESENT));
+  InputFile received(second_id, contents.size());
+  EXPECT_EQ(received.Read(contents.size() + 1).result(), contents);
+}
+
+TEST_F(PayloadManagerContentCacheTest, FailsPayloadWhenCachedFileChanged) {
+  const ByteArray contents("0123456789");
+  ContentHasher hasher;
+  hasher.Update(contents);
+  const ByteArray content_hash = hasher.GetHash();
+  Payload::Id first_id = Payload::GenerateId();
+  ReceiveChunk(first_id, contents, 0, 10, ByteArray());
+  ReceiveChunk(first_id, contents, 10, 0, content_hash, /*last_chunk=*/true);
+  // The application rewrites the received file, keeping its size.
+  OutputFile rewritten(first_id);
+  ASSERT_TRUE(rewritten.Write(ByteArray("9876543210")).Ok());
+  ASSERT_TRUE(rewritten.Close().Ok());
+
+  Payload::Id second_id = Payload::GenerateId();
+  ReceiveChunk(second_id, contents, 0, 4, content_hash);
+
+  ASSERT_TRUE(payloads_finished_.Await(kDefaultTimeout).result());
+  EXPECT_THAT(GetFinished(),
+              ElementsAre(Pair(first_id, PayloadProgressInfo::Status::kSuccess),
+                          Pair(second_id,
+                               PayloadProgressInfo::Status::kFailure)));
+  EXPECT_THAT(GetControlEvents(),
+              Not(Contains(PayloadTransferFrame::ControlMessage::
+                               PAYLOAD_CONTENT_PRESENT)));
+}
+
+TEST_F(PayloadManagerContentCacheTest, IgnoresContentHashUnlessCacheShared) {
+  FeatureFlags::Flags feature_flags;
+  feature_flags.enable_payload_content_dedup = true;
+  MediumEnvironment::Instance().SetFeatureFlags(feature_flags);
+  const ByteArray contents("0123456789");
+  ContentHasher hasher;
+  hasher.Update(contents);
+  const ByteArray content_hash = hasher.GetHash();
+  Payload::Id first_id = Payload::GenerateId();
+  ReceiveChunk(first_id, contents, 0, 10, ByteArray());
+  ReceiveChunk(first_id, contents, 10, 0, content_hash, /*last_chunk=*/true);
+
+  Payload::Id second_id = Payload::GenerateId();
+  ReceiveChunk(second_id, contents, 0, 10, content_hash);
+  ReceiveChunk(second_id, contents, 10, 0, content_hash, /*last_chunk=*/true);
+
+  ASSERT_TRUE(payloads_finished_.Await(kDefaultTimeout).result());
+  EXPECT_THAT(GetFinished(),
+              ElementsAre(Pair(first_id, PayloadProgressInfo::Status::kSuccess),
+                          Pair(second_id,
+                               PayloadProgressInfo::Status::kSuccess)));
+  EXPECT_THAT(GetControlEvents(),
+              Not(Contains(PayloadTransferFrame::ControlMessage::
+                               PAYLOAD_CONTENT_PRESENT)));
+}
+
+// Sends payloads to endpoints over mock channels, one of which can block
+// writes of payload data.
+class PayloadManagerChunkSenderTest : public ::testing::Test {
+ protected:
+  ~PayloadManagerChunkSenderTest() override {
+    release_slow_.CountDown();
+    read_done_.CountDown();
+  }
+
+  // Connects |endpoint_id|, and counts down |sent| once a payload was sent to
+  // it in full.
+  void AddEndpoint(const std::string& endpoint_id, bool slow,
+                   CountDownLatch* sent) {
+    auto channel = std::make_unique<NiceMock<MockEndpointChannel>>();
+    ON_CALL(*channel, Read()).WillByDefault([this]() {
+      read_done_.Await();
+      return ExceptionOr<ByteArray>(Exception::kIo);
+    });
+    ON_CALL(*channel, Write).WillByDefault([this, slow](const ByteArray& data) {
+      if (slow && IsPayloadData(data)) release_slow_.Await();
+      return Exception{Exception::kSuccess};
+    });
+    ON_CALL(*channel, GetMedium()).WillByDefault(Return(Medium::BLE));
+    ON_CALL(*channel, GetLastReadTimestamp())
+        .WillByDefault(Return(SystemClock::ElapsedRealtime()));
+    ON_CALL(*channel, GetLastWriteTimestamp())
+        .WillByDefault(Return(SystemClock::ElapsedRealtime()));
+    CountDownLatch registered(1);
+    em_.RegisterEndpoint(
+        &client_, endpoint_id,
+        {.remote_endpoint_info = ByteArray{"info"},
+         .is_incoming_connection = true},
+        {.keep_alive_interval_millis = 5000,
+         .keep_alive_timeout_millis = 30000},
+        std::move(channel),
+        {.initiated_cb = [&registered](const std::string& endpoint_id,
+                                       const ConnectionResponseInfo& info) {
+           registered.CountDown();
+         }},
+        "conntokn");
+    EXPECT_TRUE(registered.Await(kDefaultTimeout).result());
+    client_.LocalEndpointAcceptedConnection(
+        endpoint_id, {.payload_progress_cb =
+                          [sent](const std::string& endpoint_id,
+                                 const PayloadProgressInfo& info) {
+                            if (info.status ==
+                                PayloadProgressInfo::Status::kSuccess) {
+                              sent->CountDown();
+                            }
+                          }});
+    client_.RemoteEndpointAcceptedConnection(endpoint_id);
+    client_.OnConnectionAccepted(endpoint_id);
+  }
+
+  void SendBytes(const std::string& endpoint_id) {
+    pm_.SendPayload(&client_, {endpoint_id},
+                    Payload(ByteArray(std::string(kMessage))));
+  }
+
+  CountDownLatch release_slow_{1};
+
+ private:
+  static bool IsPayloadData(const ByteArray& data) {
+    ExceptionOr<OfflineFrame> frame = parser::FromBytes(data);
+    return frame.ok() &&
+           parser::GetFrameType(frame.result()) == V1Frame::PAYLOAD_TRANSFER &&
+           frame.result().v1().payload_transfer().packet_type() ==
+               PayloadTransferFrame::DATA;
+  }
+
+  CountDownLatch read_done_{1};
+  ClientProxy client_;
+  EndpointChannelManager ecm_;
+  EndpointManager em_{&ecm_};
+  PayloadManager pm_{em_};
+};
+
+TEST_F(PayloadManagerChunkSenderTest, SlowEndpointDoesNotHoldUpOthers) {
+  CountDownLatch slow_sent(1);
+  CountDownLatch fast_sent(1);
+  AddEndpoint("slow", /*slow=*/true, &slow_sent);
+  AddEndpoint("fast", /*slow=*/false, &fast_sent);
+
+  // Writing the payload to the slow endpoint blocks, but a payload sent to
+  // the other endpoint afterwards still goes out.
+  SendBytes("slow");
+  SendBytes("fast");
+  EXPECT_TRUE(fast_sent.Await(kDefaultTimeout).result());
+  EXPECT_FALSE(slow_sent.Await(absl::ZeroDuration()).result());
+
+  release_slow_.CountDown();
+  EXPECT_TRUE(slow_sent.Await(kDefaultTimeout).result());
+}
+
 }  // namespace
 }  // namespace connections
 }  // namespace nearby
@@ -0,0 +1,77 @@
+// Copyright 2021 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "core/internal/payload_scheduler.h"
+
+#include <algorithm>
+
+namespace location {
+namespace nearby {
+namespace connections {
+
+namespace {
+// The largest priority weight; costs are scaled by it so they stay integral.
+constexpr std::uint64_t kMaxWeight =
+    static_cast<std::uint64_t>(Payload::Priority::kHigh);
+}  // namespace
+
+void PayloadScheduler::Add(Payload::Id payload_id,
+                           Payload::Priority priority) {
+  if (entries_.contains(payload_id)) return;
+  Key key{virtual_time_, sequence_++};
+  std::uint64_t weight =
+      std::max<std::uint64_t>(static_cast<std::uint64_t>(priority), 1);
+  entries_.emplace(payload_id, Entry{key, weight});
+  queue_.emplace(key, payload_id);
+}
+
+void PayloadScheduler::Remove(Payload::Id payload_id) {
+  auto it = entries_.find(payload_id);
+  if (it == entries_.end()) return;
+  queue_.erase(it->second.key);
+  entries_.erase(it);
+}
+
+void PayloadScheduler::Hold(Payload::Id payload_id) {
+  auto it = entries_.find(payload_id);
+  if (it == entries_.end()) return;
+  queue_.erase(it->second.key);
+}
+
+void PayloadScheduler::Release(Payload::Id payload_id) {
+  auto it = entries_.find(payload_id);
+  if (it == entries_.end()) return;
+  queue_.emplace(it->second.key, payload_id);
+}
+
+Payload::Id PayloadScheduler::Next() const { return queue_.begin()->second; }
+
+void PayloadScheduler::OnChunkSent(Payload::Id payload_id,
+                                   std::size_t chunk_size) {
+  auto it = entries_.find(payload_id);
+  if (it == entries_.end()) return;
+  Entry& entry = it->second;
+  // The chunk started being served at the payload's tag.
+  virtual_time_ = std::max(virtual_time_, entry.key.first);
+  // Even an empty chunk costs something, so a payload can't hog the sender.
+  std::uint64_t cost =
+      std::max<std::uint64_t>(chunk_size, 1) * (kMaxWeight / entry.weight);
+  queue_.erase(entry.key);
+  entry.key = {entry.key.first + cost, sequence_++};
+  queue_.emplace(entry.key, payload_id);
+}
+
+}  // namespace connections
+}  // namespace nearby
+}  // namespace location
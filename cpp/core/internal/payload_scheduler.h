@@ -0,0 +1,85 @@
+// Copyright 2021 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef CORE_INTERNAL_PAYLOAD_SCHEDULER_H_
+#define CORE_INTERNAL_PAYLOAD_SCHEDULER_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+
+#include "absl/container/btree_map.h"
+#include "absl/container/flat_hash_map.h"
+#include "core/payload.h"
+
+namespace location {
+namespace nearby {
+namespace connections {
+
+// Decides which outgoing payload sends its next chunk.
+//
+// Payloads are interleaved chunk by chunk with start-time fair queuing: each
+// payload carries a virtual time tag that advances by the size of every chunk
+// it sends, divided by its priority weight, and the payload with the smallest
+// tag goes next. A payload that is added later starts at the current virtual
+// time, so a small or urgent payload goes out right away instead of waiting
+// behind a large file that has been sending for a while.
+//
+// Not thread safe; PayloadManager guards it with its own mutex.
+class PayloadScheduler {
+ public:
+  // Starts scheduling a payload. Adding a payload twice has no effect.
+  void Add(Payload::Id payload_id, Payload::Priority priority);
+
+  // Stops scheduling a payload.
+  void Remove(Payload::Id payload_id);
+
+  // Stops picking a payload, e.g. while one of its chunks is being sent,
+  // until Release() or OnChunkSent(). It keeps its place in the order.
+  void Hold(Payload::Id payload_id);
+  void Release(Payload::Id payload_id);
+
+  // Only counts payloads that aren't held.
+  bool IsEmpty() const { return queue_.empty(); }
+  std::size_t Size() const { return queue_.size(); }
+
+  // Returns the payload that should send the next chunk. Must not be called
+  // when IsEmpty().
+  Payload::Id Next() const;
+
+  // Charges |chunk_size| bytes to a payload after it sent a chunk, and
+  // releases it if it was held.
+  void OnChunkSent(Payload::Id payload_id, std::size_t chunk_size);
+
+ private:
+  // Orders by virtual time, then by insertion, so payloads of equal tag are
+  // served round robin.
+  using Key = std::pair<std::uint64_t, std::uint64_t>;
+
+  struct Entry {
+    Key key;
+    std::uint64_t weight;
+  };
+
+  absl::btree_map<Key, Payload::Id> queue_;
+  absl::flat_hash_map<Payload::Id, Entry> entries_;
+  std::uint64_t virtual_time_ = 0;
+  std::uint64_t sequence_ = 0;
+};
+
+}  // namespace connections
+}  // namespace nearby
+}  // namespace location
+
+#endif  // CORE_INTERNAL_PAYLOAD_SCHEDULER_H_
@@ -0,0 +1,127 @@
+// Copyright 2021 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "core/internal/payload_scheduler.h"
+
+#include "gtest/gtest.h"
+#include "absl/container/flat_hash_map.h"
+
+namespace location {
+namespace nearby {
+namespace connections {
+namespace {
+
+constexpr std::size_t kChunkSize = 1024;
+
+// Sends |chunks| chunks and returns how many each payload got to send.
+absl::flat_hash_map<Payload::Id, int> SendChunks(PayloadScheduler& scheduler,
+                                                 int chunks) {
+  absl::flat_hash_map<Payload::Id, int> sent;
+  for (int i = 0; i < chunks; i++) {
+    Payload::Id id = scheduler.Next();
+    sent[id]++;
+    scheduler.OnChunkSent(id, kChunkSize);
+  }
+  return sent;
+}
+
+TEST(PayloadSchedulerTest, StartsEmpty) {
+  PayloadScheduler scheduler;
+
+  EXPECT_TRUE(scheduler.IsEmpty());
+  EXPECT_EQ(scheduler.Size(), 0);
+}
+
+TEST(PayloadSchedulerTest, AddAndRemove) {
+  PayloadScheduler scheduler;
+
+  scheduler.Add(1, Payload::Priority::kNormal);
+  scheduler.Add(1, Payload::Priority::kHigh);
+  EXPECT_EQ(scheduler.Size(), 1);
+  EXPECT_EQ(scheduler.Next(), 1);
+
+  scheduler.Remove(1);
+  scheduler.Remove(2);
+  EXPECT_TRUE(scheduler.IsEmpty());
+}
+
+TEST(PayloadSchedulerTest, EqualPrioritiesAlternate) {
+  PayloadScheduler scheduler;
+  scheduler.Add(1, Payload::Priority::kNormal);
+  scheduler.Add(2, Payload::Priority::kNormal);
+
+  EXPECT_EQ(scheduler.Next(), 1);
+  scheduler.OnChunkSent(1, kChunkSize);
+  EXPECT_EQ(scheduler.Next(), 2);
+  scheduler.OnChunkSent(2, kChunkSize);
+  EXPECT_EQ(scheduler.Next(), 1);
+}
+
+TEST(PayloadSchedulerTest, SharesFollowPriorities) {
+  PayloadScheduler scheduler;
+  scheduler.Add(1, Payload::Priority::kLow);
+  scheduler.Add(2, Payload::Priority::kNormal);
+  scheduler.Add(3, Payload::Priority::kHigh);
+
+  auto sent = SendChunks(scheduler, 2100);
+
+  EXPECT_NEAR(sent[1], 100, 2);
+  EXPECT_NEAR(sent[2], 400, 2);
+  EXPECT_NEAR(sent[3], 1600, 2);
+}
+
+TEST(PayloadSchedulerTest, LatePayloadDoesNotWaitBehindLargeOne) {
+  PayloadScheduler scheduler;
+  scheduler.Add(1, Payload::Priority::kHigh);
+  SendChunks(scheduler, 10000);
+
+  scheduler.Add(2, Payload::Priority::kLow);
+
+  EXPECT_EQ(scheduler.Next(), 2);
+}
+
+TEST(PayloadSchedulerTest, RemovedPayloadIsNotScheduled) {
+  PayloadScheduler scheduler;
+  scheduler.Add(1, Payload::Priority::kNormal);
+  scheduler.Add(2, Payload::Priority::kNormal);
+
+  scheduler.Remove(1);
+
+  auto sent = SendChunks(scheduler, 10);
+  EXPECT_EQ(sent.size(), 1);
+  EXPECT_EQ(sent[2], 10);
+}
+
+TEST(PayloadSchedulerTest, HeldPayloadKeepsItsPlace) {
+  PayloadScheduler scheduler;
+  scheduler.Add(1, Payload::Priority::kNormal);
+  scheduler.Add(2, Payload::Priority::kNormal);
+
+  scheduler.Hold(1);
+  EXPECT_EQ(scheduler.Size(), 1);
+  EXPECT_EQ(scheduler.Next(), 2);
+  scheduler.OnChunkSent(2, kChunkSize);
+  EXPECT_EQ(scheduler.Next(), 2);
+
+  scheduler.Release(1);
+  EXPECT_EQ(scheduler.Next(), 1);
+  scheduler.Hold(1);
+  scheduler.OnChunkSent(1, kChunkSize);
+  EXPECT_EQ(scheduler.Size(), 2);
+}
+
+}  // namespace
+}  // namespace connections
+}  // namespace nearby
+}  // namespace location
@@ -0,0 +1,86 @@
+// Copyright 2021 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "core/internal/session_keys.h"
+
+#include "openssl/evp.h"
+#include "openssl/hmac.h"
+
+namespace location {
+namespace nearby {
+namespace connections {
+
+// C++14 requires to declare this.
+// TODO(apolyudov): remove when migration to c++17 is possible.
+constexpr int SessionKeys::kKeySize;
+
+namespace {
+
+// D2DConnectionContextV1::SaveSession() layout: protocol version (1 byte),
+// encode and decode sequence numbers (4 bytes each), encode key, decode key.
+constexpr char kSavedSessionVersion = 1;
+constexpr std::size_t kSavedSessionKeysOffset = 9;
+constexpr std::size_t kSavedSessionSize =
+    kSavedSessionKeysOffset + 2 * SessionKeys::kKeySize;
+
+}  // namespace
+
+ByteArray SessionKeys::HmacSha256(const ByteArray& key, const ByteArray& data) {
+  unsigned char mac[EVP_MAX_MD_SIZE];
+  unsigned int mac_size = 0;
+  if (HMAC(EVP_sha256(), key.data(), key.size(),
+           reinterpret_cast<const unsigned char*>(data.data()), data.size(),
+           mac, &mac_size) == nullptr) {
+    return {};
+  }
+  return ByteArray(reinterpret_cast<const char*>(mac), mac_size);
+}
+
+ByteArray SessionKeys::Hkdf(const ByteArray& secret, const ByteArray& salt,
+                            const std::string& info) {
+  // A single block of output is all we need, so the expand step is one HMAC.
+  ByteArray prk = HmacSha256(salt, secret);
+  if (prk.Empty()) return {};
+  return HmacSha256(prk, ByteArray(info + '\x01'));
+}
+
+bool SessionKeys::Read(EncryptionContext& context, ByteArray* encode_key,
+                       ByteArray* decode_key) {
+  std::unique_ptr<std::string> session = context.SaveSession();
+  if (!session || session->size() != kSavedSessionSize ||
+      (*session)[0] != kSavedSessionVersion) {
+    return false;
+  }
+  const char* keys = session->data() + kSavedSessionKeysOffset;
+  *encode_key = ByteArray(keys, kKeySize);
+  *decode_key = ByteArray(keys + kKeySize, kKeySize);
+  return true;
+}
+
+std::unique_ptr<SessionKeys::EncryptionContext> SessionKeys::ToContext(
+    const ByteArray& encode_key, const ByteArray& decode_key) {
+  if (encode_key.size() != kKeySize || decode_key.size() != kKeySize) {
+    return nullptr;
+  }
+  // Both sequence numbers start at zero.
+  std::string session(kSavedSessionKeysOffset, '\0');
+  session[0] = kSavedSessionVersion;
+  session.append(encode_key.data(), encode_key.size());
+  session.append(decode_key.data(), decode_key.size());
+  return EncryptionContext::FromSavedSession(session);
+}
+
+}  // namespace connections
+}  // namespace nearby
+}  // namespace location
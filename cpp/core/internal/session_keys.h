@@ -0,0 +1,59 @@
+// Copyright 2021 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef CORE_INTERNAL_SESSION_KEYS_H_
+#define CORE_INTERNAL_SESSION_KEYS_H_
+
+#include <memory>
+#include <string>
+
+#include "securegcm/d2d_connection_context_v1.h"
+#include "platform/base/byte_array.h"
+
+namespace location {
+namespace nearby {
+namespace connections {
+
+// Access to the keys of an encrypted session, and derivation of new keys from
+// them.
+class SessionKeys {
+ public:
+  using EncryptionContext = ::securegcm::D2DConnectionContextV1;
+
+  // Size of the keys used by EncryptionContext, and of derived keys.
+  static constexpr int kKeySize = 32;
+
+  // Returns the HMAC-SHA256 of |data| keyed with |key|.
+  static ByteArray HmacSha256(const ByteArray& key, const ByteArray& data);
+
+  // Returns kKeySize bytes derived from |secret| with HKDF-SHA256 (RFC 5869).
+  static ByteArray Hkdf(const ByteArray& secret, const ByteArray& salt,
+                        const std::string& info);
+
+  // Reads the keys |context| encodes and decodes messages with. Returns false
+  // if they can't be read.
+  static bool Read(EncryptionContext& context, ByteArray* encode_key,
+                   ByteArray* decode_key);
+
+  // Returns a new context that encodes and decodes messages with the given
+  // keys, or nullptr if the keys are malformed.
+  static std::unique_ptr<EncryptionContext> ToContext(
+      const ByteArray& encode_key, const ByteArray& decode_key);
+};
+
+}  // namespace connections
+}  // namespace nearby
+}  // namespace location
+
+#endif  // CORE_INTERNAL_SESSION_KEYS_H_
@@ -0,0 +1,73 @@
+// Copyright 2021 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "core/internal/session_keys.h"
+
+#include <string>
+
+#include "gtest/gtest.h"
+#include "absl/strings/escaping.h"
+
+namespace location {
+namespace nearby {
+namespace connections {
+namespace {
+
+ByteArray FromHex(const std::string& hex) {
+  return ByteArray(absl::HexStringToBytes(hex));
+}
+
+TEST(SessionKeysTest, HmacSha256MatchesRfc4231) {
+  // Test case 2.
+  EXPECT_EQ(SessionKeys::HmacSha256(ByteArray("Jefe"),
+                                    ByteArray("what do ya want for nothing?")),
+            FromHex("5bdcc146bf60754e6a042426089575c7"
+                    "5a003f089d2739839dec58b964ec3843"));
+}
+
+TEST(SessionKeysTest, HkdfMatchesRfc5869) {
+  // Test case 1, truncated to the first kKeySize bytes of output.
+  EXPECT_EQ(SessionKeys::Hkdf(ByteArray(std::string(22, '\x0b')),
+                              FromHex("000102030405060708090a0b0c"),
+                              absl::HexStringToBytes("f0f1f2f3f4f5f6f7f8f9")),
+            FromHex("3cb25f25faacd57a90434f64d0362f2a"
+                    "2d2d0a90cf1a5a4c5db02d56ecc4c5bf"));
+}
+
+TEST(SessionKeysTest, ContextKeysCanBeReadBack) {
+  ByteArray encode_key(std::string(SessionKeys::kKeySize, 'e'));
+  ByteArray decode_key(std::string(SessionKeys::kKeySize, 'd'));
+
+  auto context = SessionKeys::ToContext(encode_key, decode_key);
+  ASSERT_NE(context, nullptr);
+
+  ByteArray read_encode_key;
+  ByteArray read_decode_key;
+  ASSERT_TRUE(
+      SessionKeys::Read(*context, &read_encode_key, &read_decode_key));
+  EXPECT_EQ(read_encode_key, encode_key);
+  EXPECT_EQ(read_decode_key, decode_key);
+}
+
+TEST(SessionKeysTest, ToContextRejectsMalformedKeys) {
+  EXPECT_EQ(SessionKeys::ToContext(ByteArray("short"),
+                                   ByteArray(std::string(
+                                       SessionKeys::kKeySize, 'd'))),
+            nullptr);
+}
+
+}  // namespace
+}  // namespace connections
+}  // namespace nearby
+}  // namespace location
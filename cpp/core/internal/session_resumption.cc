@@ -0,0 +1,260 @@
+// Copyright 2021 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "core/internal/session_resumption.h"
+
+#include <utility>
+
+#include "core/internal/session_keys.h"
+#include "platform/public/logging.h"
+#include "platform/public/mutex_lock.h"
+#include "openssl/crypto.h"
+#include "openssl/rand.h"
+
+namespace location {
+namespace nearby {
+namespace connections {
+
+// C++14 requires to declare this.
+// TODO(apolyudov): remove when migration to c++17 is possible.
+constexpr int SessionResumption::kMaxSecrets;
+
+namespace {
+
+// Every message starts with kMagic and a type byte. UKEY2 messages are
+// serialized Ukey2Message protos, which never start with 'N'.
+constexpr char kMagic[] = "NCR";
+constexpr std::size_t kMagicSize = sizeof(kMagic) - 1;
+constexpr char kRequest = 1;
+constexpr char kAccept = 2;
+constexpr char kReject = 3;
+constexpr std::size_t kHeaderSize = kMagicSize + 1;
+
+constexpr std::size_t kTicketSize = 16;
+constexpr std::size_t kNonceSize = 32;
+constexpr std::size_t kMacSize = 32;
+
+// Request: header | ticket | client nonce | MAC.
+constexpr std::size_t kRequestSize =
+    kHeaderSize + kTicketSize + kNonceSize + kMacSize;
+// Accept: header | server nonce | MAC.
+constexpr std::size_t kAcceptSize = kHeaderSize + kNonceSize + kMacSize;
+
+constexpr char kSalt[] = "Nearby Connections resumption";
+
+std::string Header(char type) { return std::string(kMagic) + type; }
+
+bool HasType(const ByteArray& message, char type) {
+  return SessionResumption::IsResumptionMessage(message) &&
+         message.data()[kMagicSize] == type;
+}
+
+ByteArray Derive(const ByteArray& secret, const std::string& info) {
+  return SessionKeys::Hkdf(secret, ByteArray(kSalt), info);
+}
+
+ByteArray GetTicket(const ByteArray& secret) {
+  return ByteArray(Derive(secret, "ticket").data(), kTicketSize);
+}
+
+ByteArray RandomNonce() {
+  ByteArray nonce(kNonceSize);
+  RAND_bytes(reinterpret_cast<unsigned char*>(nonce.data()), kNonceSize);
+  return nonce;
+}
+
+// Constant-time comparison of |rhs| with as many bytes at |lhs|.
+bool Equal(const char* lhs, const ByteArray& rhs) {
+  return !rhs.Empty() && CRYPTO_memcmp(lhs, rhs.data(), rhs.size()) == 0;
+}
+
+// Builds the keys both sides use after the nonces are exchanged, and the key
+// that authenticates the server's response.
+struct SessionSecrets {
+  SessionSecrets(const ByteArray& secret, const std::string& client_nonce,
+                 const std::string& server_nonce) {
+    ByteArray salt(client_nonce + server_nonce);
+    client_key = SessionKeys::Hkdf(secret, salt, "client key");
+    server_key = SessionKeys::Hkdf(secret, salt, "server key");
+    confirm_key = SessionKeys::Hkdf(secret, salt, "confirm");
+    auth_token = SessionKeys::Hkdf(secret, salt, "auth token");
+  }
+
+  ByteArray client_key;
+  ByteArray server_key;
+  ByteArray confirm_key;
+  ByteArray auth_token;
+};
+
+}  // namespace
+
+bool SessionResumption::IsResumptionMessage(const ByteArray& message) {
+  return message.size() >= kHeaderSize &&
+         std::string(message.data(), kMagicSize) == kMagic;
+}
+
+void SessionResumption::Save(const std::string& endpoint_id,
+                             EncryptionContext& context, bool is_client,
+                             absl::Time expiry) {
+  ByteArray encode_key;
+  ByteArray decode_key;
+  if (!SessionKeys::Read(context, &encode_key, &decode_key)) {
+    NEARBY_LOGS(WARNING) << "Unable to read session keys; not saving a "
+                            "resumption secret for endpoint_id="
+                         << endpoint_id;
+    return;
+  }
+  // Both sides must feed the keys in the same order.
+  const ByteArray& client_key = is_client ? encode_key : decode_key;
+  const ByteArray& server_key = is_client ? decode_key : encode_key;
+  ByteArray secret = Derive(
+      ByteArray(std::string(client_key) + std::string(server_key)), "secret");
+
+  MutexLock lock(&mutex_);
+  secrets_[endpoint_id] = {std::move(secret), expiry};
+  if (secrets_.size() > kMaxSecrets) {
+    auto oldest = secrets_.begin();
+    for (auto it = secrets_.begin(); it != secrets_.end(); ++it) {
+      if (it->second.expiry < oldest->second.expiry) oldest = it;
+    }
+    secrets_.erase(oldest);
+  }
+}
+
+void SessionResumption::Forget(const std::string& endpoint_id) {
+  MutexLock lock(&mutex_);
+  secrets_.erase(endpoint_id);
+}
+
+ByteArray SessionResumption::TakeSecret(const std::string& endpoint_id,
+                                        absl::Time now) {
+  MutexLock lock(&mutex_);
+  auto it = secrets_.find(endpoint_id);
+  if (it == secrets_.end()) return {};
+  Secret secret = std::move(it->second);
+  secrets_.erase(it);
+  if (secret.expiry <= now) return {};
+  return std::move(secret.value);
+}
+
+ByteArray SessionResumption::FindSecret(const std::string& endpoint_id,
+                                        absl::Time now) {
+  MutexLock lock(&mutex_);
+  auto it = secrets_.find(endpoint_id);
+  if (it == secrets_.end()) return {};
+  if (it->second.expiry <= now) {
+    secrets_.erase(it);
+    return {};
+  }
+  return it->second.value;
+}
+
+bool SessionResumption::ConsumeSecret(const std::string& endpoint_id,
+                                      const ByteArray& secret) {
+  MutexLock lock(&mutex_);
+  auto it = secrets_.find(endpoint_id);
+  if (it == secrets_.end() || it->second.value != secret) return false;
+  secrets_.erase(it);
+  return true;
+}
+
+ByteArray SessionResumption::CreateRequest(const std::string& endpoint_id,
+                                           absl::Time now, Attempt* attempt) {
+  ByteArray secret = TakeSecret(endpoint_id, now);
+  if (secret.Empty()) return {};
+
+  std::string request = Header(kRequest) + std::string(GetTicket(secret)) +
+                        std::string(RandomNonce());
+  request += std::string(
+      SessionKeys::HmacSha256(Derive(secret, "request"), ByteArray(request)));
+  attempt->secret = std::move(secret);
+  attempt->request = ByteArray(request);
+  return attempt->request;
+}
+
+SessionResumption::Outcome SessionResumption::HandleResponse(
+    const Attempt& attempt, const ByteArray& response, Session* session) {
+  if (HasType(response, kReject)) return Outcome::kRejected;
+  if (!HasType(response, kAccept) || response.size() != kAcceptSize ||
+      attempt.request.size() != kRequestSize) {
+    return Outcome::kFailed;
+  }
+
+  const char* client_nonce =
+      attempt.request.data() + kHeaderSize + kTicketSize;
+  const char* server_nonce = response.data() + kHeaderSize;
+  SessionSecrets secrets(attempt.secret, std::string(client_nonce, kNonceSize),
+                         std::string(server_nonce, kNonceSize));
+  ByteArray expected_mac = SessionKeys::HmacSha256(
+      secrets.confirm_key,
+      ByteArray(std::string(attempt.request) +
+                std::string(response.data(), kHeaderSize + kNonceSize)));
+  if (!Equal(server_nonce + kNonceSize, expected_mac)) return Outcome::kFailed;
+
+  session->context =
+      SessionKeys::ToContext(secrets.client_key, secrets.server_key);
+  if (!session->context) return Outcome::kFailed;
+  session->raw_auth_token = std::move(secrets.auth_token);
+  return Outcome::kResumed;
+}
+
+ByteArray SessionResumption::HandleRequest(const std::string& endpoint_id,
+                                           const ByteArray& request,
+                                           absl::Time now, Session* session) {
+  ByteArray secret = FindSecret(endpoint_id, now);
+  if (secret.Empty() || !HasType(request, kRequest) ||
+      request.size() != kRequestSize) {
+    NEARBY_LOGS(INFO) << "Rejecting session resumption; endpoint_id="
+                      << endpoint_id;
+    return ByteArray(Header(kReject));
+  }
+
+  const char* ticket = request.data() + kHeaderSize;
+  const char* client_nonce = ticket + kTicketSize;
+  const char* mac = client_nonce + kNonceSize;
+  ByteArray expected_mac =
+      SessionKeys::HmacSha256(Derive(secret, "request"),
+                              ByteArray(request.data(), mac - request.data()));
+  if (!Equal(ticket, GetTicket(secret)) || !Equal(mac, expected_mac)) {
+    NEARBY_LOGS(INFO) << "Rejecting session resumption with unknown secret; "
+                         "endpoint_id="
+                      << endpoint_id;
+    return ByteArray(Header(kReject));
+  }
+  // Secrets are single use. This also rejects a concurrent replay of the
+  // same request.
+  if (!ConsumeSecret(endpoint_id, secret)) {
+    NEARBY_LOGS(INFO) << "Rejecting session resumption with a used secret; "
+                         "endpoint_id="
+                      << endpoint_id;
+    return ByteArray(Header(kReject));
+  }
+
+  ByteArray server_nonce = RandomNonce();
+  SessionSecrets secrets(secret, std::string(client_nonce, kNonceSize),
+                         std::string(server_nonce));
+  session->context =
+      SessionKeys::ToContext(secrets.server_key, secrets.client_key);
+  if (!session->context) return ByteArray(Header(kReject));
+  session->raw_auth_token = std::move(secrets.auth_token);
+
+  std::string response = Header(kAccept) + std::string(server_nonce);
+  response += std::string(SessionKeys::HmacSha256(
+      secrets.confirm_key, ByteArray(std::string(request) + response)));
+  return ByteArray(response);
+}
+
+}  // namespace connections
+}  // namespace nearby
+}  // namespace location
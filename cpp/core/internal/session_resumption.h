@@ -0,0 +1,131 @@
+// Copyright 2021 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef CORE_INTERNAL_SESSION_RESUMPTION_H_
+#define CORE_INTERNAL_SESSION_RESUMPTION_H_
+
+#include <memory>
+#include <string>
+
+#include "securegcm/d2d_connection_context_v1.h"
+#include "absl/base/thread_annotations.h"
+#include "absl/container/flat_hash_map.h"
+#include "absl/time/time.h"
+#include "platform/base/byte_array.h"
+#include "platform/public/mutex.h"
+
+namespace location {
+namespace nearby {
+namespace connections {
+
+// Resumes encrypted sessions with recently connected endpoints in a single
+// round trip, instead of running a full UKEY2 handshake.
+//
+// Once a connection is encrypted, both sides Save() a secret derived from its
+// session keys, under the remote endpoint ID. To reconnect, the client sends a
+// request naming that secret, with a fresh nonce and a MAC proving it knows
+// the secret. The server answers with its own nonce and a MAC over both
+// messages, and both sides derive new session keys from the secret and the
+// two nonces.
+//
+// Secrets are single use and expire. A server that no longer has the secret
+// rejects the request, and the client then runs a full UKEY2 handshake on the
+// same channel.
+class SessionResumption {
+ public:
+  using EncryptionContext = ::securegcm::D2DConnectionContextV1;
+
+  // Maximum number of secrets kept; the ones closest to expiry are dropped
+  // first.
+  static constexpr int kMaxSecrets = 64;
+
+  // Keys of a resumed session.
+  struct Session {
+    std::unique_ptr<EncryptionContext> context;
+    // Takes the place of the UKEY2 verification string.
+    ByteArray raw_auth_token;
+  };
+
+  // What a client remembers between its request and the server's response.
+  struct Attempt {
+    ByteArray secret;
+    ByteArray request;
+  };
+
+  enum class Outcome {
+    kResumed = 0,
+    // The server doesn't have the secret any more.
+    kRejected = 1,
+    // The response is malformed or doesn't authenticate.
+    kFailed = 2,
+  };
+
+  // Returns true if |message| belongs to this protocol, rather than to UKEY2.
+  static bool IsResumptionMessage(const ByteArray& message);
+
+  // Remembers a secret for resuming the session in |context| with
+  // |endpoint_id| until |expiry|. |is_client| tells whether we initiated it.
+  void Save(const std::string& endpoint_id, EncryptionContext& context,
+            bool is_client, absl::Time expiry) ABSL_LOCKS_EXCLUDED(mutex_);
+
+  // Forgets the secret for |endpoint_id|, if any.
+  void Forget(const std::string& endpoint_id) ABSL_LOCKS_EXCLUDED(mutex_);
+
+  // Client side. Returns a request to resume the session with |endpoint_id|
+  // and fills |attempt|, or returns an empty ByteArray if there is no
+  // unexpired secret for it. The secret is forgotten either way.
+  ByteArray CreateRequest(const std::string& endpoint_id, absl::Time now,
+                          Attempt* attempt) ABSL_LOCKS_EXCLUDED(mutex_);
+
+  // Client side. Handles the server's |response| to |attempt|, filling
+  // |session| if it was resumed.
+  static Outcome HandleResponse(const Attempt& attempt,
+                                const ByteArray& response, Session* session);
+
+  // Server side. Handles a |request| from |endpoint_id| and returns the
+  // response to send back. Fills |session| if the response resumes it. The
+  // secret for |endpoint_id| is only used up by a request that proves
+  // knowledge of it, so a forged request can't make us forget it.
+  ByteArray HandleRequest(const std::string& endpoint_id,
+                          const ByteArray& request, absl::Time now,
+                          Session* session) ABSL_LOCKS_EXCLUDED(mutex_);
+
+ private:
+  struct Secret {
+    ByteArray value;
+    absl::Time expiry;
+  };
+
+  // Removes and returns the secret for |endpoint_id|, or an empty ByteArray
+  // if there is no unexpired one.
+  ByteArray TakeSecret(const std::string& endpoint_id, absl::Time now)
+      ABSL_LOCKS_EXCLUDED(mutex_);
+  // Returns the secret for |endpoint_id| without removing it, or an empty
+  // ByteArray if there is no unexpired one. Expired secrets are removed.
+  ByteArray FindSecret(const std::string& endpoint_id, absl::Time now)
+      ABSL_LOCKS_EXCLUDED(mutex_);
+  // Removes the secret for |endpoint_id| if it is still |secret|. Returns
+  // false if it has been used or replaced meanwhile.
+  bool ConsumeSecret(const std::string& endpoint_id, const ByteArray& secret)
+      ABSL_LOCKS_EXCLUDED(mutex_);
+
+  Mutex mutex_;
+  absl::flat_hash_map<std::string, Secret> secrets_ ABSL_GUARDED_BY(mutex_);
+};
+
+}  // namespace connections
+}  // namespace nearby
+}  // namespace location
+
+#endif  // CORE_INTERNAL_SESSION_RESUMPTION_H_
@@ -0,0 +1,208 @@
+// Copyright 2021 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "core/internal/session_resumption.h"
+
+#include <string>
+
+#include "gtest/gtest.h"
+#include "absl/strings/str_cat.h"
+#include "absl/time/time.h"
+#include "core/internal/session_keys.h"
+
+namespace location {
+namespace nearby {
+namespace connections {
+namespace {
+
+using Outcome = SessionResumption::Outcome;
+
+constexpr char kClientId[] = "CLIENT";
+constexpr char kServerId[] = "SERVER";
+const ByteArray kClientToServerKey(std::string(SessionKeys::kKeySize, 'c'));
+const ByteArray kServerToClientKey(std::string(SessionKeys::kKeySize, 's'));
+const absl::Time kNow = absl::UnixEpoch() + absl::Hours(1);
+const absl::Time kExpiry = kNow + absl::Minutes(30);
+
+class SessionResumptionTest : public ::testing::Test {
+ protected:
+  // Saves the secret of a session with |client_to_server_key| on both sides.
+  void SaveSession(const ByteArray& client_to_server_key,
+                   absl::Time expiry = kExpiry) {
+    auto client_context =
+        SessionKeys::ToContext(client_to_server_key, kServerToClientKey);
+    auto server_context =
+        SessionKeys::ToContext(kServerToClientKey, client_to_server_key);
+    ASSERT_NE(client_context, nullptr);
+    ASSERT_NE(server_context, nullptr);
+    client_.Save(kServerId, *client_context, /*is_client=*/true, expiry);
+    server_.Save(kClientId, *server_context, /*is_client=*/false, expiry);
+  }
+
+  // Runs the protocol, with |client_session| and |server_session| set when
+  // it succeeds.
+  Outcome Resume() {
+    SessionResumption::Attempt attempt;
+    ByteArray request = client_.CreateRequest(kServerId, kNow, &attempt);
+    if (request.Empty()) return Outcome::kFailed;
+    EXPECT_TRUE(SessionResumption::IsResumptionMessage(request));
+    ByteArray response =
+        server_.HandleRequest(kClientId, request, kNow, &server_session_);
+    EXPECT_TRUE(SessionResumption::IsResumptionMessage(response));
+    return SessionResumption::HandleResponse(attempt, response,
+                                             &client_session_);
+  }
+
+  SessionResumption client_;
+  SessionResumption server_;
+  SessionResumption::Session client_session_;
+  SessionResumption::Session server_session_;
+};
+
+TEST_F(SessionResumptionTest, ResumesWithFreshKeys) {
+  SaveSession(kClientToServerKey);
+
+  ASSERT_EQ(Resume(), Outcome::kResumed);
+
+  ASSERT_NE(client_session_.context, nullptr);
+  ASSERT_NE(server_session_.context, nullptr);
+  ByteArray client_encode_key, client_decode_key;
+  ByteArray server_encode_key, server_decode_key;
+  ASSERT_TRUE(SessionKeys::Read(*client_session_.context, &client_encode_key,
+                                &client_decode_key));
+  ASSERT_TRUE(SessionKeys::Read(*server_session_.context, &server_encode_key,
+                                &server_decode_key));
+  EXPECT_EQ(client_encode_key, server_decode_key);
+  EXPECT_EQ(client_decode_key, server_encode_key);
+  EXPECT_NE(client_encode_key, client_decode_key);
+  EXPECT_NE(client_encode_key, kClientToServerKey);
+  EXPECT_NE(client_decode_key, kServerToClientKey);
+  EXPECT_EQ(client_session_.raw_auth_token, server_session_.raw_auth_token);
+}
+
+TEST_F(SessionResumptionTest, EachResumptionUsesNewKeys) {
+  SaveSession(kClientToServerKey);
+  ASSERT_EQ(Resume(), Outcome::kResumed);
+  ByteArray first_token = client_session_.raw_auth_token;
+
+  SaveSession(kClientToServerKey);
+  ASSERT_EQ(Resume(), Outcome::kResumed);
+
+  EXPECT_NE(client_session_.raw_auth_token, first_token);
+}
+
+TEST_F(SessionResumptionTest, SecretsAreSingleUse) {
+  SaveSession(kClientToServerKey);
+  SessionResumption::Attempt attempt;
+  ByteArray request = client_.CreateRequest(kServerId, kNow, &attempt);
+  ASSERT_FALSE(request.Empty());
+
+  EXPECT_TRUE(client_.CreateRequest(kServerId, kNow, &attempt).Empty());
+  server_.HandleRequest(kClientId, request, kNow, &server_session_);
+  // A replayed request is rejected.
+  ByteArray response =
+      server_.HandleRequest(kClientId, request, kNow, &server_session_);
+  EXPECT_EQ(SessionResumption::HandleResponse(attempt, response,
+                                              &client_session_),
+            Outcome::kRejected);
+}
+
+TEST_F(SessionResumptionTest, ForgedRequestLeavesSecretUsable) {
+  SaveSession(kClientToServerKey);
+  SessionResumption::Attempt attempt;
+  ByteArray request = client_.CreateRequest(kServerId, kNow, &attempt);
+  ASSERT_FALSE(request.Empty());
+  // Same length and header as a real request, but a made up ticket and MAC.
+  ByteArray garbage(std::string(request.data(), request.size()));
+  for (size_t i = request.size() / 2; i < request.size(); i++) {
+    garbage.data()[i] ^= 0x5a;
+  }
+
+  ByteArray rejection =
+      server_.HandleRequest(kClientId, garbage, kNow, &server_session_);
+  EXPECT_EQ(SessionResumption::HandleResponse(attempt, rejection,
+                                              &client_session_),
+            Outcome::kRejected);
+  EXPECT_EQ(server_session_.context, nullptr);
+
+  ByteArray response =
+      server_.HandleRequest(kClientId, request, kNow, &server_session_);
+  EXPECT_EQ(SessionResumption::HandleResponse(attempt, response,
+                                              &client_session_),
+            Outcome::kResumed);
+}
+
+TEST_F(SessionResumptionTest, ExpiredSecretsAreNotUsed) {
+  SaveSession(kClientToServerKey, /*expiry=*/kNow);
+  SessionResumption::Attempt attempt;
+
+  EXPECT_TRUE(client_.CreateRequest(kServerId, kNow, &attempt).Empty());
+}
+
+TEST_F(SessionResumptionTest, ServerWithoutSecretRejects) {
+  auto client_context =
+      SessionKeys::ToContext(kClientToServerKey, kServerToClientKey);
+  client_.Save(kServerId, *client_context, /*is_client=*/true, kExpiry);
+
+  EXPECT_EQ(Resume(), Outcome::kRejected);
+  EXPECT_EQ(server_session_.context, nullptr);
+}
+
+TEST_F(SessionResumptionTest, ServerWithDifferentSecretRejects) {
+  SaveSession(kClientToServerKey);
+  auto other_context = SessionKeys::ToContext(
+      kServerToClientKey, ByteArray(std::string(SessionKeys::kKeySize, 'x')));
+  server_.Save(kClientId, *other_context, /*is_client=*/false, kExpiry);
+
+  EXPECT_EQ(Resume(), Outcome::kRejected);
+  EXPECT_EQ(server_session_.context, nullptr);
+}
+
+TEST_F(SessionResumptionTest, TamperedResponseFails) {
+  SaveSession(kClientToServerKey);
+  SessionResumption::Attempt attempt;
+  ByteArray request = client_.CreateRequest(kServerId, kNow, &attempt);
+  ByteArray response =
+      server_.HandleRequest(kClientId, request, kNow, &server_session_);
+  response.data()[response.size() - 1] ^= 0x01;
+
+  EXPECT_EQ(SessionResumption::HandleResponse(attempt, response,
+                                              &client_session_),
+            Outcome::kFailed);
+  EXPECT_EQ(client_session_.context, nullptr);
+}
+
+TEST_F(SessionResumptionTest, Ukey2MessagesAreNotResumptionMessages) {
+  // Serialized Ukey2Message protos start with their message type field.
+  EXPECT_FALSE(SessionResumption::IsResumptionMessage(
+      ByteArray(std::string("\x08\x01\x12\x40", 4))));
+  EXPECT_FALSE(SessionResumption::IsResumptionMessage(ByteArray()));
+}
+
+TEST_F(SessionResumptionTest, DropsSecretsClosestToExpiryFirst) {
+  auto context = SessionKeys::ToContext(kClientToServerKey, kServerToClientKey);
+  for (int i = 0; i <= SessionResumption::kMaxSecrets; i++) {
+    client_.Save(absl::StrCat("ENDPOINT", i), *context, /*is_client=*/true,
+                 kExpiry + absl::Seconds(i));
+  }
+  SessionResumption::Attempt attempt;
+
+  EXPECT_TRUE(client_.CreateRequest("ENDPOINT0", kNow, &attempt).Empty());
+  EXPECT_FALSE(client_.CreateRequest("ENDPOINT1", kNow, &attempt).Empty());
+}
+
+}  // namespace
+}  // namespace connections
+}  // namespace nearby
+}  // namespace location
@@ -0,0 +1,45 @@
+// Copyright 2021 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "core/internal/token_bucket.h"
+
+#include <algorithm>
+
+namespace location {
+namespace nearby {
+namespace connections {
+
+TokenBucket::TokenBucket(std::int64_t bytes_per_second,
+                         std::int64_t burst_bytes)
+    : bytes_per_second_(std::max<std::int64_t>(bytes_per_second, 1)),
+      burst_bytes_(std::max<std::int64_t>(burst_bytes, 1)),
+      tokens_(static_cast<double>(burst_bytes_)) {}
+
+absl::Duration TokenBucket::Take(std::int64_t bytes, absl::Time now) {
+  if (last_refill_time_ != absl::InfinitePast() && now > last_refill_time_) {
+    tokens_ = std::min<double>(
+        burst_bytes_,
+        tokens_ + absl::ToDoubleSeconds(now - last_refill_time_) *
+                      bytes_per_second_);
+  }
+  last_refill_time_ = std::max(last_refill_time_, now);
+
+  tokens_ -= bytes;
+  if (tokens_ >= 0) return absl::ZeroDuration();
+  return absl::Seconds(-tokens_ / bytes_per_second_);
+}
+
+}  // namespace connections
+}  // namespace nearby
+}  // namespace location
@@ -0,0 +1,56 @@
+// Copyright 2021 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef CORE_INTERNAL_TOKEN_BUCKET_H_
+#define CORE_INTERNAL_TOKEN_BUCKET_H_
+
+#include <cstdint>
+
+#include "absl/time/time.h"
+
+namespace location {
+namespace nearby {
+namespace connections {
+
+// Token bucket rate limiter, measured in bytes.
+//
+// The bucket refills at |bytes_per_second| and holds at most |burst_bytes|,
+// so after an idle period up to |burst_bytes| may be sent without delay.
+// Callers pass the current time in, which keeps the arithmetic deterministic
+// under test. Not thread safe.
+class TokenBucket {
+ public:
+  // |bytes_per_second| and |burst_bytes| must be positive.
+  TokenBucket(std::int64_t bytes_per_second, std::int64_t burst_bytes);
+
+  // Takes |bytes| tokens at time |now| and returns how long the caller must
+  // wait before sending them. Tokens may be borrowed from the future, so a
+  // frame larger than the burst still goes out, after a proportional delay.
+  absl::Duration Take(std::int64_t bytes, absl::Time now);
+
+  std::int64_t GetBytesPerSecond() const { return bytes_per_second_; }
+
+ private:
+  std::int64_t bytes_per_second_;
+  std::int64_t burst_bytes_;
+  // May go negative while tokens are borrowed.
+  double tokens_;
+  absl::Time last_refill_time_ = absl::InfinitePast();
+};
+
+}  // namespace connections
+}  // namespace nearby
+}  // namespace location
+
+#endif  // CORE_INTERNAL_TOKEN_BUCKET_H_
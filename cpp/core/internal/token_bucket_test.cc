@@ -0,0 +1,80 @@
+// Copyright 2021 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "core/internal/token_bucket.h"
+
+#include "gtest/gtest.h"
+#include "absl/time/time.h"
+
+namespace location {
+namespace nearby {
+namespace connections {
+namespace {
+
+constexpr std::int64_t kBytesPerSecond = 1000;
+constexpr std::int64_t kBurstBytes = 100;
+
+TEST(TokenBucketTest, BurstGoesOutImmediately) {
+  TokenBucket bucket(kBytesPerSecond, kBurstBytes);
+  absl::Time now = absl::UnixEpoch();
+
+  EXPECT_EQ(bucket.Take(kBurstBytes, now), absl::ZeroDuration());
+}
+
+TEST(TokenBucketTest, BorrowedTokensDelaySender) {
+  TokenBucket bucket(kBytesPerSecond, kBurstBytes);
+  absl::Time now = absl::UnixEpoch();
+
+  EXPECT_EQ(bucket.Take(kBurstBytes, now), absl::ZeroDuration());
+  EXPECT_EQ(bucket.Take(500, now), absl::Milliseconds(500));
+}
+
+TEST(TokenBucketTest, RefillsOverTime) {
+  TokenBucket bucket(kBytesPerSecond, kBurstBytes);
+  absl::Time now = absl::UnixEpoch();
+
+  bucket.Take(kBurstBytes, now);
+  now += absl::Milliseconds(50);
+
+  EXPECT_EQ(bucket.Take(50, now), absl::ZeroDuration());
+  EXPECT_EQ(bucket.Take(50, now), absl::Milliseconds(50));
+}
+
+TEST(TokenBucketTest, RefillIsCappedByBurst) {
+  TokenBucket bucket(kBytesPerSecond, kBurstBytes);
+  absl::Time now = absl::UnixEpoch();
+
+  bucket.Take(kBurstBytes, now);
+  now += absl::Seconds(10);
+
+  EXPECT_EQ(bucket.Take(kBurstBytes, now), absl::ZeroDuration());
+  EXPECT_EQ(bucket.Take(kBurstBytes, now), absl::Milliseconds(100));
+}
+
+TEST(TokenBucketTest, SustainedThroughputMatchesRate) {
+  TokenBucket bucket(kBytesPerSecond, kBurstBytes);
+  absl::Time now = absl::UnixEpoch();
+
+  // A sender that waits as told pushes exactly rate * time after the burst.
+  for (int i = 0; i < 100; i++) {
+    now += bucket.Take(100, now);
+  }
+
+  EXPECT_EQ(now - absl::UnixEpoch(), absl::Milliseconds(9900));
+}
+
+}  // namespace
+}  // namespace connections
+}  // namespace nearby
+}  // namespace location
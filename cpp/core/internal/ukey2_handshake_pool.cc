@@ -0,0 +1,151 @@
+// Copyright 2021 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "core/internal/ukey2_handshake_pool.h"
+
+#include <algorithm>
+#include <utility>
+
+#include "platform/public/mutex_lock.h"
+#include "platform/public/system_clock.h"
+
+namespace location {
+namespace nearby {
+namespace connections {
+
+namespace {
+
+// Handshakes are replaced once they have used up this part of their lifetime,
+// leaving the rest of it for the replacement to be generated.
+constexpr int kReplaceAfterPercent = 80;
+
+}  // namespace
+
+Ukey2HandshakePool::Ukey2HandshakePool(Factory factory, std::int32_t capacity,
+                                       absl::Duration lifetime)
+    : factory_(std::move(factory)),
+      capacity_(capacity),
+      lifetime_(lifetime),
+      replace_before_expiry_(lifetime * (100 - kReplaceAfterPercent) / 100) {
+  MutexLock lock(&mutex_);
+  ScheduleRefill();
+}
+
+Ukey2HandshakePool::~Ukey2HandshakePool() { executor_.Shutdown(); }
+
+std::unique_ptr<securegcm::UKey2Handshake> Ukey2HandshakePool::Take() {
+  {
+    MutexLock lock(&mutex_);
+    DropExpired(SystemClock::ElapsedRealtime());
+    ScheduleRefill();
+    if (!entries_.empty()) {
+      // Use the newest handshake; it has the longest left to live.
+      auto handshake = std::move(entries_.back().handshake);
+      entries_.pop_back();
+      hits_++;
+      return handshake;
+    }
+    misses_++;
+  }
+  return factory_();
+}
+
+std::int32_t Ukey2HandshakePool::GetSize() const {
+  MutexLock lock(&mutex_);
+  return entries_.size();
+}
+
+std::int32_t Ukey2HandshakePool::GetHits() const {
+  MutexLock lock(&mutex_);
+  return hits_;
+}
+
+std::int32_t Ukey2HandshakePool::GetMisses() const {
+  MutexLock lock(&mutex_);
+  return misses_;
+}
+
+void Ukey2HandshakePool::ScheduleRefill() {
+  if (capacity_ <= 0 || refill_pending_) return;
+  refill_pending_ = true;
+  executor_.Execute("ukey2-pool-refill", [this]() { Refill(); });
+}
+
+void Ukey2HandshakePool::Refill() {
+  // Handshakes due to be replaced stay usable until their replacements exist.
+  std::size_t due = 0;
+  {
+    MutexLock lock(&mutex_);
+    absl::Time now = SystemClock::ElapsedRealtime();
+    DropExpired(now);
+    while (due < entries_.size() &&
+           entries_[due].created_at + lifetime_ - replace_before_expiry_ <=
+               now) {
+      due++;
+    }
+  }
+  while (true) {
+    {
+      MutexLock lock(&mutex_);
+      due = std::min(due, entries_.size());
+      if (entries_.size() - due >= static_cast<std::size_t>(capacity_)) {
+        refill_pending_ = false;
+        ScheduleReplacement(SystemClock::ElapsedRealtime());
+        return;
+      }
+    }
+    // Generating the key pair is the expensive part; don't hold the lock.
+    auto handshake = factory_();
+    absl::Time now = SystemClock::ElapsedRealtime();
+    MutexLock lock(&mutex_);
+    if (handshake == nullptr) {
+      refill_pending_ = false;
+      return;
+    }
+    entries_.push_back({std::move(handshake), now});
+    if (due > 0) {
+      entries_.pop_front();
+      due--;
+    }
+  }
+}
+
+void Ukey2HandshakePool::ScheduleReplacement(absl::Time now) {
+  // Without a margin, handshakes would be replaced as soon as they exist.
+  if (entries_.empty() || replace_before_expiry_ <= absl::ZeroDuration()) {
+    return;
+  }
+  absl::Time replace_at =
+      entries_.front().created_at + lifetime_ - replace_before_expiry_;
+  // An earlier replacement schedules the next one when it is done.
+  if (replace_at_ <= replace_at) return;
+  replace_at_ = replace_at;
+  executor_.Schedule(
+      [this]() {
+        MutexLock lock(&mutex_);
+        replace_at_ = absl::InfiniteFuture();
+        ScheduleRefill();
+      },
+      std::max(replace_at - now, absl::ZeroDuration()));
+}
+
+void Ukey2HandshakePool::DropExpired(absl::Time now) {
+  while (!entries_.empty() && entries_.front().created_at + lifetime_ <= now) {
+    entries_.pop_front();
+  }
+}
+
+}  // namespace connections
+}  // namespace nearby
+}  // namespace location
@@ -0,0 +1,101 @@
+// Copyright 2021 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef CORE_INTERNAL_UKEY2_HANDSHAKE_POOL_H_
+#define CORE_INTERNAL_UKEY2_HANDSHAKE_POOL_H_
+
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+
+#include "securegcm/ukey2_handshake.h"
+#include "absl/base/thread_annotations.h"
+#include "absl/time/time.h"
+#include "platform/public/mutex.h"
+#include "platform/public/scheduled_executor.h"
+
+namespace location {
+namespace nearby {
+namespace connections {
+
+// Keeps unused UKEY2 handshakes around, so that generating their ephemeral key
+// pairs happens in the background instead of on the handshake's critical
+// path. UKey2Handshake generates its key pair when it is created and can't be
+// handed one, so the pool holds whole handshakes; each one is used at most
+// once.
+//
+// Handshakes older than |lifetime| are thrown away instead of being used, to
+// bound how long an ephemeral key exists before it is used. Handshakes are
+// replaced in the background shortly before that, so that the pool stays full
+// while no handshakes are taken.
+class Ukey2HandshakePool {
+ public:
+  using Factory = std::function<std::unique_ptr<securegcm::UKey2Handshake>()>;
+
+  // Starts filling the pool with up to |capacity| handshakes from |factory|.
+  // A |capacity| of 0 disables pooling; Take() then always calls |factory|.
+  Ukey2HandshakePool(Factory factory, std::int32_t capacity,
+                     absl::Duration lifetime);
+  ~Ukey2HandshakePool();
+
+  // Returns an unused handshake, creating one on the spot if the pool has
+  // none, and refills the pool in the background.
+  // @AnyThread
+  std::unique_ptr<securegcm::UKey2Handshake> Take()
+      ABSL_LOCKS_EXCLUDED(mutex_);
+
+  // Number of handshakes ready to be taken, including expired ones.
+  std::int32_t GetSize() const ABSL_LOCKS_EXCLUDED(mutex_);
+  // Number of Take() calls served from the pool, and created on the spot.
+  std::int32_t GetHits() const ABSL_LOCKS_EXCLUDED(mutex_);
+  std::int32_t GetMisses() const ABSL_LOCKS_EXCLUDED(mutex_);
+
+ private:
+  struct Entry {
+    std::unique_ptr<securegcm::UKey2Handshake> handshake;
+    absl::Time created_at;
+  };
+
+  void ScheduleRefill() ABSL_EXCLUSIVE_LOCKS_REQUIRED(mutex_);
+  void Refill() ABSL_LOCKS_EXCLUDED(mutex_);
+  // Schedules a refill for when the oldest handshake is due to be replaced.
+  void ScheduleReplacement(absl::Time now)
+      ABSL_EXCLUSIVE_LOCKS_REQUIRED(mutex_);
+  void DropExpired(absl::Time now) ABSL_EXCLUSIVE_LOCKS_REQUIRED(mutex_);
+
+  const Factory factory_;
+  const std::int32_t capacity_;
+  const absl::Duration lifetime_;
+  // How long before expiring a handshake is replaced.
+  const absl::Duration replace_before_expiry_;
+
+  mutable Mutex mutex_;
+  // Oldest first.
+  std::deque<Entry> entries_ ABSL_GUARDED_BY(mutex_);
+  bool refill_pending_ ABSL_GUARDED_BY(mutex_) = false;
+  // When the next scheduled replacement runs; InfiniteFuture() if none is.
+  absl::Time replace_at_ ABSL_GUARDED_BY(mutex_) = absl::InfiniteFuture();
+  std::int32_t hits_ ABSL_GUARDED_BY(mutex_) = 0;
+  std::int32_t misses_ ABSL_GUARDED_BY(mutex_) = 0;
+
+  // Destroyed first, so that no refill outlives the members above.
+  ScheduledExecutor executor_;
+};
+
+}  // namespace connections
+}  // namespace nearby
+}  // namespace location
+
+#endif  // CORE_INTERNAL_UKEY2_HANDSHAKE_POOL_H_
@@ -0,0 +1,107 @@
+// Copyright 2021 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "core/internal/ukey2_handshake_pool.h"
+
+#include <atomic>
+
+#include "gtest/gtest.h"
+#include "absl/time/clock.h"
+#include "absl/time/time.h"
+
+namespace location {
+namespace nearby {
+namespace connections {
+namespace {
+
+using ::securegcm::UKey2Handshake;
+
+constexpr absl::Duration kLifetime = absl::Minutes(5);
+
+class Ukey2HandshakePoolTest : public ::testing::Test {
+ protected:
+  Ukey2HandshakePool::Factory GetFactory() {
+    return [this]() {
+      created_++;
+      return UKey2Handshake::ForInitiator(
+          UKey2Handshake::HandshakeCipher::P256_SHA512);
+    };
+  }
+
+  // Waits for the background refill to bring |pool| to |size|.
+  static bool AwaitSize(const Ukey2HandshakePool& pool, std::int32_t size) {
+    absl::Time deadline = absl::Now() + absl::Seconds(5);
+    while (pool.GetSize() != size) {
+      if (absl::Now() > deadline) return false;
+      absl::SleepFor(absl::Milliseconds(10));
+    }
+    return true;
+  }
+
+  std::atomic_int created_{0};
+};
+
+TEST_F(Ukey2HandshakePoolTest, DisabledPoolCreatesHandshakesOnTake) {
+  Ukey2HandshakePool pool(GetFactory(), /*capacity=*/0, kLifetime);
+
+  EXPECT_NE(pool.Take(), nullptr);
+  EXPECT_EQ(created_, 1);
+  EXPECT_EQ(pool.GetSize(), 0);
+  EXPECT_EQ(pool.GetMisses(), 1);
+}
+
+TEST_F(Ukey2HandshakePoolTest, FillsInBackground) {
+  Ukey2HandshakePool pool(GetFactory(), /*capacity=*/2, kLifetime);
+  ASSERT_TRUE(AwaitSize(pool, 2));
+
+  auto first = pool.Take();
+  auto second = pool.Take();
+
+  EXPECT_NE(first, nullptr);
+  EXPECT_NE(second, nullptr);
+  EXPECT_NE(first, second);
+  EXPECT_EQ(pool.GetHits(), 2);
+  EXPECT_EQ(pool.GetMisses(), 0);
+  EXPECT_TRUE(AwaitSize(pool, 2));
+}
+
+TEST_F(Ukey2HandshakePoolTest, ExpiredHandshakesAreNotUsed) {
+  Ukey2HandshakePool pool(GetFactory(), /*capacity=*/1,
+                          /*lifetime=*/absl::ZeroDuration());
+  ASSERT_TRUE(AwaitSize(pool, 1));
+
+  EXPECT_NE(pool.Take(), nullptr);
+  EXPECT_EQ(pool.GetHits(), 0);
+  EXPECT_EQ(pool.GetMisses(), 1);
+}
+
+TEST_F(Ukey2HandshakePoolTest, StaysFullWhileIdle) {
+  constexpr absl::Duration kShortLifetime = absl::Seconds(1);
+  Ukey2HandshakePool pool(GetFactory(), /*capacity=*/1, kShortLifetime);
+  ASSERT_TRUE(AwaitSize(pool, 1));
+
+  // Nothing is taken for several lifetimes; the handshake in the pool is
+  // replaced before it expires.
+  absl::SleepFor(3 * kShortLifetime);
+
+  EXPECT_NE(pool.Take(), nullptr);
+  EXPECT_EQ(pool.GetHits(), 1);
+  EXPECT_EQ(pool.GetMisses(), 0);
+  EXPECT_GT(created_, 1);
+}
+
+}  // namespace
+}  // namespace connections
+}  // namespace nearby
+}  // namespace location
@@ -22,6 +22,7 @@
 #include "core/internal/mediums/webrtc_peer_id.h"
 #include "core/internal/offline_frames.h"
 #include "core/internal/webrtc_endpoint_channel.h"
+#include "platform/public/tracing.h"
 
 namespace location {
 namespace nearby {
@@ -122,9 +123,11 @@ WebrtcBwuHandler::CreateUpgradedEndpointChannel(
              "location hint %s",
              peer_id.GetId().c_str(), location_hint.DebugString().c_str());
 
+  TraceSpan connect_span("medium", "webrtc_connect", endpoint_id);
   mediums::WebRtcSocketWrapper socket =
       webrtc_.Connect(service_id, peer_id, location_hint,
                       client->GetCancellationFlag(endpoint_id));
+  connect_span.End();
   if (!socket.IsValid()) {
     NEARBY_LOG(ERROR,
                "WebRtcBwuHandler failed to connect to remote peer (%s) on "
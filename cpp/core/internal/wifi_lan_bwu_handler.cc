@@ -23,6 +23,7 @@
 #include "core/internal/offline_frames.h"
 #include "core/internal/wifi_lan_endpoint_channel.h"
 #include "platform/public/wifi_lan.h"
+#include "platform/public/tracing.h"
 
 namespace location {
 namespace nearby {
@@ -120,8 +121,10 @@ WifiLanBwuHandler::CreateUpgradedEndpointChannel(
                        << ip_address << ":" << port << ") for endpoint "
                        << endpoint_id;
 
+  TraceSpan connect_span("medium", "wifi_lan_connect", endpoint_id);
   WifiLanSocket socket = wifi_lan_medium_.Connect(
       service_id, ip_address, port, client->GetCancellationFlag(endpoint_id));
+  connect_span.End();
   if (!socket.IsValid()) {
     NEARBY_LOGS(ERROR)
         << "WifiLanBwuHandler failed to connect to the WifiLan service ("
@@ -16,12 +16,11 @@
 
 #include <inttypes.h>
 
+#include <algorithm>
 #include <cstring>
 #include <utility>
 
-#include "absl/strings/str_cat.h"
 #include "platform/base/base64_utils.h"
-#include "platform/base/base_input_stream.h"
 #include "platform/public/logging.h"
 
 namespace location {
@@ -63,41 +62,91 @@ WifiLanServiceInfo::WifiLanServiceInfo(Version version, Pcp pcp,
   web_rtc_state_ = web_rtc_state;
 }
 
-WifiLanServiceInfo::WifiLanServiceInfo(const NsdServiceInfo& nsd_service_info) {
-  auto txt_endpoint_info_name =
-      nsd_service_info.GetTxtRecord(std::string(kKeyEndpointInfo));
-  if (!txt_endpoint_info_name.empty()) {
-    endpoint_info_ = Base64Utils::Decode(txt_endpoint_info_name);
-    if (endpoint_info_.size() > kMaxEndpointInfoLength) {
+bool WifiLanServiceInfo::MayMatch(absl::string_view service_name, Pcp pcp,
+                                  const ByteArray& service_id_hash) {
+  char header[kHeaderLength];
+  // Leave names that aren't plain base64 to the full parser.
+  if (!Base64Utils::DecodePrefix(service_name, header, kHeaderLength)) {
+    return true;
+  }
+
+  char expected_version_and_pcp_byte = static_cast<char>(
+      ((static_cast<uint32_t>(Version::kV1) << kVersionShift) &
+       kVersionBitmask) |
+      (static_cast<uint32_t>(pcp) & kPcpBitmask));
+  if (header[0] != expected_version_and_pcp_byte) return false;
+
+  return service_id_hash.size() == kServiceIdHashLength &&
+         std::memcmp(header + 1 + kEndpointIdLength, service_id_hash.data(),
+                     kServiceIdHashLength) == 0;
+}
+
+WifiLanServiceInfo::WifiLanServiceInfo(const NsdServiceInfo& nsd_service_info)
+    : WifiLanServiceInfo(View(
+          nsd_service_info.GetServiceName(),
+          nsd_service_info.GetTxtRecord(std::string(kKeyEndpointInfo)))) {}
+
+WifiLanServiceInfo::WifiLanServiceInfo(const View& view)
+    : version_(view.GetVersion()),
+      pcp_(view.GetPcp()),
+      endpoint_id_(view.GetEndpointId()),
+      service_id_hash_(view.GetServiceIdHash().data(),
+                       view.GetServiceIdHash().size()),
+      endpoint_info_(view.GetEndpointInfo().data(),
+                     view.GetEndpointInfo().size()),
+      uwb_address_(view.GetUwbAddress().data(), view.GetUwbAddress().size()),
+      web_rtc_state_(view.GetWebRtcState()) {}
+
+WifiLanServiceInfo::View::View(absl::string_view service_name,
+                               absl::string_view endpoint_info) {
+  if (!endpoint_info.empty()) {
+    int endpoint_info_size =
+        Base64Utils::DecodeTo(endpoint_info, endpoint_info_bytes_,
+                              sizeof(endpoint_info_bytes_));
+    if (endpoint_info_size > kMaxEndpointInfoLength) {
       NEARBY_LOG(INFO,
                  "Cannot deserialize EndpointInfo: expecting endpoint info "
-                 "max %d raw bytes, got %" PRIu64,
-                 kMaxEndpointInfoLength, endpoint_info_.size());
+                 "max %d raw bytes, got %d",
+                 kMaxEndpointInfoLength, endpoint_info_size);
       return;
     }
+    if (endpoint_info_size > 0) {
+      endpoint_info_ =
+          absl::string_view(endpoint_info_bytes_, endpoint_info_size);
+    }
   }
 
-  auto service_info_name = nsd_service_info.GetServiceName();
-  ByteArray service_info_bytes = Base64Utils::Decode(service_info_name);
-  if (service_info_bytes.Empty()) {
+  int decoded_size = Base64Utils::DecodeTo(service_name, service_name_bytes_,
+                                           sizeof(service_name_bytes_));
+  if (decoded_size <= 0) {
     NEARBY_LOG(
         INFO,
         "Cannot deserialize WifiLanServiceInfo: failed Base64 decoding of %s",
-        std::string(service_info_name).c_str());
+        std::string(service_name).c_str());
     return;
   }
 
-  if (service_info_bytes.size() < kMinLanServiceNameLength) {
+  if (decoded_size < kMinLanServiceNameLength) {
     NEARBY_LOG(INFO,
                "Cannot deserialize WifiLanServiceInfo: expecting min %d raw "
-               "bytes, got %" PRIu64,
-               kMinLanServiceNameLength, service_info_bytes.size());
+               "bytes, got %d",
+               kMinLanServiceNameLength, decoded_size);
     return;
   }
 
-  BaseInputStream base_input_stream{service_info_bytes};
+  // Returns the next |size| bytes, or nothing if there aren't that many left.
+  absl::string_view remaining(
+      service_name_bytes_,
+      std::min<std::size_t>(decoded_size, sizeof(service_name_bytes_)));
+  auto read = [&remaining](std::size_t size) -> absl::string_view {
+    if (remaining.size() < size) return {};
+    absl::string_view bytes = remaining.substr(0, size);
+    remaining.remove_prefix(size);
+    return bytes;
+  };
+
   // The first 1 byte is supposed to be the version and pcp.
-  auto version_and_pcp_byte = static_cast<char>(base_input_stream.ReadUint8());
+  char version_and_pcp_byte = read(1)[0];
   // The upper 3 bits are supposed to be the version.
   version_ =
       static_cast<Version>((version_and_pcp_byte & kVersionBitmask) >> 5);
@@ -121,35 +170,34 @@ WifiLanServiceInfo::WifiLanServiceInfo(const NsdServiceInfo& nsd_service_info) {
   }
 
   // The next 4 bytes are supposed to be the endpoint_id.
-  endpoint_id_ = std::string{base_input_stream.ReadBytes(kEndpointIdLength)};
+  endpoint_id_ = read(kEndpointIdLength);
 
   // The next 3 bytes are supposed to be the service_id_hash.
-  service_id_hash_ = base_input_stream.ReadBytes(kServiceIdHashLength);
+  service_id_hash_ = read(kServiceIdHashLength);
 
   // The next 1 byte is supposed to be the length of the uwb_address. If
   // available, continues to deserialize UWB address and extra field of WebRtc
   // state.
-  if (base_input_stream.IsAvailable(1)) {
-    std::uint32_t expected_uwb_address_length = base_input_stream.ReadUint8();
+  if (!remaining.empty()) {
+    std::uint32_t expected_uwb_address_length =
+        static_cast<std::uint8_t>(read(kUwbAddressLengthSize)[0]);
     // If the length of uwb_address is not zero, then retrieve it.
     if (expected_uwb_address_length != 0) {
-      uwb_address_ = base_input_stream.ReadBytes(expected_uwb_address_length);
-      if (uwb_address_.Empty() ||
-          uwb_address_.size() != expected_uwb_address_length) {
+      uwb_address_ = read(expected_uwb_address_length);
+      if (uwb_address_.empty()) {
         NEARBY_LOG(INFO,
                    "Cannot deserialize WifiLanServiceInfo: expected "
                    "uwbAddress size to be %d bytes, got %" PRIu64,
-                   expected_uwb_address_length, uwb_address_.size());
+                   expected_uwb_address_length, remaining.size());
         // Clear enpoint_id for validity.
-        endpoint_id_.clear();
+        endpoint_id_ = {};
         return;
       }
     }
 
     // The next 1 byte is extra field.
-    web_rtc_state_ = WebRtcState::kUndefined;
-    if (base_input_stream.IsAvailable(kExtraFieldLength)) {
-      auto extra_field = static_cast<char>(base_input_stream.ReadUint8());
+    if (remaining.size() >= kExtraFieldLength) {
+      char extra_field = read(kExtraFieldLength)[0];
       web_rtc_state_ = (extra_field & kWebRtcConnectableFlagBitmask) == 1
                            ? WebRtcState::kConnectable
                            : WebRtcState::kUnconnectable;
@@ -158,46 +206,65 @@ WifiLanServiceInfo::WifiLanServiceInfo(const NsdServiceInfo& nsd_service_info) {
 }
 
 WifiLanServiceInfo::operator NsdServiceInfo() const {
-  if (!IsValid()) {
+  char service_name[kMaxServiceNameLength];
+  std::size_t service_name_size =
+      SerializeServiceNameTo(service_name, sizeof(service_name));
+  if (service_name_size == 0) {
     return {};
   }
 
+  NsdServiceInfo nsd_service_info;
+  nsd_service_info.SetServiceName(
+      std::string(service_name, service_name_size));
+  nsd_service_info.SetTxtRecord(std::string(kKeyEndpointInfo),
+                                Base64Utils::Encode(endpoint_info_));
+  return nsd_service_info;
+}
+
+std::size_t WifiLanServiceInfo::SerializeServiceNameTo(
+    char* buffer, std::size_t size) const {
+  if (!IsValid() || uwb_address_.size() > kMaxUwbAddressLength) {
+    return 0;
+  }
+
+  char bytes[kMaxServiceNameBytesLength];
+  char* out = bytes;
+  auto write = [&out](const char* data, std::size_t data_size) {
+    std::memcpy(out, data, data_size);
+    out += data_size;
+  };
+
   // The upper 3 bits are the Version.
   auto version_and_pcp_byte = static_cast<char>(
       (static_cast<uint32_t>(Version::kV1) << 5) & kVersionBitmask);
   // The lower 5 bits are the PCP.
   version_and_pcp_byte |=
       static_cast<char>(static_cast<uint32_t>(pcp_) & kPcpBitmask);
+  *out++ = version_and_pcp_byte;
 
-  std::string out = absl::StrCat(std::string(1, version_and_pcp_byte),
-                                 endpoint_id_, std::string(service_id_hash_));
+  write(endpoint_id_.data(), endpoint_id_.size());
+  write(service_id_hash_.data(), service_id_hash_.size());
 
   // The next bytes are UWB address field.
   if (!uwb_address_.Empty()) {
-    absl::StrAppend(&out, std::string(1, uwb_address_.size()));
-    absl::StrAppend(&out, std::string(uwb_address_));
-  } else {
+    *out++ = static_cast<char>(uwb_address_.size());
+    write(uwb_address_.data(), uwb_address_.size());
+  } else if (web_rtc_state_ != WebRtcState::kUndefined) {
     // Write UWB address with length 0 to be able to read the next field, which
     // needs to be appended.
-    if (web_rtc_state_ != WebRtcState::kUndefined)
-      absl::StrAppend(&out, std::string(1, uwb_address_.size()));
+    *out++ = 0;
   }
 
   // The next 1 byte is extra field.
   if (web_rtc_state_ != WebRtcState::kUndefined) {
     int web_rtc_connectable_flag =
         (web_rtc_state_ == WebRtcState::kConnectable) ? 1 : 0;
-    char field_byte = static_cast<char>(web_rtc_connectable_flag) &
-                      kWebRtcConnectableFlagBitmask;
-    absl::StrAppend(&out, std::string(1, field_byte));
+    *out++ = static_cast<char>(web_rtc_connectable_flag) &
+             kWebRtcConnectableFlagBitmask;
   }
 
-  NsdServiceInfo nsd_service_info;
-  nsd_service_info.SetServiceName(
-      Base64Utils::Encode(ByteArray{std::move(out)}));
-  nsd_service_info.SetTxtRecord(std::string(kKeyEndpointInfo),
-                                Base64Utils::Encode(endpoint_info_));
-  return nsd_service_info;
+  return Base64Utils::EncodeTo(absl::string_view(bytes, out - bytes), buffer,
+                               size);
 }
 
 }  // namespace connections
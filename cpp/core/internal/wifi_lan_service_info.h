@@ -15,7 +15,9 @@
 #ifndef CORE_INTERNAL_WIFI_LAN_SERVICE_INFO_H_
 #define CORE_INTERNAL_WIFI_LAN_SERVICE_INFO_H_
 
+#include <cstddef>
 #include <cstdint>
+#include <string>
 
 #include "absl/strings/string_view.h"
 #include "core/internal/base_pcp_handler.h"
@@ -44,6 +46,59 @@ class WifiLanServiceInfo {
   static constexpr std::uint32_t kServiceIdHashLength = 3;
   static constexpr int kMaxEndpointInfoLength = 131;
 
+ private:
+  static constexpr int kMinLanServiceNameLength = 9;
+  static constexpr int kEndpointIdLength = 4;
+  static constexpr int kUwbAddressLengthSize = 1;
+  static constexpr int kExtraFieldLength = 1;
+  // The UWB address size is written in a single byte.
+  static constexpr int kMaxUwbAddressLength = 0x0FF;
+
+  // Version and PCP, endpoint_id, and service_id_hash.
+  static constexpr int kHeaderLength =
+      1 + kEndpointIdLength + kServiceIdHashLength;
+  static constexpr int kMaxServiceNameBytesLength =
+      kHeaderLength + kUwbAddressLengthSize + kMaxUwbAddressLength +
+      kExtraFieldLength;
+
+ public:
+  // Base64 takes 4 characters for every 3 bytes, without padding.
+  static constexpr int kMaxServiceNameLength =
+      (kMaxServiceNameBytesLength * 8 + 5) / 6;
+
+  // A parsed service that keeps its decoded bytes inline, and points into
+  // them rather than copying each field, so that discovered services can be
+  // inspected without allocating. Not copyable, since the accessors point
+  // into the View itself.
+  class View {
+   public:
+    // |endpoint_info| is the base64 encoded kKeyEndpointInfo TXT record.
+    View(absl::string_view service_name, absl::string_view endpoint_info);
+    View(const View&) = delete;
+    View& operator=(const View&) = delete;
+
+    bool IsValid() const { return !endpoint_id_.empty(); }
+    Version GetVersion() const { return version_; }
+    Pcp GetPcp() const { return pcp_; }
+    absl::string_view GetEndpointId() const { return endpoint_id_; }
+    absl::string_view GetEndpointInfo() const { return endpoint_info_; }
+    absl::string_view GetServiceIdHash() const { return service_id_hash_; }
+    absl::string_view GetUwbAddress() const { return uwb_address_; }
+    WebRtcState GetWebRtcState() const { return web_rtc_state_; }
+
+   private:
+    Version version_{Version::kUndefined};
+    Pcp pcp_{Pcp::kUnknown};
+    absl::string_view endpoint_id_;
+    absl::string_view endpoint_info_;
+    absl::string_view service_id_hash_;
+    absl::string_view uwb_address_;
+    WebRtcState web_rtc_state_{WebRtcState::kUndefined};
+    // Bytes past the end of the longest possible service name are ignored.
+    char service_name_bytes_[kMaxServiceNameBytesLength];
+    char endpoint_info_bytes_[kMaxEndpointInfoLength];
+  };
+
   WifiLanServiceInfo() = default;
   WifiLanServiceInfo(Version version, Pcp pcp, absl::string_view endpoint_id,
                      const ByteArray& service_id_hash,
@@ -52,29 +107,37 @@ class WifiLanServiceInfo {
 
   // Constructs WifiLanServiceInfo through NsdServiceInfo.
   explicit WifiLanServiceInfo(const NsdServiceInfo& nsd_service_info);
+  explicit WifiLanServiceInfo(const View& view);
   WifiLanServiceInfo(const WifiLanServiceInfo&) = default;
   WifiLanServiceInfo& operator=(const WifiLanServiceInfo&) = default;
   WifiLanServiceInfo(WifiLanServiceInfo&&) = default;
   WifiLanServiceInfo& operator=(WifiLanServiceInfo&&) = default;
   ~WifiLanServiceInfo() = default;
 
+  // Returns false if |service_name| can't be the name of a valid service for
+  // |pcp| and |service_id_hash|. Only the fixed-size header is decoded,
+  // without allocating, so foreign services can be dropped as soon as they're
+  // discovered.
+  static bool MayMatch(absl::string_view service_name, Pcp pcp,
+                       const ByteArray& service_id_hash);
+
   explicit operator NsdServiceInfo() const;
 
+  // Writes the base64 encoded service name into |buffer|, and returns its
+  // size; or 0 if the service is invalid, or the name doesn't fit in |size|
+  // characters. kMaxServiceNameLength characters are always enough.
+  std::size_t SerializeServiceNameTo(char* buffer, std::size_t size) const;
+
   bool IsValid() const { return !endpoint_id_.empty(); }
   Version GetVersion() const { return version_; }
   Pcp GetPcp() const { return pcp_; }
-  std::string GetEndpointId() const { return endpoint_id_; }
-  ByteArray GetEndpointInfo() const { return endpoint_info_; }
-  ByteArray GetServiceIdHash() const { return service_id_hash_; }
-  ByteArray GetUwbAddress() const { return uwb_address_; }
+  const std::string& GetEndpointId() const { return endpoint_id_; }
+  const ByteArray& GetEndpointInfo() const { return endpoint_info_; }
+  const ByteArray& GetServiceIdHash() const { return service_id_hash_; }
+  const ByteArray& GetUwbAddress() const { return uwb_address_; }
   WebRtcState GetWebRtcState() const { return web_rtc_state_; }
 
  private:
-  static constexpr int kMinLanServiceNameLength = 9;
-  static constexpr int kEndpointIdLength = 4;
-  static constexpr int kUwbAddressLengthSize = 1;
-  static constexpr int kExtraFieldLength = 1;
-
   static constexpr int kVersionBitmask = 0x0E0;
   static constexpr int kPcpBitmask = 0x01F;
   static constexpr int kVersionShift = 5;
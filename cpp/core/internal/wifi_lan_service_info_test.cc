@@ -165,6 +165,78 @@ TEST(WifiLanServiceInfoTest, ConstructionFailsWithLongEndpointInfoLength) {
   EXPECT_FALSE(wifi_lan_service_info.IsValid());
 }
 
+TEST(WifiLanServiceInfoTest, ViewParsesServiceInfo) {
+  ByteArray service_id_hash{std::string(kServiceIDHashBytes)};
+  ByteArray endpoint_info{std::string(kEndPointName)};
+  WifiLanServiceInfo org_wifi_lan_service_info{
+      kVersion,      kPcp,        kEndPointID, service_id_hash,
+      endpoint_info, ByteArray{}, kWebRtcState};
+  NsdServiceInfo nsd_service_info{org_wifi_lan_service_info};
+  std::string service_name = nsd_service_info.GetServiceName();
+  std::string txt_endpoint_info = nsd_service_info.GetTxtRecord(
+      std::string(WifiLanServiceInfo::kKeyEndpointInfo));
+
+  WifiLanServiceInfo::View view{service_name, txt_endpoint_info};
+
+  EXPECT_TRUE(view.IsValid());
+  EXPECT_EQ(kVersion, view.GetVersion());
+  EXPECT_EQ(kPcp, view.GetPcp());
+  EXPECT_EQ(kEndPointID, view.GetEndpointId());
+  EXPECT_EQ(kServiceIDHashBytes, view.GetServiceIdHash());
+  EXPECT_EQ(kEndPointName, view.GetEndpointInfo());
+
+  WifiLanServiceInfo wifi_lan_service_info{view};
+
+  EXPECT_TRUE(wifi_lan_service_info.IsValid());
+  EXPECT_EQ(kEndPointID, wifi_lan_service_info.GetEndpointId());
+  EXPECT_EQ(endpoint_info, wifi_lan_service_info.GetEndpointInfo());
+  EXPECT_EQ(kWebRtcState, wifi_lan_service_info.GetWebRtcState());
+}
+
+TEST(WifiLanServiceInfoTest, SerializeServiceNameToMatchesNsdServiceInfo) {
+  ByteArray service_id_hash{std::string(kServiceIDHashBytes)};
+  ByteArray endpoint_info{std::string(kEndPointName)};
+  WifiLanServiceInfo wifi_lan_service_info{
+      kVersion,      kPcp,        kEndPointID, service_id_hash,
+      endpoint_info, ByteArray{}, kWebRtcState};
+  NsdServiceInfo nsd_service_info{wifi_lan_service_info};
+  char buffer[WifiLanServiceInfo::kMaxServiceNameLength];
+
+  std::size_t size =
+      wifi_lan_service_info.SerializeServiceNameTo(buffer, sizeof(buffer));
+
+  EXPECT_EQ(nsd_service_info.GetServiceName(), std::string(buffer, size));
+  // Nothing is written if the buffer is too small.
+  EXPECT_EQ(0, wifi_lan_service_info.SerializeServiceNameTo(buffer, size - 1));
+}
+
+TEST(WifiLanServiceInfoTest, MayMatchAcceptsMatchingServiceName) {
+  ByteArray service_id_hash{std::string(kServiceIDHashBytes)};
+  ByteArray endpoint_info{std::string(kEndPointName)};
+  WifiLanServiceInfo wifi_lan_service_info{
+      kVersion,      kPcp,        kEndPointID, service_id_hash,
+      endpoint_info, ByteArray{}, kWebRtcState};
+  NsdServiceInfo nsd_service_info{wifi_lan_service_info};
+
+  EXPECT_TRUE(WifiLanServiceInfo::MayMatch(nsd_service_info.GetServiceName(),
+                                           kPcp, service_id_hash));
+}
+
+TEST(WifiLanServiceInfoTest, MayMatchRejectsOtherPcpAndServiceIdHash) {
+  ByteArray service_id_hash{std::string(kServiceIDHashBytes)};
+  ByteArray endpoint_info{std::string(kEndPointName)};
+  WifiLanServiceInfo wifi_lan_service_info{
+      kVersion,      kPcp,        kEndPointID, service_id_hash,
+      endpoint_info, ByteArray{}, kWebRtcState};
+  NsdServiceInfo nsd_service_info{wifi_lan_service_info};
+  ByteArray other_service_id_hash{std::string("\x0a\x0b\x0d")};
+
+  EXPECT_FALSE(WifiLanServiceInfo::MayMatch(nsd_service_info.GetServiceName(),
+                                            Pcp::kP2pStar, service_id_hash));
+  EXPECT_FALSE(WifiLanServiceInfo::MayMatch(nsd_service_info.GetServiceName(),
+                                            kPcp, other_service_id_hash));
+}
+
 }  // namespace
 }  // namespace connections
 }  // namespace nearby
@@ -20,6 +20,19 @@ namespace location {
 namespace nearby {
 namespace connections {
 
+ScanDutyCycle ScanDutyCycle::LowPower() {
+  return {
+      .scan_window_millis = 2000,
+      .scan_interval_millis = 10000,
+      .max_scan_interval_millis = 60000,
+      .continuous_scan_millis = 10000,
+  };
+}
+
+bool ScanDutyCycle::IsContinuous() const {
+  return scan_window_millis <= 0 || scan_window_millis >= scan_interval_millis;
+}
+
 // Verify if  ConnectionOptions is in a not-initialized (Empty) state.
 bool ConnectionOptions::Empty() const { return strategy.IsNone(); }
 
@@ -13,6 +13,7 @@
 // limitations under the License.
 #ifndef CORE_OPTIONS_H_
 #define CORE_OPTIONS_H_
+#include <cstdint>
 #include <string>
 
 #include "core/medium_selector.h"
@@ -34,6 +35,27 @@ enum class PowerLevel {
   kLowPower = 1,
 };
 
+// How discovery mediums share their time between scanning and idling.
+//
+// By default, mediums scan continuously. With a scan_window_millis shorter
+// than scan_interval_millis, they only scan for scan_window_millis at the
+// start of every interval. Each interval that finds no new endpoint doubles
+// the next one, up to max_scan_interval_millis. Finding a new endpoint resets
+// the interval, and keeps the mediums scanning continuously for
+// continuous_scan_millis.
+struct ScanDutyCycle {
+  int scan_window_millis = 0;
+  int scan_interval_millis = 0;
+  int max_scan_interval_millis = 0;
+  int continuous_scan_millis = 0;
+
+  // A profile for discovery that's left running in the background.
+  static ScanDutyCycle LowPower();
+
+  // Returns true if mediums should simply scan all the time.
+  bool IsContinuous() const;
+};
+
 // Connection Options: used for both Advertising and Discovery.
 // All fields are mutable, to make the type copy-assignable.
 struct ConnectionOptions {
@@ -52,6 +74,18 @@ struct ConnectionOptions {
   int keep_alive_interval_millis = 0;
   int keep_alive_timeout_millis = 0;
 
+  // Caps how fast payload data is sent to each connected endpoint, in bytes
+  // per second; 0 means unlimited. A non-zero per-medium value caps the data
+  // sent over that medium to all endpoints together; the smallest cap set by
+  // any connected endpoint applies. Part of each budget is held back for
+  // control and keep-alive frames, which are never delayed.
+  std::int64_t max_send_bytes_per_second = 0;
+  MediumSelector<std::int64_t> max_send_bytes_per_second_per_medium{
+      MediumSelector<std::int64_t>().SetAll(0)};
+
+  // Only used for discovery.
+  ScanDutyCycle scan_duty_cycle;
+
   // Verify if  ConnectionOptions is in a not-initialized (Empty) state.
   bool Empty() const;
 
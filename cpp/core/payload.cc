@@ -89,6 +89,11 @@ void Payload::SetOffset(size_t offset) {
 
 size_t Payload::GetOffset() { return offset_; }
 
+// Sets the scheduling priority of an outgoing payload.
+void Payload::SetPriority(Priority priority) { priority_ = priority; }
+
+Payload::Priority Payload::GetPriority() const { return priority_; }
+
 // Generate Payload Id; to be passed to outgoing file constructor.
 Payload::Id Payload::GenerateId() { return Prng().NextInt64(); }
 
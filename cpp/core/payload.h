@@ -44,6 +44,10 @@ class DLL_API Payload {
   using Content = absl::variant<absl::monostate, ByteArray,
                                 std::function<InputStream&()>, InputFile>;
   enum class Type { kUnknown = 0, kBytes = 1, kStream = 2, kFile = 3 };
+  // Relative share of the outgoing bandwidth a payload gets while other
+  // payloads are being sent at the same time. Values are the weights used by
+  // the payload scheduler.
+  enum class Priority { kLow = 1, kNormal = 4, kHigh = 16 };
 
   Payload(Payload&& other) noexcept;
   ~Payload();
@@ -85,6 +89,12 @@ class DLL_API Payload {
 
   size_t GetOffset();
 
+  // Sets the scheduling priority of an outgoing payload. Has no effect on
+  // stream payloads, nor on incoming payloads.
+  void SetPriority(Priority priority);
+
+  Priority GetPriority() const;
+
   // Generate Payload Id; to be passed to outgoing file constructor.
   static Id GenerateId();
 
@@ -95,6 +105,7 @@ class DLL_API Payload {
   Id id_{GenerateId()};
   Type type_{FindType()};
   size_t offset_{0};
+  Priority priority_{Priority::kNormal};
 };
 
 }  // namespace connections
@@ -97,6 +97,13 @@ TEST(PayloadTest, PayloadHasUniqueId) {
   EXPECT_NE(payload1.GetId(), payload2.GetId());
 }
 
+TEST(PayloadTest, SupportsPriority) {
+  Payload payload(ByteArray("bytes"));
+  EXPECT_EQ(payload.GetPriority(), Payload::Priority::kNormal);
+  payload.SetPriority(Payload::Priority::kHigh);
+  EXPECT_EQ(payload.GetPriority(), Payload::Priority::kHigh);
+}
+
 TEST(PayloadTest, PayloadIsNotCopyable) {
   EXPECT_FALSE(std::is_copy_constructible_v<Payload>);
   EXPECT_FALSE(std::is_copy_assignable_v<Payload>);
@@ -14,6 +14,8 @@
 
 #include "platform/base/base64_utils.h"
 
+#include <cstdint>
+
 #include "absl/strings/escaping.h"
 #include "platform/base/byte_array.h"
 
@@ -37,5 +39,114 @@ ByteArray Base64Utils::Decode(absl::string_view base64_string) {
   return ByteArray(decoded_string.data(), decoded_string.size());
 }
 
+namespace {
+
+constexpr char kWebSafeBase64Chars[] =
+    "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789-_";
+
+int value_of(char c) {
+  if (c >= 'A' && c <= 'Z') return c - 'A';
+  if (c >= 'a' && c <= 'z') return c - 'a' + 26;
+  if (c >= '0' && c <= '9') return c - '0' + 52;
+  if (c == '-') return 62;
+  if (c == '_') return 63;
+  return -1;
+}
+
+bool IsSpace(char c) {
+  return c == ' ' || c == '\t' || c == '\n' || c == '\v' || c == '\f' ||
+         c == '\r';
+}
+
+}  // namespace
+
+bool Base64Utils::DecodePrefix(absl::string_view base64_string, char* output,
+                               std::size_t size) {
+  // Every 4 characters hold 3 bytes; only the characters needed are read.
+  std::size_t chars_needed = (size * 8 + 5) / 6;
+  if (base64_string.size() < chars_needed) return false;
+  std::uint32_t bits = 0;
+  int bit_count = 0;
+  std::size_t written = 0;
+  for (std::size_t i = 0; written < size; i++) {
+    int value = value_of(base64_string[i]);
+    if (value < 0) return false;
+    bits = (bits << 6) | value;
+    bit_count += 6;
+    if (bit_count >= 8) {
+      bit_count -= 8;
+      output[written++] = static_cast<char>((bits >> bit_count) & 0xFF);
+    }
+  }
+  return true;
+}
+
+int Base64Utils::DecodeTo(absl::string_view base64_string, char* output,
+                          std::size_t size) {
+  // Accepts the same input as absl::WebSafeBase64Unescape(): whitespace is
+  // skipped, and padding ('=' or '.') is optional, but must be complete if
+  // present.
+  std::uint32_t bits = 0;
+  int bit_count = 0;
+  std::size_t char_count = 0;
+  std::size_t padding_count = 0;
+  std::size_t written = 0;
+  for (char c : base64_string) {
+    if (IsSpace(c)) continue;
+    if (c == '=' || c == '.') {
+      padding_count++;
+      continue;
+    }
+    int value = value_of(c);
+    if (value < 0 || padding_count > 0) return -1;
+    char_count++;
+    bits = (bits << 6) | value;
+    bit_count += 6;
+    if (bit_count >= 8) {
+      bit_count -= 8;
+      if (written < size) {
+        output[written] = static_cast<char>((bits >> bit_count) & 0xFF);
+      }
+      written++;
+    }
+  }
+  switch (char_count % 4) {
+    case 0:
+      if (padding_count != 0) return -1;
+      break;
+    case 1:
+      return -1;
+    case 2:
+      if (padding_count != 0 && padding_count != 2) return -1;
+      break;
+    case 3:
+      if (padding_count > 1) return -1;
+      break;
+  }
+  return static_cast<int>(written);
+}
+
+std::size_t Base64Utils::EncodeTo(absl::string_view bytes, char* output,
+                                  std::size_t size) {
+  // Like absl::WebSafeBase64Escape(), without padding.
+  std::size_t encoded_size = (bytes.size() * 8 + 5) / 6;
+  if (encoded_size > size) return 0;
+  std::uint32_t bits = 0;
+  int bit_count = 0;
+  std::size_t written = 0;
+  for (char c : bytes) {
+    bits = (bits << 8) | static_cast<std::uint8_t>(c);
+    bit_count += 8;
+    while (bit_count >= 6) {
+      bit_count -= 6;
+      output[written++] = kWebSafeBase64Chars[(bits >> bit_count) & 0x3F];
+    }
+  }
+  if (bit_count > 0) {
+    output[written++] = kWebSafeBase64Chars[(bits << (6 - bit_count)) & 0x3F];
+  }
+  return written;
+}
+
 }  // namespace nearby
 }  // namespace location
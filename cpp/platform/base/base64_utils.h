@@ -15,6 +15,8 @@
 #ifndef PLATFORM_BASE_BASE64_UTILS_H_
 #define PLATFORM_BASE_BASE64_UTILS_H_
 
+#include <cstddef>
+
 #include "absl/strings/string_view.h"
 #include "platform/base/byte_array.h"
 
@@ -25,6 +27,24 @@ class Base64Utils {
  public:
   static std::string Encode(const ByteArray& bytes);
   static ByteArray Decode(absl::string_view base64_string);
+
+  // Decodes the first |size| bytes of |base64_string| into |output|, without
+  // allocating. Returns false if |base64_string| is too short, or if the
+  // characters needed aren't plain web-safe base64 (eg. padding).
+  static bool DecodePrefix(absl::string_view base64_string, char* output,
+                           std::size_t size);
+
+  // Decodes |base64_string| like Decode(), but into |output| instead of a new
+  // ByteArray. Returns the decoded size, which may exceed |size|, in which
+  // case only the first |size| bytes are written; or -1 if |base64_string|
+  // isn't valid.
+  static int DecodeTo(absl::string_view base64_string, char* output,
+                      std::size_t size);
+
+  // Encodes |bytes| like Encode(), but into |output| instead of a new string.
+  // Returns the encoded size, or 0 if it would exceed |size|.
+  static std::size_t EncodeTo(absl::string_view bytes, char* output,
+                              std::size_t size);
 };
 
 }  // namespace nearby
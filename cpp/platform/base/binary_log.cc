@@ -0,0 +1,245 @@
+// Copyright 2021 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "platform/base/binary_log.h"
+
+#include <algorithm>
+#include <cstring>
+#include <utility>
+
+#include "absl/strings/str_cat.h"
+#include "absl/time/clock.h"
+#include "absl/time/time.h"
+#include "platform/api/platform.h"
+
+namespace location {
+namespace nearby {
+
+namespace {
+
+// Substitutes "$n" in |format| with args[n], and "$$" with "$".
+std::string Format(const char* format, const std::vector<std::string>& args) {
+  std::string message;
+  for (const char* c = format; *c != '\0'; c++) {
+    if (*c != '$') {
+      message.push_back(*c);
+      continue;
+    }
+    if (c[1] == '$') {
+      message.push_back('$');
+      c++;
+    } else if (c[1] >= '0' && c[1] <= '9') {
+      std::size_t index = c[1] - '0';
+      if (index < args.size()) message += args[index];
+      c++;
+    } else {
+      message.push_back('$');
+    }
+  }
+  return message;
+}
+
+// Logs |entries| through the platform log, with the time they were recorded,
+// since that may be long before now.
+void Emit(const std::vector<BinaryLog::Entry>& entries) {
+  for (const BinaryLog::Entry& entry : entries) {
+    api::ImplementationPlatform::CreateLogMessage(entry.file, entry.line,
+                                                  entry.severity)
+            ->Stream()
+        << absl::FormatTime("[%H:%M:%E6S] ",
+                            absl::FromUnixMicros(entry.time_micros),
+                            absl::LocalTimeZone())
+        << entry.message;
+  }
+}
+
+}  // namespace
+
+// C++14 requires to declare this.
+// TODO(apolyudov): remove when migration to c++17 is possible.
+constexpr std::size_t BinaryLog::kCapacity;
+constexpr std::size_t BinaryLog::kMaxStringSize;
+constexpr int BinaryLog::kMaxArgs;
+constexpr std::size_t BinaryLog::kMaxRecordSize;
+
+BinaryLog& BinaryLog::GetInstance() {
+  static BinaryLog* instance = new BinaryLog();
+  return *instance;
+}
+
+BinaryLog::BinaryLog(absl::Duration max_flush_delay)
+    : max_flush_delay_(max_flush_delay), buffer_(kCapacity) {}
+
+void BinaryLog::Writer::Begin(const char* file, int line, Severity severity,
+                              const char* format, int arg_count) {
+  Header header = {
+      .file = file,
+      .format = format,
+      .time_micros = absl::GetCurrentTimeNanos() / 1000,
+      .line = line,
+      .severity = severity,
+      .arg_count = arg_count,
+  };
+  Put(&header, sizeof(header));
+}
+
+void BinaryLog::Writer::Add(absl::string_view value) {
+  ArgType type = ArgType::kString;
+  std::uint32_t size = std::min(value.size(), kMaxStringSize);
+  Put(&type, sizeof(type));
+  Put(&size, sizeof(size));
+  Put(value.data(), size);
+}
+
+void BinaryLog::Writer::Put(const void* data, std::size_t size) {
+  std::memcpy(buffer_ + size_, data, size);
+  size_ += size;
+}
+
+void BinaryLog::Append(const char* record, std::size_t size,
+                       Severity severity) {
+  std::vector<Entry> entries;
+  {
+    absl::MutexLock lock(&mutex_);
+    absl::Time now = absl::Now();
+    if (size_ == 0) first_pending_ = now;
+    std::uint32_t record_size = size;
+    while (size_ + sizeof(record_size) + size > kCapacity) DropOldest();
+    std::size_t end = begin_ + size_;
+    auto write = [&](const void* data, std::size_t length) {
+      const char* bytes = static_cast<const char*>(data);
+      for (std::size_t i = 0; i < length;) {
+        std::size_t offset = (end + i) % kCapacity;
+        std::size_t chunk = std::min(length - i, kCapacity - offset);
+        std::memcpy(buffer_.data() + offset, bytes + i, chunk);
+        i += chunk;
+      }
+      end += length;
+    };
+    write(&record_size, sizeof(record_size));
+    write(record, size);
+    size_ += sizeof(record_size) + size;
+    if (severity < Severity::kWarning &&
+        now - first_pending_ < max_flush_delay_) {
+      return;
+    }
+    entries = DecodeLocked();
+    begin_ = size_ = 0;
+  }
+  Emit(entries);
+}
+
+void BinaryLog::DropOldest() {
+  std::uint32_t record_size;
+  Read(begin_, &record_size, sizeof(record_size));
+  std::size_t total = sizeof(record_size) + record_size;
+  begin_ = (begin_ + total) % kCapacity;
+  size_ -= total;
+  dropped_++;
+}
+
+void BinaryLog::Read(std::size_t position, void* data,
+                     std::size_t size) const {
+  char* bytes = static_cast<char*>(data);
+  for (std::size_t i = 0; i < size;) {
+    std::size_t offset = (position + i) % kCapacity;
+    std::size_t chunk = std::min(size - i, kCapacity - offset);
+    std::memcpy(bytes + i, buffer_.data() + offset, chunk);
+    i += chunk;
+  }
+}
+
+std::vector<BinaryLog::Entry> BinaryLog::DecodeLocked() const {
+  std::vector<Entry> entries;
+  std::size_t position = begin_;
+  std::size_t remaining = size_;
+  std::vector<std::string> args;
+  while (remaining > 0) {
+    std::uint32_t record_size;
+    Read(position, &record_size, sizeof(record_size));
+    std::size_t next = position + sizeof(record_size);
+    auto read = [&](void* data, std::size_t size) {
+      Read(next, data, size);
+      next += size;
+    };
+    Header header;
+    read(&header, sizeof(header));
+    args.clear();
+    for (int i = 0; i < header.arg_count; i++) {
+      ArgType type;
+      read(&type, sizeof(type));
+      switch (type) {
+        case ArgType::kInt: {
+          std::int64_t value;
+          read(&value, sizeof(value));
+          args.push_back(absl::StrCat(value));
+          break;
+        }
+        case ArgType::kUint: {
+          std::uint64_t value;
+          read(&value, sizeof(value));
+          args.push_back(absl::StrCat(value));
+          break;
+        }
+        case ArgType::kDouble: {
+          double value;
+          read(&value, sizeof(value));
+          args.push_back(absl::StrCat(value));
+          break;
+        }
+        case ArgType::kString: {
+          std::uint32_t size;
+          read(&size, sizeof(size));
+          std::string value(size, '\0');
+          read(&value[0], size);
+          args.push_back(std::move(value));
+          break;
+        }
+      }
+    }
+    entries.push_back({
+        .file = header.file,
+        .line = header.line,
+        .severity = header.severity,
+        .time_micros = header.time_micros,
+        .message = Format(header.format, args),
+    });
+    position = (position + sizeof(record_size) + record_size) % kCapacity;
+    remaining -= sizeof(record_size) + record_size;
+  }
+  return entries;
+}
+
+void BinaryLog::Flush() {
+  std::vector<Entry> entries;
+  {
+    absl::MutexLock lock(&mutex_);
+    entries = DecodeLocked();
+    begin_ = size_ = 0;
+  }
+  Emit(entries);
+}
+
+std::vector<BinaryLog::Entry> BinaryLog::Decode() const {
+  absl::MutexLock lock(&mutex_);
+  return DecodeLocked();
+}
+
+std::int64_t BinaryLog::GetDroppedCount() const {
+  absl::MutexLock lock(&mutex_);
+  return dropped_;
+}
+
+}  // namespace nearby
+}  // namespace location
@@ -0,0 +1,183 @@
+// Copyright 2021 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef PLATFORM_BASE_BINARY_LOG_H_
+#define PLATFORM_BASE_BINARY_LOG_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+#include "absl/base/thread_annotations.h"
+#include "absl/strings/string_view.h"
+#include "absl/synchronization/mutex.h"
+#include "absl/time/time.h"
+#include "platform/api/log_message.h"
+
+namespace location {
+namespace nearby {
+
+// A log for hot paths that defers formatting: a record only copies its
+// arguments into a fixed-size binary ring buffer, and is formatted when the
+// buffer is flushed or decoded. Once the buffer is full, the oldest records
+// are overwritten without ever being formatted.
+//
+// Use through NEARBY_BINARY_LOG() in platform/base/logging.h. Formats use
+// absl::Substitute() style placeholders, "$0" to "$9", and must be string
+// literals, since records only keep a pointer to them. Integral, enum,
+// floating point and string arguments are supported; strings are truncated
+// to kMaxStringSize bytes.
+//
+// Records of WARNING or higher severity are flushed right away, together
+// with the records before them. Other records are flushed by the first record
+// logged once the oldest pending one is older than the flush delay, so that
+// they reach the platform log even if nobody calls Flush().
+class BinaryLog {
+ public:
+  using Severity = api::LogMessage::Severity;
+
+  struct Entry {
+    const char* file;
+    int line;
+    Severity severity;
+    std::int64_t time_micros;
+    std::string message;
+  };
+
+  // Size of the ring buffer, which is allocated once.
+  static constexpr std::size_t kCapacity = 64 * 1024;
+  static constexpr std::size_t kMaxStringSize = 128;
+  static constexpr int kMaxArgs = 10;
+
+  static BinaryLog& GetInstance();
+
+  explicit BinaryLog(absl::Duration max_flush_delay = absl::Seconds(10));
+  BinaryLog(const BinaryLog&) = delete;
+  BinaryLog& operator=(const BinaryLog&) = delete;
+
+  template <typename... Args>
+  void Record(const char* file, int line, Severity severity,
+              const char* format, const Args&... args) {
+    static_assert(sizeof...(Args) <= kMaxArgs, "Too many arguments");
+    Writer writer;
+    writer.Begin(file, line, severity, format, sizeof...(Args));
+    // Expands to one Add() per argument, in order.
+    int unused[] = {0, (writer.Add(args), 0)...};
+    (void)unused;
+    Append(writer.data(), writer.size(), severity);
+  }
+
+  // Formats all records, oldest first, and logs them through the platform
+  // log. Clears the buffer.
+  void Flush() ABSL_LOCKS_EXCLUDED(mutex_);
+
+  // Formats all records, oldest first, without clearing the buffer; eg. to
+  // attach them to a bug report.
+  std::vector<Entry> Decode() const ABSL_LOCKS_EXCLUDED(mutex_);
+
+  // Number of records overwritten before they were flushed.
+  std::int64_t GetDroppedCount() const ABSL_LOCKS_EXCLUDED(mutex_);
+
+ private:
+  enum class ArgType : char {
+    kInt = 'i',
+    kUint = 'u',
+    kDouble = 'd',
+    kString = 's',
+  };
+
+  struct Header {
+    const char* file;
+    const char* format;
+    std::int64_t time_micros;
+    int line;
+    Severity severity;
+    int arg_count;
+  };
+
+  // Large enough for a header and kMaxArgs maximal arguments.
+  static constexpr std::size_t kMaxRecordSize =
+      sizeof(Header) +
+      kMaxArgs * (sizeof(ArgType) + sizeof(std::uint32_t) + kMaxStringSize);
+
+  // Encodes one record into a stack buffer.
+  class Writer {
+   public:
+    void Begin(const char* file, int line, Severity severity,
+               const char* format, int arg_count);
+
+    template <typename T>
+    typename std::enable_if<std::is_integral<T>::value &&
+                            std::is_signed<T>::value>::type
+    Add(T value) {
+      AddScalar(ArgType::kInt, static_cast<std::int64_t>(value));
+    }
+    template <typename T>
+    typename std::enable_if<std::is_integral<T>::value &&
+                            !std::is_signed<T>::value>::type
+    Add(T value) {
+      AddScalar(ArgType::kUint, static_cast<std::uint64_t>(value));
+    }
+    template <typename T>
+    typename std::enable_if<std::is_enum<T>::value>::type Add(T value) {
+      Add(static_cast<typename std::underlying_type<T>::type>(value));
+    }
+    template <typename T>
+    typename std::enable_if<std::is_floating_point<T>::value>::type Add(
+        T value) {
+      AddScalar(ArgType::kDouble, static_cast<double>(value));
+    }
+    void Add(absl::string_view value);
+    void Add(const std::string& value) { Add(absl::string_view(value)); }
+    void Add(const char* value) { Add(absl::string_view(value)); }
+
+    const char* data() const { return buffer_; }
+    std::size_t size() const { return size_; }
+
+   private:
+    template <typename T>
+    void AddScalar(ArgType type, T value) {
+      Put(&type, sizeof(type));
+      Put(&value, sizeof(value));
+    }
+    void Put(const void* data, std::size_t size);
+
+    char buffer_[kMaxRecordSize];
+    std::size_t size_ = 0;
+  };
+
+  void Append(const char* record, std::size_t size, Severity severity)
+      ABSL_LOCKS_EXCLUDED(mutex_);
+  void DropOldest() ABSL_EXCLUSIVE_LOCKS_REQUIRED(mutex_);
+  void Read(std::size_t position, void* data, std::size_t size) const
+      ABSL_EXCLUSIVE_LOCKS_REQUIRED(mutex_);
+  std::vector<Entry> DecodeLocked() const ABSL_EXCLUSIVE_LOCKS_REQUIRED(mutex_);
+
+  const absl::Duration max_flush_delay_;
+  mutable absl::Mutex mutex_;
+  std::vector<char> buffer_ ABSL_GUARDED_BY(mutex_);
+  // When the oldest record not flushed yet was logged.
+  absl::Time first_pending_ ABSL_GUARDED_BY(mutex_);
+  // Offset of the oldest record, and number of bytes in use.
+  std::size_t begin_ ABSL_GUARDED_BY(mutex_) = 0;
+  std::size_t size_ ABSL_GUARDED_BY(mutex_) = 0;
+  std::int64_t dropped_ ABSL_GUARDED_BY(mutex_) = 0;
+};
+
+}  // namespace nearby
+}  // namespace location
+
+#endif  // PLATFORM_BASE_BINARY_LOG_H_
@@ -0,0 +1,102 @@
+// Copyright 2021 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "platform/base/binary_log.h"
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "absl/time/clock.h"
+#include "absl/time/time.h"
+
+namespace location {
+namespace nearby {
+namespace {
+
+using Severity = BinaryLog::Severity;
+
+TEST(BinaryLogTest, DecodesArguments) {
+  BinaryLog log;
+  std::string endpoint_id = "ABCD";
+  log.Record("file.cc", 7, Severity::kInfo, "$0 sent $1 bytes ($2%) $$$3",
+             endpoint_id, std::uint64_t{1024}, 12.5, -3);
+
+  std::vector<BinaryLog::Entry> entries = log.Decode();
+  ASSERT_EQ(entries.size(), 1);
+  EXPECT_EQ(entries[0].message, "ABCD sent 1024 bytes (12.5%) $-3");
+  EXPECT_STREQ(entries[0].file, "file.cc");
+  EXPECT_EQ(entries[0].line, 7);
+  EXPECT_EQ(entries[0].severity, Severity::kInfo);
+  EXPECT_GT(entries[0].time_micros, 0);
+}
+
+TEST(BinaryLogTest, TruncatesLongStrings) {
+  BinaryLog log;
+  log.Record("file.cc", 1, Severity::kInfo, "$0",
+             std::string(BinaryLog::kMaxStringSize + 10, 'x'));
+
+  EXPECT_EQ(log.Decode()[0].message,
+            std::string(BinaryLog::kMaxStringSize, 'x'));
+}
+
+TEST(BinaryLogTest, OverwritesOldestRecordsWhenFull) {
+  BinaryLog log;
+  int records = 0;
+  while (log.GetDroppedCount() == 0) {
+    log.Record("file.cc", 1, Severity::kInfo, "record $0", records++);
+  }
+  for (int i = 0; i < 1000; i++) {
+    log.Record("file.cc", 1, Severity::kInfo, "record $0", records++);
+  }
+
+  std::vector<BinaryLog::Entry> entries = log.Decode();
+  EXPECT_EQ(entries.size() + log.GetDroppedCount(), records);
+  EXPECT_EQ(entries.back().message, "record " + std::to_string(records - 1));
+  EXPECT_EQ(entries.front().message,
+            "record " + std::to_string(log.GetDroppedCount()));
+}
+
+TEST(BinaryLogTest, FlushClearsRecords) {
+  BinaryLog log;
+  log.Record("file.cc", 1, Severity::kInfo, "deferred");
+  log.Flush();
+
+  EXPECT_TRUE(log.Decode().empty());
+}
+
+TEST(BinaryLogTest, WarningsAreFlushedRightAway) {
+  BinaryLog log;
+  log.Record("file.cc", 1, Severity::kInfo, "deferred");
+  EXPECT_EQ(log.Decode().size(), 1);
+  log.Record("file.cc", 2, Severity::kWarning, "flushed");
+
+  EXPECT_TRUE(log.Decode().empty());
+}
+
+TEST(BinaryLogTest, OldRecordsAreFlushedByTheNextOne) {
+  BinaryLog log(absl::Milliseconds(50));
+  log.Record("file.cc", 1, Severity::kInfo, "deferred");
+  log.Record("file.cc", 2, Severity::kInfo, "deferred");
+  EXPECT_EQ(log.Decode().size(), 2);
+  absl::SleepFor(absl::Milliseconds(100));
+  log.Record("file.cc", 3, Severity::kInfo, "flushed");
+
+  EXPECT_TRUE(log.Decode().empty());
+}
+
+}  // namespace
+}  // namespace nearby
+}  // namespace location
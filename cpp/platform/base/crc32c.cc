@@ -0,0 +1,169 @@
+// Copyright 2021 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "platform/base/crc32c.h"
+
+#include <cstring>
+
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#define NEARBY_CRC32C_SSE42 1
+#define NEARBY_CRC32C_TARGET_SSE42 __attribute__((target("sse4.2")))
+#include <nmmintrin.h>
+#elif defined(_MSC_VER) && defined(_M_X64)
+#define NEARBY_CRC32C_SSE42 1
+#define NEARBY_CRC32C_TARGET_SSE42
+#include <intrin.h>
+#include <nmmintrin.h>
+#elif defined(__aarch64__) && defined(__ARM_FEATURE_CRC32)
+#define NEARBY_CRC32C_ARM 1
+#include <arm_acle.h>
+#endif
+
+namespace location {
+namespace nearby {
+
+namespace {
+
+// Bit-reversed Castagnoli polynomial.
+constexpr std::uint32_t kPolynomial = 0x82F63B78;
+
+struct Tables {
+  std::uint32_t table[8][256];
+};
+
+const Tables& GetTables() {
+  static const Tables* tables = [] {
+    auto* tables = new Tables;
+    for (std::uint32_t i = 0; i < 256; i++) {
+      std::uint32_t crc = i;
+      for (int bit = 0; bit < 8; bit++) {
+        crc = (crc >> 1) ^ (kPolynomial & (0U - (crc & 1)));
+      }
+      tables->table[0][i] = crc;
+    }
+    for (std::uint32_t i = 0; i < 256; i++) {
+      for (int k = 1; k < 8; k++) {
+        std::uint32_t previous = tables->table[k - 1][i];
+        tables->table[k][i] =
+            (previous >> 8) ^ tables->table[0][previous & 0xFF];
+      }
+    }
+    return tables;
+  }();
+  return *tables;
+}
+
+std::uint32_t LoadLittleEndian32(const std::uint8_t* p) {
+  return static_cast<std::uint32_t>(p[0]) |
+         (static_cast<std::uint32_t>(p[1]) << 8) |
+         (static_cast<std::uint32_t>(p[2]) << 16) |
+         (static_cast<std::uint32_t>(p[3]) << 24);
+}
+
+// Slicing-by-8: consumes 8 bytes per step with 8 table lookups.
+std::uint32_t ExtendPortable(std::uint32_t crc, const std::uint8_t* p,
+                             std::size_t size) {
+  const auto& t = GetTables().table;
+  while (size >= 8) {
+    std::uint32_t low = LoadLittleEndian32(p) ^ crc;
+    std::uint32_t high = LoadLittleEndian32(p + 4);
+    crc = t[7][low & 0xFF] ^ t[6][(low >> 8) & 0xFF] ^
+          t[5][(low >> 16) & 0xFF] ^ t[4][low >> 24] ^ t[3][high & 0xFF] ^
+          t[2][(high >> 8) & 0xFF] ^ t[1][(high >> 16) & 0xFF] ^
+          t[0][high >> 24];
+    p += 8;
+    size -= 8;
+  }
+  while (size--) {
+    crc = (crc >> 8) ^ t[0][(crc ^ *p++) & 0xFF];
+  }
+  return crc;
+}
+
+#if defined(NEARBY_CRC32C_SSE42)
+NEARBY_CRC32C_TARGET_SSE42 std::uint32_t ExtendSse42(std::uint32_t crc,
+                                                     const std::uint8_t* p,
+                                                     std::size_t size) {
+  std::uint64_t crc64 = crc;
+  while (size >= 8) {
+    std::uint64_t value;
+    std::memcpy(&value, p, sizeof(value));
+    crc64 = _mm_crc32_u64(crc64, value);
+    p += 8;
+    size -= 8;
+  }
+  std::uint32_t crc32 = static_cast<std::uint32_t>(crc64);
+  while (size--) {
+    crc32 = _mm_crc32_u8(crc32, *p++);
+  }
+  return crc32;
+}
+
+bool CpuHasSse42() {
+#if defined(_MSC_VER)
+  int info[4];
+  __cpuid(info, 1);
+  return (info[2] & (1 << 20)) != 0;
+#else
+  return __builtin_cpu_supports("sse4.2");
+#endif
+}
+#endif  // NEARBY_CRC32C_SSE42
+
+#if defined(NEARBY_CRC32C_ARM)
+std::uint32_t ExtendArm(std::uint32_t crc, const std::uint8_t* p,
+                        std::size_t size) {
+  while (size >= 8) {
+    std::uint64_t value;
+    std::memcpy(&value, p, sizeof(value));
+    crc = __crc32cd(crc, value);
+    p += 8;
+    size -= 8;
+  }
+  while (size--) {
+    crc = __crc32cb(crc, *p++);
+  }
+  return crc;
+}
+#endif  // NEARBY_CRC32C_ARM
+
+using ExtendFunction = std::uint32_t (*)(std::uint32_t, const std::uint8_t*,
+                                         std::size_t);
+
+ExtendFunction GetExtendFunction() {
+#if defined(NEARBY_CRC32C_SSE42)
+  static const ExtendFunction function =
+      CpuHasSse42() ? &ExtendSse42 : &ExtendPortable;
+  return function;
+#elif defined(NEARBY_CRC32C_ARM)
+  return &ExtendArm;
+#else
+  return &ExtendPortable;
+#endif
+}
+
+}  // namespace
+
+std::uint32_t Crc32c::Extend(std::uint32_t crc, const char* data,
+                             std::size_t size) {
+  return ~GetExtendFunction()(~crc, reinterpret_cast<const std::uint8_t*>(data),
+                              size);
+}
+
+bool Crc32c::IsHardwareAccelerated() {
+  return GetExtendFunction() != &ExtendPortable;
+}
+
+}  // namespace nearby
+}  // namespace location
@@ -0,0 +1,56 @@
+// Copyright 2021 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef PLATFORM_BASE_CRC32C_H_
+#define PLATFORM_BASE_CRC32C_H_
+
+#include <cstddef>
+#include <cstdint>
+
+#include "platform/base/byte_array.h"
+
+namespace location {
+namespace nearby {
+
+// CRC-32C (Castagnoli), as used by iSCSI and SCTP.
+//
+// Uses the SSE4.2 or ARMv8 CRC32 instructions when the CPU has them, and a
+// portable slicing-by-8 implementation otherwise; all produce identical
+// values.
+class Crc32c {
+ public:
+  // Returns the CRC-32C of |data|.
+  static std::uint32_t Value(const char* data, std::size_t size) {
+    return Extend(0, data, size);
+  }
+  static std::uint32_t Value(const ByteArray& data) {
+    return Extend(0, data.data(), data.size());
+  }
+
+  // Returns the CRC-32C of the concatenation of the data that produced |crc|
+  // and |data|, so large inputs can be checksummed incrementally.
+  static std::uint32_t Extend(std::uint32_t crc, const char* data,
+                              std::size_t size);
+  static std::uint32_t Extend(std::uint32_t crc, const ByteArray& data) {
+    return Extend(crc, data.data(), data.size());
+  }
+
+  // Returns true if a hardware implementation is in use.
+  static bool IsHardwareAccelerated();
+};
+
+}  // namespace nearby
+}  // namespace location
+
+#endif  // PLATFORM_BASE_CRC32C_H_
@@ -0,0 +1,80 @@
+// Copyright 2021 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "platform/base/crc32c.h"
+
+#include <string>
+
+#include "gtest/gtest.h"
+
+namespace location {
+namespace nearby {
+namespace {
+
+// Bit-at-a-time reference implementation.
+std::uint32_t ReferenceCrc32c(const std::string& data) {
+  std::uint32_t crc = 0xFFFFFFFF;
+  for (unsigned char c : data) {
+    crc ^= c;
+    for (int bit = 0; bit < 8; bit++) {
+      crc = (crc >> 1) ^ (0x82F63B78 & (0U - (crc & 1)));
+    }
+  }
+  return ~crc;
+}
+
+TEST(Crc32cTest, MatchesKnownValues) {
+  // Check value from the CRC catalogue, and test vectors from RFC 3720 B.4.
+  EXPECT_EQ(Crc32c::Value(ByteArray(std::string("123456789"))), 0xE3069283);
+  EXPECT_EQ(Crc32c::Value(ByteArray(std::string(32, '\x00'))), 0x8A9136AA);
+  EXPECT_EQ(Crc32c::Value(ByteArray(std::string(32, '\xFF'))), 0x62A8AB43);
+  std::string ascending;
+  for (int i = 0; i < 32; i++) ascending.push_back(static_cast<char>(i));
+  EXPECT_EQ(Crc32c::Value(ByteArray(ascending)), 0x46DD794E);
+}
+
+TEST(Crc32cTest, EmptyInputIsZero) {
+  EXPECT_EQ(Crc32c::Value(ByteArray()), 0);
+}
+
+TEST(Crc32cTest, MatchesReferenceForAllAlignments) {
+  std::string data;
+  for (int i = 0; i < 1000; i++) data.push_back(static_cast<char>(i * 7 + 3));
+
+  for (size_t size = 0; size < 40; size++) {
+    for (size_t offset = 0; offset < 8; offset++) {
+      std::string slice = data.substr(offset, size);
+      EXPECT_EQ(Crc32c::Value(slice.data(), slice.size()),
+                ReferenceCrc32c(slice))
+          << "size=" << size << " offset=" << offset;
+    }
+  }
+  EXPECT_EQ(Crc32c::Value(data.data(), data.size()), ReferenceCrc32c(data));
+}
+
+TEST(Crc32cTest, ExtendIsIncremental) {
+  std::string data(4096, '\0');
+  for (size_t i = 0; i < data.size(); i++) data[i] = static_cast<char>(i * 31);
+  std::uint32_t expected = Crc32c::Value(data.data(), data.size());
+
+  for (size_t split : {1, 7, 8, 9, 1000, 4095}) {
+    std::uint32_t crc = Crc32c::Extend(0, data.data(), split);
+    crc = Crc32c::Extend(crc, data.data() + split, data.size() - split);
+    EXPECT_EQ(crc, expected) << "split=" << split;
+  }
+}
+
+}  // namespace
+}  // namespace nearby
+}  // namespace location
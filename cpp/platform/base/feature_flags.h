@@ -42,6 +42,37 @@ class FeatureFlags {
     absl::Duration bwu_retry_exp_backoff_maximum_delay = absl::Seconds(300);
     // Support sending file and stream payloads starting from a non-zero offset.
     bool enable_send_payload_offset = true;
+    // Announce support for, and send, compressed payload chunks. Chunks are
+    // only compressed towards endpoints that announced support as well.
+    bool enable_payload_compression = false;
+    // Attach CRC-32C checksums to outgoing payload chunks. Incoming checksums
+    // are always verified when present.
+    bool enable_payload_chunk_checksums = false;
+    // Advertise content hashes of file payloads that were sent before.
+    bool enable_payload_content_dedup = false;
+    // Together with enable_payload_content_dedup, complete incoming file
+    // payloads from a local ContentCache when the content was received
+    // before. Endpoint IDs change every session and UKEY2 keys are
+    // ephemeral, so the cache can't be scoped to a peer: it is shared by all
+    // endpoints connected to a client, and any of them can learn whether the
+    // client received content with a given hash.
+    bool enable_shared_payload_content_cache = false;
+    // Announce support for, and use, AEAD-sealed data frames instead of D2D
+    // messages on encrypted channels. Only used towards endpoints that
+    // announced support as well.
+    bool enable_aead_data_frames = false;
+    // Remember a resumption secret for each encrypted connection, and use it
+    // to reconnect to the same endpoint in one round trip instead of running
+    // a full UKEY2 handshake. Secrets are only kept for endpoints that
+    // announced support, for at most session_resumption_lifetime.
+    bool enable_session_resumption = false;
+    absl::Duration session_resumption_lifetime = absl::Minutes(30);
+    // Number of UKEY2 handshakes, per role, whose ephemeral key pairs are
+    // generated ahead of time in the background. 0 generates them on the
+    // handshake's critical path. Unused ones are replaced once they are older
+    // than ukey2_key_pool_lifetime.
+    std::int32_t ukey2_key_pool_size = 0;
+    absl::Duration ukey2_key_pool_lifetime = absl::Minutes(5);
   };
 
   static const FeatureFlags& GetInstance() {
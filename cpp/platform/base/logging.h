@@ -17,9 +17,15 @@
 
 // base/logging.h is only included to allow logging clients to include CHECK's.
 // In Chrome this will be translated to base/check.h. See crbug/1212611.
+#include <atomic>
+#include <chrono>  // NOLINT
+#include <cstdint>
+#include <limits>
+
 #include "base/check.h"
 #include "platform/api/log_message.h"
 #include "platform/api/platform.h"
+#include "platform/base/binary_log.h"
 
 namespace location {
 namespace nearby {
@@ -35,6 +41,29 @@ class LogMessageVoidify {
   void operator&(std::ostream&) {}
 };
 
+// Lets at most one call through per period. NEARBY_LOGS_EVERY_N_SEC keeps one
+// of these per call site.
+class LogRateLimiter {
+ public:
+  bool Allow(double period_seconds) {
+    std::int64_t now =
+        std::chrono::steady_clock::now().time_since_epoch().count();
+    std::int64_t next = next_allowed_.load(std::memory_order_relaxed);
+    if (now < next) return false;
+    std::int64_t period = std::chrono::duration_cast<
+                              std::chrono::steady_clock::duration>(
+                              std::chrono::duration<double>(period_seconds))
+                              .count();
+    // Of concurrent callers, only the one that moves the deadline logs.
+    return next_allowed_.compare_exchange_strong(next, now + period,
+                                                 std::memory_order_relaxed);
+  }
+
+ private:
+  std::atomic<std::int64_t> next_allowed_{
+      std::numeric_limits<std::int64_t>::min()};
+};
+
 }  // namespace nearby
 }  // namespace location
 
@@ -56,10 +85,28 @@ class LogMessageVoidify {
 #endif  // defined(_WIN32)
 #define NEARBY_SEVERITY(severity) NEARBY_SEVERITY_##severity
 
+// VERBOSE logs are compiled out of release builds, unless
+// NEARBY_ENABLE_VERBOSE_LOGS is defined. Their arguments are still type
+// checked, but never evaluated.
+#if defined(NDEBUG) && !defined(NEARBY_ENABLE_VERBOSE_LOGS)
+#define NEARBY_LOG_COMPILED_IN_VERBOSE false
+#else
+#define NEARBY_LOG_COMPILED_IN_VERBOSE true
+#endif
+#define NEARBY_LOG_COMPILED_IN_INFO true
+#define NEARBY_LOG_COMPILED_IN_WARNING true
+#define NEARBY_LOG_COMPILED_IN_ERROR true
+#define NEARBY_LOG_COMPILED_IN_FATAL true
+#if defined(_WIN32)
+#define NEARBY_LOG_COMPILED_IN_0 true
+#endif  // defined(_WIN32)
+#define NEARBY_LOG_COMPILED_IN(severity) NEARBY_LOG_COMPILED_IN_##severity
+
 // Log enabling
-#define NEARBY_LOG_IS_ON(severity)                           \
-  location::nearby::api::LogMessage::ShouldCreateLogMessage( \
-      NEARBY_SEVERITY(severity))
+#define NEARBY_LOG_IS_ON(severity)                            \
+  (NEARBY_LOG_COMPILED_IN(severity) &&                        \
+   location::nearby::api::LogMessage::ShouldCreateLogMessage( \
+       NEARBY_SEVERITY(severity)))
 
 #define NEARBY_LOG_SET_SEVERITY(severity)               \
   location::nearby::api::LogMessage::SetMinLogSeverity( \
@@ -81,4 +128,26 @@ class LogMessageVoidify {
   NEARBY_LOG_IS_ON(severity)      \
   ? NEARBY_LOG_MESSAGE(severity)->Print(__VA_ARGS__) : (void)0
 
+// Like NEARBY_LOGS, but logs at most once per |seconds| from each call site,
+// eg. for errors that may repeat for every packet.
+#define NEARBY_LOGS_EVERY_N_SEC(severity, seconds)     \
+  !(NEARBY_LOG_IS_ON(severity) && []() {               \
+    static location::nearby::LogRateLimiter* limiter = \
+        new location::nearby::LogRateLimiter();        \
+    return limiter;                                    \
+  }()->Allow(seconds))                                 \
+      ? (void)0                                        \
+      : location::nearby::LogMessageVoidify() &        \
+            NEARBY_LOG_MESSAGE(severity)->Stream()
+
+// Records a message into the BinaryLog, for hot paths: formatting is deferred
+// until the log is flushed, and skipped if the record is overwritten first.
+// |format| is a string literal with "$0".."$9" placeholders, eg.
+//   NEARBY_BINARY_LOG(INFO, "KeepAlive from $0", endpoint_id);
+#define NEARBY_BINARY_LOG(severity, format, ...)                              \
+  NEARBY_LOG_IS_ON(severity)                                                  \
+  ? location::nearby::BinaryLog::GetInstance().Record(                        \
+        __FILE__, __LINE__, NEARBY_SEVERITY(severity), format, ##__VA_ARGS__) \
+  : (void)0
+
 #endif  // PLATFORM_BASE_LOGGING_H_
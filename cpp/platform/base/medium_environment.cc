@@ -14,6 +14,7 @@
 
 #include "platform/base/medium_environment.h"
 
+#include <algorithm>
 #include <atomic>
 #include <cinttypes>
 #include <functional>
@@ -22,14 +23,37 @@
 #include <type_traits>
 #include <utility>
 
+#include "absl/hash/hash.h"
 #include "platform/base/feature_flags.h"
 #include "platform/base/logging.h"
 #include "platform/base/prng.h"
 #include "platform/public/count_down_latch.h"
+#include "platform/public/mutex_lock.h"
+#include "platform/public/system_clock.h"
 
 namespace location {
 namespace nearby {
 
+namespace {
+
+// Returns the value mapped to |key|, or nullptr.
+template <typename Map, typename Key>
+typename Map::mapped_type FindOrNull(const Map& map, const Key& key) {
+  auto item = map.find(key);
+  return item != map.end() ? item->second : nullptr;
+}
+
+// Links go both ways, so they are keyed by an ordered pair of mediums.
+std::pair<const void*, const void*> GetLinkKey(const void* medium_a,
+                                               const void* medium_b) {
+  if (std::less<const void*>()(medium_b, medium_a)) {
+    std::swap(medium_a, medium_b);
+  }
+  return {medium_a, medium_b};
+}
+
+}  // namespace
+
 MediumEnvironment& MediumEnvironment::Instance() {
   static std::aligned_storage_t<sizeof(MediumEnvironment),
                                 alignof(MediumEnvironment)>
@@ -38,10 +62,15 @@ MediumEnvironment& MediumEnvironment::Instance() {
   return *env;
 }
 
+MediumEnvironment::MediumEnvironment() {
+  SetUpNotificationThreads(config_.notification_threads);
+}
+
 void MediumEnvironment::Start(EnvironmentConfig config) {
   if (!enabled_.exchange(true)) {
     NEARBY_LOGS(INFO) << "MediumEnvironment::Start()";
     config_ = std::move(config);
+    SetUpNotificationThreads(config_.notification_threads);
     Reset();
   }
 }
@@ -58,12 +87,21 @@ void MediumEnvironment::Reset() {
     NEARBY_LOGS(INFO) << "MediumEnvironment::Reset()";
     bluetooth_adapters_.clear();
     bluetooth_mediums_.clear();
+    bluetooth_adapter_mediums_.clear();
     ble_mediums_.clear();
+    ble_advertising_mediums_.clear();
+    ble_scanning_mediums_.clear();
     webrtc_signaling_message_callback_.clear();
     webrtc_signaling_complete_callback_.clear();
     wifi_lan_mediums_.clear();
+    wifi_lan_advertising_mediums_.clear();
+    wifi_lan_discovering_mediums_.clear();
+    wifi_lan_services_.clear();
     use_valid_peer_connection_ = true;
     peer_connection_latency_ = absl::ZeroDuration();
+    MutexLock lock(&link_mutex_);
+    links_.clear();
+    link_loss_generator_.seed(config_.link_loss_seed);
   });
   Sync();
 }
@@ -73,15 +111,21 @@ void MediumEnvironment::Sync(bool enable_notifications) {
   NEARBY_LOGS(INFO) << "MediumEnvironment::sync=" << enable_notifications;
   int count = 0;
   do {
-    CountDownLatch latch(1);
-    count = job_count_ + 1;
-    // We are about to schedule one last job.
-    // When it is done, counter must be equal to count.
+    WaitForDelayedNotifications(nullptr);
+    int threads = 1 + notification_executors_.size();
+    CountDownLatch latch(threads);
+    count = job_count_ + threads;
+    // We are about to schedule one last job on each thread.
+    // When they are done, counter must be equal to count.
     // However, if pending jobs schedule anything else,
     // it will be pending after us.
     // If we want to ensure we are completely idle, then we have to
     // repeat sync, until this becomes true.
     RunOnMediumEnvironmentThread([&latch]() { latch.CountDown(); });
+    for (auto& executor : notification_executors_) {
+      job_count_++;
+      executor->Execute([&latch]() { latch.CountDown(); });
+    }
     latch.Await();
   } while (count < job_count_);
   NEARBY_LOGS(INFO) << "MediumEnvironment::Sync(): done [count=" << count
@@ -103,14 +147,16 @@ void MediumEnvironment::OnBluetoothAdapterChangedState(
     NEARBY_LOGS(INFO) << "[adapter=" << &adapter
                       << ", device=" << &adapter_device << "] update: name="
                       << ", enabled=" << enabled << ", mode=" << int32_t(mode);
+    auto* adapter_medium = FindOrNull(bluetooth_adapter_mediums_, &adapter);
     for (auto& medium_info : bluetooth_mediums_) {
       auto& info = medium_info.second;
       // Do not send notification to medium that owns this adapter.
-      if (info.adapter == &adapter) continue;
+      if (info->adapter == &adapter) continue;
       NEARBY_LOGS(INFO) << "[adapter=" << &adapter
                         << ", device=" << &adapter_device
-                        << "] notify: adapter=" << info.adapter;
-      OnBluetoothDeviceStateChanged(info, adapter_device, name, mode, enabled);
+                        << "] notify: adapter=" << info->adapter;
+      OnBluetoothDeviceStateChanged(*medium_info.first, info, adapter_medium,
+                                    adapter_device, name, mode, enabled);
     }
     // We don't care if there is an adapter already since all we store is a
     // pointer. Pointer must remain valid for the duration of a Core session
@@ -127,12 +173,14 @@ void MediumEnvironment::OnBluetoothAdapterChangedState(
 }
 
 void MediumEnvironment::OnBluetoothDeviceStateChanged(
-    BluetoothMediumContext& info, api::BluetoothDevice& device,
+    api::BluetoothClassicMedium& medium,
+    const std::shared_ptr<BluetoothMediumContext>& info,
+    api::BluetoothClassicMedium* remote_medium, api::BluetoothDevice& device,
     const std::string& name, api::BluetoothAdapter::ScanMode mode,
     bool enabled) {
   if (!enabled_) return;
-  auto item = info.devices.find(&device);
-  if (item == info.devices.end()) {
+  auto item = info->devices.find(&device);
+  if (item == info->devices.end()) {
     NEARBY_LOGS(INFO) << "G3 OnBluetoothDeviceStateChanged [device impl="
                       << &device << "]: new device; notify="
                       << enable_notifications_.load();
@@ -140,10 +188,11 @@ void MediumEnvironment::OnBluetoothDeviceStateChanged(
         enabled) {
       // New device is turned on, and is in discoverable state.
       // Store device name, and report it as discovered.
-      info.devices.emplace(&device, name);
+      info->devices.emplace(&device, name);
       if (enable_notifications_) {
-        RunOnMediumEnvironmentThread(
-            [&info, &device]() { info.callback.device_discovered_cb(device); });
+        Notify(&medium, remote_medium, /*found=*/true, [info, &device]() {
+          info->callback.device_discovered_cb(device);
+        });
       }
     }
   } else {
@@ -158,15 +207,15 @@ void MediumEnvironment::OnBluetoothDeviceStateChanged(
         // Store device name, and report it as renamed.
         item->second = name;
         if (enable_notifications_) {
-          RunOnMediumEnvironmentThread([&info, &device]() {
-            info.callback.device_name_changed_cb(device);
+          Notify(&medium, remote_medium, /*found=*/false, [info, &device]() {
+            info->callback.device_name_changed_cb(device);
           });
         }
       } else {
         // Device is in discovery mode, so we are reporting it anyway.
         if (enable_notifications_) {
-          RunOnMediumEnvironmentThread([&info, &device]() {
-            info.callback.device_discovered_cb(device);
+          Notify(&medium, remote_medium, /*found=*/true, [info, &device]() {
+            info->callback.device_discovered_cb(device);
           });
         }
       }
@@ -175,10 +224,11 @@ void MediumEnvironment::OnBluetoothDeviceStateChanged(
       // Known device is turned off.
       // Erase it from the map, and report as lost.
       if (enable_notifications_) {
-        RunOnMediumEnvironmentThread(
-            [&info, &device]() { info.callback.device_lost_cb(device); });
+        Notify(&medium, remote_medium, /*found=*/false, [info, &device]() {
+          info->callback.device_lost_cb(device);
+        });
       }
-      info.devices.erase(item);
+      info->devices.erase(item);
     }
   }
 }
@@ -189,10 +239,10 @@ api::BluetoothDevice* MediumEnvironment::FindBluetoothDevice(
   CountDownLatch latch(1);
   RunOnMediumEnvironmentThread([this, &device, &latch, &mac_address]() {
     for (auto& item : bluetooth_mediums_) {
-      auto* adapter = item.second.adapter;
+      auto* adapter = item.second->adapter;
       if (!adapter) continue;
       if (adapter->GetMacAddress() == mac_address) {
-        device = bluetooth_adapters_[adapter];
+        device = FindOrNull(bluetooth_adapters_, adapter);
         break;
       }
     }
@@ -203,83 +253,89 @@ api::BluetoothDevice* MediumEnvironment::FindBluetoothDevice(
 }
 
 void MediumEnvironment::OnBlePeripheralStateChanged(
-    BleMediumContext& info, api::BlePeripheral& peripheral,
+    api::BleMedium& medium, const std::shared_ptr<BleMediumContext>& info,
+    api::BleMedium& remote_medium, api::BlePeripheral& peripheral,
     const std::string& service_id, bool fast_advertisement, bool enabled) {
   if (!enabled_) return;
   NEARBY_LOGS(INFO) << "G3 OnBleServiceStateChanged [peripheral impl="
-                    << &peripheral << "]; context=" << &info
+                    << &peripheral << "]; context=" << info.get()
                     << "; service_id=" << service_id
                     << "; notify=" << enable_notifications_.load();
   if (!enable_notifications_) return;
-  RunOnMediumEnvironmentThread([&info, enabled, &peripheral, service_id,
-                                fast_advertisement]() {
-    NEARBY_LOGS(INFO) << "G3 [Run] OnBleServiceStateChanged [peripheral impl="
-                      << &peripheral << "]; context=" << &info
-                      << "; service_id=" << service_id
-                      << "; notify=" << enabled;
-    if (enabled) {
-      info.discovery_callback.peripheral_discovered_cb(peripheral, service_id,
-                                                       fast_advertisement);
-    } else {
-      info.discovery_callback.peripheral_lost_cb(peripheral, service_id);
-    }
-  });
+  Notify(&medium, &remote_medium, /*found=*/enabled,
+         [info, enabled, &peripheral, service_id, fast_advertisement]() {
+           NEARBY_LOGS(INFO)
+               << "G3 [Run] OnBleServiceStateChanged [peripheral impl="
+               << &peripheral << "]; context=" << info.get()
+               << "; service_id=" << service_id << "; notify=" << enabled;
+           if (enabled) {
+             info->discovery_callback.peripheral_discovered_cb(
+                 peripheral, service_id, fast_advertisement);
+           } else {
+             info->discovery_callback.peripheral_lost_cb(peripheral,
+                                                         service_id);
+           }
+         });
 }
 
 void MediumEnvironment::OnWifiLanServiceStateChanged(
-    WifiLanMediumContext& info, const NsdServiceInfo& service_info,
+    api::WifiLanMedium& medium,
+    const std::shared_ptr<WifiLanMediumContext>& info,
+    api::WifiLanMedium& remote_medium, const NsdServiceInfo& service_info,
     bool enabled) {
   if (!enabled_) return;
   std::string service_type = service_info.GetServiceType();
-  auto item = info.discovered_services.find(service_type);
-  if (item == info.discovered_services.end()) {
-    NEARBY_LOGS(INFO) << "G3 OnWifiLanServiceStateChanged; context=" << &info
-                      << "; service_type=" << service_type
+  auto key = std::make_pair(&remote_medium, service_type);
+  auto item = info->discovered_services.find(key);
+  if (item == info->discovered_services.end()) {
+    NEARBY_LOGS(INFO) << "G3 OnWifiLanServiceStateChanged; context="
+                      << info.get() << "; service_type=" << service_type
                       << "; enabled=" << enabled
                       << "; notify=" << enable_notifications_.load();
     if (enabled) {
       // Find advertising service with matched service_type. Report it as
       // discovered.
       NsdServiceInfo discovered_service_info(service_info);
-      info.discovered_services.insert({service_type, discovered_service_info});
+      info->discovered_services.insert({key, discovered_service_info});
       if (enable_notifications_) {
-        RunOnMediumEnvironmentThread(
-            [&info, discovered_service_info, service_type]() {
-              auto item = info.discovered_callbacks.find(service_type);
-              if (item != info.discovered_callbacks.end()) {
-                item->second.service_discovered_cb(discovered_service_info);
-              }
-            });
+        Notify(&medium, &remote_medium, /*found=*/true,
+               [info, discovered_service_info, service_type]() {
+                 auto item = info->discovered_callbacks.find(service_type);
+                 if (item != info->discovered_callbacks.end()) {
+                   item->second.service_discovered_cb(discovered_service_info);
+                 }
+               });
       }
     }
   } else {
     NEARBY_LOGS(INFO)
         << "G3 OnWifiLanServiceStateChanged: exisitng service; context="
-        << &info << "; service_type=" << service_type << "; enabled=" << enabled
+        << info.get() << "; service_type=" << service_type
+        << "; enabled=" << enabled
         << "; notify=" << enable_notifications_.load();
     if (enabled) {
       if (enable_notifications_) {
-        RunOnMediumEnvironmentThread(
-            [&info, service_info = service_info, service_type]() {
-              auto item = info.discovered_callbacks.find(service_type);
-              if (item != info.discovered_callbacks.end()) {
-                item->second.service_discovered_cb(service_info);
-              }
-            });
+        Notify(&medium, &remote_medium, /*found=*/true,
+               [info, service_info = service_info, service_type]() {
+                 auto item = info->discovered_callbacks.find(service_type);
+                 if (item != info->discovered_callbacks.end()) {
+                   item->second.service_discovered_cb(service_info);
+                 }
+               });
       }
     } else {
       // Known service is off.
       // Erase it from the map, and report as lost.
       if (enable_notifications_) {
-        RunOnMediumEnvironmentThread(
-            [&info, service_info = service_info, service_type]() {
-              auto item = info.discovered_callbacks.find(service_type);
-              if (item != info.discovered_callbacks.end()) {
-                item->second.service_lost_cb(service_info);
-              }
-            });
+        Notify(&medium, &remote_medium, /*found=*/false,
+               [info, service_info = service_info, service_type]() {
+                 auto item = info->discovered_callbacks.find(service_type);
+                 if (item != info->discovered_callbacks.end()) {
+                   item->second.service_lost_cb(service_info);
+                 }
+               });
       }
-      info.discovered_services.erase(item);
+      info->discovered_services.erase(item);
     }
   }
 }
@@ -290,6 +346,111 @@ void MediumEnvironment::RunOnMediumEnvironmentThread(
   executor_.Execute(std::move(runnable));
 }
 
+void MediumEnvironment::RunOnNotificationThread(
+    const void* medium, std::function<void()> runnable) {
+  job_count_++;
+  auto& executor =
+      notification_executors_[absl::Hash<const void*>()(medium) %
+                              notification_executors_.size()];
+  executor->Execute(std::move(runnable));
+}
+
+void MediumEnvironment::Notify(const void* medium, const void* remote_medium,
+                               bool found, std::function<void()> runnable) {
+  LinkProperties link = GetLinkProperties(medium, remote_medium);
+  if (found && IsLost(link)) {
+    NEARBY_LOGS(INFO) << "Notification lost: medium=" << medium
+                      << "; remote_medium=" << remote_medium;
+    return;
+  }
+  if (link.latency <= absl::ZeroDuration()) {
+    RunOnNotificationThread(medium, std::move(runnable));
+    return;
+  }
+  // Held back on a timer, rather than on the notification thread, which other
+  // links share. Counted, so that Sync() goes around again.
+  job_count_++;
+  std::pair<const void*, const void*> link_key{medium, remote_medium};
+  MutexLock lock(&delayed_notifications_mutex_);
+  auto& notifications = delayed_notifications_[link_key];
+  notifications.push_back({
+      .delivery_time = SystemClock::ElapsedRealtime() + link.latency,
+      .runnable = std::move(runnable),
+  });
+  if (notifications.size() == 1) {
+    delivery_timer_.Schedule(
+        [this, link_key]() { DeliverDelayedNotifications(link_key); },
+        link.latency);
+  }
+}
+
+void MediumEnvironment::DeliverDelayedNotifications(
+    std::pair<const void*, const void*> link_key) {
+  MutexLock lock(&delayed_notifications_mutex_);
+  auto item = delayed_notifications_.find(link_key);
+  if (item == delayed_notifications_.end()) return;
+  auto& notifications = item->second;
+  absl::Time now = SystemClock::ElapsedRealtime();
+  // Notifications over one link keep their order, even if its latency
+  // changed in between.
+  while (!notifications.empty() &&
+         notifications.front().delivery_time <= now) {
+    RunOnNotificationThread(link_key.first,
+                            std::move(notifications.front().runnable));
+    notifications.pop_front();
+  }
+  if (notifications.empty()) {
+    delayed_notifications_.erase(item);
+    delayed_notifications_cond_.Notify();
+    return;
+  }
+  delivery_timer_.Schedule(
+      [this, link_key]() { DeliverDelayedNotifications(link_key); },
+      notifications.front().delivery_time - now);
+}
+
+void MediumEnvironment::WaitForDelayedNotifications(const void* medium) {
+  MutexLock lock(&delayed_notifications_mutex_);
+  while (true) {
+    bool pending = false;
+    for (const auto& item : delayed_notifications_) {
+      if (medium == nullptr || item.first.first == medium) {
+        pending = true;
+        break;
+      }
+    }
+    if (!pending) return;
+    delayed_notifications_cond_.Wait();
+  }
+}
+
+void MediumEnvironment::WaitForNotifications(const void* medium) {
+  WaitForDelayedNotifications(medium);
+  CountDownLatch latch(1);
+  RunOnNotificationThread(medium, [&latch]() { latch.CountDown(); });
+  latch.Await();
+}
+
+void MediumEnvironment::SetUpNotificationThreads(int count) {
+  count = std::max(count, 1);
+  if (notification_executors_.size() == static_cast<size_t>(count)) return;
+  notification_executors_.clear();
+  for (int i = 0; i < count; i++) {
+    notification_executors_.push_back(
+        std::make_unique<SingleThreadExecutor>());
+  }
+}
+
+template <typename Medium>
+void MediumEnvironment::RemoveFromService(
+    MediumsByService<Medium>& mediums_by_service, const std::string& service,
+    Medium* medium) {
+  auto item = mediums_by_service.find(service);
+  if (item == mediums_by_service.end()) return;
+  item->second.erase(medium);
+  if (item->second.empty()) mediums_by_service.erase(item);
+}
+
 void MediumEnvironment::RegisterBluetoothMedium(
     api::BluetoothClassicMedium& medium,
     api::BluetoothAdapter& medium_adapter) {
@@ -297,20 +458,23 @@ void MediumEnvironment::RegisterBluetoothMedium(
   RunOnMediumEnvironmentThread([this, &medium, &medium_adapter]() {
     auto& context = bluetooth_mediums_
                         .insert({&medium,
-                                 BluetoothMediumContext{
-                                     .adapter = &medium_adapter,
-                                 }})
+                                 std::make_shared<BluetoothMediumContext>(
+                                     BluetoothMediumContext{
+                                         .adapter = &medium_adapter,
+                                     })})
                         .first->second;
-    auto* owned_adapter = context.adapter;
+    auto* owned_adapter = context->adapter;
+    bluetooth_adapter_mediums_[owned_adapter] = &medium;
     NEARBY_LOGS(INFO) << "Registered: medium=" << &medium
                       << "; adapter=" << owned_adapter;
     for (auto& adapter_device : bluetooth_adapters_) {
       auto& adapter = adapter_device.first;
       auto& device = adapter_device.second;
       if (adapter == nullptr) continue;
-      OnBluetoothDeviceStateChanged(context, *device, adapter->GetName(),
-                                    adapter->GetScanMode(),
-                                    adapter->IsEnabled());
+      OnBluetoothDeviceStateChanged(
+          medium, context, FindOrNull(bluetooth_adapter_mediums_, adapter),
+          *device, adapter->GetName(), adapter->GetScanMode(),
+          adapter->IsEnabled());
     }
   });
 }
@@ -319,12 +483,15 @@ void MediumEnvironment::UpdateBluetoothMedium(
     api::BluetoothClassicMedium& medium, BluetoothDiscoveryCallback callback) {
   if (!enabled_) return;
   RunOnMediumEnvironmentThread(
-      [this, &medium, callback = std::move(callback)]() {
+      [this, &medium, callback = std::move(callback)]() mutable {
         auto item = bluetooth_mediums_.find(&medium);
         if (item == bluetooth_mediums_.end()) return;
         auto& context = item->second;
-        context.callback = std::move(callback);
-        auto* owned_adapter = context.adapter;
+        RunOnNotificationThread(
+            &medium, [context, callback = std::move(callback)]() mutable {
+              context->callback = std::move(callback);
+            });
+        auto* owned_adapter = context->adapter;
         NEARBY_LOGS(INFO) << "Updated: this=" << this << "; medium=" << &medium
                           << "; adapter=" << owned_adapter
                           << "; name=" << owned_adapter->GetName()
@@ -334,9 +501,10 @@ void MediumEnvironment::UpdateBluetoothMedium(
           auto& adapter = adapter_device.first;
           auto& device = adapter_device.second;
           if (adapter == nullptr) continue;
-          OnBluetoothDeviceStateChanged(context, *device, adapter->GetName(),
-                                        adapter->GetScanMode(),
-                                        adapter->IsEnabled());
+          OnBluetoothDeviceStateChanged(
+              medium, context, FindOrNull(bluetooth_adapter_mediums_, adapter),
+              *device, adapter->GetName(), adapter->GetScanMode(),
+              adapter->IsEnabled());
         }
       });
 }
@@ -344,17 +512,27 @@ void MediumEnvironment::UpdateBluetoothMedium(
 void MediumEnvironment::UnregisterBluetoothMedium(
     api::BluetoothClassicMedium& medium) {
   if (!enabled_) return;
-  RunOnMediumEnvironmentThread([this, &medium]() {
+  CountDownLatch latch(1);
+  RunOnMediumEnvironmentThread([this, &medium, &latch]() {
     auto item = bluetooth_mediums_.extract(&medium);
-    if (item.empty()) return;
-    NEARBY_LOGS(INFO) << "Unregistered Bluetooth medium:" << &medium;
+    if (!item.empty()) {
+      auto owner = bluetooth_adapter_mediums_.find(item.mapped()->adapter);
+      if (owner != bluetooth_adapter_mediums_.end() &&
+          owner->second == &medium) {
+        bluetooth_adapter_mediums_.erase(owner);
+      }
+      NEARBY_LOGS(INFO) << "Unregistered Bluetooth medium:" << &medium;
+    }
+    latch.CountDown();
   });
+  latch.Await();
+  WaitForNotifications(&medium);
 }
 
 void MediumEnvironment::RegisterBleMedium(api::BleMedium& medium) {
   if (!enabled_) return;
   RunOnMediumEnvironmentThread([this, &medium]() {
-    ble_mediums_.insert({&medium, BleMediumContext{}});
+    ble_mediums_.insert({&medium, std::make_shared<BleMediumContext>()});
     NEARBY_LOGS(INFO) << "Registered: medium:" << &medium;
   });
 }
@@ -371,22 +549,30 @@ void MediumEnvironment::UpdateBleMediumForAdvertising(
                            "medium registered.";
       return;
     }
-    auto& context = item->second;
+    auto& context = *item->second;
+    if (context.advertising) {
+      RemoveFromService(ble_advertising_mediums_,
+                        context.advertising_service_id, &medium);
+    }
     context.ble_peripheral = &peripheral;
     context.advertising = enabled;
     context.fast_advertisement = fast_advertisement;
+    context.advertising_service_id = enabled ? service_id : "";
+    if (enabled) ble_advertising_mediums_[service_id].insert(&medium);
     NEARBY_LOGS(INFO) << "Update Ble medium for advertising: this=" << this
                       << "; medium=" << &medium << "; service_id=" << service_id
                       << "; name=" << peripheral.GetName()
                       << "; fast_advertisement=" << fast_advertisement
                       << "; enabled=" << enabled;
-    for (auto& medium_info : ble_mediums_) {
-      auto& local_medium = medium_info.first;
-      auto& info = medium_info.second;
+    auto scanning_mediums = ble_scanning_mediums_.find(service_id);
+    if (scanning_mediums == ble_scanning_mediums_.end()) return;
+    for (auto* scanning_medium : scanning_mediums->second) {
       // Do not send notification to the same medium.
-      if (local_medium == &medium) continue;
-      OnBlePeripheralStateChanged(info, peripheral, service_id,
-                                  fast_advertisement, enabled);
+      if (scanning_medium == &medium) continue;
+      OnBlePeripheralStateChanged(*scanning_medium,
+                                  ble_mediums_[scanning_medium], medium,
+                                  peripheral, service_id, fast_advertisement,
+                                  enabled);
     }
   });
 }
@@ -398,7 +584,7 @@ void MediumEnvironment::UpdateBleMediumForScanning(
   if (!enabled_) return;
   RunOnMediumEnvironmentThread(
       [this, &medium, service_id, fast_advertisement_service_uuid,
-       callback = std::move(callback), enabled]() {
+       callback = std::move(callback), enabled]() mutable {
         auto item = ble_mediums_.find(&medium);
         if (item == ble_mediums_.end()) {
           NEARBY_LOGS(INFO)
@@ -407,24 +593,34 @@ void MediumEnvironment::UpdateBleMediumForScanning(
           return;
         }
         auto& context = item->second;
-        context.discovery_callback = std::move(callback);
+        RunOnNotificationThread(
+            &medium, [context, callback = std::move(callback)]() mutable {
+              context->discovery_callback = std::move(callback);
+            });
         NEARBY_LOGS(INFO) << "Update Ble medium for scanning: this=" << this
                           << "; medium=" << &medium
                           << "; service_id=" << service_id
                           << "; fast_advertisement_service_uuid="
                           << fast_advertisement_service_uuid
                           << "; enabled=" << enabled;
-        for (auto& medium_info : ble_mediums_) {
-          auto& local_medium = medium_info.first;
-          auto& info = medium_info.second;
+        if (context->scanning) {
+          RemoveFromService(ble_scanning_mediums_,
+                            context->scanning_service_id, &medium);
+        }
+        context->scanning = enabled;
+        context->scanning_service_id = enabled ? service_id : "";
+        if (!enabled) return;
+        ble_scanning_mediums_[service_id].insert(&medium);
+        // Search advertising mediums and send notification.
+        auto advertising_mediums = ble_advertising_mediums_.find(service_id);
+        if (advertising_mediums == ble_advertising_mediums_.end()) return;
+        for (auto* advertising_medium : advertising_mediums->second) {
           // Do not send notification to the same medium.
-          if (local_medium == &medium) continue;
-          // Search advertising mediums and send notification.
-          if (info.advertising && enabled) {
-            OnBlePeripheralStateChanged(context, *(info.ble_peripheral),
-                                        service_id, info.fast_advertisement,
-                                        enabled);
-          }
+          if (advertising_medium == &medium) continue;
+          auto& info = *ble_mediums_[advertising_medium];
+          OnBlePeripheralStateChanged(medium, context, *advertising_medium,
+                                      *(info.ble_peripheral), service_id,
+                                      info.fast_advertisement, enabled);
         }
       });
 }
@@ -434,15 +630,18 @@ void MediumEnvironment::UpdateBleMediumForAcceptedConnection(
     BleAcceptedConnectionCallback callback) {
   if (!enabled_) return;
   RunOnMediumEnvironmentThread(
-      [this, &medium, service_id, callback = std::move(callback)]() {
+      [this, &medium, service_id, callback = std::move(callback)]() mutable {
         auto item = ble_mediums_.find(&medium);
         if (item == ble_mediums_.end()) {
           NEARBY_LOGS(INFO)
               << "Update Ble medium failed. There is no medium registered.";
           return;
         }
-        auto& context = item->second;
-        context.accepted_connection_callback = std::move(callback);
+        RunOnNotificationThread(
+            &medium, [context = item->second,
+                      callback = std::move(callback)]() mutable {
+              context->accepted_connection_callback = std::move(callback);
+            });
         NEARBY_LOGS(INFO) << "Update Ble medium for accepted callback: this="
                           << this << "; medium=" << &medium
                           << "; service_id=" << service_id;
@@ -451,11 +650,25 @@ void MediumEnvironment::UpdateBleMediumForAcceptedConnection(
 
 void MediumEnvironment::UnregisterBleMedium(api::BleMedium& medium) {
   if (!enabled_) return;
-  RunOnMediumEnvironmentThread([this, &medium]() {
+  CountDownLatch latch(1);
+  RunOnMediumEnvironmentThread([this, &medium, &latch]() {
     auto item = ble_mediums_.extract(&medium);
-    if (item.empty()) return;
-    NEARBY_LOGS(INFO) << "Unregistered Ble medium";
+    if (!item.empty()) {
+      auto& context = *item.mapped();
+      if (context.advertising) {
+        RemoveFromService(ble_advertising_mediums_,
+                          context.advertising_service_id, &medium);
+      }
+      if (context.scanning) {
+        RemoveFromService(ble_scanning_mediums_, context.scanning_service_id,
+                          &medium);
+      }
+      NEARBY_LOGS(INFO) << "Unregistered Ble medium";
+    }
+    latch.CountDown();
   });
+  latch.Await();
+  WaitForNotifications(&medium);
 }
 
 void MediumEnvironment::CallBleAcceptedConnectionCallback(
@@ -471,11 +684,15 @@ void MediumEnvironment::CallBleAcceptedConnectionCallback(
                  "registered.";
           return;
         }
-        auto& info = item->second;
-        info.accepted_connection_callback.accepted_cb(socket, service_id);
+        RunOnNotificationThread(
+            &medium, [context = item->second, &socket, service_id]() {
+              context->accepted_connection_callback.accepted_cb(socket,
+                                                                service_id);
+            });
       });
 }
 
+
 void MediumEnvironment::RegisterWebRtcSignalingMessenger(
     absl::string_view self_id, OnSignalingMessageCallback message_callback,
     OnSignalingCompleteCallback complete_callback) {
@@ -575,7 +792,8 @@ int MediumEnvironment::GetFakePort() const {
 void MediumEnvironment::RegisterWifiLanMedium(api::WifiLanMedium& medium) {
   if (!enabled_) return;
   RunOnMediumEnvironmentThread([this, &medium]() {
-    wifi_lan_mediums_.insert({&medium, WifiLanMediumContext{}});
+    wifi_lan_mediums_.insert(
+        {&medium, std::make_shared<WifiLanMediumContext>()});
     NEARBY_LOG(INFO, "Registered: medium=%p", &medium);
   });
 }
@@ -592,20 +810,41 @@ void MediumEnvironment::UpdateWifiLanMediumForAdvertising(
                       << "; service_name=" << service_info.GetServiceName()
                       << "; service_type=" << service_type
                       << ", enabled=" << enabled;
-    for (auto& medium_info : wifi_lan_mediums_) {
-      auto& local_medium = medium_info.first;
-      auto& info = medium_info.second;
-      // Do not send notification to the same medium but update
-      // service info map.
-      if (local_medium == &medium) {
-        if (enabled) {
-          info.advertising_services.insert({service_type, service_info});
-        } else {
-          info.advertising_services.erase(service_type);
+    auto item = wifi_lan_mediums_.find(&medium);
+    if (item == wifi_lan_mediums_.end()) {
+      NEARBY_LOGS(INFO) << "UpdateWifiLanMediumForAdvertising failed. There "
+                           "is no medium registered.";
+      return;
+    }
+    // Do not send notification to the same medium but update
+    // service info map.
+    auto& context = *item->second;
+    if (enabled) {
+      auto& advertised_info =
+          context.advertising_services.insert({service_type, service_info})
+              .first->second;
+      wifi_lan_advertising_mediums_[service_type].insert(&medium);
+      wifi_lan_services_[{advertised_info.GetIPAddress(),
+                          advertised_info.GetPort()}] = &medium;
+    } else {
+      auto advertised = context.advertising_services.find(service_type);
+      if (advertised != context.advertising_services.end()) {
+        auto service = wifi_lan_services_.find(
+            {advertised->second.GetIPAddress(), advertised->second.GetPort()});
+        if (service != wifi_lan_services_.end() && service->second == &medium) {
+          wifi_lan_services_.erase(service);
         }
-        continue;
+        context.advertising_services.erase(advertised);
       }
-      OnWifiLanServiceStateChanged(info, service_info, enabled);
+      RemoveFromService(wifi_lan_advertising_mediums_, service_type, &medium);
+    }
+    auto discovering_mediums = wifi_lan_discovering_mediums_.find(service_type);
+    if (discovering_mediums == wifi_lan_discovering_mediums_.end()) return;
+    for (auto* discovering_medium : discovering_mediums->second) {
+      if (discovering_medium == &medium) continue;
+      OnWifiLanServiceStateChanged(*discovering_medium,
+                                   wifi_lan_mediums_[discovering_medium],
+                                   medium, service_info, enabled);
     }
   });
 }
@@ -615,7 +854,7 @@ void MediumEnvironment::UpdateWifiLanMediumForDiscovery(
     const std::string& service_type, bool enabled) {
   if (!enabled_) return;
   RunOnMediumEnvironmentThread([this, &medium, callback = std::move(callback),
-                                service_type, enabled]() {
+                                service_type, enabled]() mutable {
     auto item = wifi_lan_mediums_.find(&medium);
     if (item == wifi_lan_mediums_.end()) {
       NEARBY_LOGS(INFO)
@@ -624,53 +863,153 @@ void MediumEnvironment::UpdateWifiLanMediumForDiscovery(
       return;
     }
     auto& context = item->second;
-    context.discovered_callbacks.insert({service_type, std::move(callback)});
+    RunOnNotificationThread(&medium, [context, callback = std::move(callback),
+                                      service_type, enabled]() mutable {
+      if (enabled) {
+        context->discovered_callbacks[service_type] = std::move(callback);
+      } else {
+        context->discovered_callbacks.erase(service_type);
+      }
+    });
     NEARBY_LOGS(INFO) << "Update WifiLan medium for discovery: this=" << this
                       << "; medium=" << &medium
                       << "; service_type=" << service_type
                       << "; enabled=" << enabled;
-    for (auto& medium_info : wifi_lan_mediums_) {
-      auto& local_medium = medium_info.first;
-      auto& info = medium_info.second;
+    if (!enabled) {
+      context->discovering_service_types.erase(service_type);
+      RemoveFromService(wifi_lan_discovering_mediums_, service_type, &medium);
+      return;
+    }
+    context->discovering_service_types.insert(service_type);
+    wifi_lan_discovering_mediums_[service_type].insert(&medium);
+    // Search advertising services and send notification.
+    auto advertising_mediums = wifi_lan_advertising_mediums_.find(service_type);
+    if (advertising_mediums == wifi_lan_advertising_mediums_.end()) return;
+    for (auto* advertising_medium : advertising_mediums->second) {
       // Do not send notification to the same medium.
-      if (local_medium == &medium) continue;
-      // Search advertising services and send notification.
-      for (auto& advertising_service : info.advertising_services) {
-        auto& service_info = advertising_service.second;
-        OnWifiLanServiceStateChanged(context, service_info, /*enabled=*/true);
-      }
+      if (advertising_medium == &medium) continue;
+      auto& advertising_services =
+          wifi_lan_mediums_[advertising_medium]->advertising_services;
+      OnWifiLanServiceStateChanged(medium, context, *advertising_medium,
+                                   advertising_services[service_type],
+                                   /*enabled=*/true);
     }
   });
 }
 
 void MediumEnvironment::UnregisterWifiLanMedium(api::WifiLanMedium& medium) {
   if (!enabled_) return;
-  RunOnMediumEnvironmentThread([this, &medium]() {
+  CountDownLatch latch(1);
+  RunOnMediumEnvironmentThread([this, &medium, &latch]() {
     auto item = wifi_lan_mediums_.extract(&medium);
-    if (item.empty()) return;
-    NEARBY_LOGS(INFO) << "Unregistered WifiLan medium";
+    if (!item.empty()) {
+      auto& context = *item.mapped();
+      for (auto& advertising_service : context.advertising_services) {
+        auto& service_info = advertising_service.second;
+        auto service = wifi_lan_services_.find(
+            {service_info.GetIPAddress(), service_info.GetPort()});
+        if (service != wifi_lan_services_.end() && service->second == &medium) {
+          wifi_lan_services_.erase(service);
+        }
+        RemoveFromService(wifi_lan_advertising_mediums_,
+                          advertising_service.first, &medium);
+      }
+      for (auto& service_type : context.discovering_service_types) {
+        RemoveFromService(wifi_lan_discovering_mediums_, service_type,
+                          &medium);
+      }
+      NEARBY_LOGS(INFO) << "Unregistered WifiLan medium";
+    }
+    latch.CountDown();
   });
+  latch.Await();
+  WaitForNotifications(&medium);
 }
 
 api::WifiLanMedium* MediumEnvironment::GetWifiLanMedium(
     const std::string& ip_address, int port) {
-  for (auto& medium_info : wifi_lan_mediums_) {
-    auto* medium_found = medium_info.first;
-    auto& info = medium_info.second;
-    for (auto& advertising_service : info.advertising_services) {
-      auto& service_info = advertising_service.second;
-      if (ip_address == service_info.GetIPAddress() &&
-          port == service_info.GetPort()) {
-        return medium_found;
-      }
-    }
-  }
-  return nullptr;
+  api::WifiLanMedium* medium = nullptr;
+  CountDownLatch latch(1);
+  RunOnMediumEnvironmentThread([this, &medium, &latch, &ip_address, port]() {
+    medium = FindOrNull(wifi_lan_services_, std::make_pair(ip_address, port));
+    latch.CountDown();
+  });
+  latch.Await();
+  return medium;
 }
 
 void MediumEnvironment::SetFeatureFlags(const FeatureFlags::Flags& flags) {
   const_cast<FeatureFlags&>(FeatureFlags::GetInstance()).SetFlags(flags);
 }
 
+void MediumEnvironment::SetLinkProperties(
+    api::BluetoothClassicMedium& medium_a,
+    api::BluetoothClassicMedium& medium_b, const LinkProperties& properties) {
+  SetLinkPropertiesForMediums(&medium_a, &medium_b, properties);
+}
+
+void MediumEnvironment::SetLinkProperties(api::BleMedium& medium_a,
+                                          api::BleMedium& medium_b,
+                                          const LinkProperties& properties) {
+  SetLinkPropertiesForMediums(&medium_a, &medium_b, properties);
+}
+
+void MediumEnvironment::SetLinkProperties(api::WifiLanMedium& medium_a,
+                                          api::WifiLanMedium& medium_b,
+                                          const LinkProperties& properties) {
+  SetLinkPropertiesForMediums(&medium_a, &medium_b, properties);
+}
+
+bool MediumEnvironment::SimulateConnectionRequest(
+    api::BluetoothClassicMedium& medium,
+    api::BluetoothClassicMedium& remote_medium, LinkProperties* link) {
+  return SimulateConnectionRequestForMediums(&medium, &remote_medium, link);
+}
+
+bool MediumEnvironment::SimulateConnectionRequest(api::BleMedium& medium,
+                                                  api::BleMedium& remote_medium,
+                                                  LinkProperties* link) {
+  return SimulateConnectionRequestForMediums(&medium, &remote_medium, link);
+}
+
+bool MediumEnvironment::SimulateConnectionRequest(
+    api::WifiLanMedium& medium, api::WifiLanMedium& remote_medium,
+    LinkProperties* link) {
+  return SimulateConnectionRequestForMediums(&medium, &remote_medium, link);
+}
+
+void MediumEnvironment::SetLinkPropertiesForMediums(
+    const void* medium_a, const void* medium_b,
+    const LinkProperties& properties) {
+  MutexLock lock(&link_mutex_);
+  links_[GetLinkKey(medium_a, medium_b)] = properties;
+}
+
+LinkProperties MediumEnvironment::GetLinkProperties(const void* medium_a,
+                                                    const void* medium_b) {
+  MutexLock lock(&link_mutex_);
+  auto item = links_.find(GetLinkKey(medium_a, medium_b));
+  return item != links_.end() ? item->second : config_.link_properties;
+}
+
+bool MediumEnvironment::SimulateConnectionRequestForMediums(
+    const void* medium, const void* remote_medium, LinkProperties* link) {
+  *link = GetLinkProperties(medium, remote_medium);
+  SystemClock::Sleep(link->latency);
+  if (IsLost(*link)) {
+    NEARBY_LOGS(INFO) << "Connection request lost: medium=" << medium
+                      << "; remote_medium=" << remote_medium;
+    return false;
+  }
+  return true;
+}
+
+bool MediumEnvironment::IsLost(const LinkProperties& link) {
+  if (link.loss_rate <= 0) return false;
+  MutexLock lock(&link_mutex_);
+  return std::bernoulli_distribution(std::min(link.loss_rate, 1.0))(
+      link_loss_generator_);
+}
+
 }  // namespace nearby
 }  // namespace location
@@ -16,10 +16,19 @@
 #define PLATFORM_BASE_MEDIUM_ENVIRONMENT_H_
 
 #include <atomic>
+#include <cstdint>
+#include <deque>
 #include <memory>
+#include <random>
+#include <string>
+#include <utility>
+#include <vector>
 
+#include "absl/base/thread_annotations.h"
 #include "absl/container/flat_hash_map.h"
+#include "absl/container/flat_hash_set.h"
 #include "absl/strings/string_view.h"
+#include "absl/time/time.h"
 #include "platform/api/ble.h"
 #include "platform/api/bluetooth_adapter.h"
 #include "platform/api/bluetooth_classic.h"
@@ -29,11 +38,28 @@
 #include "platform/base/feature_flags.h"
 #include "platform/base/listeners.h"
 #include "platform/base/nsd_service_info.h"
+#include "platform/public/condition_variable.h"
+#include "platform/public/mutex.h"
+#include "platform/public/scheduled_executor.h"
 #include "platform/public/single_thread_executor.h"
 
 namespace location {
 namespace nearby {
 
+// Describes how the simulated link between two devices behaves. The default
+// is a perfect link.
+struct LinkProperties {
+  // Time it takes for a device to be found, or lost, by the other one, and for
+  // a connection request to reach it.
+  absl::Duration latency = absl::ZeroDuration();
+  // Bytes per second that can be written to a connection; 0 is unlimited.
+  std::int64_t bandwidth_bytes_per_second = 0;
+  // Probability, between 0 and 1, that a device is not reported as found when
+  // it starts advertising or the other one starts discovery, or that a
+  // connection request fails.
+  double loss_rate = 0;
+};
+
 // Environment config that can control availability of certain mediums for
 // testing.
 struct EnvironmentConfig {
@@ -41,6 +67,16 @@ struct EnvironmentConfig {
   // This is currently set to false, due to http://b/139734036 that would lead
   // to flaky tests.
   bool webrtc_enabled = false;
+  // Number of threads that notify mediums of discovered devices and accepted
+  // connections. A medium is always notified by the same thread, in order, so
+  // more threads only let different mediums be notified in parallel.
+  int notification_threads = 1;
+  // Properties of every link, unless overridden with
+  // MediumEnvironment::SetLinkProperties().
+  LinkProperties link_properties;
+  // Seeds the choice of lost notifications and connection requests, so that
+  // runs over lossy links can be reproduced.
+  std::uint32_t link_loss_seed = 0;
 };
 
 // MediumEnvironment is a simulated environment which allows multiple instances
@@ -124,6 +160,8 @@ class MediumEnvironment {
                              BluetoothDiscoveryCallback callback);
 
   // Removes medium-related info. This should correspond to device power off.
+  // Returns once notifications already sent to the medium are delivered, so it
+  // must not be called from a notification callback.
   void UnregisterBluetoothMedium(api::BluetoothClassicMedium& medium);
 
   // Returns a Bluetooth Device object matching given mac address to nullptr.
@@ -192,6 +230,8 @@ class MediumEnvironment {
       BleAcceptedConnectionCallback callback);
 
   // Removes medium-related info. This should correspond to device power off.
+  // Returns once notifications already sent to the medium are delivered, so it
+  // must not be called from a notification callback.
   void UnregisterBleMedium(api::BleMedium& medium);
 
   // Call back when advertising has created the server socket and is ready for
@@ -227,6 +267,8 @@ class MediumEnvironment {
   int GetFakePort() const;
 
   // Removes medium-related info. This should correspond to device power off.
+  // Returns once notifications already sent to the medium are delivered, so it
+  // must not be called from a notification callback.
   void UnregisterWifiLanMedium(api::WifiLanMedium& medium);
 
   // Returns WifiLan medium whose advertising service matching IP address and
@@ -235,7 +277,36 @@ class MediumEnvironment {
 
   void SetFeatureFlags(const FeatureFlags::Flags& flags);
 
+  // Overrides the properties of the link between two mediums, in both
+  // directions, until the environment is reset.
+  void SetLinkProperties(api::BluetoothClassicMedium& medium_a,
+                         api::BluetoothClassicMedium& medium_b,
+                         const LinkProperties& properties);
+  void SetLinkProperties(api::BleMedium& medium_a, api::BleMedium& medium_b,
+                         const LinkProperties& properties);
+  void SetLinkProperties(api::WifiLanMedium& medium_a,
+                         api::WifiLanMedium& medium_b,
+                         const LinkProperties& properties);
+
+  // Simulates sending a connection request from |medium| to |remote_medium|:
+  // waits for the link latency, and returns false if the request is lost.
+  // Otherwise, sets |link| to the properties of the link, which the new
+  // connection has to follow.
+  bool SimulateConnectionRequest(api::BluetoothClassicMedium& medium,
+                                 api::BluetoothClassicMedium& remote_medium,
+                                 LinkProperties* link);
+  bool SimulateConnectionRequest(api::BleMedium& medium,
+                                 api::BleMedium& remote_medium,
+                                 LinkProperties* link);
+  bool SimulateConnectionRequest(api::WifiLanMedium& medium,
+                                 api::WifiLanMedium& remote_medium,
+                                 LinkProperties* link);
+
  private:
+  // Medium contexts are shared with the notification threads, which may still
+  // be delivering notifications after a medium is unregistered. The callbacks
+  // are only accessed on the medium's notification thread, and the rest on the
+  // environment thread.
   struct BluetoothMediumContext {
     BluetoothDiscoveryCallback callback;
     api::BluetoothAdapter* adapter = nullptr;
@@ -249,6 +320,9 @@ class MediumEnvironment {
     api::BlePeripheral* ble_peripheral = nullptr;
     bool advertising = false;
     bool fast_advertisement = false;
+    std::string advertising_service_id;
+    bool scanning = false;
+    std::string scanning_service_id;
   };
 
   struct WifiLanMediumContext {
@@ -257,48 +331,126 @@ class MediumEnvironment {
     // discovered service type vs callback map.
     absl::flat_hash_map<std::string, WifiLanDiscoveredServiceCallback>
         discovered_callbacks;
-    // discovered service vs service type map.
-    absl::flat_hash_map<std::string, NsdServiceInfo> discovered_services;
+    // Service types the medium is discovering.
+    absl::flat_hash_set<std::string> discovering_service_types;
+    // (advertising medium, service type) vs discovered service map.
+    absl::flat_hash_map<std::pair<api::WifiLanMedium*, std::string>,
+                        NsdServiceInfo>
+        discovered_services;
   };
 
+  // Service id, or service type, vs mediums using it.
+  template <typename Medium>
+  using MediumsByService =
+      absl::flat_hash_map<std::string, absl::flat_hash_set<Medium*>>;
+
   // This is a singleton object, for which destructor will never be called.
   // Constructor will be invoked once from Instance() static method.
   // Object is create in-place (with a placement new) to guarantee that
   // destructor is not scheduled for execution at exit.
-  MediumEnvironment() = default;
+  MediumEnvironment();
   ~MediumEnvironment() = default;
 
-  void OnBluetoothDeviceStateChanged(BluetoothMediumContext& info,
-                                     api::BluetoothDevice& device,
-                                     const std::string& name,
-                                     api::BluetoothAdapter::ScanMode mode,
-                                     bool enabled);
+  void OnBluetoothDeviceStateChanged(
+      api::BluetoothClassicMedium& medium,
+      const std::shared_ptr<BluetoothMediumContext>& info,
+      api::BluetoothClassicMedium* remote_medium, api::BluetoothDevice& device,
+      const std::string& name, api::BluetoothAdapter::ScanMode mode,
+      bool enabled);
 
-  void OnBlePeripheralStateChanged(BleMediumContext& info,
-                                   api::BlePeripheral& peripheral,
-                                   const std::string& service_id,
-                                   bool fast_advertisement, bool enabled);
+  void OnBlePeripheralStateChanged(
+      api::BleMedium& medium, const std::shared_ptr<BleMediumContext>& info,
+      api::BleMedium& remote_medium, api::BlePeripheral& peripheral,
+      const std::string& service_id, bool fast_advertisement, bool enabled);
 
-  void OnWifiLanServiceStateChanged(WifiLanMediumContext& info,
-                                    const NsdServiceInfo& service_info,
-                                    bool enabled);
+  void OnWifiLanServiceStateChanged(
+      api::WifiLanMedium& medium,
+      const std::shared_ptr<WifiLanMediumContext>& info,
+      api::WifiLanMedium& remote_medium, const NsdServiceInfo& service_info,
+      bool enabled);
 
   void RunOnMediumEnvironmentThread(std::function<void()> runnable);
 
+  // Runs |runnable| on the thread that notifies |medium|.
+  void RunOnNotificationThread(const void* medium,
+                               std::function<void()> runnable);
+
+  // Sends a notification from |remote_medium| to |medium| over the link
+  // between them. Notifications that a device was found may get lost.
+  void Notify(const void* medium, const void* remote_medium, bool found,
+              std::function<void()> runnable);
+  // Hands the notifications over |link_key| whose latency has passed to the
+  // notification thread, and sets the timer for the next one.
+  void DeliverDelayedNotifications(std::pair<const void*, const void*> link_key)
+      ABSL_LOCKS_EXCLUDED(delayed_notifications_mutex_);
+  // Waits until no notification to |medium|, or to any medium if null, is
+  // held back by link latency.
+  void WaitForDelayedNotifications(const void* medium)
+      ABSL_LOCKS_EXCLUDED(delayed_notifications_mutex_);
+  // Returns once notifications already sent to |medium| are delivered.
+  void WaitForNotifications(const void* medium);
+
+  // Replaces notification threads; only called while the environment is idle.
+  void SetUpNotificationThreads(int count);
+
+  // Removes |medium| from |mediums_by_service| under |service|.
+  template <typename Medium>
+  static void RemoveFromService(MediumsByService<Medium>& mediums_by_service,
+                                const std::string& service, Medium* medium);
+
+  void SetLinkPropertiesForMediums(const void* medium_a, const void* medium_b,
+                                   const LinkProperties& properties);
+  LinkProperties GetLinkProperties(const void* medium_a,
+                                   const void* medium_b);
+  bool SimulateConnectionRequestForMediums(const void* medium,
+                                           const void* remote_medium,
+                                           LinkProperties* link);
+  // Returns true if something sent over |link| has to be lost.
+  bool IsLost(const LinkProperties& link);
+
   std::atomic_bool enabled_ = true;
   std::atomic_int job_count_ = 0;
   std::atomic_bool enable_notifications_ = false;
   SingleThreadExecutor executor_;
+  std::vector<std::unique_ptr<SingleThreadExecutor>> notification_executors_;
   EnvironmentConfig config_;
 
+  // Link overrides, and the generator for lost notifications and connection
+  // requests, are accessed from any thread.
+  Mutex link_mutex_;
+  absl::flat_hash_map<std::pair<const void*, const void*>, LinkProperties>
+      links_ ABSL_GUARDED_BY(link_mutex_);
+  std::mt19937 link_loss_generator_ ABSL_GUARDED_BY(link_mutex_);
+
+  // A notification held back by the latency of its link.
+  struct DelayedNotification {
+    absl::Time delivery_time;
+    std::function<void()> runnable;
+  };
+  Mutex delayed_notifications_mutex_;
+  // Notified when all notifications over a link have been delivered.
+  ConditionVariable delayed_notifications_cond_{&delayed_notifications_mutex_};
+  // Keyed by (medium, remote_medium), in the order they were sent.
+  absl::flat_hash_map<std::pair<const void*, const void*>,
+                      std::deque<DelayedNotification>>
+      delayed_notifications_ ABSL_GUARDED_BY(delayed_notifications_mutex_);
+  ScheduledExecutor delivery_timer_;
+
   // The following data members are accessed in the context of a private
   // executor_ thread.
   absl::flat_hash_map<api::BluetoothAdapter*, api::BluetoothDevice*>
       bluetooth_adapters_;
-  absl::flat_hash_map<api::BluetoothClassicMedium*, BluetoothMediumContext>
+  absl::flat_hash_map<api::BluetoothClassicMedium*,
+                      std::shared_ptr<BluetoothMediumContext>>
       bluetooth_mediums_;
+  // Adapter vs the medium that owns it.
+  absl::flat_hash_map<api::BluetoothAdapter*, api::BluetoothClassicMedium*>
+      bluetooth_adapter_mediums_;
 
-  absl::flat_hash_map<api::BleMedium*, BleMediumContext> ble_mediums_;
+  absl::flat_hash_map<api::BleMedium*, std::shared_ptr<BleMediumContext>>
+      ble_mediums_;
+  MediumsByService<api::BleMedium> ble_advertising_mediums_;
+  MediumsByService<api::BleMedium> ble_scanning_mediums_;
 
   // Maps peer id to callback for receiving signaling messages.
   absl::flat_hash_map<std::string, OnSignalingMessageCallback>
@@ -308,8 +460,14 @@ class MediumEnvironment {
   absl::flat_hash_map<std::string, OnSignalingCompleteCallback>
       webrtc_signaling_complete_callback_;
 
-  absl::flat_hash_map<api::WifiLanMedium*, WifiLanMediumContext>
+  absl::flat_hash_map<api::WifiLanMedium*,
+                      std::shared_ptr<WifiLanMediumContext>>
       wifi_lan_mediums_;
+  MediumsByService<api::WifiLanMedium> wifi_lan_advertising_mediums_;
+  MediumsByService<api::WifiLanMedium> wifi_lan_discovering_mediums_;
+  // (IP address, port) of advertised services vs advertising medium.
+  absl::flat_hash_map<std::pair<std::string, int>, api::WifiLanMedium*>
+      wifi_lan_services_;
 
   bool use_valid_peer_connection_ = true;
   absl::Duration peer_connection_latency_ = absl::ZeroDuration();
@@ -14,6 +14,7 @@
 
 #include "platform/impl/g3/ble.h"
 
+#include <algorithm>
 #include <iostream>
 #include <memory>
 #include <string>
@@ -38,6 +39,12 @@ void BleSocket::Connect(BleSocket& other) {
   absl::MutexLock lock(&mutex_);
   remote_socket_ = &other;
   input_ = other.output_;
+  link_output_.SetBandwidth(std::max(link_output_.GetBandwidth(),
+                                      other.link_output_.GetBandwidth()));
+}
+
+void BleSocket::SetBandwidth(std::int64_t bytes_per_second) {
+  link_output_.SetBandwidth(bytes_per_second);
 }
 
 InputStream& BleSocket::GetInputStream() {
@@ -96,7 +103,7 @@ InputStream& BleSocket::GetLocalInputStream() {
 
 OutputStream& BleSocket::GetLocalOutputStream() {
   absl::MutexLock lock(&mutex_);
-  return output_->GetOutputStream();
+  return link_output_;
 }
 
 std::unique_ptr<api::BleSocket> BleServerSocket::Accept(
@@ -347,6 +354,15 @@ std::unique_ptr<api::BleSocket> BleMedium::Connect(
     }
   }
 
+  LinkProperties link;
+  auto& env = MediumEnvironment::Instance();
+  if (!env.SimulateConnectionRequest(*this, *medium, &link)) {
+    NEARBY_LOGS(ERROR) << "G3 Ble Connect: Connection request lost: "
+                          "service_id="
+                       << service_id;
+    return {};
+  }
+
   if (cancellation_flag->Cancelled()) {
     NEARBY_LOGS(ERROR) << "G3 BLE Connect: Has been cancelled: "
                           "service_id="
@@ -361,6 +377,7 @@ std::unique_ptr<api::BleSocket> BleMedium::Connect(
 
   BlePeripheral peripheral = static_cast<BlePeripheral&>(remote_peripheral);
   auto socket = std::make_unique<BleSocket>(&peripheral);
+  socket->SetBandwidth(link.bandwidth_bytes_per_second);
   // Finally, Request to connect to this socket.
   if (!remote_server_socket->Connect(*socket)) {
     NEARBY_LOGS(ERROR) << "G3 Ble Connect: Failed to connect to existing Ble "
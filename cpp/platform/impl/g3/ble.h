@@ -15,6 +15,7 @@
 #ifndef PLATFORM_IMPL_G3_BLE_H_
 #define PLATFORM_IMPL_G3_BLE_H_
 
+#include <cstdint>
 #include <memory>
 #include <string>
 
@@ -28,6 +29,7 @@
 #include "platform/base/output_stream.h"
 #include "platform/impl/g3/bluetooth_adapter.h"
 #include "platform/impl/g3/bluetooth_classic.h"
+#include "platform/impl/g3/link_output_stream.h"
 #include "platform/impl/g3/multi_thread_executor.h"
 #include "platform/impl/g3/pipe.h"
 
@@ -47,6 +49,10 @@ class BleSocket : public api::BleSocket {
   // from this point on, and until Close is called, connection exists.
   void Connect(BleSocket& other) ABSL_LOCKS_EXCLUDED(mutex_);
 
+  // Limits how fast data written to this socket is sent, in bytes per second;
+  // 0 is unlimited. Connect() applies the limit set on either socket.
+  void SetBandwidth(std::int64_t bytes_per_second);
+
   // Returns the InputStream of this connected BleSocket.
   InputStream& GetInputStream() override ABSL_LOCKS_EXCLUDED(mutex_);
 
@@ -90,6 +96,8 @@ class BleSocket : public api::BleSocket {
   // it is closed. it represents output part of a local socket. Input part of a
   // local socket comes from the peer socket, after connection.
   std::shared_ptr<Pipe> output_{new Pipe};
+  // Paces writes to output_ to the bandwidth of the link.
+  LinkOutputStream link_output_{output_->GetOutputStream()};
   std::shared_ptr<Pipe> input_;
   mutable absl::Mutex mutex_;
   BlePeripheral* peripheral_;
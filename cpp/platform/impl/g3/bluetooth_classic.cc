@@ -14,6 +14,7 @@
 
 #include "platform/impl/g3/bluetooth_classic.h"
 
+#include <algorithm>
 #include <memory>
 #include <string>
 
@@ -37,6 +38,12 @@ void BluetoothSocket::Connect(BluetoothSocket& other) {
   absl::MutexLock lock(&mutex_);
   remote_socket_ = &other;
   input_ = other.output_;
+  link_output_.SetBandwidth(std::max(link_output_.GetBandwidth(),
+                                      other.link_output_.GetBandwidth()));
+}
+
+void BluetoothSocket::SetBandwidth(std::int64_t bytes_per_second) {
+  link_output_.SetBandwidth(bytes_per_second);
 }
 
 bool BluetoothSocket::IsConnected() const {
@@ -68,7 +75,7 @@ InputStream& BluetoothSocket::GetLocalInputStream() {
 
 OutputStream& BluetoothSocket::GetLocalOutputStream() {
   absl::MutexLock lock(&mutex_);
-  return output_->GetOutputStream();
+  return link_output_;
 }
 
 Exception BluetoothSocket::Close() {
@@ -227,6 +234,14 @@ std::unique_ptr<api::BluetoothSocket> BluetoothClassicMedium::ConnectToService(
     }
   }
 
+  LinkProperties link;
+  auto& env = MediumEnvironment::Instance();
+  if (!env.SimulateConnectionRequest(*this, *medium, &link)) {
+    NEARBY_LOGS(ERROR) << "G3 ConnectToService: Connection request lost: uuid="
+                       << service_uuid;
+    return {};
+  }
+
   if (cancellation_flag->Cancelled()) {
     NEARBY_LOGS(ERROR) << "G3 Bluetooth Connect: Has been cancelled: "
                           "service_uuid="
@@ -240,6 +255,7 @@ std::unique_ptr<api::BluetoothSocket> BluetoothClassicMedium::ConnectToService(
   });
 
   auto socket = std::make_unique<BluetoothSocket>(&GetAdapter());
+  socket->SetBandwidth(link.bandwidth_bytes_per_second);
   // Finally, Request to connect to this socket.
   if (!server_socket->Connect(*socket)) {
     NEARBY_LOGS(ERROR)
@@ -15,6 +15,7 @@
 #ifndef PLATFORM_IMPL_G3_BLUETOOTH_CLASSIC_H_
 #define PLATFORM_IMPL_G3_BLUETOOTH_CLASSIC_H_
 
+#include <cstdint>
 #include <memory>
 #include <string>
 
@@ -28,6 +29,7 @@
 #include "platform/base/listeners.h"
 #include "platform/base/output_stream.h"
 #include "platform/impl/g3/bluetooth_adapter.h"
+#include "platform/impl/g3/link_output_stream.h"
 #include "platform/impl/g3/pipe.h"
 
 namespace location {
@@ -45,6 +47,10 @@ class BluetoothSocket : public api::BluetoothSocket {
   // channel. From this point on, and until Close is called, connection exists.
   void Connect(BluetoothSocket& other);
 
+  // Limits how fast data written to this socket is sent, in bytes per second;
+  // 0 is unlimited. Connect() applies the limit set on either socket.
+  void SetBandwidth(std::int64_t bytes_per_second);
+
   // NOTE:
   // It is an undefined behavior if GetInputStream() or GetOutputStream() is
   // called for a not-connected BluetoothSocket, i.e. any object that is not
@@ -97,6 +103,8 @@ class BluetoothSocket : public api::BluetoothSocket {
   // it is closed. it represents output part of a local socket. Input part of a
   // local socket comes from the peer socket, after connection.
   std::shared_ptr<Pipe> output_{new Pipe};
+  // Paces writes to output_ to the bandwidth of the link.
+  LinkOutputStream link_output_{output_->GetOutputStream()};
   std::shared_ptr<Pipe> input_;
   mutable absl::Mutex mutex_;
   BluetoothAdapter* adapter_ = nullptr;  // Our Adapter. Read only.
@@ -19,6 +19,7 @@
 #include "platform/api/condition_variable.h"
 #include "platform/base/exception.h"
 #include "platform/impl/g3/mutex.h"
+#include "platform/impl/g3/virtual_clock.h"
 
 namespace location {
 namespace nearby {
@@ -30,14 +31,20 @@ class ConditionVariable : public api::ConditionVariable {
   ~ConditionVariable() override = default;
 
   Exception Wait() override {
-    cond_var_.Wait(mutex_);
+    VirtualClock& clock = VirtualClock::Instance();
+    if (clock.IsEnabled()) {
+      clock.WaitWithDeadline(mutex_, &cond_var_, absl::InfiniteFuture());
+    } else {
+      cond_var_.Wait(mutex_);
+    }
     return {Exception::kSuccess};
   }
   Exception Wait(absl::Duration timeout) override {
-    cond_var_.WaitWithTimeout(mutex_, timeout);
+    VirtualClock& clock = VirtualClock::Instance();
+    clock.WaitWithDeadline(mutex_, &cond_var_, clock.Now() + timeout);
     return {Exception::kSuccess};
   }
-  void Notify() override { cond_var_.SignalAll(); }
+  void Notify() override { VirtualClock::Instance().SignalAll(&cond_var_); }
 
  private:
   absl::Mutex* mutex_;
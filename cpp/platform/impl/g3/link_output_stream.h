@@ -0,0 +1,77 @@
+// Copyright 2021 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef PLATFORM_IMPL_G3_LINK_OUTPUT_STREAM_H_
+#define PLATFORM_IMPL_G3_LINK_OUTPUT_STREAM_H_
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+
+#include "absl/base/thread_annotations.h"
+#include "absl/synchronization/mutex.h"
+#include "absl/time/time.h"
+#include "platform/base/byte_array.h"
+#include "platform/base/exception.h"
+#include "platform/base/output_stream.h"
+#include "platform/impl/g3/virtual_clock.h"
+
+namespace location {
+namespace nearby {
+namespace g3 {
+
+// OutputStream of a simulated socket, that limits how fast data can be written
+// to the underlying stream, as configured by LinkProperties of the link.
+class LinkOutputStream : public OutputStream {
+ public:
+  explicit LinkOutputStream(OutputStream& output) : output_(output) {}
+  ~LinkOutputStream() override = default;
+
+  // Sets bytes per second that can be written; 0 is unlimited.
+  void SetBandwidth(std::int64_t bytes_per_second) {
+    bandwidth_ = std::max<std::int64_t>(bytes_per_second, 0);
+  }
+  std::int64_t GetBandwidth() const { return bandwidth_; }
+
+  // Writes |data| once the link has sent everything written before it, and
+  // waits for |data| itself to be sent. Writes are serialized, as they are on
+  // a real link.
+  Exception Write(const ByteArray& data) override ABSL_LOCKS_EXCLUDED(mutex_) {
+    absl::MutexLock lock(&mutex_);
+    std::int64_t bandwidth = bandwidth_;
+    if (bandwidth > 0) {
+      VirtualClock& clock = VirtualClock::Instance();
+      absl::Time now = clock.Now();
+      next_write_time_ =
+          std::max(next_write_time_, now) +
+          absl::Seconds(static_cast<double>(data.size()) / bandwidth);
+      clock.SleepFor(next_write_time_ - now);
+    }
+    return output_.Write(data);
+  }
+  Exception Flush() override { return output_.Flush(); }
+  Exception Close() override { return output_.Close(); }
+
+ private:
+  OutputStream& output_;
+  std::atomic<std::int64_t> bandwidth_ = 0;
+  absl::Mutex mutex_;
+  absl::Time next_write_time_ ABSL_GUARDED_BY(mutex_) = absl::InfinitePast();
+};
+
+}  // namespace g3
+}  // namespace nearby
+}  // namespace location
+
+#endif  // PLATFORM_IMPL_G3_LINK_OUTPUT_STREAM_H_
@@ -19,6 +19,7 @@
 
 #include "absl/time/clock.h"
 #include "platform/api/submittable_executor.h"
+#include "platform/impl/g3/virtual_clock.h"
 #include "platform/impl/shared/count_down_latch.h"
 #include "thread/threadpool.h"
 
@@ -36,12 +37,12 @@ class MultiThreadExecutor : public api::SubmittableExecutor {
   }
   void Execute(Runnable&& runnable) override {
     if (!shutdown_) {
-      thread_pool_.Schedule(std::move(runnable));
+      Schedule(std::move(runnable));
     }
   }
   bool DoSubmit(Runnable&& runnable) override {
     if (shutdown_) return false;
-    thread_pool_.Schedule(std::move(runnable));
+    Schedule(std::move(runnable));
     return true;
   }
   void Shutdown() override { DoShutdown(); }
@@ -49,12 +50,36 @@ class MultiThreadExecutor : public api::SubmittableExecutor {
 
   void ScheduleAfter(absl::Duration delay, Runnable&& runnable) {
     if (shutdown_) return;
+    VirtualClock& clock = VirtualClock::Instance();
+    if (clock.IsEnabled()) {
+      clock.AddTimer(this, clock.Now() + delay,
+                     [this, runnable(std::move(runnable))]() mutable {
+                       Execute(std::move(runnable));
+                     });
+      return;
+    }
     thread_pool_.ScheduleAt(absl::Now() + delay, std::move(runnable));
   }
   bool InShutdown() const { return shutdown_; }
 
  private:
-  void DoShutdown() { shutdown_ = true; }
+  void DoShutdown() {
+    shutdown_ = true;
+    VirtualClock::Instance().RemoveTimers(this);
+  }
+  // In virtual time, a task keeps the clock from moving until it is done.
+  void Schedule(Runnable&& runnable) {
+    VirtualClock& clock = VirtualClock::Instance();
+    if (!clock.IsEnabled()) {
+      thread_pool_.Schedule(std::move(runnable));
+      return;
+    }
+    clock.BeginWork();
+    thread_pool_.Schedule([runnable(std::move(runnable))]() {
+      runnable();
+      VirtualClock::Instance().EndWork();
+    });
+  }
   std::atomic_bool shutdown_ = false;
   ThreadPool thread_pool_;
 };
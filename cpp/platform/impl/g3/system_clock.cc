@@ -14,15 +14,17 @@
 
 #include "platform/api/system_clock.h"
 
-#include "absl/time/clock.h"
 #include "platform/base/exception.h"
+#include "platform/impl/g3/virtual_clock.h"
 
 namespace location {
 namespace nearby {
 
-absl::Time SystemClock::ElapsedRealtime() { return absl::Now(); }
+absl::Time SystemClock::ElapsedRealtime() {
+  return g3::VirtualClock::Instance().Now();
+}
 Exception SystemClock::Sleep(absl::Duration duration) {
-  absl::SleepFor(duration);
+  g3::VirtualClock::Instance().SleepFor(duration);
   return {Exception::kSuccess};
 }
 
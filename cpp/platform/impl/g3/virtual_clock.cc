@@ -0,0 +1,208 @@
+// Copyright 2021 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "platform/impl/g3/virtual_clock.h"
+
+#include <algorithm>
+#include <utility>
+
+#include "absl/time/clock.h"
+
+namespace location {
+namespace nearby {
+namespace g3 {
+
+VirtualClock& VirtualClock::Instance() {
+  static VirtualClock* clock = new VirtualClock();
+  return *clock;
+}
+
+void VirtualClock::Enable(absl::Time start) {
+  absl::MutexLock lock(&mutex_);
+  now_ = start;
+  active_ = 1;
+  events_.clear();
+  cond_waiters_.clear();
+  enabled_ = true;
+}
+
+void VirtualClock::Disable() {
+  absl::MutexLock lock(&mutex_);
+  enabled_ = false;
+  std::vector<Waiter*> waiters;
+  for (auto& item : events_) {
+    if (item.second.waiter) waiters.push_back(item.second.waiter);
+  }
+  for (auto& item : cond_waiters_) {
+    for (Waiter* waiter : item.second) {
+      if (waiter->key.first == absl::InfiniteFuture()) {
+        waiters.push_back(waiter);
+      }
+    }
+  }
+  for (Waiter* waiter : waiters) Wake(waiter, /*timed_out=*/false);
+  events_.clear();
+  cond_waiters_.clear();
+}
+
+absl::Time VirtualClock::Now() {
+  if (!enabled_) return absl::Now();
+  absl::MutexLock lock(&mutex_);
+  return enabled_ ? now_ : absl::Now();
+}
+
+void VirtualClock::SleepFor(absl::Duration duration) {
+  if (!enabled_) {
+    absl::SleepFor(duration);
+    return;
+  }
+  WaitWithDeadline(nullptr, nullptr, Now() + duration);
+}
+
+bool VirtualClock::WaitWithDeadline(absl::Mutex* mutex, absl::CondVar* cond,
+                                    absl::Time deadline)
+    ABSL_NO_THREAD_SAFETY_ANALYSIS {
+  auto wait_real_time = [mutex, cond, deadline]() {
+    if (cond) return cond->WaitWithDeadline(mutex, deadline);
+    absl::SleepFor(deadline - absl::Now());
+    return true;
+  };
+  if (!enabled_) return wait_real_time();
+  mutex_.Lock();
+  if (!enabled_) {
+    mutex_.Unlock();
+    return wait_real_time();
+  }
+  if (deadline <= now_) {
+    mutex_.Unlock();
+    return true;
+  }
+  Waiter waiter{.cond = cond, .key = {deadline, next_seq_++}};
+  if (deadline != absl::InfiniteFuture()) {
+    events_.emplace(waiter.key, Event{.waiter = &waiter});
+  }
+  if (cond) cond_waiters_[cond].push_back(&waiter);
+  --active_;
+  // Registered under |mutex_|, so a SignalAll() after this is not lost.
+  if (mutex) mutex->Unlock();
+  std::vector<std::function<void()>> callbacks = AdvanceIfIdle();
+  if (!callbacks.empty()) {
+    mutex_.Unlock();
+    RunTimers(std::move(callbacks));
+    mutex_.Lock();
+  }
+  mutex_.Await(absl::Condition(&waiter.woken));
+  mutex_.Unlock();
+  if (mutex) mutex->Lock();
+  return waiter.timed_out;
+}
+
+void VirtualClock::SignalAll(absl::CondVar* cond) {
+  cond->SignalAll();
+  if (!enabled_) return;
+  absl::MutexLock lock(&mutex_);
+  auto it = cond_waiters_.find(cond);
+  if (it == cond_waiters_.end()) return;
+  std::vector<Waiter*> waiters = std::move(it->second);
+  cond_waiters_.erase(it);
+  for (Waiter* waiter : waiters) {
+    waiter->cond = nullptr;
+    Wake(waiter, /*timed_out=*/false);
+  }
+}
+
+void VirtualClock::BeginWork() {
+  absl::MutexLock lock(&mutex_);
+  ++active_;
+}
+
+void VirtualClock::EndWork() {
+  std::vector<std::function<void()>> callbacks;
+  {
+    absl::MutexLock lock(&mutex_);
+    --active_;
+    callbacks = AdvanceIfIdle();
+  }
+  RunTimers(std::move(callbacks));
+}
+
+void VirtualClock::AddTimer(const void* owner, absl::Time time,
+                            std::function<void()> callback) {
+  absl::MutexLock lock(&mutex_);
+  events_.emplace(Key{std::max(time, now_), next_seq_++},
+                  Event{.owner = owner, .callback = std::move(callback)});
+}
+
+void VirtualClock::RemoveTimers(const void* owner) {
+  absl::MutexLock lock(&mutex_);
+  for (auto it = events_.begin(); it != events_.end();) {
+    if (it->second.owner == owner) {
+      it = events_.erase(it);
+    } else {
+      ++it;
+    }
+  }
+  mutex_.Await(absl::Condition(
+      +[](std::int64_t* in_flight) { return *in_flight == 0; }, &in_flight_));
+}
+
+void VirtualClock::Wake(Waiter* waiter, bool timed_out) {
+  waiter->woken = true;
+  waiter->timed_out = timed_out;
+  // The waiter is busy from now on, not from when its thread gets to run;
+  // time must not move in between.
+  ++active_;
+  events_.erase(waiter->key);
+  if (waiter->cond) {
+    auto it = cond_waiters_.find(waiter->cond);
+    if (it != cond_waiters_.end()) {
+      auto& waiters = it->second;
+      waiters.erase(std::remove(waiters.begin(), waiters.end(), waiter),
+                    waiters.end());
+      if (waiters.empty()) cond_waiters_.erase(it);
+    }
+  }
+}
+
+std::vector<std::function<void()>> VirtualClock::AdvanceIfIdle() {
+  std::vector<std::function<void()>> callbacks;
+  if (!enabled_ || active_ > 0 || events_.empty()) return callbacks;
+  now_ = std::max(now_, events_.begin()->first.first);
+  while (!events_.empty() && events_.begin()->first.first <= now_) {
+    Event event = std::move(events_.begin()->second);
+    events_.erase(events_.begin());
+    if (event.waiter) {
+      Wake(event.waiter, /*timed_out=*/true);
+    } else {
+      ++active_;
+      callbacks.push_back(std::move(event.callback));
+    }
+  }
+  in_flight_ += callbacks.size();
+  return callbacks;
+}
+
+void VirtualClock::RunTimers(std::vector<std::function<void()>> callbacks) {
+  while (!callbacks.empty()) {
+    for (auto& callback : callbacks) callback();
+    absl::MutexLock lock(&mutex_);
+    active_ -= callbacks.size();
+    in_flight_ -= callbacks.size();
+    callbacks = AdvanceIfIdle();
+  }
+}
+
+}  // namespace g3
+}  // namespace nearby
+}  // namespace location
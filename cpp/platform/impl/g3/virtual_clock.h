@@ -0,0 +1,128 @@
+// Copyright 2021 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef PLATFORM_IMPL_G3_VIRTUAL_CLOCK_H_
+#define PLATFORM_IMPL_G3_VIRTUAL_CLOCK_H_
+
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <utility>
+#include <vector>
+
+#include "absl/base/thread_annotations.h"
+#include "absl/container/flat_hash_map.h"
+#include "absl/synchronization/mutex.h"
+#include "absl/time/time.h"
+
+namespace location {
+namespace nearby {
+namespace g3 {
+
+// Source of time for SystemClock, ScheduledExecutor, ConditionVariable and
+// CountDownLatch of the g3 platform.
+//
+// By default this is real time. Once enabled, time is virtual: it stands still
+// while any thread has work to do, and jumps straight to the next deadline
+// (timed wait, sleep or scheduled task) once every thread is idle. Timeouts
+// then only fire when nothing else can happen first, so long scenarios run
+// as fast as the CPU allows and do not depend on machine load.
+//
+// A thread is busy while it runs a task of a g3 executor; the thread that
+// enabled virtual time counts as busy too. A busy thread is idle while it
+// waits on the platform primitives above, including untimed waits. Blocking
+// on anything else (absl primitives, sockets) keeps it busy, so time stops
+// until it returns; threads not started by a g3 executor must not wait on
+// the primitives above while virtual time is enabled.
+class VirtualClock {
+ public:
+  static VirtualClock& Instance();
+
+  // Switches to virtual time, starting at |start|. Must be called while no
+  // executor has tasks pending.
+  void Enable(absl::Time start = absl::FromUnixSeconds(1609459200))
+      ABSL_LOCKS_EXCLUDED(mutex_);
+  // Switches back to real time. Pending timers are dropped, and threads
+  // waiting on virtual time wake up as if notified.
+  void Disable() ABSL_LOCKS_EXCLUDED(mutex_);
+  bool IsEnabled() const { return enabled_; }
+
+  absl::Time Now() ABSL_LOCKS_EXCLUDED(mutex_);
+  void SleepFor(absl::Duration duration) ABSL_LOCKS_EXCLUDED(mutex_);
+
+  // Waits on |cond|, which is used with |mutex|, until signalled with
+  // SignalAll() or until |deadline|. |mutex| must be held. Returns true if
+  // the deadline passed, like absl::CondVar::WaitWithDeadline().
+  bool WaitWithDeadline(absl::Mutex* mutex, absl::CondVar* cond,
+                        absl::Time deadline) ABSL_LOCKS_EXCLUDED(mutex_);
+  // Wakes up every thread waiting on |cond|.
+  void SignalAll(absl::CondVar* cond) ABSL_LOCKS_EXCLUDED(mutex_);
+
+  // Marks a task as pending until the matching EndWork(). Only used while
+  // virtual time is enabled.
+  void BeginWork() ABSL_LOCKS_EXCLUDED(mutex_);
+  void EndWork() ABSL_LOCKS_EXCLUDED(mutex_);
+
+  // Calls |callback| once virtual time reaches |time|. |callback| must hand
+  // its work off (e.g. to an executor) and return without blocking.
+  void AddTimer(const void* owner, absl::Time time,
+                std::function<void()> callback) ABSL_LOCKS_EXCLUDED(mutex_);
+  // Drops timers added for |owner|; no callback of theirs runs after return.
+  void RemoveTimers(const void* owner) ABSL_LOCKS_EXCLUDED(mutex_);
+
+ private:
+  using Key = std::pair<absl::Time, std::int64_t>;
+  struct Waiter {
+    absl::CondVar* cond = nullptr;
+    Key key;
+    bool woken = false;
+    bool timed_out = false;
+  };
+  struct Event {
+    Waiter* waiter = nullptr;
+    const void* owner = nullptr;
+    std::function<void()> callback;
+  };
+
+  VirtualClock() = default;
+
+  void Wake(Waiter* waiter, bool timed_out)
+      ABSL_EXCLUSIVE_LOCKS_REQUIRED(mutex_);
+  // Moves time forward to the next deadline if every thread is idle, and
+  // returns timer callbacks that became due; they are run with RunTimers().
+  std::vector<std::function<void()>> AdvanceIfIdle()
+      ABSL_EXCLUSIVE_LOCKS_REQUIRED(mutex_);
+  void RunTimers(std::vector<std::function<void()>> callbacks)
+      ABSL_LOCKS_EXCLUDED(mutex_);
+
+  std::atomic_bool enabled_ = false;
+  absl::Mutex mutex_;
+  absl::Time now_ ABSL_GUARDED_BY(mutex_);
+  // Busy threads and pending tasks; time only moves while this is zero.
+  std::int64_t active_ ABSL_GUARDED_BY(mutex_) = 0;
+  // Timer callbacks being run outside of |mutex_|.
+  std::int64_t in_flight_ ABSL_GUARDED_BY(mutex_) = 0;
+  std::int64_t next_seq_ ABSL_GUARDED_BY(mutex_) = 0;
+  // Timers and timed waits, in the order they fire.
+  std::map<Key, Event> events_ ABSL_GUARDED_BY(mutex_);
+  absl::flat_hash_map<absl::CondVar*, std::vector<Waiter*>> cond_waiters_
+      ABSL_GUARDED_BY(mutex_);
+};
+
+}  // namespace g3
+}  // namespace nearby
+}  // namespace location
+
+#endif  // PLATFORM_IMPL_G3_VIRTUAL_CLOCK_H_
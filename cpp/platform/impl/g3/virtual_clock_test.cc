@@ -0,0 +1,157 @@
+// Copyright 2021 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "platform/impl/g3/virtual_clock.h"
+
+#include <functional>
+#include <vector>
+
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+#include "absl/time/clock.h"
+#include "absl/time/time.h"
+#include "platform/public/cancelable_alarm.h"
+#include "platform/public/condition_variable.h"
+#include "platform/public/count_down_latch.h"
+#include "platform/public/mutex.h"
+#include "platform/public/mutex_lock.h"
+#include "platform/public/scheduled_executor.h"
+#include "platform/public/single_thread_executor.h"
+#include "platform/public/system_clock.h"
+
+namespace location {
+namespace nearby {
+namespace g3 {
+namespace {
+
+using ::testing::ElementsAre;
+
+// Everything below waits for hours of virtual time; none of it may take long
+// in real time.
+constexpr absl::Duration kRealTimeLimit = absl::Seconds(30);
+
+class VirtualClockTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    real_start_ = absl::Now();
+    VirtualClock::Instance().Enable();
+    start_ = SystemClock::ElapsedRealtime();
+  }
+  void TearDown() override {
+    VirtualClock::Instance().Disable();
+    EXPECT_LT(absl::Now() - real_start_, kRealTimeLimit);
+  }
+  absl::Duration Elapsed() const {
+    return SystemClock::ElapsedRealtime() - start_;
+  }
+
+  absl::Time real_start_;
+  absl::Time start_;
+};
+
+TEST_F(VirtualClockTest, SleepAdvancesTime) {
+  SystemClock::Sleep(absl::Hours(1));
+
+  EXPECT_EQ(Elapsed(), absl::Hours(1));
+}
+
+TEST_F(VirtualClockTest, ScheduledTasksRunInDeadlineOrder) {
+  Mutex mutex;
+  std::vector<int> order;
+  CountDownLatch latch(3);
+  ScheduledExecutor executor;
+  for (int hours : {3, 1, 2}) {
+    executor.Schedule(
+        [this, &mutex, &order, &latch, hours]() {
+          EXPECT_EQ(Elapsed(), absl::Hours(hours));
+          MutexLock lock(&mutex);
+          order.push_back(hours);
+          latch.CountDown();
+        },
+        absl::Hours(hours));
+  }
+
+  EXPECT_TRUE(latch.Await(absl::Hours(4)).result());
+  EXPECT_EQ(Elapsed(), absl::Hours(3));
+  MutexLock lock(&mutex);
+  EXPECT_THAT(order, ElementsAre(1, 2, 3));
+}
+
+TEST_F(VirtualClockTest, CanceledAlarmDoesNotRun) {
+  ScheduledExecutor executor;
+  CountDownLatch latch(1);
+  CancelableAlarm alarm(
+      "test", [&latch]() { latch.CountDown(); }, absl::Minutes(30),
+      &executor);
+  alarm.Cancel();
+
+  EXPECT_FALSE(latch.Await(absl::Hours(1)).result());
+  EXPECT_EQ(Elapsed(), absl::Hours(1));
+}
+
+TEST_F(VirtualClockTest, ConditionVariableWaitTimesOut) {
+  Mutex mutex;
+  ConditionVariable cond(&mutex);
+  MutexLock lock(&mutex);
+  cond.Wait(absl::Minutes(5));
+
+  EXPECT_EQ(Elapsed(), absl::Minutes(5));
+}
+
+TEST_F(VirtualClockTest, NotifyWakesWaiterWithoutAdvancingTime) {
+  Mutex mutex;
+  ConditionVariable cond(&mutex);
+  bool done = false;
+  SingleThreadExecutor executor;
+  executor.Execute([&mutex, &cond, &done]() {
+    // Real time passes here; virtual time must not, since this task is busy.
+    absl::SleepFor(absl::Milliseconds(100));
+    MutexLock lock(&mutex);
+    done = true;
+    cond.Notify();
+  });
+
+  MutexLock lock(&mutex);
+  while (!done) cond.Wait(absl::Seconds(1));
+  EXPECT_EQ(Elapsed(), absl::ZeroDuration());
+}
+
+TEST_F(VirtualClockTest, PeriodicTaskRunsForAnHour) {
+  constexpr int kTicks = 3600;
+  CountDownLatch latch(kTicks);
+  std::function<void()> tick;
+  ScheduledExecutor executor;
+  tick = [&]() {
+    latch.CountDown();
+    executor.Schedule([&tick]() { tick(); }, absl::Seconds(1));
+  };
+  executor.Schedule([&tick]() { tick(); }, absl::Seconds(1));
+
+  EXPECT_TRUE(latch.Await(absl::Hours(2)).result());
+  EXPECT_EQ(Elapsed(), absl::Seconds(kTicks));
+}
+
+TEST(VirtualClockDisabledTest, FollowsRealTime) {
+  absl::Time before = absl::Now();
+  absl::Time now = SystemClock::ElapsedRealtime();
+
+  EXPECT_FALSE(VirtualClock::Instance().IsEnabled());
+  EXPECT_GE(now, before);
+  EXPECT_LE(now, absl::Now());
+}
+
+}  // namespace
+}  // namespace g3
+}  // namespace nearby
+}  // namespace location
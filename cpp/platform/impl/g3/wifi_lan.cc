@@ -14,6 +14,7 @@
 
 #include "platform/impl/g3/wifi_lan.h"
 
+#include <algorithm>
 #include <iostream>
 #include <memory>
 #include <string>
@@ -41,6 +42,12 @@ void WifiLanSocket::Connect(WifiLanSocket& other) {
   absl::MutexLock lock(&mutex_);
   remote_socket_ = &other;
   input_ = other.output_;
+  link_output_.SetBandwidth(std::max(link_output_.GetBandwidth(),
+                                      other.link_output_.GetBandwidth()));
+}
+
+void WifiLanSocket::SetBandwidth(std::int64_t bytes_per_second) {
+  link_output_.SetBandwidth(bytes_per_second);
 }
 
 InputStream& WifiLanSocket::GetInputStream() {
@@ -94,7 +101,7 @@ InputStream& WifiLanSocket::GetLocalInputStream() {
 
 OutputStream& WifiLanSocket::GetLocalOutputStream() {
   absl::MutexLock lock(&mutex_);
-  return output_->GetOutputStream();
+  return link_output_;
 }
 
 std::string WifiLanServerSocket::GetName(const std::string& ip_address,
@@ -321,6 +328,14 @@ std::unique_ptr<api::WifiLanSocket> WifiLanMedium::ConnectToService(
     }
   }
 
+  LinkProperties link;
+  if (!env.SimulateConnectionRequest(*this, *remote_medium, &link)) {
+    NEARBY_LOGS(ERROR)
+        << "G3 WifiLan ConnectToService: Connection request lost: socket_name="
+        << socket_name;
+    return {};
+  }
+
   if (cancellation_flag->Cancelled()) {
     NEARBY_LOGS(ERROR) << "G3 WifiLan Connect: Has been cancelled: socket_name="
                        << socket_name;
@@ -335,6 +350,7 @@ std::unique_ptr<api::WifiLanSocket> WifiLanMedium::ConnectToService(
   });
 
   auto socket = std::make_unique<WifiLanSocket>();
+  socket->SetBandwidth(link.bandwidth_bytes_per_second);
   // Finally, Request to connect to this socket.
   if (!server_socket->Connect(*socket)) {
     NEARBY_LOGS(ERROR) << "G3 WifiLan Failed to connect to existing WifiLan "
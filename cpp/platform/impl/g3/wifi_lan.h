@@ -15,6 +15,7 @@
 #ifndef PLATFORM_IMPL_G3_WIFI_LAN_H_
 #define PLATFORM_IMPL_G3_WIFI_LAN_H_
 
+#include <cstdint>
 #include <memory>
 #include <string>
 #include <utility>
@@ -27,6 +28,7 @@
 #include "platform/base/input_stream.h"
 #include "platform/base/nsd_service_info.h"
 #include "platform/base/output_stream.h"
+#include "platform/impl/g3/link_output_stream.h"
 #include "platform/impl/g3/multi_thread_executor.h"
 #include "platform/impl/g3/pipe.h"
 
@@ -45,6 +47,10 @@ class WifiLanSocket : public api::WifiLanSocket {
   // from this point on, and until Close is called, connection exists.
   void Connect(WifiLanSocket& other) ABSL_LOCKS_EXCLUDED(mutex_);
 
+  // Limits how fast data written to this socket is sent, in bytes per second;
+  // 0 is unlimited. Connect() applies the limit set on either socket.
+  void SetBandwidth(std::int64_t bytes_per_second);
+
   // Returns the InputStream of this connected WifiLanSocket.
   InputStream& GetInputStream() override ABSL_LOCKS_EXCLUDED(mutex_);
 
@@ -84,6 +90,8 @@ class WifiLanSocket : public api::WifiLanSocket {
   // it is closed. it represents output part of a local socket. Input part of a
   // local socket comes from the peer socket, after connection.
   std::shared_ptr<Pipe> output_{new Pipe};
+  // Paces writes to output_ to the bandwidth of the link.
+  LinkOutputStream link_output_{output_->GetOutputStream()};
   std::shared_ptr<Pipe> input_;
   mutable absl::Mutex mutex_;
   WifiLanSocket* remote_socket_ ABSL_GUARDED_BY(mutex_) = nullptr;
@@ -0,0 +1,61 @@
+// Copyright 2021 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "platform/public/executor_metrics.h"
+
+#include <utility>
+
+#include "absl/strings/str_cat.h"
+#include "absl/time/time.h"
+#include "platform/public/system_clock.h"
+
+namespace location {
+namespace nearby {
+
+ExecutorMetrics::ExecutorMetrics(const std::string& name)
+    : state_(std::make_shared<State>()) {
+  MetricsRegistry& registry = MetricsRegistry::GetInstance();
+  state_->queue_depth =
+      registry.GetGauge(absl::StrCat("executor/", name, "/queue_depth"));
+  state_->wait_time =
+      registry.GetHistogram(absl::StrCat("executor/", name, "/wait_us"));
+  state_->run_time =
+      registry.GetHistogram(absl::StrCat("executor/", name, "/run_us"));
+}
+
+Runnable ExecutorMetrics::Track(Runnable&& runnable) {
+  state_->queued.fetch_add(1, std::memory_order_relaxed);
+  state_->queue_depth->Add(1);
+  return [state = state_, runnable = std::move(runnable),
+          post_time = SystemClock::ElapsedRealtime()]() {
+    absl::Time start_time = SystemClock::ElapsedRealtime();
+    state->queued.fetch_sub(1, std::memory_order_relaxed);
+    state->queue_depth->Add(-1);
+    state->wait_time->Record(start_time - post_time);
+    runnable();
+    state->run_time->Record(SystemClock::ElapsedRealtime() - start_time);
+  };
+}
+
+void ExecutorMetrics::OnRejected() {
+  state_->queued.fetch_sub(1, std::memory_order_relaxed);
+  state_->queue_depth->Add(-1);
+}
+
+void ExecutorMetrics::OnShutdown() {
+  state_->queue_depth->Add(-state_->queued.exchange(0));
+}
+
+}  // namespace nearby
+}  // namespace location
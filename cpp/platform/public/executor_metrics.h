@@ -0,0 +1,62 @@
+// Copyright 2021 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef PLATFORM_PUBLIC_EXECUTOR_METRICS_H_
+#define PLATFORM_PUBLIC_EXECUTOR_METRICS_H_
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <string>
+
+#include "platform/base/runnable.h"
+#include "platform/public/metrics_registry.h"
+
+namespace location {
+namespace nearby {
+
+// Feeds an executor's queue depth and task wait and run times into
+// MetricsRegistry, as "executor/<name>/queue_depth", "executor/<name>/wait_us"
+// and "executor/<name>/run_us". Executors sharing a name add up.
+class ExecutorMetrics {
+ public:
+  explicit ExecutorMetrics(const std::string& name);
+
+  // Wraps |runnable| so that it is counted as queued until it starts.
+  Runnable Track(Runnable&& runnable);
+  // Must be called when the executor did not accept a task wrapped by Track();
+  // it stops counting as queued.
+  void OnRejected();
+
+  // Must be called once the executor has shut down and no task will start
+  // anymore; tasks that never ran stop counting as queued.
+  void OnShutdown();
+
+ private:
+  struct State {
+    std::shared_ptr<Gauge> queue_depth;
+    std::shared_ptr<Histogram> wait_time;
+    std::shared_ptr<Histogram> run_time;
+    // This executor's share of |queue_depth|.
+    std::atomic<std::int64_t> queued{0};
+  };
+
+  // Shared with tracked tasks, which may run after this object is moved from.
+  std::shared_ptr<State> state_;
+};
+
+}  // namespace nearby
+}  // namespace location
+
+#endif  // PLATFORM_PUBLIC_EXECUTOR_METRICS_H_
@@ -14,6 +14,12 @@
 
 #include "platform/public/file.h"
 
+#include <algorithm>
+#include <utility>
+
+#include "absl/memory/memory.h"
+#include "platform/public/mutex_lock.h"
+
 namespace location {
 namespace nearby {
 
@@ -88,5 +94,48 @@ OutputStream& OutputFile::GetOutputStream() { return *impl_; }
 // Returns payload id of this file. The closest "file" equivalent is inode.
 PayloadId OutputFile::GetPayloadId() const { return id_; }
 
+// C++14 requires to declare this.
+constexpr int ContentCache::kDefaultMaxEntries;
+
+ContentCache::ContentCache(int max_entries) : max_entries_(max_entries) {}
+
+void ContentCache::Add(const std::string& scope, const ByteArray& content_hash,
+                       PayloadId payload_id, std::int64_t size) {
+  MutexLock lock(&mutex_);
+  Key key(scope, std::string(content_hash));
+  if (entries_.insert_or_assign(key, Entry{payload_id, size}).second) {
+    insertion_order_.push_back(std::move(key));
+  }
+  while (entries_.size() > static_cast<size_t>(max_entries_)) {
+    entries_.erase(insertion_order_.front());
+    insertion_order_.pop_front();
+  }
+}
+
+std::unique_ptr<InputFile> ContentCache::Open(
+    const std::string& scope, const ByteArray& content_hash) const {
+  MutexLock lock(&mutex_);
+  auto item = entries_.find(Key(scope, std::string(content_hash)));
+  if (item == entries_.end()) return {};
+  return absl::make_unique<InputFile>(item->second.payload_id,
+                                      item->second.size);
+}
+
+void ContentCache::Remove(const std::string& scope,
+                          const ByteArray& content_hash) {
+  MutexLock lock(&mutex_);
+  Key key(scope, std::string(content_hash));
+  if (entries_.erase(key)) {
+    insertion_order_.erase(
+        std::remove(insertion_order_.begin(), insertion_order_.end(), key),
+        insertion_order_.end());
+  }
+}
+
+int ContentCache::Size() const {
+  MutexLock lock(&mutex_);
+  return entries_.size();
+}
+
 }  // namespace nearby
 }  // namespace location
@@ -16,9 +16,12 @@
 #define PLATFORM_PUBLIC_FILE_H_
 
 #include <cstdint>
+#include <deque>
 #include <memory>
 #include <string>
+#include <utility>
 
+#include "absl/container/flat_hash_map.h"
 #include "platform/api/input_file.h"
 #include "platform/api/output_file.h"
 #include "platform/api/platform.h"
@@ -27,6 +30,7 @@
 #include "platform/base/input_stream.h"
 #include "platform/base/output_stream.h"
 #include "platform/public/core_config.h"
+#include "platform/public/mutex.h"
 
 namespace location {
 namespace nearby {
@@ -110,6 +114,54 @@ class DLL_API OutputFile final {
   PayloadId id_;
 };
 
+// Content-addressed directory of files received earlier.
+//
+// Entries refer to the payload files holding the content, so they stay valid
+// only as long as the application leaves those files in place. Callers must
+// check the content read through Open() before relying on it, and Remove()
+// entries that turn out to be stale.
+//
+// Entries are scoped, eg. to the peer that sent the content. A lookup only
+// finds content added under the same scope, so that one peer can't learn
+// which files another peer sent.
+class DLL_API ContentCache final {
+ public:
+  static constexpr int kDefaultMaxEntries = 256;
+
+  explicit ContentCache(int max_entries = kDefaultMaxEntries);
+
+  // Records that the file of |payload_id| holds |size| bytes of content with
+  // the given hash. Evicts the oldest entry once |max_entries| is reached.
+  void Add(const std::string& scope, const ByteArray& content_hash,
+           PayloadId payload_id, std::int64_t size)
+      ABSL_LOCKS_EXCLUDED(mutex_);
+
+  // Opens the file holding the content with the given hash, or returns null
+  // if there is no such entry in |scope|.
+  std::unique_ptr<InputFile> Open(const std::string& scope,
+                                  const ByteArray& content_hash) const
+      ABSL_LOCKS_EXCLUDED(mutex_);
+
+  void Remove(const std::string& scope, const ByteArray& content_hash)
+      ABSL_LOCKS_EXCLUDED(mutex_);
+
+  int Size() const ABSL_LOCKS_EXCLUDED(mutex_);
+
+ private:
+  // Scope and content hash.
+  using Key = std::pair<std::string, std::string>;
+  struct Entry {
+    PayloadId payload_id;
+    std::int64_t size;
+  };
+
+  const int max_entries_;
+  mutable Mutex mutex_;
+  absl::flat_hash_map<Key, Entry> entries_ ABSL_GUARDED_BY(mutex_);
+  // Keys of |entries_|, oldest first.
+  std::deque<Key> insertion_order_ ABSL_GUARDED_BY(mutex_);
+};
+
 }  // namespace nearby
 }  // namespace location
 
@@ -0,0 +1,86 @@
+// Copyright 2021 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "platform/public/file.h"
+
+#include <string>
+
+#include "gtest/gtest.h"
+#include "platform/base/prng.h"
+
+namespace location {
+namespace nearby {
+namespace {
+
+const ByteArray kHashA(std::string("hash-a"));
+const ByteArray kHashB(std::string("hash-b"));
+const ByteArray kHashC(std::string("hash-c"));
+constexpr char kScope[] = "client:ABCD";
+
+TEST(ContentCacheTest, OpensAddedContent) {
+  PayloadId payload_id = Prng().NextInt64();
+  ByteArray content(std::string("cached content"));
+  OutputFile output_file(payload_id);
+  ASSERT_TRUE(output_file.Write(content).Ok());
+  ASSERT_TRUE(output_file.Close().Ok());
+  ContentCache cache;
+
+  cache.Add(kScope, kHashA, payload_id, content.size());
+  std::unique_ptr<InputFile> input_file = cache.Open(kScope, kHashA);
+
+  ASSERT_NE(input_file, nullptr);
+  EXPECT_EQ(input_file->GetTotalSize(), content.size());
+  ExceptionOr<ByteArray> read = input_file->Read(content.size());
+  ASSERT_TRUE(read.ok());
+  EXPECT_EQ(read.result(), content);
+  EXPECT_EQ(cache.Open(kScope, kHashB), nullptr);
+}
+
+TEST(ContentCacheTest, RemoveDropsEntry) {
+  ContentCache cache;
+  cache.Add(kScope, kHashA, 1, 10);
+
+  cache.Remove(kScope, kHashA);
+
+  EXPECT_EQ(cache.Size(), 0);
+  EXPECT_EQ(cache.Open(kScope, kHashA), nullptr);
+}
+
+TEST(ContentCacheTest, EvictsOldestEntryWhenFull) {
+  ContentCache cache(/*max_entries=*/2);
+  cache.Add(kScope, kHashA, 1, 10);
+  cache.Add(kScope, kHashB, 2, 10);
+  // Re-adding an entry does not make it any younger.
+  cache.Add(kScope, kHashA, 3, 10);
+
+  cache.Add(kScope, kHashC, 4, 10);
+
+  EXPECT_EQ(cache.Size(), 2);
+  EXPECT_EQ(cache.Open(kScope, kHashA), nullptr);
+  EXPECT_NE(cache.Open(kScope, kHashB), nullptr);
+  EXPECT_NE(cache.Open(kScope, kHashC), nullptr);
+}
+
+TEST(ContentCacheTest, OpenOnlyFindsEntriesOfTheSameScope) {
+  ContentCache cache;
+  cache.Add(kScope, kHashA, 1, 10);
+
+  EXPECT_EQ(cache.Open("client:WXYZ", kHashA), nullptr);
+  cache.Remove("client:WXYZ", kHashA);
+  EXPECT_EQ(cache.Size(), 1);
+}
+
+}  // namespace
+}  // namespace nearby
+}  // namespace location
@@ -49,4 +49,32 @@ TEST(LoggingTest, CanStream_LoggingDisabled) {
   EXPECT_EQ(num, 42);
 }
 
+TEST(LoggingTest, CanStreamEveryNSec) {
+  NEARBY_LOG_SET_SEVERITY(INFO);
+  int num = 0;
+  for (int i = 0; i < 3; i++) {
+    NEARBY_LOGS_EVERY_N_SEC(INFO, 60) << "Logged once: " << num++;
+  }
+  EXPECT_EQ(num, 1);
+}
+
+TEST(LoggingTest, CanStreamEveryNSec_EachCallSiteIsLimited) {
+  NEARBY_LOG_SET_SEVERITY(INFO);
+  int num = 0;
+  NEARBY_LOGS_EVERY_N_SEC(INFO, 60) << "First call site: " << num++;
+  NEARBY_LOGS_EVERY_N_SEC(INFO, 60) << "Second call site: " << num++;
+  EXPECT_EQ(num, 2);
+}
+
+TEST(LoggingTest, VerboseIsCompiledOutOfReleaseBuilds) {
+  NEARBY_LOG_SET_SEVERITY(VERBOSE);
+  int num = 42;
+  NEARBY_LOGS(VERBOSE) << "The answer to everything: " << num++;
+#if defined(NDEBUG) && !defined(NEARBY_ENABLE_VERBOSE_LOGS)
+  EXPECT_EQ(num, 42);
+#else
+  EXPECT_EQ(num, 43);
+#endif
+}
+
 }  // namespace
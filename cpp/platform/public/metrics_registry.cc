@@ -0,0 +1,175 @@
+// Copyright 2021 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "platform/public/metrics_registry.h"
+
+#include <algorithm>
+#include <cmath>
+
+#include "absl/strings/match.h"
+#include "platform/public/mutex_lock.h"
+#include "platform/public/system_clock.h"
+
+namespace location {
+namespace nearby {
+
+namespace {
+
+template <typename Metric>
+std::shared_ptr<Metric> GetOrCreate(
+    absl::flat_hash_map<std::string, std::shared_ptr<Metric>>& metrics,
+    absl::string_view name) {
+  auto& metric = metrics[std::string(name)];
+  if (metric == nullptr) metric = std::make_shared<Metric>();
+  return metric;
+}
+
+template <typename Metric>
+void RemoveWithPrefix(
+    absl::flat_hash_map<std::string, std::shared_ptr<Metric>>& metrics,
+    absl::string_view prefix) {
+  for (auto it = metrics.begin(); it != metrics.end();) {
+    if (absl::StartsWith(it->first, prefix)) {
+      metrics.erase(it++);
+    } else {
+      ++it;
+    }
+  }
+}
+
+// Index of the highest set bit of |value|, which must be positive.
+int GetHighestBit(std::uint64_t value) {
+  int bit = 0;
+  while (value >>= 1) bit++;
+  return bit;
+}
+
+}  // namespace
+
+// C++14 requires to declare this.
+// TODO(apolyudov): remove when migration to c++17 is possible.
+constexpr int Histogram::kSubBucketBits;
+constexpr int Histogram::kSubBucketCount;
+constexpr int Histogram::kBucketCount;
+
+std::int64_t HistogramSnapshot::GetPercentile(double percentile) const {
+  if (count == 0) return 0;
+  std::int64_t rank = static_cast<std::int64_t>(
+      std::ceil(std::max(0.0, std::min(percentile, 100.0)) / 100 * count));
+  std::int64_t seen = 0;
+  for (const auto& bucket : buckets) {
+    seen += bucket.count;
+    if (seen >= rank) {
+      return std::max(std::min(bucket.lower_bound, max), min);
+    }
+  }
+  return max;
+}
+
+void Histogram::Record(std::int64_t value) {
+  if (value < 0) value = 0;
+  buckets_[GetBucketIndex(value)].fetch_add(1, std::memory_order_relaxed);
+  count_.fetch_add(1, std::memory_order_relaxed);
+  sum_.fetch_add(value, std::memory_order_relaxed);
+  std::int64_t min = min_.load(std::memory_order_relaxed);
+  while (value < min && !min_.compare_exchange_weak(
+                            min, value, std::memory_order_relaxed)) {
+  }
+  std::int64_t max = max_.load(std::memory_order_relaxed);
+  while (value > max && !max_.compare_exchange_weak(
+                            max, value, std::memory_order_relaxed)) {
+  }
+}
+
+HistogramSnapshot Histogram::GetSnapshot() const {
+  HistogramSnapshot snapshot;
+  // The fields are read one at a time while others may be recording, so they
+  // can be off from each other by the few values being recorded right now.
+  for (int i = 0; i < kBucketCount; i++) {
+    std::int64_t count = buckets_[i].load(std::memory_order_relaxed);
+    if (count == 0) continue;
+    snapshot.buckets.push_back({GetBucketLowerBound(i), count});
+    snapshot.count += count;
+  }
+  if (snapshot.count == 0) return snapshot;
+  snapshot.sum = sum_.load(std::memory_order_relaxed);
+  snapshot.min = min_.load(std::memory_order_relaxed);
+  snapshot.max = max_.load(std::memory_order_relaxed);
+  return snapshot;
+}
+
+int Histogram::GetBucketIndex(std::int64_t value) {
+  if (value < 2 * kSubBucketCount) return static_cast<int>(value);
+  // Keep the top kSubBucketBits + 1 bits; the highest one is always set.
+  int shift = GetHighestBit(value) - kSubBucketBits;
+  return shift * kSubBucketCount + static_cast<int>(value >> shift);
+}
+
+std::int64_t Histogram::GetBucketLowerBound(int index) {
+  if (index < 2 * kSubBucketCount) return index;
+  int shift = index / kSubBucketCount - 1;
+  return static_cast<std::int64_t>(kSubBucketCount + index % kSubBucketCount)
+         << shift;
+}
+
+MetricsRegistry& MetricsRegistry::GetInstance() {
+  static MetricsRegistry* instance = new MetricsRegistry();
+  return *instance;
+}
+
+MetricsRegistry::MetricsRegistry() = default;
+
+MetricsRegistry::~MetricsRegistry() = default;
+
+std::shared_ptr<Counter> MetricsRegistry::GetCounter(absl::string_view name) {
+  MutexLock lock(&mutex_);
+  return GetOrCreate(counters_, name);
+}
+
+std::shared_ptr<Gauge> MetricsRegistry::GetGauge(absl::string_view name) {
+  MutexLock lock(&mutex_);
+  return GetOrCreate(gauges_, name);
+}
+
+std::shared_ptr<Histogram> MetricsRegistry::GetHistogram(
+    absl::string_view name) {
+  MutexLock lock(&mutex_);
+  return GetOrCreate(histograms_, name);
+}
+
+void MetricsRegistry::RemoveMetrics(absl::string_view prefix) {
+  MutexLock lock(&mutex_);
+  RemoveWithPrefix(counters_, prefix);
+  RemoveWithPrefix(gauges_, prefix);
+  RemoveWithPrefix(histograms_, prefix);
+}
+
+MetricsSnapshot MetricsRegistry::GetSnapshot() const {
+  MetricsSnapshot snapshot;
+  snapshot.time = SystemClock::ElapsedRealtime();
+  MutexLock lock(&mutex_);
+  for (const auto& item : counters_) {
+    snapshot.counters.emplace(item.first, item.second->GetValue());
+  }
+  for (const auto& item : gauges_) {
+    snapshot.gauges.emplace(item.first, item.second->GetValue());
+  }
+  for (const auto& item : histograms_) {
+    snapshot.histograms.emplace(item.first, item.second->GetSnapshot());
+  }
+  return snapshot;
+}
+
+}  // namespace nearby
+}  // namespace location
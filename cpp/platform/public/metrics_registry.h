@@ -0,0 +1,174 @@
+// Copyright 2021 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef PLATFORM_PUBLIC_METRICS_REGISTRY_H_
+#define PLATFORM_PUBLIC_METRICS_REGISTRY_H_
+
+#include <atomic>
+#include <cstdint>
+#include <limits>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "absl/base/thread_annotations.h"
+#include "absl/container/flat_hash_map.h"
+#include "absl/strings/string_view.h"
+#include "absl/time/time.h"
+#include "platform/public/mutex.h"
+
+namespace location {
+namespace nearby {
+
+// A monotonically increasing count, eg. bytes written.
+class Counter {
+ public:
+  void Increment(std::int64_t delta = 1) {
+    value_.fetch_add(delta, std::memory_order_relaxed);
+  }
+  std::int64_t GetValue() const {
+    return value_.load(std::memory_order_relaxed);
+  }
+
+ private:
+  std::atomic<std::int64_t> value_{0};
+};
+
+// A value that goes up and down, eg. the number of queued tasks.
+class Gauge {
+ public:
+  void Set(std::int64_t value) {
+    value_.store(value, std::memory_order_relaxed);
+  }
+  void Add(std::int64_t delta) {
+    value_.fetch_add(delta, std::memory_order_relaxed);
+  }
+  std::int64_t GetValue() const {
+    return value_.load(std::memory_order_relaxed);
+  }
+
+ private:
+  std::atomic<std::int64_t> value_{0};
+};
+
+// A point-in-time copy of a Histogram.
+struct HistogramSnapshot {
+  struct Bucket {
+    // Smallest value that falls in the bucket.
+    std::int64_t lower_bound;
+    std::int64_t count;
+  };
+
+  // Returns the value below which |percentile| (0 to 100) percent of the
+  // recorded values fall, rounded down to its bucket's lower bound; 0 if
+  // nothing was recorded.
+  std::int64_t GetPercentile(double percentile) const;
+  double GetMean() const {
+    return count > 0 ? static_cast<double>(sum) / count : 0;
+  }
+
+  std::int64_t count = 0;
+  std::int64_t sum = 0;
+  std::int64_t min = 0;
+  std::int64_t max = 0;
+  // Non-empty buckets only, in increasing order.
+  std::vector<Bucket> buckets;
+};
+
+// Distribution of non-negative values, eg. latencies in microseconds.
+//
+// Values are counted in log-linear buckets, like an HDR histogram with 3
+// significant bits: values up to 15 are exact, and every larger power of 2
+// range is split into 8 equal buckets, so any value is known to within 12.5%.
+// Recording is lock free and never allocates.
+class Histogram {
+ public:
+  // Negative values are recorded as 0.
+  void Record(std::int64_t value);
+  void Record(absl::Duration duration) {
+    Record(absl::ToInt64Microseconds(duration));
+  }
+
+  HistogramSnapshot GetSnapshot() const;
+
+ private:
+  static constexpr int kSubBucketBits = 3;
+  static constexpr int kSubBucketCount = 1 << kSubBucketBits;
+  // Values 0..15 get a bucket each; each of the remaining 59 powers of 2 get
+  // kSubBucketCount.
+  static constexpr int kBucketCount = (2 + 59) * kSubBucketCount;
+
+  static int GetBucketIndex(std::int64_t value);
+  static std::int64_t GetBucketLowerBound(int index);
+
+  std::atomic<std::int64_t> buckets_[kBucketCount] = {};
+  std::atomic<std::int64_t> count_{0};
+  std::atomic<std::int64_t> sum_{0};
+  std::atomic<std::int64_t> min_{std::numeric_limits<std::int64_t>::max()};
+  std::atomic<std::int64_t> max_{0};
+};
+
+// A point-in-time copy of every registered metric, keyed by name.
+struct MetricsSnapshot {
+  absl::Time time;
+  std::map<std::string, std::int64_t> counters;
+  std::map<std::string, std::int64_t> gauges;
+  std::map<std::string, HistogramSnapshot> histograms;
+};
+
+// A global registry of named metrics, so that the state of transfers and
+// executors can be inspected programmatically instead of through logs.
+//
+// Metrics are created on first use and shared by everyone asking for the same
+// name. Callers on hot paths should look their metrics up once and keep the
+// returned pointers; updating a metric never takes a lock.
+//
+// Names are '/'-separated paths, eg. "endpoint/ABCD/bytes_written".
+class MetricsRegistry {
+ public:
+  static MetricsRegistry& GetInstance();
+
+  ~MetricsRegistry();
+
+  std::shared_ptr<Counter> GetCounter(absl::string_view name)
+      ABSL_LOCKS_EXCLUDED(mutex_);
+  std::shared_ptr<Gauge> GetGauge(absl::string_view name)
+      ABSL_LOCKS_EXCLUDED(mutex_);
+  std::shared_ptr<Histogram> GetHistogram(absl::string_view name)
+      ABSL_LOCKS_EXCLUDED(mutex_);
+
+  // Unregisters all metrics whose name starts with |prefix|, eg. when an
+  // endpoint goes away. Metrics still held by callers keep working, but no
+  // longer show up in snapshots.
+  void RemoveMetrics(absl::string_view prefix) ABSL_LOCKS_EXCLUDED(mutex_);
+
+  MetricsSnapshot GetSnapshot() const ABSL_LOCKS_EXCLUDED(mutex_);
+
+ private:
+  MetricsRegistry();
+
+  mutable Mutex mutex_;
+  absl::flat_hash_map<std::string, std::shared_ptr<Counter>> counters_
+      ABSL_GUARDED_BY(mutex_);
+  absl::flat_hash_map<std::string, std::shared_ptr<Gauge>> gauges_
+      ABSL_GUARDED_BY(mutex_);
+  absl::flat_hash_map<std::string, std::shared_ptr<Histogram>> histograms_
+      ABSL_GUARDED_BY(mutex_);
+};
+
+}  // namespace nearby
+}  // namespace location
+
+#endif  // PLATFORM_PUBLIC_METRICS_REGISTRY_H_
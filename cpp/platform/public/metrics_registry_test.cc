@@ -0,0 +1,142 @@
+// Copyright 2021 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "platform/public/metrics_registry.h"
+
+#include <memory>
+
+#include "gtest/gtest.h"
+#include "absl/time/time.h"
+#include "platform/api/submittable_executor.h"
+#include "platform/public/count_down_latch.h"
+#include "platform/public/future.h"
+#include "platform/public/single_thread_executor.h"
+#include "platform/public/submittable_executor.h"
+
+namespace location {
+namespace nearby {
+namespace {
+
+TEST(MetricsRegistryTest, SameNameGetsSameMetric) {
+  MetricsRegistry& registry = MetricsRegistry::GetInstance();
+  registry.GetCounter("metrics_test/same/counter")->Increment(2);
+  registry.GetCounter("metrics_test/same/counter")->Increment(3);
+
+  EXPECT_EQ(registry.GetCounter("metrics_test/same/counter")->GetValue(), 5);
+  EXPECT_EQ(registry.GetSnapshot().counters.at("metrics_test/same/counter"),
+            5);
+}
+
+TEST(MetricsRegistryTest, RemoveMetricsDropsPrefixFromSnapshot) {
+  MetricsRegistry& registry = MetricsRegistry::GetInstance();
+  auto gauge = registry.GetGauge("metrics_test/remove/gauge");
+  registry.GetCounter("metrics_test/keep/counter")->Increment();
+  gauge->Set(7);
+
+  registry.RemoveMetrics("metrics_test/remove/");
+  gauge->Add(1);
+
+  MetricsSnapshot snapshot = registry.GetSnapshot();
+  EXPECT_EQ(snapshot.gauges.count("metrics_test/remove/gauge"), 0);
+  EXPECT_EQ(snapshot.counters.count("metrics_test/keep/counter"), 1);
+  EXPECT_EQ(gauge->GetValue(), 8);
+}
+
+TEST(MetricsRegistryTest, HistogramKeepsValuesWithinBucketPrecision) {
+  Histogram histogram;
+  for (int i = 1; i <= 1000; i++) histogram.Record(i);
+  histogram.Record(absl::Milliseconds(2));
+
+  HistogramSnapshot snapshot = histogram.GetSnapshot();
+  EXPECT_EQ(snapshot.count, 1001);
+  EXPECT_EQ(snapshot.min, 1);
+  EXPECT_EQ(snapshot.max, 2000);
+  EXPECT_EQ(snapshot.sum, 500500 + 2000);
+  EXPECT_EQ(snapshot.GetPercentile(1), 11);
+  EXPECT_GE(snapshot.GetPercentile(50), 500 * 7 / 8);
+  EXPECT_LE(snapshot.GetPercentile(50), 500);
+  EXPECT_GE(snapshot.GetPercentile(99), 990 * 7 / 8);
+  EXPECT_EQ(snapshot.GetPercentile(100), 1920);
+}
+
+TEST(MetricsRegistryTest, EmptyHistogram) {
+  Histogram histogram;
+
+  HistogramSnapshot snapshot = histogram.GetSnapshot();
+  EXPECT_EQ(snapshot.count, 0);
+  EXPECT_EQ(snapshot.GetPercentile(50), 0);
+  EXPECT_EQ(snapshot.GetMean(), 0);
+}
+
+TEST(MetricsRegistryTest, ExecutorReportsQueueDepthAndWaitTime) {
+  MetricsRegistry& registry = MetricsRegistry::GetInstance();
+  CountDownLatch started(1);
+  CountDownLatch release(1);
+  CountDownLatch done(2);
+  {
+    SingleThreadExecutor executor("metrics_test");
+    executor.Execute([&]() {
+      started.CountDown();
+      release.Await();
+    });
+    executor.Execute([&]() { done.CountDown(); });
+    executor.Execute([&]() { done.CountDown(); });
+    started.Await();
+
+    EXPECT_EQ(registry.GetGauge("executor/metrics_test/queue_depth")
+                  ->GetValue(),
+              2);
+    release.CountDown();
+    done.Await();
+  }
+
+  EXPECT_EQ(
+      registry.GetGauge("executor/metrics_test/queue_depth")->GetValue(), 0);
+  EXPECT_EQ(registry.GetHistogram("executor/metrics_test/wait_us")
+                ->GetSnapshot()
+                .count,
+            3);
+}
+
+// Rejects every task, as a platform executor does once it is shutting down.
+class RejectingExecutor : public api::SubmittableExecutor {
+ public:
+  void Execute(Runnable&& runnable) override {}
+  bool DoSubmit(Runnable&& runnable) override { return false; }
+  void Shutdown() override {}
+};
+
+class RejectingSubmittableExecutor : public SubmittableExecutor {
+ public:
+  RejectingSubmittableExecutor()
+      : SubmittableExecutor(std::make_unique<RejectingExecutor>(),
+                            "metrics_test_rejecting") {}
+};
+
+TEST(MetricsRegistryTest, RejectedTaskIsNotCountedAsQueued) {
+  MetricsRegistry& registry = MetricsRegistry::GetInstance();
+  RejectingSubmittableExecutor executor;
+  Future<int> future;
+
+  EXPECT_FALSE(executor.Submit<int>([]() { return ExceptionOr<int>(1); },
+                                    &future));
+
+  EXPECT_EQ(registry.GetGauge("executor/metrics_test_rejecting/queue_depth")
+                ->GetValue(),
+            0);
+}
+
+}  // namespace
+}  // namespace nearby
+}  // namespace location
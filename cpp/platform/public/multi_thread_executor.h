@@ -15,6 +15,8 @@
 #ifndef PLATFORM_PUBLIC_MULTI_THREAD_EXECUTOR_H_
 #define PLATFORM_PUBLIC_MULTI_THREAD_EXECUTOR_H_
 
+#include <string>
+
 #include "absl/base/thread_annotations.h"
 #include "platform/api/platform.h"
 #include "platform/public/submittable_executor.h"
@@ -32,6 +34,11 @@ class ABSL_LOCKABLE MultiThreadExecutor final : public SubmittableExecutor {
   explicit MultiThreadExecutor(int max_parallelism)
       : SubmittableExecutor(
             Platform::CreateMultiThreadExecutor(max_parallelism)) {}
+  // Reports to MetricsRegistry under |metrics_name|.
+  MultiThreadExecutor(int max_parallelism, const std::string& metrics_name)
+      : SubmittableExecutor(
+            Platform::CreateMultiThreadExecutor(max_parallelism),
+            metrics_name) {}
   MultiThreadExecutor(MultiThreadExecutor&&) = default;
   MultiThreadExecutor& operator=(MultiThreadExecutor&&) = default;
   ~MultiThreadExecutor() override = default;
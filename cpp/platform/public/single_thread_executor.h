@@ -15,6 +15,8 @@
 #ifndef PLATFORM_PUBLIC_SINGLE_THREAD_EXECUTOR_H_
 #define PLATFORM_PUBLIC_SINGLE_THREAD_EXECUTOR_H_
 
+#include <string>
+
 #include "absl/base/thread_annotations.h"
 #include "platform/public/submittable_executor.h"
 
@@ -30,6 +32,10 @@ class ABSL_LOCKABLE SingleThreadExecutor final : public SubmittableExecutor {
   using Platform = api::ImplementationPlatform;
   SingleThreadExecutor()
       : SubmittableExecutor(Platform::CreateSingleThreadExecutor()) {}
+  // Reports to MetricsRegistry under |metrics_name|.
+  explicit SingleThreadExecutor(const std::string& metrics_name)
+      : SubmittableExecutor(Platform::CreateSingleThreadExecutor(),
+                            metrics_name) {}
   ~SingleThreadExecutor() override = default;
   SingleThreadExecutor(SingleThreadExecutor&&) = default;
   SingleThreadExecutor& operator=(SingleThreadExecutor&&) = default;
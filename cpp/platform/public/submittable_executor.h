@@ -18,6 +18,7 @@
 #include <cstddef>
 #include <functional>
 #include <memory>
+#include <string>
 #include <utility>
 
 #include "absl/base/thread_annotations.h"
@@ -25,6 +26,7 @@
 #include "platform/api/submittable_executor.h"
 #include "platform/base/callable.h"
 #include "platform/base/runnable.h"
+#include "platform/public/executor_metrics.h"
 #include "platform/public/future.h"
 #include "platform/public/lockable.h"
 #include "platform/public/monitored_runnable.h"
@@ -41,6 +43,9 @@ inline int GetCurrentTid() { return api::GetCurrentTid(); }
 // Main interface to be used by platform as a base class for
 // - MultiThreadExecutor
 // - SingleThreadExecutor
+//
+// Every task is tracked by ExecutorMetrics, under the name given to the
+// executor or "unnamed".
 class ABSL_LOCKABLE SubmittableExecutor : public api::SubmittableExecutor,
                                           public Lockable {
  public:
@@ -55,6 +60,7 @@ class ABSL_LOCKABLE SubmittableExecutor : public api::SubmittableExecutor,
     {
       MutexLock other_lock(&other.mutex_);
       impl_ = std::move(other.impl_);
+      metrics_ = std::move(other.metrics_);
     }
     return *this;
   }
@@ -63,14 +69,15 @@ class ABSL_LOCKABLE SubmittableExecutor : public api::SubmittableExecutor,
     MutexLock lock(&mutex_);
     if (impl_)
       impl_->Execute(MonitoredRunnable(
-          name, ThreadCheckRunnable(this, std::move(runnable))));
+          name,
+          ThreadCheckRunnable(this, metrics_->Track(std::move(runnable)))));
   }
 
   void Execute(Runnable&& runnable) ABSL_LOCKS_EXCLUDED(mutex_) override {
     MutexLock lock(&mutex_);
     if (impl_)
-      impl_->Execute(
-          MonitoredRunnable(ThreadCheckRunnable(this, std::move(runnable))));
+      impl_->Execute(MonitoredRunnable(
+          ThreadCheckRunnable(this, metrics_->Track(std::move(runnable)))));
   }
 
   void Shutdown() ABSL_LOCKS_EXCLUDED(mutex_) override {
@@ -103,14 +110,17 @@ class ABSL_LOCKABLE SubmittableExecutor : public api::SubmittableExecutor,
   }
 
  protected:
-  explicit SubmittableExecutor(std::unique_ptr<api::SubmittableExecutor> impl)
-      : impl_(std::move(impl)) {}
+  explicit SubmittableExecutor(std::unique_ptr<api::SubmittableExecutor> impl,
+                               const std::string& metrics_name = "unnamed")
+      : impl_(std::move(impl)),
+        metrics_(std::make_unique<ExecutorMetrics>(metrics_name)) {}
 
  private:
   void DoShutdown() ABSL_EXCLUSIVE_LOCKS_REQUIRED(mutex_) {
     if (impl_) {
       impl_->Shutdown();
       impl_.reset();
+      metrics_->OnShutdown();
     }
   }
   // Submit a callable (with no delay).
@@ -118,10 +128,16 @@ class ABSL_LOCKABLE SubmittableExecutor : public api::SubmittableExecutor,
   // Callable is not submitted if shutdown is in progress.
   bool DoSubmit(Runnable&& wrapped_callable)
       ABSL_EXCLUSIVE_LOCKS_REQUIRED(mutex_) override {
-    return impl_ ? impl_->DoSubmit(std::move(wrapped_callable)) : false;
+    if (!impl_) return false;
+    if (!impl_->DoSubmit(metrics_->Track(std::move(wrapped_callable)))) {
+      metrics_->OnRejected();
+      return false;
+    }
+    return true;
   }
   mutable Mutex mutex_;
   std::unique_ptr<api::SubmittableExecutor> ABSL_GUARDED_BY(mutex_) impl_;
+  std::unique_ptr<ExecutorMetrics> ABSL_GUARDED_BY(mutex_) metrics_;
 };
 
 }  // namespace nearby
@@ -0,0 +1,178 @@
+// Copyright 2021 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "platform/public/tracing.h"
+
+#include <utility>
+
+#include "absl/strings/str_cat.h"
+#include "absl/strings/str_format.h"
+#include "platform/api/executor.h"
+#include "platform/public/mutex_lock.h"
+#include "platform/public/system_clock.h"
+
+namespace location {
+namespace nearby {
+
+namespace {
+
+void AppendJsonString(absl::string_view value, std::string* json) {
+  json->push_back('"');
+  for (char c : value) {
+    if (c == '"' || c == '\\') {
+      json->push_back('\\');
+      json->push_back(c);
+    } else if (static_cast<unsigned char>(c) < 0x20) {
+      absl::StrAppendFormat(json, "\\u%04x", c);
+    } else {
+      json->push_back(c);
+    }
+  }
+  json->push_back('"');
+}
+
+}  // namespace
+
+// C++14 requires to declare this.
+// TODO(apolyudov): remove when migration to c++17 is possible.
+constexpr std::size_t TraceRecorder::kMaxEvents;
+
+TraceRecorder& TraceRecorder::GetInstance() {
+  static TraceRecorder* instance = new TraceRecorder();
+  return *instance;
+}
+
+TraceRecorder::TraceRecorder() = default;
+
+TraceRecorder::~TraceRecorder() = default;
+
+void TraceRecorder::Start() {
+  MutexLock lock(&mutex_);
+  events_.clear();
+  start_time_ = SystemClock::ElapsedRealtime();
+  enabled_.store(true, std::memory_order_relaxed);
+}
+
+void TraceRecorder::Stop() { enabled_.store(false, std::memory_order_relaxed); }
+
+std::string TraceRecorder::ExportChromeTrace() const {
+  MutexLock lock(&mutex_);
+  std::string json = "{\"traceEvents\":[";
+  bool first = true;
+  auto append_event = [&](const Event& event, absl::string_view phase,
+                          absl::Time time, bool with_duration) {
+    if (!first) json.push_back(',');
+    first = false;
+    json += "{\"name\":";
+    AppendJsonString(event.name, &json);
+    json += ",\"cat\":";
+    AppendJsonString(event.category, &json);
+    absl::StrAppend(&json, ",\"ph\":\"", phase, "\",\"ts\":",
+                    absl::ToInt64Microseconds(time - start_time_));
+    if (with_duration) {
+      absl::StrAppend(&json, ",\"dur\":",
+                      absl::ToInt64Microseconds(event.duration));
+    }
+    if (event.async_id != 0) {
+      absl::StrAppend(&json, ",\"id\":", event.async_id);
+    }
+    absl::StrAppend(&json, ",\"pid\":1,\"tid\":", event.tid);
+    if (!event.endpoint_id.empty()) {
+      json += ",\"args\":{\"endpoint_id\":";
+      AppendJsonString(event.endpoint_id, &json);
+      json.push_back('}');
+    }
+    json.push_back('}');
+  };
+  for (const Event& event : events_) {
+    if (event.async_id == 0) {
+      append_event(event, "X", event.start_time, /*with_duration=*/true);
+    } else {
+      append_event(event, "b", event.start_time, /*with_duration=*/false);
+      append_event(event, "e", event.start_time + event.duration,
+                   /*with_duration=*/false);
+    }
+  }
+  json += "],\"displayTimeUnit\":\"ms\"}";
+  return json;
+}
+
+std::size_t TraceRecorder::GetEventCount() const {
+  MutexLock lock(&mutex_);
+  return events_.size();
+}
+
+void TraceRecorder::Record(Event event) {
+  MutexLock lock(&mutex_);
+  // Drop spans that started before the last Start().
+  if (event.start_time < start_time_) return;
+  if (events_.size() >= kMaxEvents) events_.pop_front();
+  events_.push_back(std::move(event));
+}
+
+#ifndef NEARBY_DISABLE_TRACING
+TraceSpan::TraceSpan(const char* category, const char* name,
+                     absl::string_view endpoint_id) {
+  if (!TraceRecorder::GetInstance().IsEnabled()) return;
+  active_ = true;
+  category_ = category;
+  name_ = name;
+  endpoint_id_ = std::string(endpoint_id);
+  start_time_ = SystemClock::ElapsedRealtime();
+  tid_ = api::GetCurrentTid();
+}
+
+TraceSpan& TraceSpan::operator=(TraceSpan&& other) {
+  if (this == &other) return *this;
+  End();
+  active_ = other.active_;
+  category_ = other.category_;
+  name_ = other.name_;
+  endpoint_id_ = std::move(other.endpoint_id_);
+  start_time_ = other.start_time_;
+  tid_ = other.tid_;
+  async_id_ = other.async_id_;
+  other.active_ = false;
+  return *this;
+}
+
+TraceSpan TraceSpan::Async(const char* category, const char* name,
+                           absl::string_view endpoint_id) {
+  TraceSpan span(category, name, endpoint_id);
+  if (span.active_) {
+    span.async_id_ = TraceRecorder::GetInstance().NextAsyncId();
+  }
+  return span;
+}
+
+void TraceSpan::End() {
+  if (!active_) return;
+  active_ = false;
+  TraceRecorder& recorder = TraceRecorder::GetInstance();
+  // Spans still open when tracing stops are dropped.
+  if (!recorder.IsEnabled()) return;
+  recorder.Record({
+      .category = category_,
+      .name = name_,
+      .endpoint_id = std::move(endpoint_id_),
+      .start_time = start_time_,
+      .duration = SystemClock::ElapsedRealtime() - start_time_,
+      .tid = tid_,
+      .async_id = async_id_,
+  });
+}
+#endif  // NEARBY_DISABLE_TRACING
+
+}  // namespace nearby
+}  // namespace location
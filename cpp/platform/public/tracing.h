@@ -0,0 +1,150 @@
+// Copyright 2021 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef PLATFORM_PUBLIC_TRACING_H_
+#define PLATFORM_PUBLIC_TRACING_H_
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <string>
+#include <utility>
+
+#include "absl/base/thread_annotations.h"
+#include "absl/strings/string_view.h"
+#include "absl/time/time.h"
+#include "platform/public/mutex.h"
+
+// Tracing is compiled in unless NEARBY_DISABLE_TRACING is defined; then
+// TraceSpan does nothing and NEARBY_TRACE_SPAN() expands to nothing.
+#ifdef NEARBY_DISABLE_TRACING
+#define NEARBY_TRACE_SPAN(category, name, ...)
+#else
+#define NEARBY_TRACE_CONCAT_INNER(a, b) a##b
+#define NEARBY_TRACE_CONCAT(a, b) NEARBY_TRACE_CONCAT_INNER(a, b)
+// Traces the rest of the enclosing scope, eg.
+//   NEARBY_TRACE_SPAN("pcp", "connect_impl", endpoint_id);
+#define NEARBY_TRACE_SPAN(category, name, ...)                        \
+  ::location::nearby::TraceSpan NEARBY_TRACE_CONCAT(nearby_trace_span_, \
+                                                    __LINE__)(          \
+      category, name, ##__VA_ARGS__)
+#endif
+
+namespace location {
+namespace nearby {
+
+// Collects finished TraceSpans while tracing is on, and exports them in the
+// Chrome trace event format, which chrome://tracing and Perfetto can open.
+// Tracing is off by default; while off, a span costs one atomic load.
+class TraceRecorder {
+ public:
+  // Spans beyond this replace the oldest ones.
+  static constexpr std::size_t kMaxEvents = 16384;
+
+  static TraceRecorder& GetInstance();
+
+  ~TraceRecorder();
+
+  // Drops all recorded spans and starts recording.
+  void Start() ABSL_LOCKS_EXCLUDED(mutex_);
+  // Stops recording; recorded spans are kept for export.
+  void Stop();
+  bool IsEnabled() const {
+    return enabled_.load(std::memory_order_relaxed);
+  }
+
+  // Returns the recorded spans as a JSON trace, with timestamps relative to
+  // the last Start().
+  std::string ExportChromeTrace() const ABSL_LOCKS_EXCLUDED(mutex_);
+  std::size_t GetEventCount() const ABSL_LOCKS_EXCLUDED(mutex_);
+
+ private:
+  friend class TraceSpan;
+
+  struct Event {
+    const char* category;
+    const char* name;
+    std::string endpoint_id;
+    absl::Time start_time;
+    absl::Duration duration;
+    int tid;
+    // Non-zero for spans that don't nest on one thread; see TraceSpan::Async.
+    std::uint64_t async_id;
+  };
+
+  TraceRecorder();
+
+  void Record(Event event) ABSL_LOCKS_EXCLUDED(mutex_);
+  std::uint64_t NextAsyncId() {
+    return next_async_id_.fetch_add(1, std::memory_order_relaxed);
+  }
+
+  std::atomic_bool enabled_{false};
+  std::atomic<std::uint64_t> next_async_id_{1};
+  mutable Mutex mutex_;
+  absl::Time start_time_ ABSL_GUARDED_BY(mutex_);
+  std::deque<Event> events_ ABSL_GUARDED_BY(mutex_);
+};
+
+// Measures one phase of work, from construction to End() or destruction.
+// Spans are only recorded if tracing was on when they started.
+//
+// |category| and |name| must be string literals, or otherwise outlive the
+// recorder; spans are cheap enough to put on connection setup paths, but not
+// in per-byte or per-frame loops.
+class TraceSpan {
+ public:
+  // An empty span, which records nothing.
+  TraceSpan() = default;
+  TraceSpan(const char* category, const char* name,
+            absl::string_view endpoint_id = {});
+  TraceSpan(TraceSpan&& other) { *this = std::move(other); }
+  TraceSpan& operator=(TraceSpan&& other);
+  ~TraceSpan() { End(); }
+
+  // Starts a span that may end on another thread, or overlap other spans of
+  // its thread, eg. a whole connection attempt. Chrome shows it on its own
+  // track.
+  static TraceSpan Async(const char* category, const char* name,
+                         absl::string_view endpoint_id = {});
+
+  // Records the span, if it is active; later calls do nothing.
+  void End();
+
+ private:
+#ifndef NEARBY_DISABLE_TRACING
+  bool active_ = false;
+  const char* category_ = nullptr;
+  const char* name_ = nullptr;
+  std::string endpoint_id_;
+  absl::Time start_time_;
+  int tid_ = 0;
+  std::uint64_t async_id_ = 0;
+#endif
+};
+
+#ifdef NEARBY_DISABLE_TRACING
+inline TraceSpan::TraceSpan(const char*, const char*, absl::string_view) {}
+inline TraceSpan& TraceSpan::operator=(TraceSpan&&) { return *this; }
+inline TraceSpan TraceSpan::Async(const char*, const char*, absl::string_view) {
+  return {};
+}
+inline void TraceSpan::End() {}
+#endif
+
+}  // namespace nearby
+}  // namespace location
+
+#endif  // PLATFORM_PUBLIC_TRACING_H_
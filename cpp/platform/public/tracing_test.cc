@@ -0,0 +1,94 @@
+// Copyright 2021 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "platform/public/tracing.h"
+
+#include <string>
+
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+
+namespace location {
+namespace nearby {
+namespace {
+
+using ::testing::HasSubstr;
+using ::testing::Not;
+
+class TracingTest : public ::testing::Test {
+ protected:
+  void TearDown() override { TraceRecorder::GetInstance().Stop(); }
+};
+
+TEST_F(TracingTest, SpansAreNotRecordedWhileStopped) {
+  TraceRecorder& recorder = TraceRecorder::GetInstance();
+  recorder.Start();
+  recorder.Stop();
+  { NEARBY_TRACE_SPAN("test", "ignored"); }
+
+  EXPECT_EQ(recorder.GetEventCount(), 0);
+}
+
+TEST_F(TracingTest, ExportsScopedSpansAsCompleteEvents) {
+  TraceRecorder& recorder = TraceRecorder::GetInstance();
+  recorder.Start();
+  { NEARBY_TRACE_SPAN("test", "scoped", "ABCD"); }
+
+  std::string trace = recorder.ExportChromeTrace();
+  EXPECT_EQ(recorder.GetEventCount(), 1);
+  EXPECT_THAT(trace, HasSubstr("{\"traceEvents\":[{\"name\":\"scoped\","
+                               "\"cat\":\"test\",\"ph\":\"X\""));
+  EXPECT_THAT(trace, HasSubstr("\"args\":{\"endpoint_id\":\"ABCD\"}"));
+}
+
+TEST_F(TracingTest, ExportsAsyncSpansAsBeginAndEnd) {
+  TraceRecorder& recorder = TraceRecorder::GetInstance();
+  recorder.Start();
+  TraceSpan span = TraceSpan::Async("test", "async");
+  TraceSpan moved = std::move(span);
+  span.End();
+  EXPECT_EQ(recorder.GetEventCount(), 0);
+  moved.End();
+  moved.End();
+
+  std::string trace = recorder.ExportChromeTrace();
+  EXPECT_EQ(recorder.GetEventCount(), 1);
+  EXPECT_THAT(trace, HasSubstr("\"ph\":\"b\""));
+  EXPECT_THAT(trace, HasSubstr("\"ph\":\"e\""));
+  EXPECT_THAT(trace, Not(HasSubstr("\"ph\":\"X\"")));
+}
+
+TEST_F(TracingTest, EscapesEndpointIds) {
+  TraceRecorder& recorder = TraceRecorder::GetInstance();
+  recorder.Start();
+  { NEARBY_TRACE_SPAN("test", "escaped", "a\"b\\"); }
+
+  EXPECT_THAT(recorder.ExportChromeTrace(),
+              HasSubstr("\"endpoint_id\":\"a\\\"b\\\\\""));
+}
+
+TEST_F(TracingTest, StartDropsEarlierSpans) {
+  TraceRecorder& recorder = TraceRecorder::GetInstance();
+  recorder.Start();
+  { NEARBY_TRACE_SPAN("test", "first"); }
+  TraceSpan open_span("test", "open");
+  recorder.Start();
+  open_span.End();
+
+  EXPECT_EQ(recorder.GetEventCount(), 0);
+}
+
+}  // namespace
+}  // namespace nearby
+}  // namespace location
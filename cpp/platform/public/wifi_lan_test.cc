@@ -14,11 +14,16 @@
 
 #include "platform/public/wifi_lan.h"
 
+#include <atomic>
 #include <memory>
+#include <string>
+#include <vector>
 
 #include "gmock/gmock.h"
 #include "gtest/gtest.h"
+#include "absl/strings/str_cat.h"
 #include "absl/strings/string_view.h"
+#include "absl/time/clock.h"
 #include "platform/base/medium_environment.h"
 #include "platform/public/count_down_latch.h"
 #include "platform/public/logging.h"
@@ -385,6 +390,154 @@ TEST_F(WifiLanMediumTest, CanDiscoverThatOtherMediumAdvertise) {
   env_.Stop();
 }
 
+TEST_F(WifiLanMediumTest, ManyMediumsDiscoverEachOther) {
+  constexpr int kMediums = 16;
+  env_.Start({.notification_threads = 4});
+  std::string service_type(kServiceType);
+  std::vector<std::unique_ptr<WifiLanMedium>> mediums;
+  CountDownLatch discovered_latch(kMediums * (kMediums - 1));
+
+  for (int i = 0; i < kMediums; i++) {
+    mediums.push_back(std::make_unique<WifiLanMedium>());
+    // Every advertiser is reported, so use the api medium directly.
+    EXPECT_TRUE(mediums.back()->GetImpl().StartDiscovery(
+        service_type,
+        api::WifiLanMedium::DiscoveredServiceCallback{
+            .service_discovered_cb =
+                [&discovered_latch](NsdServiceInfo service_info) {
+                  discovered_latch.CountDown();
+                },
+        }));
+  }
+  for (int i = 0; i < kMediums; i++) {
+    NsdServiceInfo nsd_service_info;
+    nsd_service_info.SetServiceName(absl::StrCat(kServiceInfoName, i));
+    nsd_service_info.SetServiceType(service_type);
+    EXPECT_TRUE(mediums[i]->StartAdvertising(nsd_service_info));
+  }
+
+  EXPECT_TRUE(discovered_latch.Await(kWaitDuration).result());
+  mediums.clear();
+  env_.Stop();
+}
+
+TEST_F(WifiLanMediumTest, LossyLinkDropsDiscoveryAndConnection) {
+  env_.Start();
+  WifiLanMedium wifi_lan_a;
+  WifiLanMedium wifi_lan_b;
+  WifiLanMedium wifi_lan_c;
+  std::string service_type(kServiceType);
+  env_.SetLinkProperties(wifi_lan_a.GetImpl(), wifi_lan_b.GetImpl(),
+                         {.loss_rate = 1});
+  std::atomic_int discovered_b = 0;
+  CountDownLatch discovered_c_latch(1);
+
+  WifiLanServerSocket server_socket_b = wifi_lan_b.ListenForService();
+  NsdServiceInfo service_info_b;
+  service_info_b.SetServiceName("b");
+  service_info_b.SetServiceType(service_type);
+  service_info_b.SetIPAddress(server_socket_b.GetIPAddress());
+  service_info_b.SetPort(server_socket_b.GetPort());
+  EXPECT_TRUE(wifi_lan_b.StartAdvertising(service_info_b));
+  NsdServiceInfo service_info_c;
+  service_info_c.SetServiceName("c");
+  service_info_c.SetServiceType(service_type);
+  EXPECT_TRUE(wifi_lan_c.StartAdvertising(service_info_c));
+  EXPECT_TRUE(wifi_lan_a.GetImpl().StartDiscovery(
+      service_type,
+      api::WifiLanMedium::DiscoveredServiceCallback{
+          .service_discovered_cb =
+              [&discovered_b, &discovered_c_latch](
+                  NsdServiceInfo service_info) {
+                if (service_info.GetServiceName() == "b") discovered_b++;
+                if (service_info.GetServiceName() == "c") {
+                  discovered_c_latch.CountDown();
+                }
+              },
+      }));
+
+  EXPECT_TRUE(discovered_c_latch.Await(kWaitDuration).result());
+  env_.Sync();
+  EXPECT_EQ(discovered_b, 0);
+  CancellationFlag flag;
+  EXPECT_FALSE(wifi_lan_a.ConnectToService(service_info_b, &flag).IsValid());
+  server_socket_b.Close();
+  env_.Stop();
+}
+
+TEST_F(WifiLanMediumTest, LinkLatencyDelaysDiscovery) {
+  constexpr absl::Duration kLatency = absl::Milliseconds(100);
+  env_.Start({.link_properties = {.latency = kLatency}});
+  WifiLanMedium wifi_lan_a;
+  WifiLanMedium wifi_lan_b;
+  std::string service_id(kServiceId);
+  std::string service_type(kServiceType);
+  CountDownLatch discovered_latch(1);
+
+  wifi_lan_a.StartDiscovery(
+      service_id, service_type,
+      DiscoveredServiceCallback{
+          .service_discovered_cb =
+              [&discovered_latch](NsdServiceInfo service_info,
+                                  const std::string& service_id) {
+                discovered_latch.CountDown();
+              },
+      });
+  NsdServiceInfo nsd_service_info;
+  nsd_service_info.SetServiceName(std::string(kServiceInfoName));
+  nsd_service_info.SetServiceType(service_type);
+  absl::Time start_time = absl::Now();
+  EXPECT_TRUE(wifi_lan_b.StartAdvertising(nsd_service_info));
+
+  EXPECT_TRUE(discovered_latch.Await(kWaitDuration).result());
+  EXPECT_GE(absl::Now() - start_time, kLatency);
+  env_.Stop();
+}
+
+TEST_F(WifiLanMediumTest, SlowLinkDoesNotDelayOtherLinks) {
+  constexpr absl::Duration kLatency = absl::Seconds(2);
+  // Every medium is notified by the same thread.
+  env_.Start({.notification_threads = 1});
+  WifiLanMedium wifi_lan_a;
+  WifiLanMedium wifi_lan_b;
+  WifiLanMedium wifi_lan_c;
+  std::string service_type(kServiceType);
+  env_.SetLinkProperties(wifi_lan_a.GetImpl(), wifi_lan_b.GetImpl(),
+                         {.latency = kLatency});
+  CountDownLatch discovered_b_latch(1);
+  CountDownLatch discovered_c_latch(1);
+
+  EXPECT_TRUE(wifi_lan_a.GetImpl().StartDiscovery(
+      service_type,
+      api::WifiLanMedium::DiscoveredServiceCallback{
+          .service_discovered_cb =
+              [&discovered_b_latch,
+               &discovered_c_latch](NsdServiceInfo service_info) {
+                if (service_info.GetServiceName() == "b") {
+                  discovered_b_latch.CountDown();
+                }
+                if (service_info.GetServiceName() == "c") {
+                  discovered_c_latch.CountDown();
+                }
+              },
+      }));
+  absl::Time start_time = absl::Now();
+  NsdServiceInfo service_info_b;
+  service_info_b.SetServiceName("b");
+  service_info_b.SetServiceType(service_type);
+  EXPECT_TRUE(wifi_lan_b.StartAdvertising(service_info_b));
+  NsdServiceInfo service_info_c;
+  service_info_c.SetServiceName("c");
+  service_info_c.SetServiceType(service_type);
+  EXPECT_TRUE(wifi_lan_c.StartAdvertising(service_info_c));
+
+  // c is found while the notification about b is still on its way.
+  EXPECT_TRUE(discovered_c_latch.Await(kLatency / 2).result());
+  EXPECT_TRUE(discovered_b_latch.Await(kLatency + kWaitDuration).result());
+  EXPECT_GE(absl::Now() - start_time, kLatency);
+  env_.Stop();
+}
+
 }  // namespace
 }  // namespace nearby
 }  // namespace location